@@ -0,0 +1,702 @@
+// Microbenchmarks of the simulation and rendering hot paths, each one is timed on its own and reported as JSON
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Config.h"
+#include "Format.h"
+#include "common/WorkerPool.h"
+#include "common/tpt-rand.h"
+#include "graphics/FrameCapture.h"
+#include "graphics/Graphics.h"
+#include "graphics/Renderer.h"
+#include "font.h"
+#include "simulation/Air.h"
+#include "simulation/ElementGraphics.h"
+#include "simulation/Gravity.h"
+#include "simulation/Scenes.h"
+#include "simulation/Simulation.h"
+
+namespace
+{
+	struct Options
+	{
+		int warmup;
+		int repetitions;
+		unsigned int seed;
+		const char * filter;
+		bool list;
+	};
+
+	struct Benchmark
+	{
+		ByteString name;
+		// How many operations a single run does, the results are reported per operation
+		int operations;
+		// Called once before the warmup
+		std::function<void()> setup;
+		// Called before every run, not timed
+		std::function<void()> prepare;
+		std::function<void()> run;
+	};
+
+	struct Position
+	{
+		int x, y;
+	};
+
+	// Sink for results that would otherwise be optimised away
+	volatile unsigned int sink;
+
+	void Usage(const char * name)
+	{
+		fprintf(stderr, "Usage: %s [--warmup N] [--repetitions N] [--seed N] [--filter TEXT] [--list]\n", name);
+		fprintf(stderr, "  --filter   only run the benchmarks with TEXT in their name\n");
+	}
+
+	bool ParseArguments(int argc, char * argv[], Options & options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			bool hasValue = i+1 < argc;
+			if (!strcmp(argv[i], "--warmup") && hasValue)
+				options.warmup = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--repetitions") && hasValue)
+				options.repetitions = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--seed") && hasValue)
+				options.seed = strtoul(argv[++i], NULL, 10);
+			else if (!strcmp(argv[i], "--filter") && hasValue)
+				options.filter = argv[++i];
+			else if (!strcmp(argv[i], "--list"))
+				options.list = true;
+			else
+				return false;
+		}
+		return options.warmup >= 0 && options.repetitions > 0;
+	}
+
+	std::vector<Position> RandomPositions(int count, int x1, int y1, int x2, int y2)
+	{
+		std::vector<Position> positions(count);
+		for (int i = 0; i < count; i++)
+		{
+			positions[i].x = RNG::Ref().between(x1, x2);
+			positions[i].y = RNG::Ref().between(y1, y2);
+		}
+		return positions;
+	}
+
+	double Median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		size_t middle = values.size()/2;
+		return values.size() % 2 ? values[middle] : (values[middle-1] + values[middle])/2;
+	}
+
+	class Suite
+	{
+		Simulation * sim;
+		Renderer * ren;
+		WorkerPool * workers;
+		unsigned int seed;
+		std::vector<Benchmark> benchmarks;
+
+		// Shared state of the benchmark that is currently running
+		std::vector<Position> positions;
+		std::vector<int> ids;
+		std::vector<float> savedAir;
+		std::vector<unsigned char> savedFire;
+		std::unique_ptr<FrameCapture> capture;
+
+		void Add(ByteString name, int operations, std::function<void()> setup, std::function<void()> run, std::function<void()> prepare = std::function<void()>())
+		{
+			Benchmark benchmark = { name, operations, setup, prepare, run };
+			benchmarks.push_back(benchmark);
+		}
+
+		void Clear()
+		{
+			sim->clear_sim();
+			RNG::Ref().seed(seed);
+		}
+
+		void AddMovement()
+		{
+			const int count = 4096;
+			// Mix of movers so that more than a single row of the can_move table is used
+			const int movers[] = { PT_SAND, PT_WATR, PT_GAS, PT_PHOT };
+
+			auto evalMove = [this, movers]() {
+				unsigned int total = 0, r;
+				for (size_t i = 0; i < positions.size(); i++)
+					total += sim->eval_move(movers[i%4], positions[i].x, positions[i].y, &r) + r;
+				sink = total;
+			};
+			Add("eval_move/empty", count, [this, count]() {
+				Clear();
+				positions = RandomPositions(count, CELL, CELL, XRES-CELL-1, YRES-CELL-1);
+			}, evalMove);
+			Add("eval_move/liquid", count, [this, count]() {
+				Scenes::Build(sim, "water-tank", seed);
+				positions = RandomPositions(count, CELL, YRES/4, XRES-CELL-1, YRES-CELL-1);
+			}, evalMove);
+			Add("eval_move/walls", count, [this, count]() {
+				Clear();
+				const int walls[] = { WL_WALL, WL_ALLOWLIQUID, WL_ALLOWPOWDER, WL_ALLOWGAS, WL_ALLOWENERGY, WL_EHOLE };
+				for (int x = 0; x < XRES/CELL; x++)
+					sim->CreateWallBox(x*CELL, 0, x*CELL, YRES-1, walls[x%6]);
+				positions = RandomPositions(count, CELL, CELL, XRES-CELL-1, YRES-CELL-1);
+			}, evalMove);
+			Add("eval_move/mixed", count, [this, count]() {
+				Scenes::Build(sim, "full-pack", seed);
+				positions = RandomPositions(count, CELL, CELL, XRES-CELL-1, YRES-CELL-1);
+			}, evalMove);
+
+			// SAND trying to move into STNE, eval_move says no and nothing changes
+			Add("try_move/blocked", count, [this, count]() {
+				Clear();
+				sim->CreateBox(CELL, CELL, XRES-CELL-1, YRES-CELL-1, PT_STNE);
+				positions = RandomPositions(count, CELL, CELL, XRES-CELL-1, YRES-CELL-2);
+				ids.clear();
+				for (size_t i = 0; i < positions.size(); i++)
+				{
+					sim->delete_part(positions[i].x, positions[i].y);
+					ids.push_back(sim->create_part(-1, positions[i].x, positions[i].y, PT_SAND));
+				}
+			}, [this]() {
+				unsigned int total = 0;
+				for (size_t i = 0; i < positions.size(); i++)
+					if (ids[i] >= 0)
+						total += sim->try_move(ids[i], positions[i].x, positions[i].y, positions[i].x, positions[i].y+1);
+				sink = total;
+			});
+
+			// Pairs of SAND above WATR, the SAND swaps down and then back up
+			auto pairs = [this](int top, int bottom) {
+				Clear();
+				positions.clear();
+				ids.clear();
+				for (int y = CELL; y < YRES-CELL-1 && positions.size() < 2048; y += 4)
+					for (int x = CELL; x < XRES-CELL && positions.size() < 2048; x += 2)
+					{
+						Position position = { x, y };
+						positions.push_back(position);
+						ids.push_back(sim->create_part(-1, x, y, top));
+						if (bottom)
+							sim->create_part(-1, x, y+1, bottom);
+					}
+			};
+			auto moveDownAndUp = [this]() {
+				unsigned int total = 0;
+				for (size_t i = 0; i < positions.size(); i++)
+				{
+					int x = positions[i].x, y = positions[i].y;
+					total += sim->do_move(ids[i], x, y, (float)x, (float)(y+1));
+					total += sim->do_move(ids[i], x, y+1, (float)x, (float)y);
+				}
+				sink = total;
+			};
+			Add("do_move/empty", 4096, [pairs]() { pairs(PT_SAND, 0); }, moveDownAndUp);
+			Add("do_move/swap", 4096, [pairs]() { pairs(PT_SAND, PT_WATR); }, moveDownAndUp);
+		}
+
+		void AddParticles()
+		{
+			const int count = 4096;
+			Add("create_kill", count*2, [this, count]() {
+				Scenes::Build(sim, "avalanche", seed);
+				// Only empty positions, so that every create_part succeeds
+				positions.clear();
+				while ((int)positions.size() < count)
+				{
+					Position position = RandomPositions(1, CELL, CELL, XRES-CELL-1, YRES-CELL-1)[0];
+					if (!sim->pmap[position.y][position.x] && !sim->bmap[position.y/CELL][position.x/CELL])
+						positions.push_back(position);
+				}
+				ids.resize(count);
+			}, [this]() {
+				for (size_t i = 0; i < positions.size(); i++)
+					ids[i] = sim->create_part(-1, positions[i].x, positions[i].y, PT_DUST);
+				for (size_t i = 0; i < positions.size(); i++)
+					if (ids[i] >= 0)
+						sim->kill_part(ids[i]);
+			});
+			Add("RecalcFreeParticles", 1, [this]() {
+				Scenes::Build(sim, "full-pack", seed);
+			}, [this]() {
+				sim->RecalcFreeParticles(false);
+			});
+		}
+
+		void SaveAir()
+		{
+			const int size = (XRES/CELL)*(YRES/CELL);
+			savedAir.resize(size*4);
+			std::copy(&sim->air->pv[0][0], &sim->air->pv[0][0]+size, savedAir.begin());
+			std::copy(&sim->air->vx[0][0], &sim->air->vx[0][0]+size, savedAir.begin()+size);
+			std::copy(&sim->air->vy[0][0], &sim->air->vy[0][0]+size, savedAir.begin()+size*2);
+			std::copy(&sim->air->hv[0][0], &sim->air->hv[0][0]+size, savedAir.begin()+size*3);
+		}
+
+		void RestoreAir()
+		{
+			const int size = (XRES/CELL)*(YRES/CELL);
+			std::copy(savedAir.begin(), savedAir.begin()+size, &sim->air->pv[0][0]);
+			std::copy(savedAir.begin()+size, savedAir.begin()+size*2, &sim->air->vx[0][0]);
+			std::copy(savedAir.begin()+size*2, savedAir.begin()+size*3, &sim->air->vy[0][0]);
+			std::copy(savedAir.begin()+size*3, savedAir.end(), &sim->air->hv[0][0]);
+		}
+
+		void AddFields()
+		{
+			// Air starts from the same random pressure, velocity and heat every run, so that it never settles
+			auto airSetup = [this]() {
+				Scenes::Build(sim, "gas-cloud", seed);
+				for (int y = 0; y < YRES/CELL; y++)
+					for (int x = 0; x < XRES/CELL; x++)
+					{
+						sim->air->pv[y][x] = RNG::Ref().uniform01()*20.0f - 10.0f;
+						sim->air->vx[y][x] = RNG::Ref().uniform01()*4.0f - 2.0f;
+						sim->air->vy[y][x] = RNG::Ref().uniform01()*4.0f - 2.0f;
+						sim->air->hv[y][x] = RNG::Ref().uniform01()*1000.0f;
+					}
+				SaveAir();
+			};
+			Add("air/update_air", 1, airSetup, [this]() { sim->air->update_air(); }, [this]() { RestoreAir(); });
+			Add("air/update_airh", 1, airSetup, [this]() { sim->air->update_airh(); }, [this]() { RestoreAir(); });
+
+			// Some blobs of mass, the direct sum is quadratic in the number of cells with mass so keep it small
+			auto gravSetup = [this]() {
+				Clear();
+				for (int i = 0; i < 4; i++)
+				{
+					int cx = RNG::Ref().between(4, XRES/CELL-8), cy = RNG::Ref().between(4, YRES/CELL-8);
+					for (int y = cy; y < cy+2; y++)
+						for (int x = cx; x < cx+2; x++)
+							sim->grav->gravmap[y*(XRES/CELL)+x] = RNG::Ref().uniform01()*5.0f;
+				}
+			};
+			Add("gravity/direct", 1, gravSetup, [this]() { sim->grav->update_grav_sync(false); });
+#ifdef GRAVFFT
+			Add("gravity/fft", 1, gravSetup, [this]() { sim->grav->update_grav_sync(true); });
+#endif
+		}
+
+		void AddRendering()
+		{
+			struct Mode
+			{
+				const char * name;
+				unsigned int mode;
+			};
+			const Mode modes[] = {
+				{ "basic", RENDER_BASC },
+				{ "fire", RENDER_FIRE },
+				{ "spark", RENDER_SPRK },
+				{ "glow", RENDER_GLOW },
+				{ "blur", RENDER_BLUR },
+				{ "blob", RENDER_BLOB },
+				{ "effects", RENDER_EFFE },
+				{ "none", RENDER_NONE },
+			};
+			for (size_t i = 0; i < sizeof(modes)/sizeof(modes[0]); i++)
+			{
+				unsigned int mode = modes[i].mode;
+				// On the calling thread, and split into bands drawn by the worker threads
+				for (int threaded = 0; threaded < 2; threaded++)
+				{
+					WorkerPool * pool = threaded ? workers : NULL;
+					Add(ByteString("render_parts/") + modes[i].name + (threaded ? "/threads" : ""), 1, [this, mode, pool]() {
+						Scenes::Build(sim, "lava", seed);
+						ren->SetRenderMode(std::vector<unsigned int>(1, mode));
+						ren->SetColourMode(COLOUR_DEFAULT);
+						ren->SetDisplayMode(std::vector<unsigned int>());
+						ren->SetWorkerPool(pool);
+					}, [this]() {
+						ren->render_parts();
+					}, [this]() {
+						ren->clearScreen(1.0f);
+					});
+				}
+			}
+			// A single portal, which only draws across the whole screen with debug lines on and the mouse over it
+			Add("render_parts/portal/threads", 1, [this]() {
+				Scenes::Build(sim, "lava", seed);
+				sim->create_part(-1, XRES/2, 8, PT_PRTI);
+				ren->SetRenderMode(std::vector<unsigned int>(1, RENDER_EFFE));
+				ren->SetColourMode(COLOUR_DEFAULT);
+				ren->SetDisplayMode(std::vector<unsigned int>());
+				ren->SetWorkerPool(workers);
+			}, [this]() {
+				ren->render_parts();
+			}, [this]() {
+				ren->clearScreen(1.0f);
+			});
+
+			// The presets that have a copy of render_parts of their own, against the copy that handles any mode.
+			// "default" is the mode GameModel starts the game in, "renderer" the one a new Renderer starts in
+			struct Preset
+			{
+				const char * name;
+				unsigned int renderModes[4];
+				unsigned int colourMode;
+			};
+			const Preset presets[] = {
+				{ "default", { RENDER_FIRE, RENDER_EFFE, RENDER_BASC }, COLOUR_DEFAULT },
+				{ "renderer", { RENDER_FIRE, RENDER_SPRK, RENDER_BASC }, COLOUR_DEFAULT },
+				{ "velocity", { RENDER_EFFE, RENDER_BASC }, COLOUR_DEFAULT },
+				{ "fire", { RENDER_FIRE, RENDER_SPRK, RENDER_EFFE, RENDER_BASC }, COLOUR_DEFAULT },
+				{ "heat", { RENDER_BASC }, COLOUR_HEAT },
+				{ "nothing", { RENDER_BASC }, COLOUR_DEFAULT },
+			};
+			for (size_t i = 0; i < sizeof(presets)/sizeof(presets[0]); i++)
+			{
+				std::vector<unsigned int> renderModes;
+				for (int j = 0; j < 4 && presets[i].renderModes[j]; j++)
+					renderModes.push_back(presets[i].renderModes[j]);
+				unsigned int colourMode = presets[i].colourMode;
+				for (int specialised = 1; specialised >= 0; specialised--)
+				{
+					Add(ByteString("render_parts/preset/") + presets[i].name + (specialised ? "" : "/generic"), 1, [this, renderModes, colourMode]() {
+						Scenes::Build(sim, "lava", seed);
+						ren->SetRenderMode(renderModes);
+						ren->SetColourMode(colourMode);
+						ren->SetDisplayMode(std::vector<unsigned int>());
+						ren->SetWorkerPool(NULL);
+					}, [this, specialised]() {
+						ren->specialisedParts = specialised;
+						ren->render_parts();
+						ren->specialisedParts = true;
+					}, [this]() {
+						ren->clearScreen(1.0f);
+					});
+				}
+			}
+
+			// The colour modes that map temperature and life to colours, and the air heat display
+			const struct
+			{
+				const char * name;
+				unsigned int colourMode;
+			} colourModes[] = {
+				{ "heat", COLOUR_HEAT },
+				{ "life", COLOUR_LIFE },
+			};
+			for (size_t i = 0; i < sizeof(colourModes)/sizeof(colourModes[0]); i++)
+			{
+				unsigned int colourMode = colourModes[i].colourMode;
+				Add(ByteString("render_parts/colour/") + colourModes[i].name, 1, [this, colourMode]() {
+					Scenes::Build(sim, "lava", seed);
+					ren->SetRenderMode(std::vector<unsigned int>(1, RENDER_BASC));
+					ren->SetColourMode(colourMode);
+					ren->SetDisplayMode(std::vector<unsigned int>());
+					ren->SetWorkerPool(NULL);
+				}, [this]() {
+					ren->render_parts();
+				}, [this]() {
+					ren->clearScreen(1.0f);
+				});
+			}
+			// Scenes full of elements whose look depends on their state, see Element::GraphicsState
+			const char * stateScenes[] = { "prism", "reactor", "lava" };
+			for (size_t i = 0; i < sizeof(stateScenes)/sizeof(stateScenes[0]); i++)
+			{
+				ByteString scene = stateScenes[i];
+				Add(ByteString("render_parts/scene/") + scene, 1, [this, scene]() {
+					Scenes::Build(sim, scene, seed);
+					for (int tick = 0; tick < 20; tick++)
+						sim->TickSerial();
+					ren->SetRenderMode(std::vector<unsigned int>(1, RENDER_BASC));
+					ren->SetColourMode(COLOUR_DEFAULT);
+					ren->SetDisplayMode(std::vector<unsigned int>());
+					ren->SetWorkerPool(NULL);
+				}, [this]() {
+					ren->render_parts();
+				}, [this]() {
+					ren->clearScreen(1.0f);
+				});
+			}
+			// The paused runs draw air that hasn't changed since the run before, so only the blowing up is left
+			const char * airNames[] = { "pressure", "velocity", "heat", "cracker" };
+			const unsigned int airModes[] = { DISPLAY_AIRP, DISPLAY_AIRV, DISPLAY_AIRH, DISPLAY_AIRC };
+			for (int paused = 0; paused < 2; paused++)
+				for (int m = 0; m < 4; m++)
+				{
+					unsigned int mode = airModes[m];
+					Add(ByteString("draw_air/") + airNames[m] + (paused ? "/paused" : ""), 1, [this, mode]() {
+						Scenes::Build(sim, "lava", seed);
+						ren->SetDisplayMode(std::vector<unsigned int>(1, mode));
+					}, [this, paused]() {
+						// The heat display only draws with ambient heat on, which would change the simulation for later runs
+						int aheat = sim->aheat_enable;
+						sim->aheat_enable = 1;
+						ren->reuseAirColours = paused;
+						ren->draw_air();
+						ren->reuseAirColours = true;
+						sim->aheat_enable = aheat;
+					});
+				}
+		}
+
+		// The passes over the whole frame that follow the particles
+		void AddPostPasses()
+		{
+			const size_t fireSize = sizeof(ren->fire_r);
+			for (int threaded = 0; threaded < 2; threaded++)
+			{
+				WorkerPool * pool = threaded ? workers : NULL;
+				ByteString suffix = threaded ? "/threads" : "";
+				auto renderFrame = [this, pool](unsigned int mode) {
+					Scenes::Build(sim, "lava", seed);
+					ren->SetRenderMode(std::vector<unsigned int>(1, mode));
+					ren->SetColourMode(COLOUR_DEFAULT);
+					ren->SetDisplayMode(std::vector<unsigned int>());
+					ren->SetWorkerPool(pool);
+					ren->clearScreen(1.0f);
+					ren->render_parts();
+				};
+				// Fire fades as it is drawn, so every run starts from the same fire
+				Add(ByteString("render_fire") + suffix, 1, [this, renderFrame, fireSize]() {
+					renderFrame(RENDER_FIRE);
+					savedFire.resize(fireSize*3);
+					memcpy(&savedFire[0], ren->fire_r, fireSize);
+					memcpy(&savedFire[fireSize], ren->fire_g, fireSize);
+					memcpy(&savedFire[fireSize*2], ren->fire_b, fireSize);
+				}, [this]() {
+					ren->render_fire();
+				}, [this, fireSize]() {
+					memcpy(ren->fire_r, &savedFire[0], fireSize);
+					memcpy(ren->fire_g, &savedFire[fireSize], fireSize);
+					memcpy(ren->fire_b, &savedFire[fireSize*2], fireSize);
+				});
+				Add(ByteString("StorePersistent") + suffix, 1, [renderFrame]() {
+					renderFrame(RENDER_BASC);
+				}, [this]() {
+					ren->StorePersistent();
+				});
+				Add(ByteString("render_gravlensing") + suffix, 1, [this, renderFrame]() {
+					renderFrame(RENDER_BASC);
+					std::copy(ren->vid, ren->vid + WINDOWW*WINDOWH, ren->warpVid);
+					for (int y = 0; y < YRES/CELL; y++)
+						for (int x = 0; x < XRES/CELL; x++)
+						{
+							sim->gravx[y*(XRES/CELL)+x] = 8.0f*std::sin(x*0.1f + y*0.05f);
+							sim->gravy[y*(XRES/CELL)+x] = 8.0f*std::cos(x*0.07f - y*0.1f);
+						}
+				}, [this]() {
+					ren->render_gravlensing(ren->warpVid);
+				});
+			}
+		}
+
+		void AddCapture()
+		{
+			auto renderFrame = [this]() {
+				Scenes::Build(sim, "lava", seed);
+				ren->clearScreen(1.0f);
+				ren->render_parts();
+			};
+			// What the main thread pays per recorded frame when it encodes the frame itself
+			Add("capture/dump_ppm", 1, renderFrame, [this]() {
+				VideoBuffer frame(ren->DumpFrame());
+				sink = format::VideoBufferToPPM(frame).size();
+			});
+			// And when it hands the frame over to the capture writer, which is given time to catch up between
+			// runs so that no frame is dropped
+#ifdef WIN
+			const char * nullDevice = "NUL";
+#else
+			const char * nullDevice = "/dev/null";
+#endif
+			Add("capture/ring", 1, [this, renderFrame, nullDevice]() {
+				renderFrame();
+				ByteString error;
+				capture.reset(new FrameCapture(nullDevice, FrameCapture::RawStream, XRES, YRES));
+				if (!capture->Start(error))
+					fprintf(stderr, "%s\n", error.c_str());
+			}, [this]() {
+				capture->Capture(ren->vid, WINDOWW);
+			}, [this]() {
+				while (capture->GetStats().written < capture->GetStats().captured)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			});
+		}
+
+		// The software drawing methods that UI panels, overlays and text go through
+		void AddRaster()
+		{
+			auto clear = [this]() {
+				ren->clearScreen(1.0f);
+			};
+			Add("raster/fillrect", 1, clear, [this]() {
+				ren->fillrect(0, 0, XRES, YRES, 40, 80, 160, 128);
+			});
+			Add("raster/fillrect/opaque", 1, clear, [this]() {
+				ren->fillrect(0, 0, XRES, YRES, 40, 80, 160, 255);
+			});
+			const int lines = 256;
+			Add("raster/draw_line", lines, clear, [this, lines]() {
+				for (int i = 0; i < lines; i++)
+					ren->draw_line(0, i, XRES-1, i + (i%3)*8, 200, 200, 200, 100);
+			});
+			std::shared_ptr<std::vector<pixel> > image = std::make_shared<std::vector<pixel> >(XRES*YRES);
+			for (int i = 0; i < XRES*YRES; i++)
+				(*image)[i] = PIXRGB(i%256, (i/XRES)%256, (i*7)%256);
+			Add("raster/draw_image", 1, clear, [this, image]() {
+				ren->draw_image(image->data(), 0, 0, XRES, YRES, 128);
+			});
+			const int texts = 64;
+			Add("raster/drawtext", texts, clear, [this, texts]() {
+				for (int i = 0; i < texts; i++)
+					ren->drawtext(4, 4 + i*FONT_H, "The quick brown fox jumps over the lazy dog 0123456789", 255, 255, 255, 200);
+			});
+			// Like the HUD and the tooltips, already formatted and changing colour part of the way through
+			std::shared_ptr<String> label = std::make_shared<String>("\bgTemp: \bw1234.56 C, \bgPressure: \bw-3.14, \bgLife: \bw150");
+			Add("raster/drawtext/outline", texts, clear, [this, texts, label]() {
+				for (int i = 0; i < texts; i++)
+					ren->drawtext_outline(4, 4 + i*FONT_H, *label, 255, 255, 255, 200);
+			});
+			Add("raster/textwidth", texts, clear, [this, texts, label]() {
+				unsigned int total = 0;
+				for (int i = 0; i < texts; i++)
+					total += Graphics::textwidth(*label);
+				sink = total;
+			});
+		}
+
+		// Resampling a frame the way thumbnails are made and the way the window is scaled up
+		void AddResample()
+		{
+			for (int threaded = 0; threaded < 2; threaded++)
+			{
+				WorkerPool * pool = threaded ? workers : NULL;
+				ByteString suffix = threaded ? "/threads" : "";
+				auto renderFrame = [this]() {
+					Scenes::Build(sim, "lava", seed);
+					ren->clearScreen(1.0f);
+					ren->render_parts();
+				};
+				Add(ByteString("resample/thumbnail") + suffix, 1, renderFrame, [this, pool]() {
+					delete[] Graphics::resample_img(ren->vid, WINDOWW, YRES, WINDOWW/4, YRES/4, pool);
+				});
+				Add(ByteString("resample/scale") + suffix, 1, renderFrame, [this, pool]() {
+					delete[] Graphics::resample_img(ren->vid, WINDOWW, YRES, WINDOWW*2, YRES*2, pool);
+				});
+			}
+		}
+
+		void AddRandom()
+		{
+			const int count = 1<<16;
+			Add("RNG::chance", count, [this]() {
+				RNG::Ref().seed(seed);
+			}, [count]() {
+				unsigned int total = 0;
+				for (int i = 0; i < count; i++)
+					total += RNG::Ref().chance(1, 3);
+				sink = total;
+			});
+		}
+
+	public:
+		Suite(Simulation * sim, Renderer * ren, WorkerPool * workers, unsigned int seed):
+			sim(sim),
+			ren(ren),
+			workers(workers),
+			seed(seed)
+		{
+			AddMovement();
+			AddParticles();
+			AddFields();
+			AddRendering();
+			AddPostPasses();
+			AddCapture();
+			AddRaster();
+			AddResample();
+			AddRandom();
+		}
+
+		const std::vector<Benchmark> & Benchmarks() const
+		{
+			return benchmarks;
+		}
+
+		// Runs one benchmark and prints its results, returns the time per operation of every repetition in nanoseconds
+		std::vector<double> Run(const Benchmark & benchmark, int warmup, int repetitions)
+		{
+			benchmark.setup();
+			std::vector<double> times;
+			for (int i = 0; i < warmup + repetitions; i++)
+			{
+				if (benchmark.prepare)
+					benchmark.prepare();
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				benchmark.run();
+				std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+				if (i >= warmup)
+					times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / benchmark.operations);
+			}
+			return times;
+		}
+	};
+}
+
+int main(int argc, char * argv[])
+{
+	Options options = { 5, 30, 0, NULL, false };
+	if (!ParseArguments(argc, argv, options))
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	Simulation * sim = new Simulation();
+	Graphics * g = new Graphics();
+	Renderer * ren = new Renderer(g, sim);
+	WorkerPool * workers = new WorkerPool(THRDS);
+	Suite suite(sim, ren, workers, options.seed);
+
+	std::vector<const Benchmark *> selected;
+	for (size_t i = 0; i < suite.Benchmarks().size(); i++)
+		if (!options.filter || suite.Benchmarks()[i].name.Contains(options.filter))
+			selected.push_back(&suite.Benchmarks()[i]);
+	if (options.list)
+	{
+		for (size_t i = 0; i < selected.size(); i++)
+			printf("%s\n", selected[i]->name.c_str());
+		return 0;
+	}
+
+	printf("{\n");
+	printf("\t\"warmup\": %d,\n\t\"repetitions\": %d,\n\t\"seed\": %u,\n", options.warmup, options.repetitions, options.seed);
+	printf("\t\"benchmarks\": [\n");
+	for (size_t i = 0; i < selected.size(); i++)
+	{
+		std::vector<double> times = suite.Run(*selected[i], options.warmup, options.repetitions);
+		double mean = 0, variance = 0;
+		for (size_t j = 0; j < times.size(); j++)
+			mean += times[j];
+		mean /= times.size();
+		for (size_t j = 0; j < times.size(); j++)
+			variance += (times[j] - mean) * (times[j] - mean);
+		double stddev = times.size() > 1 ? std::sqrt(variance / (times.size() - 1)) : 0;
+		printf("\t\t{ \"name\": \"%s\", \"operations\": %d, \"ns_per_op\": { \"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f } }%s\n",
+			selected[i]->name.c_str(), selected[i]->operations, *std::min_element(times.begin(), times.end()), Median(times), mean, stddev,
+			i+1 < selected.size() ? "," : "");
+		fflush(stdout);
+	}
+	printf("\t]\n");
+	printf("}\n");
+
+	delete workers;
+	delete ren;
+	delete g;
+	delete sim;
+	return 0;
+}
@@ -0,0 +1,207 @@
+// Headless replay player. Runs an input replay recorded in the game as fast as the simulation goes and
+// reports where, if anywhere, it stopped matching the hashes stored in the recording.
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "common/String.h"
+#include "graphics/Graphics.h"
+#include "graphics/Renderer.h"
+#include "simulation/Replay.h"
+#include "simulation/Simulation.h"
+
+namespace
+{
+	struct Options
+	{
+		const char * path;
+		int seek;
+		int keyframes;
+		bool roundTrip;
+	};
+
+	void Usage(const char * name)
+	{
+		fprintf(stderr, "Usage: %s FILE [--seek N] [--keyframes N]\n", name);
+		fprintf(stderr, "       %s --roundtrip FILE\n", name);
+		fprintf(stderr, "  --seek       play up to frame N, then seek back to frame 0 and forward again to check seeking\n");
+		fprintf(stderr, "  --keyframes  keep the state every N frames while playing, 0 to keep none\n");
+		fprintf(stderr, "  --roundtrip  record a replay to FILE while drawing every frame like the game does, then check\n");
+		fprintf(stderr, "               that playing it back without drawing and seeking around in it end up the same\n");
+	}
+
+	bool ParseArguments(int argc, char * argv[], Options & options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			bool hasValue = i+1 < argc;
+			if (!strcmp(argv[i], "--seek") && hasValue)
+				options.seek = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--keyframes") && hasValue)
+				options.keyframes = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--roundtrip"))
+				options.roundTrip = true;
+			else if (argv[i][0] != '-' && !options.path)
+				options.path = argv[i];
+			else
+				return false;
+		}
+		return options.path && options.keyframes >= 0;
+	}
+
+	const int ROUND_TRIP_TICKS = 120;
+	const int ROUND_TRIP_PAUSE_START = 50, ROUND_TRIP_PAUSE_END = 60;
+	const int ROUND_TRIP_KEYFRAMES = 20;
+
+	// Records GOLD and EXOT, which both look different every time they are drawn, with a frame drawn after every
+	// tick, and a pause in the middle that only the replay's settings know about. Playing it back draws nothing,
+	// so this only ends up on the same state if drawing doesn't touch the simulation, and seeking back to before
+	// the pause from inside of it only does if the settings are put back with the keyframe. Seeking all the way back
+	// has to end up on the state the recording started from.
+	int RoundTrip(const char * path)
+	{
+		ByteString error;
+		Simulation * sim = new Simulation();
+		Graphics * g = new Graphics();
+		Renderer * ren = new Renderer(g, sim);
+		ren->SetRenderMode(std::vector<unsigned int>(1, RENDER_BASC));
+		ren->SetColourMode(COLOUR_DEFAULT);
+		ren->SetDisplayMode(std::vector<unsigned int>());
+		for (int x = 100; x < 300; x++)
+		{
+			sim->create_part(-1, x, 100, PT_GOLD);
+			int i = sim->create_part(-1, x, 150, PT_EXOT);
+			if (i >= 0)
+			{
+				sim->parts[i].life = 500;
+				sim->parts[i].tmp2 = 500;
+			}
+			sim->create_part(-1, x, 50, PT_SAND);
+		}
+
+		sim->recorder = new ReplayRecorder(sim, 1);
+		for (int tick = 0; tick < ROUND_TRIP_TICKS; tick++)
+		{
+			if (tick == ROUND_TRIP_PAUSE_START || tick == ROUND_TRIP_PAUSE_END)
+				sim->sys_pause = tick == ROUND_TRIP_PAUSE_START;
+			sim->Tick(NULL);
+			ren->clearScreen(1.0f);
+			ren->RenderBegin();
+			ren->RenderEnd();
+		}
+		uint64_t recorded = Replay::Hash(sim);
+		bool saved = sim->recorder->Save(path, error);
+		delete sim->recorder;
+		sim->recorder = NULL;
+		delete ren;
+		delete g;
+		delete sim;
+		if (!saved)
+		{
+			fprintf(stderr, "%s: %s\n", path, error.c_str());
+			return 1;
+		}
+
+		sim = new Simulation();
+		ReplayPlayer * player = new ReplayPlayer(sim);
+		player->SetKeyframeInterval(ROUND_TRIP_KEYFRAMES);
+		int status = 0;
+		bool loaded = player->Load(path, error);
+		uint64_t start = Replay::Hash(sim);
+		if (!loaded || !player->Seek(player->GetFrameCount(), error))
+		{
+			fprintf(stderr, "%s: %s\n", path, error.c_str());
+			status = 1;
+		}
+		else if (player->GetDesyncFrame() >= 0 || Replay::Hash(sim) != recorded)
+		{
+			printf("%s: playback went its own way from frame %d\n", path, player->GetDesyncFrame());
+			status = 1;
+		}
+		else
+		{
+			int inside = (ROUND_TRIP_PAUSE_START + ROUND_TRIP_PAUSE_END) / 2, before = ROUND_TRIP_PAUSE_START - 5;
+			if (!player->Seek(inside, error) || !player->Seek(before, error) || !player->Seek(player->GetFrameCount(), error) ||
+				Replay::Hash(sim) != recorded)
+			{
+				printf("%s: seeking from frame %d back to frame %d did not reproduce the same state\n", path, inside, before);
+				status = 1;
+			}
+			else if (!player->Seek(0, error) || Replay::Hash(sim) != start || !player->Seek(player->GetFrameCount(), error) ||
+				Replay::Hash(sim) != recorded)
+			{
+				printf("%s: seeking back to the start did not reproduce the same state\n", path);
+				status = 1;
+			}
+			else
+				printf("%s: %d frames played back and seeked through the same as recorded\n", path, player->GetFrameCount());
+		}
+		delete player;
+		delete sim;
+		return status;
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	Options options = { NULL, -1, 0, false };
+	if (!ParseArguments(argc, argv, options))
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+	if (options.roundTrip)
+		return RoundTrip(options.path);
+
+	Simulation * sim = new Simulation();
+	ReplayPlayer * player = new ReplayPlayer(sim);
+	player->SetKeyframeInterval(options.keyframes);
+	ByteString error;
+	if (!player->Load(options.path, error))
+	{
+		fprintf(stderr, "%s: %s\n", options.path, error.c_str());
+		delete player;
+		delete sim;
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (options.seek >= 0)
+	{
+		// Going forward, back and forward again has to end up on the same state as going straight there
+		if (!player->Seek(options.seek, error))
+			fprintf(stderr, "%s: %s\n", options.path, error.length() ? error.c_str() : "replay ends before that frame");
+		uint64_t expected = Replay::Hash(sim);
+		if (error.length() || !player->Seek(0, error) || !player->Seek(options.seek, error) || Replay::Hash(sim) != expected)
+		{
+			printf("%s: seeking back to frame %d did not reproduce the same state\n", options.path, options.seek);
+			delete player;
+			delete sim;
+			return 1;
+		}
+	}
+	while (player->Step(error));
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(end - start).count();
+
+	int status = 0;
+	if (error.length())
+	{
+		printf("%s: %s at frame %d\n", options.path, error.c_str(), player->GetFrame());
+		status = 1;
+	}
+	printf("%s: played %d of %d frames in %.2fs (%.0f ticks/s)\n", options.path, player->GetFrame(), player->GetFrameCount(),
+		seconds, seconds > 0 ? player->GetFrame() / seconds : 0.0);
+	if (player->GetDesyncFrame() >= 0)
+	{
+		printf("%s: desync at frame %d\n", options.path, player->GetDesyncFrame());
+		status = 1;
+	}
+	else
+		printf("%s: final state %016" PRIx64 "\n", options.path, Replay::Hash(sim));
+	delete player;
+	delete sim;
+	return status;
+}
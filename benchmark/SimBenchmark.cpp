@@ -0,0 +1,201 @@
+// Headless simulation benchmark, runs the simulation without any of the GUI and reports timings as JSON
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "Config.h"
+#include "common/tpt-barrier.h"
+#include "simulation/Air.h"
+#include "simulation/Gravity.h"
+#include "simulation/Scenes.h"
+#include "simulation/Simulation.h"
+
+namespace
+{
+	struct Options
+	{
+		int ticks;
+		int warmup;
+		int threads;
+		unsigned int seed;
+		ByteString scene;
+		int airMode;
+		bool ambientHeat;
+		bool newtonianGravity;
+	};
+
+	enum Phase
+	{
+		PhaseBeforeSim = 0,
+		PhaseMarkRegions,
+		PhaseParticles,
+		PhaseAfterSim,
+		PhaseTick,
+		PhaseCount
+	};
+	const char * phaseNames[PhaseCount] = { "BeforeSim", "MarkPartsRegions", "UpdateParticles", "AfterSim", "Tick" };
+
+	void Usage(const char * name)
+	{
+		fprintf(stderr, "Usage: %s [--ticks N] [--warmup N] [--threads N] [--seed N] [--scene NAME] [--air MODE] [--aheat] [--ngrav]\n", name);
+		fprintf(stderr, "  --threads  worker threads for the particle update, 1 to %d\n", THRDS);
+		fprintf(stderr, "  --air      air mode, 0 on, 1 pressure off, 2 velocity off, 3 off, 4 no update\n");
+		fprintf(stderr, "  --scene    one of:\n");
+		std::vector<ByteString> names = Scenes::Names();
+		for (size_t i = 0; i < names.size(); i++)
+			fprintf(stderr, "               %-12s %s\n", names[i].c_str(), Scenes::Description(names[i]).c_str());
+	}
+
+	bool ParseArguments(int argc, char * argv[], Options & options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			bool hasValue = i+1 < argc;
+			if (!strcmp(argv[i], "--ticks") && hasValue)
+				options.ticks = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--warmup") && hasValue)
+				options.warmup = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--threads") && hasValue)
+				options.threads = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--seed") && hasValue)
+				options.seed = strtoul(argv[++i], NULL, 10);
+			else if (!strcmp(argv[i], "--scene") && hasValue)
+				options.scene = argv[++i];
+			else if (!strcmp(argv[i], "--air") && hasValue)
+				options.airMode = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--aheat"))
+				options.ambientHeat = true;
+			else if (!strcmp(argv[i], "--ngrav"))
+				options.newtonianGravity = true;
+			else
+				return false;
+		}
+		return options.ticks > 0 && options.warmup >= 0 && options.threads >= 1 && options.threads <= THRDS && options.airMode >= 0 && options.airMode <= 4;
+	}
+
+	double Percentile(std::vector<double> values, double percentile)
+	{
+		if (values.empty())
+			return 0;
+		std::sort(values.begin(), values.end());
+		size_t index = std::min(values.size()-1, (size_t)(percentile/100.0*(values.size()-1)+0.5));
+		return values[index];
+	}
+
+	double Milliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	Options options = { 1000, 100, THRDS, 0, "avalanche", 0, false, false };
+	if (!ParseArguments(argc, argv, options))
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	Simulation * sim = new Simulation();
+	if (!Scenes::Build(sim, options.scene, options.seed))
+	{
+		fprintf(stderr, "Unknown scene %s\n", options.scene.c_str());
+		Usage(argv[0]);
+		delete sim;
+		return 1;
+	}
+	sim->air->airMode = options.airMode;
+	sim->aheat_enable = options.ambientHeat;
+	if (options.newtonianGravity)
+		sim->grav->start_grav_async();
+
+	// Same scheme as GameController: all even regions run in parallel, then all odd ones. Worker n
+	// takes regions 2n, 2(n+threads) and so on of each half, so fewer threads simply take more regions.
+	Barrier startBarrier(options.threads+1), endBarrier(options.threads+1);
+	std::atomic<bool> running(true);
+	int phase = 0;
+	std::vector<std::thread> workers;
+	for (int id = 0; id < options.threads; id++)
+	{
+		workers.push_back(std::thread([&, id]() {
+			while (true)
+			{
+				startBarrier.Wait();
+				if (!running)
+					break;
+				for (int region = phase + 2*id; region < 2*THRDS; region += 2*options.threads)
+					sim->UpdateParticles(0, NPART, region);
+				endBarrier.Wait();
+			}
+		}));
+	}
+
+	std::vector<double> times[PhaseCount];
+	for (int i = 0; i < PhaseCount; i++)
+		times[i].reserve(options.ticks);
+	std::chrono::steady_clock::time_point runStart;
+	for (int tick = 0; tick < options.warmup + options.ticks; tick++)
+	{
+		if (tick == options.warmup)
+			runStart = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		sim->BeforeSim();
+		std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+		sim->MarkPartsRegions(0, NPART);
+		std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+		for (phase = 0; phase < 2; phase++)
+		{
+			startBarrier.Wait();
+			endBarrier.Wait();
+		}
+		std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+		sim->AfterSim();
+		std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+
+		if (tick >= options.warmup)
+		{
+			times[PhaseBeforeSim].push_back(Milliseconds(t0, t1));
+			times[PhaseMarkRegions].push_back(Milliseconds(t1, t2));
+			times[PhaseParticles].push_back(Milliseconds(t2, t3));
+			times[PhaseAfterSim].push_back(Milliseconds(t3, t4));
+			times[PhaseTick].push_back(Milliseconds(t0, t4));
+		}
+	}
+	double elapsed = Milliseconds(runStart, std::chrono::steady_clock::now());
+
+	running = false;
+	startBarrier.Wait();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("{\n");
+	printf("\t\"scene\": \"%s\",\n", options.scene.c_str());
+	printf("\t\"ticks\": %d,\n\t\"warmup\": %d,\n\t\"threads\": %d,\n\t\"seed\": %u,\n", options.ticks, options.warmup, options.threads, options.seed);
+	printf("\t\"air_mode\": %d,\n\t\"ambient_heat\": %s,\n\t\"newtonian_gravity\": %s,\n", options.airMode, options.ambientHeat ? "true" : "false", options.newtonianGravity ? "true" : "false");
+	printf("\t\"particles\": %d,\n", sim->NUM_PARTS);
+	printf("\t\"ticks_per_second\": %.3f,\n", options.ticks/(elapsed/1000.0));
+	printf("\t\"phases_ms\": {\n");
+	for (int i = 0; i < PhaseCount; i++)
+	{
+		printf("\t\t\"%s\": { \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n", phaseNames[i],
+			Percentile(times[i], 50), Percentile(times[i], 90), Percentile(times[i], 99), Percentile(times[i], 100), i+1 < PhaseCount ? "," : "");
+	}
+	printf("\t},\n");
+	// ru_maxrss is in kilobytes on Linux
+	printf("\t\"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+	printf("}\n");
+
+	if (options.newtonianGravity)
+		sim->grav->stop_grav_async();
+	delete sim;
+	return 0;
+}
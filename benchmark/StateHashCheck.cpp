@@ -0,0 +1,235 @@
+// State hash regression harness. Runs the scenes single threaded from a fixed seed and hashes the whole
+// simulation state every few ticks, then either records the hashes as golden files or compares against them.
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "common/String.h"
+#include "simulation/Scenes.h"
+#include "simulation/Simulation.h"
+#include "simulation/StateHash.h"
+
+namespace
+{
+	struct Options
+	{
+		int ticks;
+		int interval;
+		unsigned int seed;
+		bool record;
+		const char * directory;
+		std::vector<ByteString> scenes;
+	};
+
+	struct Checkpoint
+	{
+		int tick;
+		std::vector<StateHash::Section> sections;
+	};
+
+	void Usage(const char * name)
+	{
+		fprintf(stderr, "Usage: %s (--record DIR | --check DIR) [--scene NAME]... [--ticks N] [--interval N] [--seed N]\n", name);
+		fprintf(stderr, "  --record    run the scenes and write their hashes to DIR\n");
+		fprintf(stderr, "  --check     run the scenes and compare their hashes with the ones in DIR\n");
+		fprintf(stderr, "  --scene     scene to run, can be given more than once, all scenes by default\n");
+		fprintf(stderr, "  --interval  hash the state every N ticks\n");
+	}
+
+	bool ParseArguments(int argc, char * argv[], Options & options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			bool hasValue = i+1 < argc;
+			if ((!strcmp(argv[i], "--record") || !strcmp(argv[i], "--check")) && hasValue)
+			{
+				options.record = !strcmp(argv[i], "--record");
+				options.directory = argv[++i];
+			}
+			else if (!strcmp(argv[i], "--scene") && hasValue)
+				options.scenes.push_back(argv[++i]);
+			else if (!strcmp(argv[i], "--ticks") && hasValue)
+				options.ticks = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--interval") && hasValue)
+				options.interval = atoi(argv[++i]);
+			else if (!strcmp(argv[i], "--seed") && hasValue)
+				options.seed = strtoul(argv[++i], NULL, 10);
+			else
+				return false;
+		}
+		return options.directory && options.ticks > 0 && options.interval > 0;
+	}
+
+	ByteString Header(ByteString scene, const Options & options)
+	{
+		return ByteString::Build("scene ", scene, " seed ", options.seed, " ticks ", options.ticks, " interval ", options.interval);
+	}
+
+	std::vector<Checkpoint> Run(Simulation * sim, ByteString scene, const Options & options)
+	{
+		std::vector<Checkpoint> checkpoints;
+		Scenes::Build(sim, scene, options.seed);
+		for (int tick = 1; tick <= options.ticks; tick++)
+		{
+			sim->TickSerial();
+			if (tick % options.interval == 0)
+			{
+				Checkpoint checkpoint = { tick, StateHash::Compute(sim) };
+				checkpoints.push_back(checkpoint);
+			}
+		}
+		return checkpoints;
+	}
+
+	bool Write(ByteString path, ByteString header, const std::vector<Checkpoint> & checkpoints)
+	{
+		FILE * file = fopen(path.c_str(), "w");
+		if (!file)
+			return false;
+		fprintf(file, "%s\n", header.c_str());
+		for (size_t i = 0; i < checkpoints.size(); i++)
+		{
+			fprintf(file, "tick %d\n", checkpoints[i].tick);
+			for (size_t j = 0; j < checkpoints[i].sections.size(); j++)
+				fprintf(file, "%s %016" PRIx64 "\n", checkpoints[i].sections[j].name.c_str(), checkpoints[i].sections[j].hash);
+		}
+		return !fclose(file);
+	}
+
+	// Reads a file written by Write, returns false if it can't be read or was recorded with different settings
+	bool Read(ByteString path, ByteString header, std::vector<Checkpoint> & checkpoints, ByteString & error)
+	{
+		FILE * file = fopen(path.c_str(), "r");
+		if (!file)
+		{
+			error = "can't open " + path;
+			return false;
+		}
+		char line[256];
+		if (!fgets(line, sizeof(line), file) || ByteString(line, strcspn(line, "\r\n")) != header)
+		{
+			error = path + " was recorded with different settings";
+			fclose(file);
+			return false;
+		}
+		while (fgets(line, sizeof(line), file))
+		{
+			char name[200];
+			uint64_t hash;
+			int tick;
+			if (sscanf(line, "tick %d", &tick) == 1)
+			{
+				Checkpoint checkpoint;
+				checkpoint.tick = tick;
+				checkpoints.push_back(checkpoint);
+			}
+			else if (!checkpoints.empty() && sscanf(line, "%199s %" SCNx64, name, &hash) == 2)
+			{
+				StateHash::Section section = { name, hash };
+				checkpoints.back().sections.push_back(section);
+			}
+		}
+		fclose(file);
+		return true;
+	}
+
+	// Prints the first checkpoint and section that differ, returns true if everything matched
+	bool Compare(ByteString scene, const std::vector<Checkpoint> & expected, const std::vector<Checkpoint> & actual)
+	{
+		for (size_t i = 0; i < expected.size() && i < actual.size(); i++)
+		{
+			if (expected[i].tick != actual[i].tick || expected[i].sections.size() != actual[i].sections.size())
+			{
+				printf("%s: golden file does not match the current set of hashes at tick %d\n", scene.c_str(), actual[i].tick);
+				return false;
+			}
+			ByteString first, others;
+			for (size_t j = 0; j < actual[i].sections.size(); j++)
+			{
+				const StateHash::Section & section = actual[i].sections[j];
+				if (expected[i].sections[j].name != section.name)
+				{
+					printf("%s: golden file has %s where %s was expected\n", scene.c_str(), expected[i].sections[j].name.c_str(), section.name.c_str());
+					return false;
+				}
+				if (expected[i].sections[j].hash == section.hash)
+					continue;
+				if (!first.length())
+					first = section.name;
+				else
+				{
+					if (others.length())
+						others += ", ";
+					others += section.name;
+				}
+			}
+			if (first.length())
+			{
+				printf("%s: first difference at tick %d in %s", scene.c_str(), actual[i].tick, first.c_str());
+				if (others.length())
+					printf(", also differs: %s", others.c_str());
+				printf("\n");
+				return false;
+			}
+		}
+		if (expected.size() != actual.size())
+		{
+			printf("%s: golden file has %d checkpoints, expected %d\n", scene.c_str(), (int)expected.size(), (int)actual.size());
+			return false;
+		}
+		printf("%s: ok\n", scene.c_str());
+		return true;
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	Options options = { 300, 10, 0, false, NULL, std::vector<ByteString>() };
+	if (!ParseArguments(argc, argv, options))
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+	if (options.scenes.empty())
+		options.scenes = Scenes::Names();
+
+	Simulation * sim = new Simulation();
+	bool passed = true;
+	for (size_t i = 0; i < options.scenes.size(); i++)
+	{
+		ByteString scene = options.scenes[i];
+		if (Scenes::Description(scene).empty())
+		{
+			fprintf(stderr, "Unknown scene %s\n", scene.c_str());
+			passed = false;
+			continue;
+		}
+		ByteString path = ByteString(options.directory) + "/" + scene + ".hashes";
+		ByteString header = Header(scene, options);
+		std::vector<Checkpoint> checkpoints = Run(sim, scene, options);
+		if (options.record)
+		{
+			if (Write(path, header, checkpoints))
+				printf("%s: recorded %d checkpoints\n", scene.c_str(), (int)checkpoints.size());
+			else
+			{
+				fprintf(stderr, "%s: can't write %s\n", scene.c_str(), path.c_str());
+				passed = false;
+			}
+			continue;
+		}
+		std::vector<Checkpoint> expected;
+		ByteString error;
+		if (!Read(path, header, expected, error))
+		{
+			printf("%s: %s\n", scene.c_str(), error.c_str());
+			passed = false;
+			continue;
+		}
+		if (!Compare(scene, expected, checkpoints))
+			passed = false;
+	}
+	delete sim;
+	return passed ? 0 : 1;
+}
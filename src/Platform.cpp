@@ -8,8 +8,10 @@
 #include <shlwapi.h>
 #include <windows.h>
 #else
+#include <cerrno>
 #include <unistd.h>
 #include <ctime>
+#include <sys/stat.h>
 #include <sys/time.h>
 #endif
 #ifdef MACOSX
@@ -132,6 +134,14 @@ long unsigned int GetTime()
 #endif
 }
 
+bool MakeDirectory(ByteString path)
+{
+#ifdef WIN
+	return CreateDirectory(path.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+	return !mkdir(path.c_str(), 0755) || errno == EEXIST;
+#endif
+}
 
 void LoadFileInResource(int name, int type, unsigned int& size, const char*& data)
 {
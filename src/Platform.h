@@ -12,6 +12,8 @@ namespace Platform
 
 	void Millisleep(long int t);
 	long unsigned int GetTime();
+	// Succeeds if the directory already exists
+	bool MakeDirectory(ByteString path);
 
 	void LoadFileInResource(int name, int type, unsigned int& size, const char*& data);
 }
@@ -5,3 +5,5 @@ void ClipboardPush(ByteString text);
 ByteString ClipboardPull();
 int GetModifiers();
 unsigned int GetTicks();
+// Nanoseconds from a clock that only ever goes forward, for timing frames
+long long GetNanoTicks();
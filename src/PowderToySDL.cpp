@@ -1,6 +1,9 @@
 #ifndef RENDERER
 
 #include <map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include "common/String.h"
 #include <ctime>
 #include <climits>
@@ -33,6 +36,7 @@
 #include "Format.h"
 
 #include "Misc.h"
+#include "common/tpt-trace.h"
 
 #include "gui/game/GameController.h"
 #include "gui/game/GameView.h"
@@ -55,6 +59,10 @@ int desktopWidth = 1280, desktopHeight = 1024;
 SDL_Window * sdl_window;
 SDL_Renderer * sdl_renderer;
 SDL_Texture * sdl_texture;
+// Frames are written into a locked streaming texture instead of going through SDL_UpdateTexture. Two textures
+// take turns so that the one just presented isn't locked again while it may still be in use.
+SDL_Texture * sdl_texture_back = NULL;
+bool streamPresent = true;
 int scale = 1;
 bool fullscreen = false;
 bool altFullscreen = false;
@@ -106,12 +114,26 @@ void blit(SDL_Window * window)
 #else
 void blit(pixel * vid)
 {
-	SDL_UpdateTexture(sdl_texture, NULL, vid, WINDOWW * sizeof (Uint32));
+	TRACE_ZONE("blit");
+	void * pixels;
+	int pitch;
+	// Locked texture memory is only good for writing to, it can be very slow to read and drawing reads back what
+	// it drew all the time, so frames are drawn into vid and written out into the texture here in one pass
+	if (streamPresent && !SDL_LockTexture(sdl_texture, NULL, &pixels, &pitch))
+	{
+		for (int y = 0; y < WINDOWH; y++)
+			memcpy((char *)pixels + y * pitch, vid + y * WINDOWW, WINDOWW * PIXELSIZE);
+		SDL_UnlockTexture(sdl_texture);
+	}
+	else
+		SDL_UpdateTexture(sdl_texture, NULL, vid, WINDOWW * sizeof (Uint32));
 	// need to clear the renderer if there are black edges (fullscreen, or resizable window)
 	if (fullscreen || resizable)
 		SDL_RenderClear(sdl_renderer);
 	SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
 	SDL_RenderPresent(sdl_renderer);
+	if (streamPresent)
+		std::swap(sdl_texture, sdl_texture_back);
 }
 #endif
 
@@ -143,6 +165,14 @@ int SDLOpen()
 	//Uncomment this to force fullscreen to an integer resolution
 	//SDL_RenderSetIntegerScale(sdl_renderer, SDL_TRUE);
 	sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WINDOWW, WINDOWH);
+#ifndef OGLI
+	if (streamPresent)
+	{
+		sdl_texture_back = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, WINDOWW, WINDOWH);
+		if (!sdl_texture_back)
+			streamPresent = false;
+	}
+#endif
 	if (fullscreen)
 		SDL_RaiseWindow(sdl_window);
 	//Uncomment this to enable resizing
@@ -208,6 +238,11 @@ unsigned int GetTicks()
 	return SDL_GetTicks();
 }
 
+long long GetNanoTicks()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 std::map<ByteString, ByteString> readArguments(int argc, char * argv[])
 {
 	std::map<ByteString, ByteString> arguments;
@@ -222,6 +257,9 @@ std::map<ByteString, ByteString> readArguments(int argc, char * argv[])
 	arguments["open"] = "";
 	arguments["ddir"] = "";
 	arguments["ptsave"] = "";
+	arguments["copypresent"] = "false";
+	arguments["fps"] = "";
+	arguments["tickrate"] = "";
 
 	for (int i=1; i<argc; i++)
 	{
@@ -229,6 +267,14 @@ std::map<ByteString, ByteString> readArguments(int argc, char * argv[])
 		{
 			arguments["scale"] = argv[i]+6;
 		}
+		else if (!strncmp(argv[i], "fps:", 4))
+		{
+			arguments["fps"] = argv[i]+4;
+		}
+		else if (!strncmp(argv[i], "tickrate:", 9))
+		{
+			arguments["tickrate"] = argv[i]+9;
+		}
 		else if (!strncmp(argv[i], "proxy:", 6))
 		{
 			if(argv[i]+6)
@@ -252,6 +298,10 @@ std::map<ByteString, ByteString> readArguments(int argc, char * argv[])
 		{
 			arguments["scripts"] = "true";
 		}
+		else if (!strncmp(argv[i], "copypresent", 12))
+		{
+			arguments["copypresent"] = "true";
+		}
 		else if (!strncmp(argv[i], "open", 5) && i+1<argc)
 		{
 			arguments["open"] = argv[i+1];
@@ -411,13 +461,35 @@ void DoubleScreenDialog()
 	}
 }
 
+static const long long NANOSECONDS = 1000000000LL;
+// SDL_Delay can oversleep by a millisecond or two, so the last of the wait before a frame is spent spinning
+static const long long SPIN_NANOSECONDS = 2000000LL;
+// The most time the simulation gets to catch up in one frame when it can't keep up with its tick rate. Whatever
+// it is still behind by after that is dropped, so that frames still get drawn and input still gets handled.
+static const long long SIM_BUDGET_NANOSECONDS = 100000000LL;
+
+// Waits until the clock reaches deadline, sleeping for most of it and spinning for the rest
+static void WaitUntil(long long deadline)
+{
+	long long remaining = deadline - GetNanoTicks();
+	if (remaining > SPIN_NANOSECONDS)
+		SDL_Delay((remaining - SPIN_NANOSECONDS) / 1000000);
+	while (GetNanoTicks() < deadline)
+		std::this_thread::yield();
+}
+
 void EngineProcess()
 {
-	double frameTimeAvg = 0.0f, correctedFrameTimeAvg = 0.0f;
+	double frameTimeAvg = 0.0, tickTimeAvg = 0.0;
+	long long now = GetNanoTicks();
+	// When the next frame is to be shown, and up to when the simulation has been ticked
+	long long nextFrame = now, simTime = now;
+	int ticksSinceUpdate = 0;
+	lastFpsUpdate = now / 1000000;
 	SDL_Event event;
 	while(engine->Running())
 	{
-		int frameStart = SDL_GetTicks();
+		long long frameStart = GetNanoTicks();
 		if(engine->Broken()) { engine->UnBreak(); break; }
 		event.type = 0;
 		while (SDL_PollEvent(&event))
@@ -427,7 +499,35 @@ void EngineProcess()
 		}
 		if(engine->Broken()) { engine->UnBreak(); break; }
 
+		int ticks = 1;
+		if (engine->SimTickRate > 0)
+		{
+			long long tickLength = (long long)(NANOSECONDS / engine->SimTickRate);
+			long long due = (frameStart - simTime) / tickLength;
+			long long affordable = std::max(1LL, (long long)(SIM_BUDGET_NANOSECONDS / std::max(tickTimeAvg, 1.0)));
+			if (due > affordable)
+			{
+				due = affordable;
+				simTime = frameStart - due * tickLength;
+			}
+			simTime += due * tickLength;
+			ticks = int(due);
+		}
+		else
+			simTime = frameStart;
+		engine->SetSimTicks(ticks);
+		engine->SetSimTicksRun(0);
+
 		engine->Tick();
+		// Only the ticks that were actually run count, the simulation may be paused, behind another window or
+		// fast forwarding
+		int ran = engine->GetSimTicksRun();
+		if (ran)
+		{
+			long long tickTime = (GetNanoTicks() - frameStart) / ran;
+			tickTimeAvg = tickTimeAvg ? tickTimeAvg * 0.8 + tickTime * 0.2 : tickTime;
+			ticksSinceUpdate += ran;
+		}
 		engine->Draw();
 
 		if (scale != engine->Scale || fullscreen != engine->Fullscreen
@@ -442,26 +542,33 @@ void EngineProcess()
 		blit(engine->g->vid);
 #endif
 
-		int frameTime = SDL_GetTicks() - frameStart;
-		frameTimeAvg = frameTimeAvg * 0.8 + frameTime * 0.2;
-		int fpsLimit = ui::Engine::Ref().FpsLimit;
-		if(fpsLimit > 2)
+		float fpsLimit = engine->FpsLimit;
+		if (fpsLimit > 2 && !engine->Unthrottled)
 		{
-			double offset = 1000.0 / fpsLimit - frameTimeAvg;
-			if(offset > 0)
-				SDL_Delay(offset + 0.5);
+			// Frames are due at fixed steps, so that time lost in one frame is made up in the next instead of
+			// adding up, unless it is a whole frame or more behind
+			long long frameLength = (long long)(NANOSECONDS / fpsLimit);
+			nextFrame += frameLength;
+			now = GetNanoTicks();
+			if (nextFrame < now - frameLength)
+				nextFrame = now;
+			WaitUntil(nextFrame);
 		}
-		int correctedFrameTime = SDL_GetTicks() - frameStart;
-		correctedFrameTimeAvg = correctedFrameTimeAvg * 0.95 + correctedFrameTime * 0.05;
-		if (frameStart - lastFpsUpdate > 200)
+		now = GetNanoTicks();
+		double frameTime = double(now - frameStart);
+		frameTimeAvg = frameTimeAvg ? frameTimeAvg * 0.95 + frameTime * 0.05 : frameTime;
+		unsigned int frameStartTicks = frameStart / 1000000;
+		if (frameStartTicks - lastFpsUpdate > 200)
 		{
-			engine->SetFps(1000.0 / correctedFrameTimeAvg);
-			lastFpsUpdate = frameStart;
+			engine->SetFps(NANOSECONDS / frameTimeAvg);
+			engine->SetTps(ticksSinceUpdate * 1000.0f / (frameStartTicks - lastFpsUpdate));
+			ticksSinceUpdate = 0;
+			lastFpsUpdate = frameStartTicks;
 		}
-		if (frameStart - lastTick > 1000)
+		if (frameStartTicks - lastTick > 1000)
 		{
 			//Run client tick every second
-			lastTick = frameStart;
+			lastTick = frameStartTicks;
 		}
 		if (showDoubleScreenDialog)
 		{
@@ -539,7 +646,7 @@ int main(int argc, char * argv[])
 #endif
 	currentWidth = WINDOWW;
 	currentHeight = WINDOWH;
-
+	Trace::SetThreadName("Main");
 
 	std::map<ByteString, ByteString> arguments = readArguments(argc, argv);
 
@@ -570,6 +677,9 @@ int main(int argc, char * argv[])
 	if(scale < 1 || scale > 10)
 		scale = 1;
 
+	if(arguments["copypresent"] == "true")
+		streamPresent = false;
+
 	SDLOpen();
 
 #ifdef OGLI
@@ -589,6 +699,10 @@ int main(int argc, char * argv[])
 	ui::Engine::Ref().SetResizable(resizable);
 	ui::Engine::Ref().Fullscreen = fullscreen;
 	ui::Engine::Ref().SetAltFullscreen(altFullscreen);
+	if(arguments["fps"].length())
+		ui::Engine::Ref().FpsLimit = arguments["fps"].ToNumber<float>(true);
+	if(arguments["tickrate"].length())
+		ui::Engine::Ref().SimTickRate = std::max(arguments["tickrate"].ToNumber<float>(true), 0.0f);
 
 	engine = &ui::Engine::Ref();
 	engine->SetMaxSize(desktopWidth, desktopHeight);
@@ -640,6 +754,7 @@ int main(int argc, char * argv[])
 	ui::Engine::Ref().CloseWindow();
 	delete gameController;
 	delete ui::Engine::Ref().g;
+	Trace::Shutdown();
 	return 0;
 }
 
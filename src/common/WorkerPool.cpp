@@ -0,0 +1,49 @@
+#include "WorkerPool.h"
+#include "tpt-trace.h"
+
+WorkerPool::WorkerPool(int count):
+	names(count),
+	startBarrier(count+1),
+	endBarrier(count+1),
+	job(NULL),
+	stopping(false)
+{
+	// The names have to stay where they are for as long as the threads run, so they are all made first
+	for (int id = 0; id < count; id++)
+		names[id] = ByteString::Build("Worker ", id);
+	for (int id = 0; id < count; id++)
+		threads.push_back(std::thread(&WorkerPool::Work, this, id));
+}
+
+WorkerPool::~WorkerPool()
+{
+	stopping = true;
+	startBarrier.Wait();
+	for (size_t id = 0; id < threads.size(); id++)
+		threads[id].join();
+}
+
+void WorkerPool::Work(int id)
+{
+	Trace::SetThreadName(names[id].c_str());
+	while (true)
+	{
+		{
+			TRACE_ZONE("Wait for start");
+			startBarrier.Wait();
+		}
+		if (stopping)
+			break;
+		(*job)(id);
+		TRACE_ZONE("Wait for others");
+		endBarrier.Wait();
+	}
+}
+
+void WorkerPool::Run(const std::function<void(int)> & newJob)
+{
+	job = &newJob;
+	startBarrier.Wait();
+	endBarrier.Wait();
+	job = NULL;
+}
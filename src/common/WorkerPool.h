@@ -0,0 +1,34 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <functional>
+#include <thread>
+#include <vector>
+#include "common/String.h"
+#include "tpt-barrier.h"
+
+// A fixed set of threads that all run the same job side by side, each one told which worker it is. Run only
+// returns once every worker has finished, and the workers only start once Run is called, so a job can use
+// anything the caller set up before and the caller anything the job left behind without further locking.
+// Used for the simulation's particle regions and for drawing the frame, which never run at the same time.
+class WorkerPool
+{
+	std::vector<std::thread> threads;
+	std::vector<ByteString> names;
+	Barrier startBarrier;
+	Barrier endBarrier;
+	const std::function<void(int)> * job;
+	bool stopping;
+
+	void Work(int id);
+
+public:
+	WorkerPool(int count);
+	~WorkerPool();
+
+	int GetCount() { return threads.size(); }
+	// Calls job(id) for every id from 0 to GetCount()-1, each on its own worker, and waits for all of them
+	void Run(const std::function<void(int)> & job);
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef TPT_BARRIER_H
+#define TPT_BARRIER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+//Barrier class taken from StackOverflow
+class Barrier
+{
+public:
+	explicit Barrier(size_t iCount) :
+		mThreshold(iCount),
+		mCount(iCount),
+		mGeneration(0) {
+		}
+
+	void Wait() {
+		std::unique_lock<std::mutex> lLock{mMutex};
+		auto lGen = mGeneration;
+		if (!--mCount) {
+			mGeneration++;
+			mCount = mThreshold;
+			mCond.notify_all();
+		} else {
+			mCond.wait(lLock, [this, lGen] { return lGen != mGeneration; });
+		}
+	}
+
+private:
+	std::mutex mMutex;
+	std::condition_variable mCond;
+	size_t mThreshold;
+	size_t mCount;
+	size_t mGeneration;
+};
+
+#endif /* TPT_BARRIER_H */
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "tpt-lz.h"
+
+namespace
+{
+	const size_t MIN_MATCH = 4;
+	// The format requires the last five bytes to be literals and the last match to start at least
+	// twelve bytes before the end
+	const size_t LAST_LITERALS = 5;
+	const size_t MATCH_LIMIT = 12;
+	const size_t MAX_OFFSET = 65535;
+	const int HASH_BITS = 16;
+
+	inline uint32_t Read32(const unsigned char * p)
+	{
+		uint32_t value;
+		memcpy(&value, p, 4);
+		return value;
+	}
+
+	inline uint32_t Hash(uint32_t value)
+	{
+		return (value * 2654435761U) >> (32 - HASH_BITS);
+	}
+
+	// Writes a length that did not fit into its four bits of the token
+	inline unsigned char * WriteLength(unsigned char * op, size_t length)
+	{
+		while (length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = (unsigned char)length;
+		return op;
+	}
+
+	inline bool ReadLength(const unsigned char *& ip, const unsigned char * end, size_t & length)
+	{
+		unsigned char b;
+		do
+		{
+			if (ip >= end)
+				return false;
+			b = *ip++;
+			length += b;
+		}
+		while (b == 255);
+		return true;
+	}
+}
+
+namespace LZ
+{
+	size_t Bound(size_t size)
+	{
+		return size + size/255 + 16;
+	}
+
+	size_t Compress(const unsigned char * source, size_t size, unsigned char * destination, size_t capacity)
+	{
+		unsigned char * op = destination, * oend = destination + capacity;
+		size_t ip = 0, anchor = 0;
+
+		// Emits the literals since anchor and a match, or only the literals if matchLength is 0
+		auto emit = [&](size_t literals, size_t offset, size_t matchLength) -> bool {
+			if ((size_t)(oend - op) < 1 + literals/255 + 1 + literals + 2 + matchLength/255 + 1)
+				return false;
+			unsigned char * token = op++;
+			*token = (unsigned char)(std::min<size_t>(literals, 15) << 4);
+			if (literals >= 15)
+				op = WriteLength(op, literals - 15);
+			if (literals)
+				memcpy(op, source + anchor, literals);
+			op += literals;
+			if (matchLength)
+			{
+				*op++ = (unsigned char)offset;
+				*op++ = (unsigned char)(offset >> 8);
+				size_t length = matchLength - MIN_MATCH;
+				*token |= (unsigned char)std::min<size_t>(length, 15);
+				if (length >= 15)
+					op = WriteLength(op, length - 15);
+			}
+			return true;
+		};
+
+		if (size >= MATCH_LIMIT)
+		{
+			std::vector<uint32_t> table(1 << HASH_BITS, 0);
+			size_t limit = size - MATCH_LIMIT, matchEnd = size - LAST_LITERALS;
+			while (ip <= limit)
+			{
+				uint32_t sequence = Read32(source + ip);
+				uint32_t & slot = table[Hash(sequence)];
+				size_t match = slot;
+				slot = (uint32_t)ip;
+				if (match >= ip || ip - match > MAX_OFFSET || Read32(source + match) != sequence)
+				{
+					// Skip ahead faster the longer nothing has matched
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+				while (ip > anchor && match > 0 && source[ip-1] == source[match-1])
+				{
+					ip--;
+					match--;
+				}
+				size_t length = MIN_MATCH;
+				while (ip + length < matchEnd && source[match + length] == source[ip + length])
+					length++;
+				if (!emit(ip - anchor, ip - match, length))
+					return 0;
+				ip += length;
+				anchor = ip;
+				if (ip - 2 <= limit)
+					table[Hash(Read32(source + ip - 2))] = (uint32_t)(ip - 2);
+			}
+		}
+		if (!emit(size - anchor, 0, 0))
+			return 0;
+		return op - destination;
+	}
+
+	bool Decompress(const unsigned char * source, size_t size, unsigned char * destination, size_t outputSize)
+	{
+		const unsigned char * ip = source, * end = source + size;
+		unsigned char * op = destination, * oend = destination + outputSize;
+		while (ip < end)
+		{
+			unsigned char token = *ip++;
+			size_t literals = token >> 4;
+			if (literals == 15 && !ReadLength(ip, end, literals))
+				return false;
+			if (literals > (size_t)(end - ip) || literals > (size_t)(oend - op))
+				return false;
+			if (literals)
+				memcpy(op, ip, literals);
+			ip += literals;
+			op += literals;
+			if (ip == end)
+				break;
+
+			if (end - ip < 2)
+				return false;
+			size_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			size_t length = token & 15;
+			if (length == 15 && !ReadLength(ip, end, length))
+				return false;
+			length += MIN_MATCH;
+			if (!offset || offset > (size_t)(op - destination) || length > (size_t)(oend - op))
+				return false;
+			const unsigned char * match = op - offset;
+			if (offset >= length)
+				memcpy(op, match, length);
+			else
+			{
+				// Overlapping match, the output repeats with a period of offset. Every copy from the start of
+				// the match can be twice as long as the one before it without overlapping.
+				size_t copied = 0;
+				while (copied < length)
+				{
+					size_t chunk = std::min(length - copied, offset + copied);
+					memcpy(op + copied, match, chunk);
+					copied += chunk;
+				}
+			}
+			op += length;
+		}
+		return op == oend;
+	}
+}
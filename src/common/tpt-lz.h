@@ -0,0 +1,18 @@
+#ifndef TPT_LZ_H
+#define TPT_LZ_H
+
+#include <cstddef>
+
+// Small byte oriented LZ77 compressor using the LZ4 block format. It trades ratio for speed,
+// both ways run at hundreds of megabytes per second which is what saves and snapshots need.
+namespace LZ
+{
+	// Largest possible compressed size of size bytes of input
+	size_t Bound(size_t size);
+	// Returns the compressed size, or 0 if the output did not fit into capacity bytes
+	size_t Compress(const unsigned char * source, size_t size, unsigned char * destination, size_t capacity);
+	// Output must be exactly outputSize bytes long, returns false on corrupt input
+	bool Decompress(const unsigned char * source, size_t size, unsigned char * destination, size_t outputSize);
+}
+
+#endif
@@ -58,8 +58,28 @@ RNG::RNG()
 
 void RNG::seed(unsigned int sd)
 {
-	s[0] = sd;
-	s[1] = sd;
+	// xoroshiro128+ never leaves the all zero state, so spread the seed over both words with splitmix64
+	// instead of using it directly, otherwise a seed of 0 makes every number 0
+	uint64_t x = sd;
+	for (int i = 0; i < 2; i++)
+	{
+		uint64_t z = (x += UINT64_C(0x9E3779B97F4A7C15));
+		z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+		z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+		s[i] = z ^ (z >> 31);
+	}
+}
+
+RNG::State RNG::state() const
+{
+	State current = { { s[0], s[1] } };
+	return current;
+}
+
+void RNG::state(State newState)
+{
+	s[0] = newState.s[0];
+	s[1] = newState.s[1];
 }
 
 RNG random_gen;
@@ -10,6 +10,12 @@ private:
 	uint64_t s[2];
 	uint64_t next();
 public:
+	// The whole generator state, so that a run can be continued exactly
+	struct State
+	{
+		uint64_t s[2];
+	};
+
 	unsigned int operator()();
 	unsigned int gen();
 	int between(int lower, int upper);
@@ -18,6 +24,9 @@ public:
 
 	RNG();
 	void seed(unsigned int sd);
+
+	State state() const;
+	void state(State newState);
 };
 
 extern RNG random_gen;
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "tpt-trace.h"
+
+namespace
+{
+	// About five seconds worth of zones at 60 frames per second
+	const uint64_t CAPACITY = 1 << 14;
+
+	struct Event
+	{
+		std::atomic<const char *> name;
+		std::atomic<uint64_t> start;
+		std::atomic<uint64_t> end;
+	};
+
+	// Only the owning thread writes to a buffer. head counts every zone ever recorded, the
+	// ring keeps the last CAPACITY of them. A buffer outlives its thread so that the thread's
+	// zones can still be exported, until a new thread takes it over or tracing is turned off.
+	struct ThreadBuffer
+	{
+		int id;
+		bool finished;
+		std::atomic<const char *> name;
+		std::atomic<uint64_t> head;
+		Event events[CAPACITY];
+	};
+
+	struct ExportedEvent
+	{
+		const char * name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::atomic<bool> enabled(true);
+	// Everything below is only touched with buffersMutex held, other than each thread writing to its own buffer
+	std::mutex buffersMutex;
+	std::vector<ThreadBuffer *> buffers;
+	int nextId = 1;
+
+	// Hands the buffer back when its thread finishes
+	struct LocalBuffer
+	{
+		ThreadBuffer * buffer;
+
+		~LocalBuffer()
+		{
+			if (!buffer)
+				return;
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			buffer->finished = true;
+			if (!enabled)
+			{
+				buffers.erase(std::find(buffers.begin(), buffers.end(), buffer));
+				delete buffer;
+			}
+		}
+	};
+	thread_local LocalBuffer localBuffer = { NULL };
+
+	ThreadBuffer * GetBuffer()
+	{
+		if (!localBuffer.buffer)
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			// Threads come and go, the gravity one every time gravity is turned on, so the buffer of one
+			// that has finished is reused instead of adding another
+			ThreadBuffer * buffer = NULL;
+			for (size_t i = 0; i < buffers.size() && !buffer; i++)
+				if (buffers[i]->finished)
+					buffer = buffers[i];
+			if (!buffer)
+			{
+				buffer = new ThreadBuffer();
+				buffers.push_back(buffer);
+			}
+			buffer->id = nextId++;
+			buffer->finished = false;
+			buffer->name.store(NULL);
+			buffer->head.store(0);
+			localBuffer.buffer = buffer;
+		}
+		return localBuffer.buffer;
+	}
+}
+
+uint64_t Trace::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::Record(const char * name, uint64_t start, uint64_t end)
+{
+	ThreadBuffer * buffer = GetBuffer();
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	Event & event = buffer->events[head % CAPACITY];
+	event.name.store(name, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+	buffer->head.store(head+1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char * name)
+{
+	GetBuffer()->name.store(name, std::memory_order_release);
+}
+
+bool Trace::Export(ByteString filename)
+{
+	FILE * f = fopen(filename.c_str(), "wb");
+	if (!f)
+		return false;
+
+	// Keeps the buffers from being freed or taken over while they are read
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	const std::vector<ThreadBuffer *> & threads = buffers;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	std::vector<ExportedEvent> events;
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		ThreadBuffer * buffer = threads[i];
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t begin = head > CAPACITY ? head-CAPACITY : 0;
+		events.clear();
+		for (uint64_t j = begin; j < head; j++)
+		{
+			Event & event = buffer->events[j % CAPACITY];
+			ExportedEvent exported = { event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed) };
+			events.push_back(exported);
+		}
+		// The owning thread keeps recording while we copy, drop everything it may have overwritten since
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t newHead = buffer->head.load(std::memory_order_relaxed);
+		size_t skip = 0;
+		if (newHead >= begin+CAPACITY)
+			skip = std::min<uint64_t>(newHead-CAPACITY+1-begin, events.size());
+
+		const char * name = buffer->name.load(std::memory_order_acquire);
+		fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->id, name ? name : "Unnamed");
+		first = false;
+		for (size_t j = skip; j < events.size(); j++)
+		{
+			fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", events[j].name, buffer->id,
+				events[j].start/1000.0, (events[j].end-events[j].start)/1000.0);
+		}
+	}
+	fprintf(f, "\n]}\n");
+	return fclose(f) == 0;
+}
+
+void Trace::SetEnabled(bool enable)
+{
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	enabled = enable;
+	if (enable)
+		return;
+	for (size_t i = 0; i < buffers.size();)
+	{
+		if (buffers[i]->finished)
+		{
+			delete buffers[i];
+			buffers.erase(buffers.begin()+i);
+		}
+		else
+			i++;
+	}
+}
+
+bool Trace::Enabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void Trace::Shutdown()
+{
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	enabled = false;
+	for (size_t i = 0; i < buffers.size(); i++)
+		delete buffers[i];
+	buffers.clear();
+	localBuffer.buffer = NULL;
+}
@@ -0,0 +1,49 @@
+#ifndef TPT_TRACE_H
+#define TPT_TRACE_H
+
+#include <cstdint>
+#include "common/String.h"
+
+// Lightweight frame tracing. Every thread records finished zones into its own ring buffer without
+// taking any locks. The most recent zones of every thread can be written out at any time as a
+// Chrome trace, which chrome://tracing and ui.perfetto.dev can open.
+namespace Trace
+{
+	// Nanoseconds since the process started
+	uint64_t Now();
+	void Record(const char * name, uint64_t start, uint64_t end);
+	// Names the calling thread in exported traces, name must outlive the thread
+	void SetThreadName(const char * name);
+	bool Export(ByteString filename);
+	// Tracing is on from the start. While it is off no zones are recorded, and the buffers of threads that
+	// have finished are freed rather than kept around for exporting.
+	void SetEnabled(bool enabled);
+	bool Enabled();
+	// Turns tracing off and frees every buffer, only to be called once all other threads have finished
+	void Shutdown();
+
+	class Zone
+	{
+		const char * name;
+		uint64_t start;
+	public:
+		Zone(const char * name):
+			name(Enabled() ? name : NULL),
+			start(this->name ? Now() : 0)
+		{
+		}
+
+		~Zone()
+		{
+			if (name)
+				Record(name, start, Now());
+		}
+	};
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Records the time until the end of the enclosing scope, name must be a string literal
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+
+#endif /* TPT_TRACE_H */
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include "ElementCost.h"
+#include "gui/interface/Engine.h"
+#include "simulation/Simulation.h"
+#include "Format.h"
+
+ElementCostDebug::ElementCostDebug(unsigned int id, Simulation * sim):
+	DebugInfo(id),
+	sim(sim),
+	frames(0),
+	frameTotal(0)
+{
+
+}
+
+void ElementCostDebug::Draw()
+{
+	Graphics * g = ui::Engine::Ref().g;
+
+	// Collect about a second worth of samples before updating the table, so it stays readable. Updates and
+	// movement happen once a tick and graphics once a drawn frame, so each is averaged over its own count.
+	if (++frames >= 60)
+	{
+		sim->profiler.Sum(counters);
+		unsigned int ticks = std::max(sim->profiler.ticks, 1U);
+		sim->profiler.Reset();
+
+		rows.clear();
+		frameTotal = 0;
+		for (int t = 0; t < PT_NUM; t++)
+		{
+			Row row;
+			row.type = t;
+			row.calls = (double)counters[t][ElementProfiler::Update].calls/ticks;
+			row.total = 0;
+			for (int p = 0; p < ElementProfiler::PhaseCount; p++)
+			{
+				row.time[p] = counters[t][p].Estimate()/(p == ElementProfiler::Graphics ? frames : ticks)/1000.0;
+				row.total += row.time[p];
+			}
+			if (row.total > 0)
+			{
+				rows.push_back(row);
+				frameTotal += row.total;
+			}
+		}
+		std::sort(rows.begin(), rows.end(), [](const Row & a, const Row & b) { return a.total > b.total; });
+		frames = 0;
+	}
+
+	int xStart = 10, yStart = 10;
+	int lines = std::min((int)rows.size(), 20);
+	int columns[] = { 0, 50, 100, 150, 200, 250 };
+	g->fillrect(xStart-5, yStart-5, 310, lines*12+34, 0, 0, 0, 180);
+	g->drawtext(xStart, yStart, String::Build("Element cost, us per tick, graphics per frame (", Format::Precision(frameTotal/1000.0, 2), " ms total)"), 255, 255, 255, 255);
+	g->drawtext(xStart+columns[0], yStart+14, "Name", 192, 192, 192, 255);
+	g->drawtext(xStart+columns[1], yStart+14, "Calls", 192, 192, 192, 255);
+	g->drawtext(xStart+columns[2], yStart+14, "Update", 192, 192, 192, 255);
+	g->drawtext(xStart+columns[3], yStart+14, "Graphics", 192, 192, 192, 255);
+	g->drawtext(xStart+columns[4], yStart+14, "Move", 192, 192, 192, 255);
+	g->drawtext(xStart+columns[5], yStart+14, "Share", 192, 192, 192, 255);
+
+	for (int i = 0; i < lines; i++)
+	{
+		const Row & row = rows[i];
+		int y = yStart+28+i*12;
+		pixel colour = sim->elements[row.type].Colour;
+		g->drawtext(xStart+columns[0], y, sim->elements[row.type].Name.FromUtf8(), PIXR(colour), PIXG(colour), PIXB(colour), 255);
+		g->drawtext(xStart+columns[1], y, String::Build(Format::Precision(row.calls, 0)), 255, 255, 255, 255);
+		for (int p = 0; p < ElementProfiler::PhaseCount; p++)
+			g->drawtext(xStart+columns[2+p], y, String::Build(Format::Precision(row.time[p], 1)), 255, 255, 255, 255);
+		g->drawtext(xStart+columns[5], y, String::Build(Format::Precision(frameTotal > 0 ? row.total/frameTotal*100.0 : 0.0, 1), "%"), 255, 255, 255, 255);
+	}
+}
+
+ElementCostDebug::~ElementCostDebug()
+{
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include "DebugInfo.h"
+#include "simulation/Simulation.h"
+
+class ElementCostDebug : public DebugInfo
+{
+	struct Row
+	{
+		int type;
+		double calls;
+		double time[ElementProfiler::PhaseCount];
+		double total;
+	};
+
+	Simulation * sim;
+	int frames;
+	double frameTotal;
+	std::vector<Row> rows;
+	ElementProfiler::Counter counters[PT_NUM][ElementProfiler::PhaseCount];
+public:
+	ElementCostDebug(unsigned int id, Simulation * sim);
+	virtual void Draw();
+	virtual ~ElementCostDebug();
+};
@@ -0,0 +1,52 @@
+#include "FontAtlas.h"
+#include "FontReader.h"
+
+FontAtlas::FontAtlas():
+	direct(0)
+{
+	Build();
+}
+
+void FontAtlas::Add(String::value_type ch, std::vector<size_t> & offsets)
+{
+	FontReader reader(ch);
+	Glyph glyph;
+	glyph.width = reader.GetWidth();
+	glyph.levels = NULL;
+	glyphs.push_back(glyph);
+	offsets.push_back(levels.size());
+	for (int i = 0; i < FONT_H*glyph.width; i++)
+		levels.push_back(reader.NextPixel());
+}
+
+void FontAtlas::Build()
+{
+	ranges.clear();
+	glyphs.clear();
+	levels.clear();
+	std::vector<size_t> offsets;
+	for (int i = 0; font_ranges[i][1]; i++)
+	{
+		Range range = { font_ranges[i][0], font_ranges[i][1], glyphs.size() };
+		ranges.push_back(range);
+		for (unsigned int ch = range.first; ch <= range.last; ch++)
+			Add(ch, offsets);
+	}
+	// Last of all, for everything that isn't in any of the ranges
+	Add(0xFFFD, offsets);
+	// Only now that levels won't move any more
+	for (size_t i = 0; i < glyphs.size(); i++)
+		glyphs[i].levels = levels.empty() ? NULL : &levels[offsets[i]];
+	direct = (ranges.size() && !ranges[0].first) ? ranges[0].last + 1 : 0;
+}
+
+// Ranges are in order, like FontReader looks for them
+const FontAtlas::Glyph & FontAtlas::Find(String::value_type ch) const
+{
+	for (size_t i = 0; i < ranges.size(); i++)
+		if (ranges[i].first > (unsigned int)ch)
+			break;
+		else if (ranges[i].last >= (unsigned int)ch)
+			return glyphs[ranges[i].glyph + (ch - ranges[i].first)];
+	return glyphs.back();
+}
@@ -0,0 +1,66 @@
+#ifndef FONTATLAS_H
+#define FONTATLAS_H
+
+#include <vector>
+#include "common/String.h"
+#include "font.h"
+
+// Every glyph of the font read out of font_data once, one byte per pixel holding its level from 0 to 3, so that
+// text can be measured and drawn a whole row of pixels at a time instead of going through FontReader for every
+// pixel of every character each time it is drawn
+class FontAtlas
+{
+public:
+	struct Glyph
+	{
+		int width;
+		// FONT_H rows of width levels, top to bottom
+		const unsigned char * levels;
+	};
+
+private:
+	struct Range
+	{
+		unsigned int first, last;
+		size_t glyph;
+	};
+	std::vector<Range> ranges;
+	std::vector<Glyph> glyphs;
+	std::vector<unsigned char> levels;
+	// The first range of the font starts at 0, so the characters in it are their own index into glyphs
+	size_t direct;
+
+	FontAtlas();
+	void Build();
+	void Add(String::value_type ch, std::vector<size_t> & offsets);
+	const Glyph & Find(String::value_type ch) const;
+
+	static FontAtlas & Instance()
+	{
+		static FontAtlas atlas;
+		return atlas;
+	}
+
+public:
+	// Characters that aren't in the font get the glyph of 0xFFFD, the same as FontReader gives them
+	static const Glyph & Get(String::value_type ch)
+	{
+		const FontAtlas & atlas = Instance();
+		if ((size_t)ch < atlas.direct)
+			return atlas.glyphs[ch];
+		return atlas.Find(ch);
+	}
+
+	static int GetWidth(String::value_type ch)
+	{
+		return Get(ch).width;
+	}
+
+	// Reads the font again, for the font editor, which changes it while running
+	static void Reload()
+	{
+		Instance().Build();
+	}
+};
+
+#endif
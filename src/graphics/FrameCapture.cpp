@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "Config.h"
+#include "FrameCapture.h"
+#include "Platform.h"
+#include "common/tpt-trace.h"
+
+FrameCapture::FrameCapture(ByteString path, Format format, int width, int height, int ringSize):
+	path(path),
+	format(format),
+	width(width),
+	height(height),
+	ring(ringSize, std::vector<pixel>(width*height)),
+	head(0),
+	tail(0),
+	stopping(false),
+	failed(false),
+	written(0),
+	stream(NULL),
+	captured(0),
+	dropped(0),
+	throttled(0),
+	frame(0)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	ByteString error;
+	Stop(error);
+}
+
+bool FrameCapture::Start(ByteString & error)
+{
+	if (format == ImageSequence)
+	{
+		if (!Platform::MakeDirectory(path))
+		{
+			error = "Can't create " + path;
+			return false;
+		}
+	}
+	else
+	{
+		stream = fopen(path.c_str(), "wb");
+		if (!stream)
+		{
+			error = "Can't open " + path;
+			return false;
+		}
+	}
+	writer = std::thread(&FrameCapture::Write, this);
+	return true;
+}
+
+void FrameCapture::Capture(const pixel * source, int stride)
+{
+	TRACE_ZONE("FrameCapture::Capture");
+	if (!writer.joinable() || failed.load(std::memory_order_relaxed))
+		return;
+	frame++;
+	unsigned int position = head.load(std::memory_order_relaxed);
+	unsigned int backlog = position - tail.load(std::memory_order_acquire);
+	if (backlog >= ring.size())
+	{
+		dropped++;
+		return;
+	}
+	if (backlog > ring.size()/2 && (frame & 1))
+	{
+		throttled++;
+		return;
+	}
+	pixel * buffer = ring[position % ring.size()].data();
+	for (int y = 0; y < height; y++)
+		std::copy(source + y*stride, source + y*stride + width, buffer + y*width);
+	head.store(position + 1, std::memory_order_release);
+	captured++;
+}
+
+void FrameCapture::Write()
+{
+	unsigned int position = tail.load(std::memory_order_relaxed);
+	while (true)
+	{
+		if (position == head.load(std::memory_order_acquire))
+		{
+			// Stop is called after the last Capture, so once it has been seen head is final
+			if (stopping.load(std::memory_order_acquire) && position == head.load(std::memory_order_acquire))
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		if (!WriteFrame(ring[position % ring.size()].data(), written.load(std::memory_order_relaxed)))
+		{
+			failed.store(true, std::memory_order_release);
+			break;
+		}
+		written.fetch_add(1, std::memory_order_relaxed);
+		tail.store(++position, std::memory_order_release);
+	}
+}
+
+bool FrameCapture::WriteFrame(const pixel * buffer, int index)
+{
+	TRACE_ZONE("FrameCapture::WriteFrame");
+	char header[64] = "";
+	if (format == ImageSequence)
+		sprintf(header, "P6\n%d %d\n255\n", width, height);
+	size_t headerSize = strlen(header);
+	encoded.resize(headerSize + width*height*3);
+	memcpy(encoded.data(), header, headerSize);
+	unsigned char * out = encoded.data() + headerSize;
+	for (int i = 0; i < width*height; i++)
+	{
+		*out++ = PIXR(buffer[i]);
+		*out++ = PIXG(buffer[i]);
+		*out++ = PIXB(buffer[i]);
+	}
+
+	if (format == RawStream)
+	{
+		if (fwrite(encoded.data(), 1, encoded.size(), stream) == encoded.size())
+			return true;
+		writeError = "Can't write to " + path;
+		return false;
+	}
+	char filename[32];
+	sprintf(filename, "frame_%06d.ppm", index);
+	ByteString filePath = path + PATH_SEP + filename;
+	FILE * file = fopen(filePath.c_str(), "wb");
+	bool ok = file && fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+	if (file && fclose(file))
+		ok = false;
+	if (!ok)
+		writeError = "Can't write " + filePath;
+	return ok;
+}
+
+bool FrameCapture::Stop(ByteString & error)
+{
+	if (writer.joinable())
+	{
+		stopping.store(true, std::memory_order_release);
+		writer.join();
+	}
+	if (stream)
+	{
+		if (fclose(stream) && !failed.load(std::memory_order_acquire))
+		{
+			writeError = "Can't write to " + path;
+			failed.store(true, std::memory_order_release);
+		}
+		stream = NULL;
+	}
+	if (failed.load(std::memory_order_acquire))
+	{
+		error = writeError;
+		return false;
+	}
+	return true;
+}
+
+FrameCapture::Stats FrameCapture::GetStats() const
+{
+	Stats stats = { captured, written.load(std::memory_order_relaxed), dropped, throttled };
+	return stats;
+}
@@ -0,0 +1,75 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "common/String.h"
+#include "Pixel.h"
+
+// Records the frames that are drawn without slowing drawing down. Capture only copies the frame into the next
+// buffer of a fixed ring and moves on, a writer thread encodes and writes the frames behind it. The ring is
+// the buffer pool as well, a slot is free again once the writer has moved past it, so nothing is allocated
+// while recording. The main thread is the only one that moves the head and the writer the only one that
+// moves the tail, so handing a frame over needs no lock.
+//
+// When the writer falls behind by more than half the ring only every other frame is taken, when the ring is
+// full frames are dropped. Both are counted so that a recording with gaps can be told apart.
+class FrameCapture
+{
+public:
+	enum Format
+	{
+		// A directory of numbered PPM images
+		ImageSequence,
+		// Frames back to back as 24 bit RGB without any header, for piping into an encoder, e.g.
+		// ffmpeg -f rawvideo -pixel_format rgb24 -video_size WxH -framerate 60 -i FILE out.mp4
+		RawStream,
+	};
+
+	struct Stats
+	{
+		int captured;
+		int written;
+		int dropped;
+		int throttled;
+	};
+
+private:
+	ByteString path;
+	Format format;
+	int width, height;
+	std::vector<std::vector<pixel> > ring;
+	std::atomic<unsigned int> head, tail;
+	std::atomic<bool> stopping, failed;
+	std::atomic<int> written;
+	// Set by the writer before failed is
+	ByteString writeError;
+	FILE * stream;
+	std::thread writer;
+	// Only used by the writer
+	std::vector<unsigned char> encoded;
+	// Only used by the main thread
+	int captured, dropped, throttled;
+	unsigned int frame;
+
+	void Write();
+	bool WriteFrame(const pixel * buffer, int index);
+
+public:
+	FrameCapture(ByteString path, Format format, int width, int height, int ringSize = 16);
+	~FrameCapture();
+
+	// Creates the directory or opens the stream and starts the writer
+	bool Start(ByteString & error);
+	// Takes a frame of width by height pixels, stride is the width of the whole source buffer
+	void Capture(const pixel * source, int stride);
+	// Waits for the frames that were already taken to be written, false if anything couldn't be
+	bool Stop(ByteString & error);
+
+	Stats GetStats() const;
+	ByteString GetPath() const { return path; }
+};
+
+#endif
@@ -4,9 +4,9 @@
 #include "Config.h"
 #include "Misc.h"
 #include "Graphics.h"
-#include "FontReader.h"
-#ifdef HIGH_QUALITY_RESAMPLE
-#include "resampler/resampler.h"
+#include "FontAtlas.h"
+#if defined(HIGH_QUALITY_RESAMPLE) && !defined(PIX16)
+#include "resampler/ImageResampler.h"
 #endif
 
 VideoBuffer::VideoBuffer(int width, int height):
@@ -41,14 +41,14 @@ VideoBuffer::VideoBuffer(pixel * buffer, int width, int height):
 	std::copy(buffer, buffer+(width*height), Buffer);
 }
 
-void VideoBuffer::Resize(float factor, bool resample)
+void VideoBuffer::Resize(float factor, bool resample, WorkerPool * workers)
 {
 	int newWidth = ((float)Width)*factor;
 	int newHeight = ((float)Height)*factor;
-	Resize(newWidth, newHeight, resample);
+	Resize(newWidth, newHeight, resample, true, workers);
 }
 
-void VideoBuffer::Resize(int width, int height, bool resample, bool fixedRatio)
+void VideoBuffer::Resize(int width, int height, bool resample, bool fixedRatio, WorkerPool * workers)
 {
 	int newWidth = width;
 	int newHeight = height;
@@ -71,7 +71,7 @@ void VideoBuffer::Resize(int width, int height, bool resample, bool fixedRatio)
 			newHeight = (int)(Height * (newWidth/(float)Width));
 	}
 	if(resample)
-		newBuffer = Graphics::resample_img(Buffer, Width, Height, newWidth, newHeight);
+		newBuffer = Graphics::resample_img(Buffer, Width, Height, newWidth, newHeight, workers);
 	else
 		newBuffer = Graphics::resample_img_nn(Buffer, Width, Height, newWidth, newHeight);
 
@@ -86,29 +86,32 @@ void VideoBuffer::Resize(int width, int height, bool resample, bool fixedRatio)
 
 int VideoBuffer::SetCharacter(int x, int y, String::value_type c, int r, int g, int b, int a)
 {
-	FontReader reader(c);
+	const FontAtlas::Glyph & glyph = FontAtlas::Get(c);
+	const unsigned char * levels = glyph.levels;
 	for (int j = -2; j < FONT_H - 2; j++)
-		for (int i = 0; i < reader.GetWidth(); i++)
-			SetPixel(x + i, y + j, r, g, b, reader.NextPixel() * a / 3);
-	return x + reader.GetWidth();
+		for (int i = 0; i < glyph.width; i++)
+			SetPixel(x + i, y + j, r, g, b, *(levels++) * a / 3);
+	return x + glyph.width;
 }
 
 int VideoBuffer::BlendCharacter(int x, int y, String::value_type c, int r, int g, int b, int a)
 {
-	FontReader reader(c);
+	const FontAtlas::Glyph & glyph = FontAtlas::Get(c);
+	const unsigned char * levels = glyph.levels;
 	for (int j = -2; j < FONT_H - 2; j++)
-		for (int i = 0; i < reader.GetWidth(); i++)
-			BlendPixel(x + i, y + j, r, g, b, reader.NextPixel() * a / 3);
-	return x + reader.GetWidth();
+		for (int i = 0; i < glyph.width; i++)
+			BlendPixel(x + i, y + j, r, g, b, *(levels++) * a / 3);
+	return x + glyph.width;
 }
 
 int VideoBuffer::AddCharacter(int x, int y, String::value_type c, int r, int g, int b, int a)
 {
-	FontReader reader(c);
+	const FontAtlas::Glyph & glyph = FontAtlas::Get(c);
+	const unsigned char * levels = glyph.levels;
 	for (int j = -2; j < FONT_H - 2; j++)
-		for (int i = 0; i < reader.GetWidth(); i++)
-			AddPixel(x + i, y + j, r, g, b, reader.NextPixel() * a / 3);
-	return x + reader.GetWidth();
+		for (int i = 0; i < glyph.width; i++)
+			AddPixel(x + i, y + j, r, g, b, *(levels++) * a / 3);
+	return x + glyph.width;
 }
 
 VideoBuffer::~VideoBuffer()
@@ -180,96 +183,11 @@ pixel *Graphics::resample_img_nn(pixel * src, int sw, int sh, int rw, int rh)
 	return q;
 }
 
-pixel *Graphics::resample_img(pixel *src, int sw, int sh, int rw, int rh)
+pixel *Graphics::resample_img(pixel *src, int sw, int sh, int rw, int rh, WorkerPool * workers)
 {
-#ifdef HIGH_QUALITY_RESAMPLE
-
-	unsigned char * source = (unsigned char*)src;
-	int sourceWidth = sw, sourceHeight = sh;
-	int resultWidth = rw, resultHeight = rh;
-	int sourcePitch = sourceWidth*PIXELSIZE, resultPitch = resultWidth*PIXELSIZE;
+#if defined(HIGH_QUALITY_RESAMPLE) && !defined(PIX16)
 	// Filter scale - values < 1.0 cause aliasing, but create sharper looking mips.
-	const float filter_scale = 0.75f;
-	const char* pFilter = "lanczos12";
-
-
-	Resampler * resamplers[PIXELCHANNELS];
-	float * samples[PIXELCHANNELS];
-
-	//Resampler for each colour channel
-	if (sourceWidth <= 0 || sourceHeight <= 0 || resultWidth <= 0 || resultHeight <= 0)
-		return NULL;
-	resamplers[0] = new Resampler(sourceWidth, sourceHeight, resultWidth, resultHeight, Resampler::BOUNDARY_CLAMP, 0.0f, 1.0f, pFilter, NULL, NULL, filter_scale, filter_scale);
-	samples[0] = new float[sourceWidth];
-	for (int i = 1; i < PIXELCHANNELS; i++)
-	{
-		resamplers[i] = new Resampler(sourceWidth, sourceHeight, resultWidth, resultHeight, Resampler::BOUNDARY_CLAMP, 0.0f, 1.0f, pFilter, resamplers[0]->get_clist_x(), resamplers[0]->get_clist_y(), filter_scale, filter_scale);
-		samples[i] = new float[sourceWidth];
-	}
-
-	unsigned char * resultImage = new unsigned char[resultHeight * resultPitch];
-	std::fill(resultImage, resultImage + (resultHeight*resultPitch), 0);
-
-	//Resample time
-	int resultY = 0;
-	for (int sourceY = 0; sourceY < sourceHeight; sourceY++)
-	{
-		unsigned char * sourcePixel = &source[sourceY * sourcePitch];
-
-		//Move pixel components into channel samples
-		for (int c = 0; c < PIXELCHANNELS; c++)
-		{
-			for (int x = 0; x < sourceWidth; x++)
-			{
-				samples[c][x] = sourcePixel[(x*PIXELSIZE)+c] * (1.0f/255.0f);
-			}
-		}
-
-		//Put channel sample data into resampler
-		for (int c = 0; c < PIXELCHANNELS; c++)
-		{
-			if (!resamplers[c]->put_line(&samples[c][0]))
-			{
-				printf("Out of memory!\n");
-				return NULL;
-			}
-		}
-
-		//Perform resample and Copy components from resampler result samples to image buffer
-		for ( ; ; )
-		{
-			int comp_index;
-			for (comp_index = 0; comp_index < PIXELCHANNELS; comp_index++)
-			{
-				const float* resultSamples = resamplers[comp_index]->get_line();
-				if (!resultSamples)
-					break;
-
-				unsigned char * resultPixel = &resultImage[(resultY * resultPitch) + comp_index];
-
-				for (int x = 0; x < resultWidth; x++)
-				{
-					int c = (int)(255.0f * resultSamples[x] + .5f);
-					if (c < 0) c = 0; else if (c > 255) c = 255;
-					*resultPixel = (unsigned char)c;
-					resultPixel += PIXELSIZE;
-				}
-			}
-			if (comp_index < PIXELCHANNELS)
-				break;
-
-			resultY++;
-		}
-	}
-
-	//Clean up
-	for(int i = 0; i < PIXELCHANNELS; i++)
-	{
-		delete resamplers[i];
-		delete[] samples[i];
-	}
-
-	return (pixel*)resultImage;
+	return ImageResampler::Resize(src, sw, sh, rw, rh, "lanczos12", 0.75f, workers);
 #else
 #ifdef DEBUG
 	std::cout << "Resampling " << sw << "x" << sh << " to " << rw << "x" << rh << std::endl;
@@ -422,7 +340,7 @@ pixel *Graphics::rescale_img(pixel *src, int sw, int sh, int *qw, int *qh, int f
 	return q;
 }
 
-int Graphics::textwidth(String str)
+int Graphics::textwidth(const String & str)
 {
 	int x = 0;
 	String::value_type const *s = str.c_str();
@@ -438,14 +356,14 @@ int Graphics::textwidth(String str)
 			s+=3;
 			continue;
 		}
-		x += FontReader(*s).GetWidth();
+		x += FontAtlas::GetWidth(*s);
 	}
 	return x-1;
 }
 
 int Graphics::CharWidth(String::value_type c)
 {
-	return FontReader(c).GetWidth();
+	return FontAtlas::GetWidth(c);
 }
 
 int Graphics::textnwidth(String str, int n)
@@ -466,7 +384,7 @@ int Graphics::textnwidth(String str, int n)
 			s+=3;
 			continue;
 		}
-		x += FontReader(*s).GetWidth();
+		x += FontAtlas::GetWidth(*s);
 		n--;
 	}
 	return x-1;
@@ -494,7 +412,7 @@ void Graphics::textnpos(String str, int n, int w, int *cx, int *cy)
 			if (!n) {
 				break;
 			}
-			x += FontReader(*s).GetWidth();
+			x += FontAtlas::GetWidth(*s);
 			if (x>=w)
 			{
 				x = 0;
@@ -524,7 +442,7 @@ int Graphics::textwidthx(String str, int w)
 			s+=3;
 			continue;
 		}
-		cw = FontReader(*s).GetWidth();
+		cw = FontAtlas::GetWidth(*s);
 		if (x+(cw/2) >= w)
 			break;
 		x += cw;
@@ -558,7 +476,7 @@ int Graphics::PositionAtCharIndex(String str, int charIndex, int & positionX, in
 			charIndex-=4;
 			continue;
 		}
-		x += FontReader(*s).GetWidth();
+		x += FontAtlas::GetWidth(*s);
 		charIndex--;
 	}
 	positionX = x;
@@ -588,7 +506,7 @@ int Graphics::CharIndexAtPosition(String str, int positionX, int positionY)
 			charIndex+=4;
 			continue;
 		}
-		cw = FontReader(*s).GetWidth();
+		cw = FontAtlas::GetWidth(*s);
 		if ((x+(cw/2) >= positionX && y+FONT_H >= positionY) || y > positionY)
 			break;
 		x += cw;
@@ -634,7 +552,7 @@ int Graphics::textwrapheight(String str, int width)
 			}
 			else
 			{
-				cw = FontReader(*s).GetWidth();
+				cw = FontAtlas::GetWidth(*s);
 				if (x+cw>=width)
 				{
 					x = 0;
@@ -647,7 +565,7 @@ int Graphics::textwrapheight(String str, int width)
 	return height;
 }
 
-void Graphics::textsize(String str, int & width, int & height)
+void Graphics::textsize(const String & str, int & width, int & height)
 {
 	if(!str.size())
 	{
@@ -677,7 +595,7 @@ void Graphics::textsize(String str, int & width, int & height)
 		}
 		else
 		{
-			cWidth += FontReader(*s).GetWidth();
+			cWidth += FontAtlas::GetWidth(*s);
 			if(cWidth>lWidth)
 				lWidth = cWidth;
 		}
@@ -11,8 +11,11 @@
 #include "Config.h"
 #include "common/tpt-inline.h"
 #include "Pixel.h"
+#include "Raster.h"
 #include "Icons.h"
 
+class WorkerPool;
+
 //"Graphics lite" - slightly lower performance due to variable size,
 class VideoBuffer
 {
@@ -24,8 +27,9 @@ public:
 	VideoBuffer(VideoBuffer * old);
 	VideoBuffer(pixel * buffer, int width, int height);
 	VideoBuffer(int width, int height);
-	void Resize(float factor, bool resample = false);
-	void Resize(int width, int height, bool resample = false, bool fixedRatio = true);
+	// Resampling big images is shared out between the workers if there are any
+	void Resize(float factor, bool resample = false, WorkerPool * workers = NULL);
+	void Resize(int width, int height, bool resample = false, bool fixedRatio = true, WorkerPool * workers = NULL);
 	TPT_INLINE void BlendPixel(int x, int y, int r, int g, int b, int a)
 	{
 	#ifdef PIX32OGL
@@ -42,17 +46,9 @@ public:
 		}
 		Buffer[y*(Width)+x] = PIXRGBA(r,g,b,a);
 	#else
-		pixel t;
 		if (x<0 || y<0 || x>=Width || y>=Height)
 			return;
-		if (a!=255)
-		{
-			t = Buffer[y*(Width)+x];
-			r = (a*r + (255-a)*PIXR(t)) >> 8;
-			g = (a*g + (255-a)*PIXG(t)) >> 8;
-			b = (a*b + (255-a)*PIXB(t)) >> 8;
-		}
-		Buffer[y*(Width)+x] = PIXRGB(r,g,b);
+		Buffer[y*(Width)+x] = Raster::Blend(Buffer[y*(Width)+x], r, g, b, a);
 	#endif
 	}
 
@@ -69,20 +65,9 @@ public:
 
 	TPT_INLINE void AddPixel(int x, int y, int r, int g, int b, int a)
 	{
-		pixel t;
 		if (x<0 || y<0 || x>=Width || y>=Height)
 			return;
-		t = Buffer[y*(Width)+x];
-		r = (a*r + 255*PIXR(t)) >> 8;
-		g = (a*g + 255*PIXG(t)) >> 8;
-		b = (a*b + 255*PIXB(t)) >> 8;
-		if (r>255)
-			r = 255;
-		if (g>255)
-			g = 255;
-		if (b>255)
-			b = 255;
-		Buffer[y*(Width)+x] = PIXRGB(r,g,b);
+		Buffer[y*(Width)+x] = Raster::Add(Buffer[y*(Width)+x], r, g, b, a);
 	}
 	int SetCharacter(int x, int y, String::value_type c, int r, int g, int b, int a);
 	int BlendCharacter(int x, int y, String::value_type c, int r, int g, int b, int a);
@@ -109,7 +94,7 @@ public:
 
 	//PTIF methods
 	static pixel *resample_img_nn(pixel *src, int sw, int sh, int rw, int rh);
-	static pixel *resample_img(pixel *src, int sw, int sh, int rw, int rh);
+	static pixel *resample_img(pixel *src, int sw, int sh, int rw, int rh, WorkerPool * workers = NULL);
 	static pixel *rescale_img(pixel *src, int sw, int sh, int *qw, int *qh, int f);
 
 	//Font/text metrics
@@ -120,8 +105,8 @@ public:
 	static void textnpos(String s, int n, int w, int *cx, int *cy);
 	static int textwidthx(String s, int w);
 	static int textwrapheight(String s, int width);
-	static int textwidth(String s);
-	static void textsize(String s, int & width, int & height);
+	static int textwidth(const String & s);
+	static void textsize(const String & s, int & width, int & height);
 
 	VideoBuffer DumpFrame();
 
@@ -136,8 +121,8 @@ public:
 	void Clear();
 	void Finalise();
 	//
-	int drawtext_outline(int x, int y, String s, int r, int g, int b, int a);
-	int drawtext(int x, int y, String s, int r, int g, int b, int a);
+	int drawtext_outline(int x, int y, const String & s, int r, int g, int b, int a);
+	int drawtext(int x, int y, const String & s, int r, int g, int b, int a);
 	int drawchar(int x, int y, String::value_type c, int r, int g, int b, int a);
 	int addchar(int x, int y, String::value_type c, int r, int g, int b, int a);
 
@@ -2,7 +2,7 @@
 #include <cmath>
 #include "FontReader.h"
 
-int PIXELMETHODS_CLASS::drawtext_outline(int x, int y, String s, int r, int g, int b, int a)
+int PIXELMETHODS_CLASS::drawtext_outline(int x, int y, const String & s, int r, int g, int b, int a)
 {
 	drawtext(x-1, y-1, s, 0, 0, 0, 120);
 	drawtext(x+1, y+1, s, 0, 0, 0, 120);
@@ -13,7 +13,7 @@ int PIXELMETHODS_CLASS::drawtext_outline(int x, int y, String s, int r, int g, i
 	return drawtext(x, y, s, r, g, b, a);
 }
 
-int PIXELMETHODS_CLASS::drawtext(int x, int y, String str, int r, int g, int b, int a)
+int PIXELMETHODS_CLASS::drawtext(int x, int y, const String & str, int r, int g, int b, int a)
 {
 	bool invert = false;
 	if(!str.length())
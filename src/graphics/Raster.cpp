@@ -0,0 +1,298 @@
+#include <algorithm>
+#include "Raster.h"
+
+#if !defined(PIX16) && (defined(__SSE2__) || defined(__AVX2__))
+#define RASTER_VECTOR
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#endif
+
+namespace Raster
+{
+#ifdef RASTER_VECTOR
+	// The vector kernels work on all four bytes of a pixel alike, widened to 16 bits so that nothing overflows:
+	// a*c + (255-a)*t and a*c + 255*t are both at most 2*255*255, and the latter is only ever clamped to 255
+	// after the shift, so saturating at 65535 gives the same result. The byte that isn't a channel is put back to
+	// whatever PIXRGB puts there afterwards.
+	static const pixel channelBits = PIXRGB(255, 255, 255) ^ PIXRGB(0, 0, 0);
+	static const pixel fixedBits = PIXRGB(0, 0, 0);
+
+	struct Sse2
+	{
+		typedef __m128i Vector;
+		static const int pixels = 4;
+		static Vector Load(const pixel * p) { return _mm_loadu_si128((const __m128i *)p); }
+		static void Store(pixel * p, Vector v) { _mm_storeu_si128((__m128i *)p, v); }
+		static Vector Zero() { return _mm_setzero_si128(); }
+		static Vector Set16(int v) { return _mm_set1_epi16(v); }
+		static Vector Set32(pixel v) { return _mm_set1_epi32(v); }
+		static Vector Low(Vector v, Vector zero) { return _mm_unpacklo_epi8(v, zero); }
+		static Vector High(Vector v, Vector zero) { return _mm_unpackhi_epi8(v, zero); }
+		static Vector Pack(Vector low, Vector high) { return _mm_packus_epi16(low, high); }
+		static Vector Mul(Vector a, Vector b) { return _mm_mullo_epi16(a, b); }
+		static Vector Add(Vector a, Vector b) { return _mm_add_epi16(a, b); }
+		static Vector AddSaturate(Vector a, Vector b) { return _mm_adds_epu16(a, b); }
+		static Vector Shift(Vector v) { return _mm_srli_epi16(v, 8); }
+		static Vector SubtractSaturate(Vector a, Vector b) { return _mm_subs_epu8(a, b); }
+		static Vector Finish(Vector v, Vector keep, Vector fixed) { return _mm_or_si128(_mm_and_si128(v, keep), fixed); }
+	};
+
+#ifdef __AVX2__
+	// Unpacking and packing both work within 128 bit halves, so pixels come out in the order they went in
+	struct Avx2
+	{
+		typedef __m256i Vector;
+		static const int pixels = 8;
+		static Vector Load(const pixel * p) { return _mm256_loadu_si256((const __m256i *)p); }
+		static void Store(pixel * p, Vector v) { _mm256_storeu_si256((__m256i *)p, v); }
+		static Vector Zero() { return _mm256_setzero_si256(); }
+		static Vector Set16(int v) { return _mm256_set1_epi16(v); }
+		static Vector Set32(pixel v) { return _mm256_set1_epi32(v); }
+		static Vector Low(Vector v, Vector zero) { return _mm256_unpacklo_epi8(v, zero); }
+		static Vector High(Vector v, Vector zero) { return _mm256_unpackhi_epi8(v, zero); }
+		static Vector Pack(Vector low, Vector high) { return _mm256_packus_epi16(low, high); }
+		static Vector Mul(Vector a, Vector b) { return _mm256_mullo_epi16(a, b); }
+		static Vector Add(Vector a, Vector b) { return _mm256_add_epi16(a, b); }
+		static Vector AddSaturate(Vector a, Vector b) { return _mm256_adds_epu16(a, b); }
+		static Vector Shift(Vector v) { return _mm256_srli_epi16(v, 8); }
+		static Vector SubtractSaturate(Vector a, Vector b) { return _mm256_subs_epu8(a, b); }
+		static Vector Finish(Vector v, Vector keep, Vector fixed) { return _mm256_or_si256(_mm256_and_si256(v, keep), fixed); }
+	};
+#endif
+
+	// Each kernel does as many whole vectors as fit and moves row and count past them, the caller finishes the rest
+	template<class V>
+	static void BlendVectors(pixel *& row, int & count, int r, int g, int b, int a)
+	{
+		typedef typename V::Vector Vector;
+		Vector zero = V::Zero(), keep = V::Set32(channelBits), fixed = V::Set32(fixedBits);
+		Vector colour = V::Mul(V::Low(V::Set32(PIXRGB(r, g, b)), zero), V::Set16(a));
+		Vector inverse = V::Set16(255-a);
+		for (; count >= V::pixels; count -= V::pixels, row += V::pixels)
+		{
+			Vector t = V::Load(row);
+			Vector low = V::Shift(V::Add(colour, V::Mul(V::Low(t, zero), inverse)));
+			Vector high = V::Shift(V::Add(colour, V::Mul(V::High(t, zero), inverse)));
+			V::Store(row, V::Finish(V::Pack(low, high), keep, fixed));
+		}
+	}
+
+	template<class V>
+	static void AddVectors(pixel *& row, int & count, int r, int g, int b, int a)
+	{
+		typedef typename V::Vector Vector;
+		Vector zero = V::Zero(), keep = V::Set32(channelBits), fixed = V::Set32(fixedBits);
+		Vector colour = V::Mul(V::Low(V::Set32(PIXRGB(r, g, b)), zero), V::Set16(a));
+		Vector full = V::Set16(255);
+		for (; count >= V::pixels; count -= V::pixels, row += V::pixels)
+		{
+			Vector t = V::Load(row);
+			Vector low = V::Shift(V::AddSaturate(colour, V::Mul(V::Low(t, zero), full)));
+			Vector high = V::Shift(V::AddSaturate(colour, V::Mul(V::High(t, zero), full)));
+			V::Store(row, V::Finish(V::Pack(low, high), keep, fixed));
+		}
+	}
+
+	template<class V>
+	static void BlendImageVectors(pixel *& row, const pixel *& source, int & count, int a)
+	{
+		typedef typename V::Vector Vector;
+		Vector zero = V::Zero(), keep = V::Set32(channelBits), fixed = V::Set32(fixedBits);
+		Vector alpha = V::Set16(a), inverse = V::Set16(255-a);
+		for (; count >= V::pixels; count -= V::pixels, row += V::pixels, source += V::pixels)
+		{
+			Vector s = V::Load(source), t = V::Load(row);
+			Vector low = V::Shift(V::Add(V::Mul(V::Low(s, zero), alpha), V::Mul(V::Low(t, zero), inverse)));
+			Vector high = V::Shift(V::Add(V::Mul(V::High(s, zero), alpha), V::Mul(V::High(t, zero), inverse)));
+			V::Store(row, V::Finish(V::Pack(low, high), keep, fixed));
+		}
+	}
+
+	template<class V>
+	static void FadeVectors(pixel *& row, const pixel *& source, int & count)
+	{
+		typedef typename V::Vector Vector;
+		Vector keep = V::Set32(channelBits), fixed = V::Set32(fixedBits), step = V::Set32(PIXRGB(1, 1, 1));
+		for (; count >= V::pixels; count -= V::pixels, row += V::pixels, source += V::pixels)
+			V::Store(row, V::Finish(V::SubtractSaturate(V::Load(source), step), keep, fixed));
+	}
+
+	// Only SSE2, the rows this is used for are too short for anything wider to pay for spreading the alphas out
+	static void AddAlphaVectors(pixel *& row, const int *& alphas, int & count, int r, int g, int b)
+	{
+		__m128i zero = _mm_setzero_si128(), keep = _mm_set1_epi32(channelBits), fixed = _mm_set1_epi32(fixedBits);
+		__m128i colour = _mm_unpacklo_epi8(_mm_set1_epi32(PIXRGB(r, g, b)), zero);
+		__m128i full = _mm_set1_epi16(255);
+		for (; count >= Sse2::pixels; count -= Sse2::pixels, row += Sse2::pixels, alphas += Sse2::pixels)
+		{
+			// Four alphas become one 16 bit lane for every byte of their pixel
+			__m128i a = _mm_loadu_si128((const __m128i *)alphas);
+			a = _mm_packs_epi32(a, a);
+			a = _mm_unpacklo_epi16(a, a);
+			__m128i alphaLow = _mm_unpacklo_epi32(a, a), alphaHigh = _mm_unpackhi_epi32(a, a);
+			__m128i t = _mm_loadu_si128((const __m128i *)row);
+			__m128i low = _mm_adds_epu16(_mm_mullo_epi16(colour, alphaLow), _mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), full));
+			__m128i high = _mm_adds_epu16(_mm_mullo_epi16(colour, alphaHigh), _mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), full));
+			low = _mm_srli_epi16(low, 8);
+			high = _mm_srli_epi16(high, 8);
+			_mm_storeu_si128((__m128i *)row, _mm_or_si128(_mm_and_si128(_mm_packus_epi16(low, high), keep), fixed));
+		}
+	}
+
+	// The same for blending, where a pixel with an alpha of 255 is set to the colour rather than blended with it
+	static void BlendAlphaVectors(pixel *& row, const int *& alphas, int & count, int r, int g, int b)
+	{
+		__m128i zero = _mm_setzero_si128(), keep = _mm_set1_epi32(channelBits), fixed = _mm_set1_epi32(fixedBits);
+		__m128i solid = _mm_set1_epi32(PIXRGB(r, g, b));
+		__m128i colour = _mm_unpacklo_epi8(solid, zero);
+		__m128i full = _mm_set1_epi16(255), opaque = _mm_set1_epi32(255);
+		for (; count >= Sse2::pixels; count -= Sse2::pixels, row += Sse2::pixels, alphas += Sse2::pixels)
+		{
+			__m128i alpha = _mm_loadu_si128((const __m128i *)alphas);
+			__m128i a = _mm_packs_epi32(alpha, alpha);
+			a = _mm_unpacklo_epi16(a, a);
+			__m128i alphaLow = _mm_unpacklo_epi32(a, a), alphaHigh = _mm_unpackhi_epi32(a, a);
+			__m128i t = _mm_loadu_si128((const __m128i *)row);
+			__m128i low = _mm_add_epi16(_mm_mullo_epi16(colour, alphaLow), _mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), _mm_sub_epi16(full, alphaLow)));
+			__m128i high = _mm_add_epi16(_mm_mullo_epi16(colour, alphaHigh), _mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), _mm_sub_epi16(full, alphaHigh)));
+			low = _mm_srli_epi16(low, 8);
+			high = _mm_srli_epi16(high, 8);
+			__m128i blended = _mm_or_si128(_mm_and_si128(_mm_packus_epi16(low, high), keep), fixed);
+			__m128i set = _mm_cmpeq_epi32(alpha, opaque);
+			_mm_storeu_si128((__m128i *)row, _mm_or_si128(_mm_and_si128(set, solid), _mm_andnot_si128(set, blended)));
+		}
+	}
+
+	// Only for a scale of four, which is what the air display uses with the usual cell size, every pixel of the
+	// source fills a whole SSE2 vector
+	static void ScaleVectors(pixel *& row, const pixel *& source, int & count)
+	{
+		for (; count >= Sse2::pixels; count -= Sse2::pixels, source += Sse2::pixels, row += Sse2::pixels*4)
+		{
+			__m128i s = _mm_loadu_si128((const __m128i *)source);
+			_mm_storeu_si128((__m128i *)row, _mm_shuffle_epi32(s, 0x00));
+			_mm_storeu_si128((__m128i *)(row+4), _mm_shuffle_epi32(s, 0x55));
+			_mm_storeu_si128((__m128i *)(row+8), _mm_shuffle_epi32(s, 0xAA));
+			_mm_storeu_si128((__m128i *)(row+12), _mm_shuffle_epi32(s, 0xFF));
+		}
+	}
+
+	// Anything outside of 0 to 255 wouldn't fit the 16 bit lanes, and is left to the scalar code, which carries
+	// on as it always did
+	static bool Vectorisable(int r, int g, int b, int a)
+	{
+		return !((r | g | b | a) & ~0xFF);
+	}
+#endif
+
+	void BlendRow(pixel * row, int count, int r, int g, int b, int a)
+	{
+		if (a == 255)
+		{
+			std::fill(row, row + count, (pixel)PIXRGB(r, g, b));
+			return;
+		}
+#ifdef RASTER_VECTOR
+		if (Vectorisable(r, g, b, a))
+		{
+#ifdef __AVX2__
+			BlendVectors<Avx2>(row, count, r, g, b, a);
+#endif
+			BlendVectors<Sse2>(row, count, r, g, b, a);
+		}
+#endif
+		for (int i = 0; i < count; i++)
+			row[i] = Blend(row[i], r, g, b, a);
+	}
+
+	void AddRow(pixel * row, int count, int r, int g, int b, int a)
+	{
+#ifdef RASTER_VECTOR
+		if (Vectorisable(r, g, b, a))
+		{
+#ifdef __AVX2__
+			AddVectors<Avx2>(row, count, r, g, b, a);
+#endif
+			AddVectors<Sse2>(row, count, r, g, b, a);
+		}
+#endif
+		for (int i = 0; i < count; i++)
+			row[i] = Add(row[i], r, g, b, a);
+	}
+
+	void AddRowAlphas(pixel * row, const int * alphas, int count, int r, int g, int b)
+	{
+#ifdef RASTER_VECTOR
+		int all = r | g | b;
+		for (int i = 0; i < count; i++)
+			all |= alphas[i];
+		if (Vectorisable(all, 0, 0, 0))
+			AddAlphaVectors(row, alphas, count, r, g, b);
+#endif
+		for (int i = 0; i < count; i++)
+			row[i] = Add(row[i], r, g, b, alphas[i]);
+	}
+
+	void BlendRowAlphas(pixel * row, const int * alphas, int count, int r, int g, int b)
+	{
+#ifdef RASTER_VECTOR
+		int all = r | g | b;
+		for (int i = 0; i < count; i++)
+			all |= alphas[i];
+		if (Vectorisable(all, 0, 0, 0))
+			BlendAlphaVectors(row, alphas, count, r, g, b);
+#endif
+		for (int i = 0; i < count; i++)
+			row[i] = Blend(row[i], r, g, b, alphas[i]);
+	}
+
+	void BlendImageRow(pixel * row, const pixel * source, int count, int a)
+	{
+#ifdef RASTER_VECTOR
+		// Source pixels have their channels in range by construction, the byte that isn't a channel goes through
+		// the lanes like the others and is replaced afterwards
+		if (a != 255 && Vectorisable(0, 0, 0, a))
+		{
+#ifdef __AVX2__
+			BlendImageVectors<Avx2>(row, source, count, a);
+#endif
+			BlendImageVectors<Sse2>(row, source, count, a);
+		}
+#endif
+		for (int i = 0; i < count; i++)
+			row[i] = Blend(row[i], PIXR(source[i]), PIXG(source[i]), PIXB(source[i]), a);
+	}
+
+	void FadeRow(pixel * row, const pixel * source, int count)
+	{
+#ifdef RASTER_VECTOR
+#ifdef __AVX2__
+		FadeVectors<Avx2>(row, source, count);
+#endif
+		FadeVectors<Sse2>(row, source, count);
+#endif
+		for (int i = 0; i < count; i++)
+		{
+			int r = PIXR(source[i]), g = PIXG(source[i]), b = PIXB(source[i]);
+			if (r>0)
+				r--;
+			if (g>0)
+				g--;
+			if (b>0)
+				b--;
+			row[i] = PIXRGB(r,g,b);
+		}
+	}
+
+	void ScaleRow(pixel * row, const pixel * source, int count, int scale)
+	{
+#ifdef RASTER_VECTOR
+		if (scale == 4)
+			ScaleVectors(row, source, count);
+#endif
+		for (int i = 0; i < count; i++, row += scale)
+			std::fill(row, row + scale, source[i]);
+	}
+}
@@ -0,0 +1,125 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "Pixel.h"
+
+// Software pixel blending shared by the drawing methods of Graphics and Renderer, VideoBuffer and the particle
+// renderer. Blend and Add are what blendpixel and addpixel do to a single pixel. The Row functions do the same
+// to a run of pixels, several at a time with SSE2 or AVX2 where the build allows it, with results identical to
+// going pixel by pixel.
+namespace Raster
+{
+	inline pixel Blend(pixel t, int r, int g, int b, int a)
+	{
+		if (a!=255)
+		{
+			r = (a*r + (255-a)*PIXR(t)) >> 8;
+			g = (a*g + (255-a)*PIXG(t)) >> 8;
+			b = (a*b + (255-a)*PIXB(t)) >> 8;
+		}
+		return PIXRGB(r,g,b);
+	}
+
+	inline pixel Add(pixel t, int r, int g, int b, int a)
+	{
+		r = (a*r + 255*PIXR(t)) >> 8;
+		g = (a*g + 255*PIXG(t)) >> 8;
+		b = (a*b + 255*PIXB(t)) >> 8;
+		if (r>255)
+			r = 255;
+		if (g>255)
+			g = 255;
+		if (b>255)
+			b = 255;
+		return PIXRGB(r,g,b);
+	}
+
+	// Blend or Add the same colour to count pixels starting at row, which have to be inside the buffer
+	void BlendRow(pixel * row, int count, int r, int g, int b, int a);
+	void AddRow(pixel * row, int count, int r, int g, int b, int a);
+	// Add or Blend the same colour with a different alpha for every pixel
+	void AddRowAlphas(pixel * row, const int * alphas, int count, int r, int g, int b);
+	void BlendRowAlphas(pixel * row, const int * alphas, int count, int r, int g, int b);
+	// Blends every source pixel over the one it lands on with the same alpha
+	void BlendImageRow(pixel * row, const pixel * source, int count, int a);
+	// Copies count source pixels with every channel one step darker, down to 0
+	void FadeRow(pixel * row, const pixel * source, int count);
+	// Writes each of count source pixels scale times in a row, for blowing up something drawn at a lower resolution
+	void ScaleRow(pixel * row, const pixel * source, int count, int scale);
+
+	// The part of a pixel buffer that drawing is limited to, from left to right and top to bottom with right and
+	// bottom not included. Everything that falls outside of it is dropped, spans are cut down to the part that
+	// is inside before the Row functions get them.
+	struct Target
+	{
+		pixel * vid;
+		int stride;
+		int left, top, right, bottom;
+
+		// Cuts the span of count pixels starting at x, y down to the part inside, false if nothing is left
+		bool Clip(int & x, int y, int & count) const
+		{
+			if (y < top || y >= bottom)
+				return false;
+			if (x < left)
+			{
+				count -= left - x;
+				x = left;
+			}
+			if (count > right - x)
+				count = right - x;
+			return count > 0;
+		}
+
+		void BlendPixel(int x, int y, int r, int g, int b, int a)
+		{
+			if (x < left || y < top || x >= right || y >= bottom)
+				return;
+			vid[y*stride+x] = Blend(vid[y*stride+x], r, g, b, a);
+		}
+
+		void AddPixel(int x, int y, int r, int g, int b, int a)
+		{
+			if (x < left || y < top || x >= right || y >= bottom)
+				return;
+			vid[y*stride+x] = Add(vid[y*stride+x], r, g, b, a);
+		}
+
+		void BlendSpan(int x, int y, int count, int r, int g, int b, int a)
+		{
+			if (Clip(x, y, count))
+				BlendRow(vid + y*stride + x, count, r, g, b, a);
+		}
+
+		void AddSpan(int x, int y, int count, int r, int g, int b, int a)
+		{
+			if (Clip(x, y, count))
+				AddRow(vid + y*stride + x, count, r, g, b, a);
+		}
+
+		// alphas holds one alpha for each of the count pixels, whatever gets cut off is skipped over
+		void AddSpanAlphas(int x, int y, int count, const int * alphas, int r, int g, int b)
+		{
+			int start = x;
+			if (Clip(x, y, count))
+				AddRowAlphas(vid + y*stride + x, alphas + (x - start), count, r, g, b);
+		}
+
+		void BlendSpanAlphas(int x, int y, int count, const int * alphas, int r, int g, int b)
+		{
+			int start = x;
+			if (Clip(x, y, count))
+				BlendRowAlphas(vid + y*stride + x, alphas + (x - start), count, r, g, b);
+		}
+
+		// The same for source, which holds the count pixels that go from x onwards
+		void BlendImageSpan(int x, int y, const pixel * source, int count, int a)
+		{
+			int start = x;
+			if (Clip(x, y, count))
+				BlendImageRow(vid + y*stride + x, source + (x - start), count, a);
+		}
+	};
+}
+
+#endif
@@ -1,7 +1,84 @@
+#include <algorithm>
 #include <cmath>
-#include "FontReader.h"
+#include "FontAtlas.h"
+#include "Raster.h"
 
-int PIXELMETHODS_CLASS::drawtext_outline(int x, int y, String s, int r, int g, int b, int a)
+// Spans are clipped to the whole buffer, the same as blendpixel clips single pixels
+static Raster::Target WholeBuffer(pixel * vid)
+{
+	Raster::Target target = { vid, VIDXRES, 0, 0, VIDXRES, VIDYRES };
+	return target;
+}
+
+// Glyphs that follow each other on a line in the same colour, blended a whole row of pixels of all of them at a
+// time. Glyphs never overlap, so this comes out the same as drawing them one after the other.
+class TextRun
+{
+	static const int MAX_GLYPHS = 128;
+	static const int MAX_WIDTH = 1024;
+	const FontAtlas::Glyph * glyphs[MAX_GLYPHS];
+	int alphas[MAX_WIDTH];
+	int count, width;
+	int x, y;
+
+public:
+	TextRun(int x, int y):
+		count(0),
+		width(0),
+		x(x),
+		y(y)
+	{
+	}
+
+	// Moves on to the start of another line, or past whatever has been drawn, after Draw
+	void MoveTo(int newX, int newY)
+	{
+		x = newX;
+		y = newY;
+	}
+
+	int GetX() const
+	{
+		return x + width;
+	}
+
+	// False if the glyph doesn't fit any more and the run has to be drawn first
+	bool Add(const FontAtlas::Glyph & glyph)
+	{
+		if (count == MAX_GLYPHS || width + glyph.width > MAX_WIDTH)
+			return false;
+		glyphs[count++] = &glyph;
+		width += glyph.width;
+		return true;
+	}
+
+	// Draws everything added so far, the same as drawchar would, and starts over just after it
+	void Draw(Raster::Target target, int r, int g, int b, int a)
+	{
+		if (count)
+		{
+			int levelAlphas[4] = { 0*a/3, 1*a/3, 2*a/3, 3*a/3 };
+			for (int j = 0; j < FONT_H; j++)
+			{
+				if (y - 2 + j < target.top || y - 2 + j >= target.bottom)
+					continue;
+				int * out = alphas;
+				for (int k = 0; k < count; k++)
+				{
+					const unsigned char * levels = glyphs[k]->levels + j*glyphs[k]->width;
+					for (int i = 0; i < glyphs[k]->width; i++)
+						*(out++) = levelAlphas[levels[i]];
+				}
+				target.BlendSpanAlphas(x, y - 2 + j, width, alphas, r, g, b);
+			}
+		}
+		x += width;
+		count = 0;
+		width = 0;
+	}
+};
+
+int PIXELMETHODS_CLASS::drawtext_outline(int x, int y, const String & s, int r, int g, int b, int a)
 {
 	drawtext(x-1, y-1, s, 0, 0, 0, 120);
 	drawtext(x+1, y+1, s, 0, 0, 0, 120);
@@ -12,22 +89,26 @@ int PIXELMETHODS_CLASS::drawtext_outline(int x, int y, String s, int r, int g, i
 	return drawtext(x, y, s, r, g, b, a);
 }
 
-int PIXELMETHODS_CLASS::drawtext(int x, int y, String str, int r, int g, int b, int a)
+int PIXELMETHODS_CLASS::drawtext(int x, int y, const String & str, int r, int g, int b, int a)
 {
 	if(!str.size())
 		return 0;
 
+	Raster::Target target = WholeBuffer(vid);
 	int invert = 0;
 	int oR = r, oG = g, oB = b;
-	int characterX = x, characterY = y;
-	int startX = characterX;
+	int characterY = y;
+	TextRun run(x, y);
 	String::value_type const *s = str.c_str();
 	for (; *s; s++)
 	{
+		// Anything that isn't a glyph ends the run, whether it changes the colour or not
+		if (*s == '\n' || *s == '\x0F' || *s == '\x0E' || *s == '\x01' || *s == '\b')
+			run.Draw(target, r, g, b, a);
 		if (*s == '\n')
 		{
-			characterX = startX;
 			characterY += FONT_H;
+			run.MoveTo(x, characterY);
 		}
 		else if (*s == '\x0F')
 		{
@@ -97,28 +178,39 @@ int PIXELMETHODS_CLASS::drawtext(int x, int y, String str, int r, int g, int b,
 		}
 		else
 		{
-			characterX = drawchar(characterX, characterY, *s, r, g, b, a);
+			const FontAtlas::Glyph & glyph = FontAtlas::Get(*s);
+			if (!run.Add(glyph))
+			{
+				run.Draw(target, r, g, b, a);
+				run.Add(glyph);
+			}
 		}
 	}
+	run.Draw(target, r, g, b, a);
 	return x;
 }
 
 int PIXELMETHODS_CLASS::drawchar(int x, int y, String::value_type c, int r, int g, int b, int a)
 {
-	FontReader reader(c);
-	for (int j = -2; j < FONT_H - 2; j++)
-		for (int i = 0; i < reader.GetWidth(); i++)
-			blendpixel(x + i, y + j, r, g, b, reader.NextPixel() * a / 3);
-	return x + reader.GetWidth();
+	TextRun run(x, y);
+	run.Add(FontAtlas::Get(c));
+	run.Draw(WholeBuffer(vid), r, g, b, a);
+	return run.GetX();
 }
 
 int PIXELMETHODS_CLASS::addchar(int x, int y, String::value_type c, int r, int g, int b, int a)
 {
-	FontReader reader(c);
-	for (int j = -2; j < FONT_H - 2; j++)
-		for (int i = 0; i < reader.GetWidth(); i++)
-			addpixel(x + i, y + j, r, g, b, reader.NextPixel() * a / 3);
-	return x + reader.GetWidth();
+	const FontAtlas::Glyph & glyph = FontAtlas::Get(c);
+	Raster::Target target = WholeBuffer(vid);
+	int levelAlphas[4] = { 0*a/3, 1*a/3, 2*a/3, 3*a/3 };
+	int alphas[256];
+	for (int j = 0; j < FONT_H; j++)
+	{
+		for (int i = 0; i < glyph.width; i++)
+			alphas[i] = levelAlphas[glyph.levels[j*glyph.width + i]];
+		target.AddSpanAlphas(x, y - 2 + j, glyph.width, alphas, r, g, b);
+	}
+	return x + glyph.width;
 }
 
 TPT_INLINE void PIXELMETHODS_CLASS::xor_pixel(int x, int y)
@@ -136,35 +228,16 @@ TPT_INLINE void PIXELMETHODS_CLASS::xor_pixel(int x, int y)
 
 void PIXELMETHODS_CLASS::blendpixel(int x, int y, int r, int g, int b, int a)
 {
-	pixel t;
 	if (x<0 || y<0 || x>=VIDXRES || y>=VIDYRES)
 		return;
-	if (a!=255)
-	{
-		t = vid[y*(VIDXRES)+x];
-		r = (a*r + (255-a)*PIXR(t)) >> 8;
-		g = (a*g + (255-a)*PIXG(t)) >> 8;
-		b = (a*b + (255-a)*PIXB(t)) >> 8;
-	}
-	vid[y*(VIDXRES)+x] = PIXRGB(r,g,b);
+	vid[y*(VIDXRES)+x] = Raster::Blend(vid[y*(VIDXRES)+x], r, g, b, a);
 }
 
 void PIXELMETHODS_CLASS::addpixel(int x, int y, int r, int g, int b, int a)
 {
-	pixel t;
 	if (x<0 || y<0 || x>=VIDXRES || y>=VIDYRES)
 		return;
-	t = vid[y*(VIDXRES)+x];
-	r = (a*r + 255*PIXR(t)) >> 8;
-	g = (a*g + 255*PIXG(t)) >> 8;
-	b = (a*b + 255*PIXB(t)) >> 8;
-	if (r>255)
-		r = 255;
-	if (g>255)
-		g = 255;
-	if (b>255)
-		b = 255;
-	vid[y*(VIDXRES)+x] = PIXRGB(r,g,b);
+	vid[y*(VIDXRES)+x] = Raster::Add(vid[y*(VIDXRES)+x], r, g, b, a);
 }
 
 void PIXELMETHODS_CLASS::xor_line(int x1, int y1, int x2, int y2)
@@ -288,19 +361,35 @@ void PIXELMETHODS_CLASS::draw_line(int x1, int y1, int x2, int y2, int r, int g,
 		de = 0.0f;
 	y = y1;
 	sy = (y1<y2) ? 1 : -1;
-	for (x=x1; x<=x2; x++)
+	if (cp)
 	{
-		if (cp)
+		for (x=x1; x<=x2; x++)
+		{
 			blendpixel(y, x, r, g, b, a);
-		else
-			blendpixel(x, y, r, g, b, a);
+			e += de;
+			if (e >= 0.5f)
+			{
+				y += sy;
+				e -= 1.0f;
+			}
+		}
+		return;
+	}
+	// Mostly horizontal lines are drawn as one span for every row they cross
+	Raster::Target target = WholeBuffer(vid);
+	int start = x1;
+	for (x=x1; x<=x2; x++)
+	{
 		e += de;
 		if (e >= 0.5f)
 		{
+			target.BlendSpan(start, y, x+1-start, r, g, b, a);
+			start = x+1;
 			y += sy;
 			e -= 1.0f;
 		}
 	}
+	target.BlendSpan(start, y, x2+1-start, r, g, b, a);
 }
 
 void PIXELMETHODS_CLASS::drawrect(int x, int y, int w, int h, int r, int g, int b, int a)
@@ -308,11 +397,9 @@ void PIXELMETHODS_CLASS::drawrect(int x, int y, int w, int h, int r, int g, int
 	int i;
 	w--;
 	h--;
-	for (i=0; i<=w; i++)
-	{
-		blendpixel(x+i, y, r, g, b, a);
-		blendpixel(x+i, y+h, r, g, b, a);
-	}
+	Raster::Target target = WholeBuffer(vid);
+	target.BlendSpan(x, y, w+1, r, g, b, a);
+	target.BlendSpan(x, y+h, w+1, r, g, b, a);
 	for (i=1; i<h; i++)
 	{
 		blendpixel(x, y+i, r, g, b, a);
@@ -322,10 +409,9 @@ void PIXELMETHODS_CLASS::drawrect(int x, int y, int w, int h, int r, int g, int
 
 void PIXELMETHODS_CLASS::fillrect(int x, int y, int w, int h, int r, int g, int b, int a)
 {
-	int i,j;
-	for (j=0; j<h; j++)
-		for (i=0; i<w; i++)
-			blendpixel(x+i, y+j, r, g, b, a);
+	Raster::Target target = WholeBuffer(vid);
+	for (int j=0; j<h; j++)
+		target.BlendSpan(x, y+j, w, r, g, b, a);
 }
 
 void PIXELMETHODS_CLASS::drawcircle(int x, int y, int rx, int ry, int r, int g, int b, int a)
@@ -445,27 +531,16 @@ void PIXELMETHODS_CLASS::draw_image(pixel *img, int x, int y, int w, int h, int
 	if (a >= 255)
 		for (int j = 0; j < h; j++)
 		{
-			img += startX;
-			for (int i = startX; i < w; i++)
-			{
-				vid[(y+j)*(VIDXRES)+(x+i)] = *img;
-				img++;
-			}
+			std::copy(img + startX, img + w, vid + (y+j)*(VIDXRES) + x + startX);
+			img += w;
 		}
 	else
 	{
-		int r, g, b;
+		Raster::Target target = WholeBuffer(vid);
 		for (int j = 0; j < h; j++)
 		{
-			img += startX;
-			for (int i = startX; i < w; i++)
-			{
-				r = PIXR(*img);
-				g = PIXG(*img);
-				b = PIXB(*img);
-				blendpixel(x+i, y+j, r, g, b, a);
-				img++;
-			}
+			target.BlendImageSpan(x+startX, y+j, img+startX, w-startX, a);
+			img += w;
 		}
 	}
 }
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <cmath>
 #include <iostream>
 #include <iomanip>
@@ -8,9 +9,12 @@
 #include "Misc.h"
 #include "Renderer.h"
 #include "Graphics.h"
+#include "Raster.h"
 #include "common/tpt-compat.h"
 #include "common/tpt-minmax.h"
 #include "common/tpt-rand.h"
+#include "common/tpt-trace.h"
+#include "common/WorkerPool.h"
 #include "gui/game/RenderPreset.h"
 #include "simulation/Elements.h"
 #include "simulation/ElementGraphics.h"
@@ -35,6 +39,7 @@
 
 void Renderer::RenderBegin()
 {
+	TRACE_ZONE("RenderBegin");
 #ifdef OGLI
 #ifdef OGLR
 	draw_air();
@@ -67,22 +72,7 @@ void Renderer::RenderBegin()
 	DrawWalls();
 	render_parts();
 	if(display_mode & DISPLAY_PERS)
-	{
-		int i,r,g,b;
-		for (i = 0; i < VIDXRES*YRES; i++)
-		{
-			r = PIXR(vid[i]);
-			g = PIXG(vid[i]);
-			b = PIXB(vid[i]);
-			if (r>0)
-				r--;
-			if (g>0)
-				g--;
-			if (b>0)
-				b--;
-			persistentVid[i] = PIXRGB(r,g,b);
-		}
-	}
+		StorePersistent();
 
 	render_fire();
 	draw_other();
@@ -94,6 +84,15 @@ void Renderer::RenderBegin()
 	}
 #endif
 #else
+	if (incrementalRendering && RenderIncremental())
+	{
+		draw_other();
+		draw_grav_zones();
+		DrawSigns();
+		FinaliseParts();
+		return;
+	}
+
 	if(display_mode & DISPLAY_PERS)
 	{
 		std::copy(persistentVid, persistentVid+(VIDXRES*YRES), vid);
@@ -111,24 +110,13 @@ void Renderer::RenderBegin()
 	DrawWalls();
 	render_parts();
 	if(display_mode & DISPLAY_PERS)
-	{
-		int i,r,g,b;
-		for (i = 0; i < VIDXRES*YRES; i++)
-		{
-			r = PIXR(vid[i]);
-			g = PIXG(vid[i]);
-			b = PIXB(vid[i]);
-			if (r>0)
-				r--;
-			if (g>0)
-				g--;
-			if (b>0)
-				b--;
-			persistentVid[i] = PIXRGB(r,g,b);
-		}
-	}
+		StorePersistent();
 
 	render_fire();
+	if (incrementalRendering)
+		StoreTiles();
+	else
+		MarkAllDirty();
 	draw_other();
 	draw_grav_zones();
 	DrawSigns();
@@ -144,6 +132,7 @@ void Renderer::RenderBegin()
 
 void Renderer::RenderEnd()
 {
+	TRACE_ZONE("RenderEnd");
 #ifdef OGLI
 #ifdef OGLR
 	glTranslated(0, -MENUSIZE, 0);
@@ -159,6 +148,236 @@ void Renderer::RenderEnd()
 #endif
 }
 
+#if !defined(OGLR) && !defined(OGLI)
+static inline unsigned int HashWord(unsigned int hash, unsigned int value)
+{
+	return (hash ^ value) * 0x01000193;
+}
+
+static inline unsigned int HashFloat(unsigned int hash, float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return HashWord(hash, bits);
+}
+
+bool Renderer::RenderIncremental()
+{
+	if (!UpdateTileSignatures())
+		return false;
+
+	// A changed tile can alter the pixels of its neighbours (glow, blur, fire), which in turn have to
+	// be drawn with every particle that reaches into them. No bounded effect reaches further than one tile.
+	unsigned char redrawTiles[TILESY][TILESX];
+	DilateTiles(dirtyTiles, redrawTiles);
+	DilateTiles(redrawTiles, renderTiles);
+
+	bool anyDirty = false;
+	for (int ty = 0; ty < TILESY && !anyDirty; ty++)
+		for (int tx = 0; tx < TILESX; tx++)
+			if (redrawTiles[ty][tx])
+			{
+				anyDirty = true;
+				break;
+			}
+
+	if (anyDirty)
+	{
+		memcpy(fireBackup[0], fire_r, sizeof(fire_r));
+		memcpy(fireBackup[1], fire_g, sizeof(fire_g));
+		memcpy(fireBackup[2], fire_b, sizeof(fire_b));
+		renderDirtyOnly = true;
+		unboundedEffects = false;
+		draw_air();
+		DrawWalls();
+		render_parts();
+		if (unboundedEffects)
+		{
+			// Something started drawing across tiles, undo the partial frame and redraw everything
+			memcpy(fire_r, fireBackup[0], sizeof(fire_r));
+			memcpy(fire_g, fireBackup[1], sizeof(fire_g));
+			memcpy(fire_b, fireBackup[2], sizeof(fire_b));
+			renderDirtyOnly = false;
+			std::fill(vid, vid+(VIDXRES*YRES), 0);
+			return false;
+		}
+		render_fire();
+		renderDirtyOnly = false;
+	}
+
+	for (int ty = 0; ty < TILESY; ty++)
+	{
+		int y1 = ty*TILE_SIZE, y2 = std::min(y1+TILE_SIZE, YRES);
+		for (int tx = 0; tx < TILESX; tx++)
+		{
+			int x1 = tx*TILE_SIZE, x2 = std::min(x1+TILE_SIZE, XRES);
+			for (int y = y1; y < y2; y++)
+			{
+				if (redrawTiles[ty][tx])
+					std::copy(vid+(y*VIDXRES)+x1, vid+(y*VIDXRES)+x2, tileVid+(y*XRES)+x1);
+				else
+					std::copy(tileVid+(y*XRES)+x1, tileVid+(y*XRES)+x2, vid+(y*VIDXRES)+x1);
+			}
+		}
+	}
+	UpdateFireTiles();
+	return true;
+}
+
+// Hashes everything the particle, wall and air renderers read into one signature per tile and marks
+// the tiles whose signature changed as dirty. Returns false if this frame needs a full redraw.
+bool Renderer::UpdateTileSignatures()
+{
+	bool incremental = tileCacheValid;
+	unsigned int settings = 0x811C9DC5;
+	settings = HashWord(settings, render_mode);
+	settings = HashWord(settings, colour_mode);
+	settings = HashWord(settings, display_mode);
+	settings = HashWord(settings, decorations_enable);
+	settings = HashWord(settings, blackDecorations);
+	settings = HashWord(settings, debugLines);
+	settings = HashWord(settings, gridSize);
+	settings = HashWord(settings, sim->aheat_enable);
+	if (settings != tileSettings)
+	{
+		tileSettings = settings;
+		incremental = false;
+		tileSignaturesValid = false;
+	}
+	if ((display_mode & (DISPLAY_WARP | DISPLAY_PERS)) || gravityFieldEnabled || findingElement)
+		incremental = false;
+
+	memset(dirtyTiles, 0, sizeof(dirtyTiles));
+	if (!tileSignaturesValid || sim->revision != tileSimRevision || ((display_mode & DISPLAY_AIR) && sim->air->revision != tileAirRevision))
+	{
+		HashTiles();
+		tileSignaturesValid = true;
+		tileSimRevision = sim->revision;
+		tileAirRevision = sim->air->revision;
+		for (int ty = 0; ty < TILESY; ty++)
+			for (int tx = 0; tx < TILESX; tx++)
+			{
+				if (newTileSignature[ty][tx] != tileSignature[ty][tx])
+					dirtyTiles[ty][tx] = 1;
+				tileSignature[ty][tx] = newTileSignature[ty][tx];
+			}
+	}
+
+	// Streamlines are drawn across the whole screen
+	if (tileStreamlines)
+		incremental = false;
+	for (int t = 0; t < PT_NUM; t++)
+		if (tileTypes[t] && unboundedTypes[t])
+			incremental = false;
+	for (int ty = 0; ty < TILESY; ty++)
+		for (int tx = 0; tx < TILESX; tx++)
+			if (animatedTiles[ty][tx] || fireTiles[ty][tx])
+				dirtyTiles[ty][tx] = 1;
+	return incremental;
+}
+
+// Works out newTileSignature, along with which tiles are animated and which element types are on screen
+void Renderer::HashTiles()
+{
+	memset(newTileSignature, 0, sizeof(newTileSignature));
+	memset(animatedTiles, 0, sizeof(animatedTiles));
+	std::fill(tileTypes, tileTypes+PT_NUM, 0);
+	tileStreamlines = false;
+	for (int i = 0; i <= sim->parts_lastActiveIndex; i++)
+	{
+		Particle & part = sim->parts[i];
+		int t = part.type;
+		if (t <= 0 || t >= PT_NUM)
+			continue;
+		int nx = (int)(part.x+0.5f);
+		int ny = (int)(part.y+0.5f);
+		if (nx >= XRES || nx < 0 || ny >= YRES || ny < 0)
+			continue;
+		tileTypes[t] = 1;
+		// These elements' graphics functions use random numbers or the tick count
+		if (t == PT_GOLD || t == PT_EXOT || t == PT_GRAV)
+			animatedTiles[ny/TILE_SIZE][nx/TILE_SIZE] = 1;
+
+		unsigned int hash = newTileSignature[ny/TILE_SIZE][nx/TILE_SIZE];
+		hash = HashWord(hash, i);
+		hash = HashWord(hash, t);
+		hash = HashWord(hash, nx);
+		hash = HashWord(hash, ny);
+		hash = HashWord(hash, part.life);
+		hash = HashWord(hash, part.ctype);
+		hash = HashFloat(hash, part.vx);
+		hash = HashFloat(hash, part.vy);
+		hash = HashFloat(hash, part.temp);
+		hash = HashFloat(hash, part.pavg[0]);
+		hash = HashFloat(hash, part.pavg[1]);
+		hash = HashWord(hash, part.flags);
+		hash = HashWord(hash, part.tmp);
+		hash = HashWord(hash, part.tmp2);
+		hash = HashWord(hash, part.dcolour);
+		newTileSignature[ny/TILE_SIZE][nx/TILE_SIZE] = hash;
+	}
+
+	for (int y = 0; y < YRES/CELL; y++)
+		for (int x = 0; x < XRES/CELL; x++)
+		{
+			unsigned int & hash = newTileSignature[y*CELL/TILE_SIZE][x*CELL/TILE_SIZE];
+			if (sim->bmap[y][x])
+			{
+				if (sim->bmap[y][x] == WL_STREAM)
+					tileStreamlines = true;
+				hash = HashWord(hash, (y*(XRES/CELL)+x) | (sim->bmap[y][x]<<16) | (sim->emap[y][x]<<24));
+			}
+			if (display_mode & DISPLAY_AIR)
+			{
+				hash = HashFloat(hash, sim->air->pv[y][x]);
+				hash = HashFloat(hash, sim->air->vx[y][x]);
+				hash = HashFloat(hash, sim->air->vy[y][x]);
+				hash = HashFloat(hash, sim->air->hv[y][x]);
+			}
+		}
+}
+
+void Renderer::StoreTiles()
+{
+	if (display_mode & (DISPLAY_WARP | DISPLAY_PERS))
+	{
+		tileCacheValid = false;
+		return;
+	}
+	for (int y = 0; y < YRES; y++)
+		std::copy(vid+(y*VIDXRES), vid+(y*VIDXRES)+XRES, tileVid+(y*XRES));
+	tileCacheValid = true;
+	UpdateFireTiles();
+}
+
+// Fire fades out over several frames, so tiles with any fire left in them stay dirty
+void Renderer::UpdateFireTiles()
+{
+	memset(fireTiles, 0, sizeof(fireTiles));
+	for (int y = 0; y < YRES/CELL; y++)
+		for (int x = 0; x < XRES/CELL; x++)
+			if (fire_r[y][x] || fire_g[y][x] || fire_b[y][x])
+				fireTiles[y*CELL/TILE_SIZE][x*CELL/TILE_SIZE] = 1;
+}
+
+void Renderer::DilateTiles(unsigned char (*src)[TILESX], unsigned char (*dst)[TILESX])
+{
+	for (int ty = 0; ty < TILESY; ty++)
+		for (int tx = 0; tx < TILESX; tx++)
+		{
+			unsigned char dirty = 0;
+			for (int y = std::max(ty-1, 0); y <= std::min(ty+1, TILESY-1) && !dirty; y++)
+				for (int x = std::max(tx-1, 0); x <= std::min(tx+1, TILESX-1); x++)
+					if (src[y][x])
+					{
+						dirty = 1;
+						break;
+					}
+			dst[ty][tx] = dirty;
+		}
+}
+#endif
+
 void Renderer::SetSample(int x, int y)
 {
 	sampleColor = GetPixel(x, y);
@@ -202,6 +421,11 @@ void Renderer::clearScreen(float alpha)
 	g->Clear();
 #endif
 }
+
+pixel * Renderer::LastFrame()
+{
+	return vid;
+}
 #ifdef OGLR
 void Renderer::checkShader(GLuint shader, const char * shname)
 {
@@ -727,7 +951,7 @@ void Renderer::DrawWalls()
 #else
 	for (int y = 0; y < YRES/CELL; y++)
 		for (int x =0; x < XRES/CELL; x++)
-			if (sim->bmap[y][x])
+			if (sim->bmap[y][x] && InRenderRegion(x*CELL, y*CELL))
 			{
 				unsigned char wt = sim->bmap[y][x];
 				if (wt >= UI_WALLCOUNT)
@@ -973,7 +1197,7 @@ void Renderer::DrawWalls()
 void Renderer::DrawSigns()
 {
 	int x, y, w, h;
-	std::vector<sign> signs = sim->signs;
+	std::vector<sign> & signs = sim->signs;
 #ifdef OGLR
 	GLint prevFbo;
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
@@ -1027,40 +1251,45 @@ void Renderer::DrawSigns()
 void Renderer::render_gravlensing(pixel * source)
 {
 #ifndef OGLR
-	int nx, ny, rx, ry, gx, gy, bx, by, co;
-	int r, g, b;
-	pixel t;
+	TRACE_ZONE("render_gravlensing");
 	pixel *src = source;
 	pixel *dst = vid;
 	if (!dst)
 		return;
-	for(nx = 0; nx < XRES; nx++)
-	{
-		for(ny = 0; ny < YRES; ny++)
-		{
-			co = (ny/CELL)*(XRES/CELL)+(nx/CELL);
-			rx = (int)(nx-sim->gravx[co]*0.75f+0.5f);
-			ry = (int)(ny-sim->gravy[co]*0.75f+0.5f);
-			gx = (int)(nx-sim->gravx[co]*0.875f+0.5f);
-			gy = (int)(ny-sim->gravy[co]*0.875f+0.5f);
-			bx = (int)(nx-sim->gravx[co]+0.5f);
-			by = (int)(ny-sim->gravy[co]+0.5f);
-			if(rx >= 0 && rx < XRES && ry >= 0 && ry < YRES && gx >= 0 && gx < XRES && gy >= 0 && gy < YRES && bx >= 0 && bx < XRES && by >= 0 && by < YRES)
+	// Row by row, so that the pixels written and the gravity read both go along memory
+	DrawBands([this, src, dst](int top, int bottom) {
+		int nx, ny, rx, ry, gx, gy, bx, by, co;
+		int r, g, b;
+		pixel t;
+		bottom = std::min(bottom, YRES);
+		for(ny = top; ny < bottom; ny++)
+		{
+			for(nx = 0; nx < XRES; nx++)
 			{
-				t = dst[ny*(VIDXRES)+nx];
-				r = PIXR(src[ry*(VIDXRES)+rx]) + PIXR(t);
-				g = PIXG(src[gy*(VIDXRES)+gx]) + PIXG(t);
-				b = PIXB(src[by*(VIDXRES)+bx]) + PIXB(t);
-				if (r>255)
-					r = 255;
-				if (g>255)
-					g = 255;
-				if (b>255)
-					b = 255;
-				dst[ny*(VIDXRES)+nx] = PIXRGB(r,g,b);
+				co = (ny/CELL)*(XRES/CELL)+(nx/CELL);
+				rx = (int)(nx-sim->gravx[co]*0.75f+0.5f);
+				ry = (int)(ny-sim->gravy[co]*0.75f+0.5f);
+				gx = (int)(nx-sim->gravx[co]*0.875f+0.5f);
+				gy = (int)(ny-sim->gravy[co]*0.875f+0.5f);
+				bx = (int)(nx-sim->gravx[co]+0.5f);
+				by = (int)(ny-sim->gravy[co]+0.5f);
+				if(rx >= 0 && rx < XRES && ry >= 0 && ry < YRES && gx >= 0 && gx < XRES && gy >= 0 && gy < YRES && bx >= 0 && bx < XRES && by >= 0 && by < YRES)
+				{
+					t = dst[ny*(VIDXRES)+nx];
+					r = PIXR(src[ry*(VIDXRES)+rx]) + PIXR(t);
+					g = PIXG(src[gy*(VIDXRES)+gx]) + PIXG(t);
+					b = PIXB(src[by*(VIDXRES)+bx]) + PIXB(t);
+					if (r>255)
+						r = 255;
+					if (g>255)
+						g = 255;
+					if (b>255)
+						b = 255;
+					dst[ny*(VIDXRES)+nx] = PIXRGB(r,g,b);
+				}
 			}
 		}
-	}
+	});
 #endif
 }
 
@@ -1069,25 +1298,34 @@ void Renderer::render_fire()
 #ifndef OGLR
 	if(!(render_mode & FIREMODE))
 		return;
-	int i,j,x,y,r,g,b,a;
+	TRACE_ZONE("render_fire");
+	int i,j,x,y,r,g,b;
+	int stamp[CELL*3][CELL*3];
+	for (y=0; y<CELL*3; y++)
+		for (x=0; x<CELL*3; x++)
+			stamp[y][x] = findingElement ? fire_alpha[y][x]/2 : fire_alpha[y][x];
+	// Every cell's fire is stamped before any of it spreads, which is what it was when its stamp was drawn
+	// anyway. Each band goes through the cells that reach into it in the usual order, so stamps that overlap
+	// add up the same way no matter where the bands are.
+	DrawBands([this, &stamp](int top, int bottom) {
+		Raster::Target band = { vid, VIDXRES, 0, top, VIDXRES, bottom };
+		int firstRow = std::max(top/CELL-1, 0), lastRow = std::min((bottom-1)/CELL+1, YRES/CELL-1);
+		for (int j = firstRow; j <= lastRow; j++)
+			for (int i = 0; i < XRES/CELL; i++)
+			{
+				int r = fire_r[j][i], g = fire_g[j][i], b = fire_b[j][i];
+				if ((r || g || b) && InRenderRegion(i*CELL, j*CELL))
+					for (int y = -CELL; y < 2*CELL; y++)
+						band.AddSpanAlphas(i*CELL-CELL, j*CELL+y, CELL*3, stamp[y+CELL], r, g, b);
+			}
+	});
+	// Spreading happens in place, every cell already sees the new values of the cells before it
 	for (j=0; j<YRES/CELL; j++)
 		for (i=0; i<XRES/CELL; i++)
 		{
-			r = fire_r[j][i];
-			g = fire_g[j][i];
-			b = fire_b[j][i];
-			if (r || g || b)
-				for (y=-CELL; y<2*CELL; y++)
-					for (x=-CELL; x<2*CELL; x++)
-					{
-						a = fire_alpha[y+CELL][x+CELL];
-						if (findingElement)
-							a /= 2;
-						addpixel(i*CELL+x, j*CELL+y, r, g, b, a);
-					}
-			r *= 8;
-			g *= 8;
-			b *= 8;
+			r = fire_r[j][i]*8;
+			g = fire_g[j][i]*8;
+			b = fire_b[j][i]*8;
 			for (y=-1; y<2; y++)
 				for (x=-1; x<2; x++)
 					if ((x || y) && i+x>=0 && j+y>=0 && i+x<XRES/CELL && j+y<YRES/CELL)
@@ -1106,6 +1344,17 @@ void Renderer::render_fire()
 #endif
 }
 
+void Renderer::StorePersistent()
+{
+#ifndef OGLR
+	TRACE_ZONE("StorePersistent");
+	DrawBands([this](int top, int bottom) {
+		bottom = std::min(bottom, YRES);
+		Raster::FadeRow(persistentVid + top*(VIDXRES), vid + top*(VIDXRES), (bottom-top)*(VIDXRES));
+	});
+#endif
+}
+
 float temp[CELL*3][CELL*3];
 float fire_alphaf[CELL*3][CELL*3];
 float glow_alphaf[11][11];
@@ -1191,18 +1440,482 @@ void Renderer::prepare_alpha(int size, float intensity)
 #endif
 }
 
+#ifndef OGLR
+// How far the arms of sparks and flares reach, they fade by falloff every pixel until they can't be seen
+static int ArmReach(float gradv, float falloff)
+{
+	int reach = 0;
+	for (; gradv > 0.5f; reach++)
+		gradv = gradv/falloff;
+	// One more in case the drawing code rounds a little differently
+	return reach + 1;
+}
+#endif
+
+//The step of the heat gradient in color_data that a temperature falls on, the same for particles and air
+static int HeatStep(float temp)
+{
+	float ttemp = temp+(-MIN_TEMP);
+	if (ttemp < 0.0f)
+		ttemp = 0.0f;
+	if (ttemp > MAX_TEMP+(-MIN_TEMP))
+		ttemp = MAX_TEMP+(-MIN_TEMP);
+	int step = ttemp / ((MAX_TEMP+(-MIN_TEMP))/1024);
+	return step < 0 ? 0 : (step > 1023 ? 1023 : step);
+}
+
+//The grey of the life gradient display, where q is a particle's life or its square root
+static int LifeShade(int q)
+{
+	float gradv = 0.4f;
+	return sin(gradv*q) * 100 + 128;
+}
+
+//How much PROP_HOT_GLOW adds to red, green and blue caddress degrees into the 800 below the high temperature
+static void HotGlowShift(float gradv, int caddress, double * shift)
+{
+	shift[0] = sin(gradv*caddress) * 226;
+	shift[1] = sin(gradv*caddress*4.55 +3.14) * 34;
+	shift[2] = sin(gradv*caddress*2.22 +3.14) * 64;
+}
+
+void Renderer::BuildHotGlow(int t)
+{
+	HotGlow & glow = hotGlow[t];
+	glow.highTemperature = sim->elements[t].HighTemperature;
+	float gradv = 3.1415/(2*glow.highTemperature-(glow.highTemperature-800.0f));
+	glow.shift.resize(3*(HOT_GLOW_DEGREES+1));
+	for (int caddress = 0; caddress <= HOT_GLOW_DEGREES; caddress++)
+		HotGlowShift(gradv, caddress, &glow.shift[3*caddress]);
+}
+
+const double * Renderer::GetHotGlow(int t, int caddress, double * shift)
+{
+	HotGlow & glow = hotGlow[t];
+	//Elements can be changed from Lua, so the table is checked against the current high temperature
+	if (glow.shift.empty() || glow.highTemperature != sim->elements[t].HighTemperature)
+		BuildHotGlow(t);
+	if (caddress >= 0 && caddress <= HOT_GLOW_DEGREES)
+		return &glow.shift[3*caddress];
+	//Only reachable with a high temperature so large that float rounding stretches the range
+	HotGlowShift(3.1415/(2*glow.highTemperature-(glow.highTemperature-800.0f)), caddress, shift);
+	return shift;
+}
+
+void Renderer::GraphicsFromState(int i, int t, int nx, int ny, PartShade & shade)
+{
+	Particle & part = sim->parts[i];
+	Element & element = sim->elements[t];
+	GraphicsStateEntry key;
+	key.life = (element.GraphicsState & GSTATE_LIFE) ? part.life : 0;
+	key.ctype = (element.GraphicsState & GSTATE_CTYPE) ? part.ctype : 0;
+	key.tmp = (element.GraphicsState & GSTATE_TMP) ? part.tmp : 0;
+	key.tmp2 = (element.GraphicsState & GSTATE_TMP2) ? part.tmp2 : 0;
+	key.flags = (element.GraphicsState & GSTATE_FLAGS) ? part.flags : 0;
+
+	GraphicsStateCache & cache = graphicsStates[t];
+	//Elements can be changed from Lua, what the function gave is only any good for the function and colour it had
+	if (cache.entries.empty() || cache.graphics != element.Graphics || cache.colour != element.Colour)
+	{
+		cache.entries.assign(GRAPHICS_STATES, GraphicsStateEntry());
+		cache.graphics = element.Graphics;
+		cache.colour = element.Colour;
+	}
+	unsigned int hash = key.life*0x9E3779B1u ^ key.ctype*0x85EBCA77u ^ key.tmp*0xC2B2AE3Du ^ key.tmp2*0x27D4EB2Fu ^ key.flags*0x165667B1u;
+	GraphicsStateEntry & entry = cache.entries[(hash ^ (hash >> 16)) & (GRAPHICS_STATES-1)];
+	if (entry.valid && entry.life == key.life && entry.ctype == key.ctype && entry.tmp == key.tmp && entry.tmp2 == key.tmp2 && entry.flags == key.flags)
+	{
+		shade = entry.shade;
+		return;
+	}
+	(*(element.Graphics))(this, &part, nx, ny, &shade.pixel_mode, &shade.cola, &shade.colr, &shade.colg, &shade.colb, &shade.firea, &shade.firer, &shade.fireg, &shade.fireb);
+	entry = key;
+	entry.valid = true;
+	entry.shade = shade;
+}
+
+template<unsigned int RenderMode, unsigned int ColourMode, int Decorations>
+void Renderer::ShadePart(int i, int t, int nx, int ny, PartShade & shade)
+{
+	//Fixed for the common presets so that everything that depends on them is decided at compile time
+	const unsigned int renderMode = RenderMode == ANY_MODE ? render_mode : RenderMode;
+	const unsigned int colourMode = ColourMode == ANY_MODE ? colour_mode : ColourMode;
+	const bool decorations = Decorations < 0 ? decorations_enable != 0 : Decorations != 0;
+	int &pixel_mode = shade.pixel_mode, &cola = shade.cola, &colr = shade.colr, &colg = shade.colg, &colb = shade.colb;
+	int &firea = shade.firea, &firer = shade.firer, &fireg = shade.fireg, &fireb = shade.fireb;
+	int deca, decr, decg, decb, q, caddress;
+	Particle * parts = sim->parts;
+	Element * elements = sim->elements;
+
+	//Defaults
+	pixel_mode = 0 | PMODE_FLAT;
+	cola = 255;
+	colr = PIXR(elements[t].Colour);
+	colg = PIXG(elements[t].Colour);
+	colb = PIXB(elements[t].Colour);
+	firer = fireg = fireb = firea = 0;
+
+	deca = (sim->parts[i].dcolour>>24)&0xFF;
+	decr = (sim->parts[i].dcolour>>16)&0xFF;
+	decg = (sim->parts[i].dcolour>>8)&0xFF;
+	decb = (sim->parts[i].dcolour)&0xFF;
+
+	if(decorations && blackDecorations)
+	{
+		if(deca < 250 || decr > 5 || decg > 5 || decb > 5)
+			deca = 0;
+		else
+		{
+			deca = 255;
+			decr = decg = decb = 0;
+		}
+	}
+
+	if (graphicscache[t].isready)
+	{
+		pixel_mode = graphicscache[t].pixel_mode;
+		cola = graphicscache[t].cola;
+		colr = graphicscache[t].colr;
+		colg = graphicscache[t].colg;
+		colb = graphicscache[t].colb;
+		firea = graphicscache[t].firea;
+		firer = graphicscache[t].firer;
+		fireg = graphicscache[t].fireg;
+		fireb = graphicscache[t].fireb;
+	}
+	else if(!(colourMode & COLOUR_BASC))
+	{
+		if (elements[t].Graphics)
+		{
+			ElementProfiler::Sample graphicsSample(sim->profiler, ElementProfiler::RENDER_SLOT, t, ElementProfiler::Graphics);
+#if !defined(RENDERER) && defined(LUACONSOLE)
+			if (lua_gr_func[t])
+			{
+				if (luacon_graphicsReplacement(this, &(sim->parts[i]), nx, ny, &pixel_mode, &cola, &colr, &colg, &colb, &firea, &firer, &fireg, &fireb, i))
+				{
+					graphicscache[t].isready = 1;
+					graphicscache[t].pixel_mode = pixel_mode;
+					graphicscache[t].cola = cola;
+					graphicscache[t].colr = colr;
+					graphicscache[t].colg = colg;
+					graphicscache[t].colb = colb;
+					graphicscache[t].firea = firea;
+					graphicscache[t].firer = firer;
+					graphicscache[t].fireg = fireg;
+					graphicscache[t].fireb = fireb;
+				}
+			}
+			else if (elements[t].GraphicsState)
+#else
+			if (elements[t].GraphicsState)
+#endif
+				GraphicsFromState(i, t, nx, ny, shade);
+			else if ((*(elements[t].Graphics))(this, &(sim->parts[i]), nx, ny, &pixel_mode, &cola, &colr, &colg, &colb, &firea, &firer, &fireg, &fireb)) //That's a lot of args, a struct might be better
+			{
+				graphicscache[t].isready = 1;
+				graphicscache[t].pixel_mode = pixel_mode;
+				graphicscache[t].cola = cola;
+				graphicscache[t].colr = colr;
+				graphicscache[t].colg = colg;
+				graphicscache[t].colb = colb;
+				graphicscache[t].firea = firea;
+				graphicscache[t].firer = firer;
+				graphicscache[t].fireg = fireg;
+				graphicscache[t].fireb = fireb;
+			}
+		}
+		else
+		{
+			graphicscache[t].isready = 1;
+			graphicscache[t].pixel_mode = pixel_mode;
+			graphicscache[t].cola = cola;
+			graphicscache[t].colr = colr;
+			graphicscache[t].colg = colg;
+			graphicscache[t].colb = colb;
+			graphicscache[t].firea = firea;
+			graphicscache[t].firer = firer;
+			graphicscache[t].fireg = fireg;
+			graphicscache[t].fireb = fireb;
+		}
+	}
+	if((elements[t].Properties & PROP_HOT_GLOW) && sim->parts[i].temp>(elements[t].HighTemperature-800.0f))
+	{
+		caddress = (sim->parts[i].temp>elements[t].HighTemperature)?elements[t].HighTemperature-(elements[t].HighTemperature-800.0f):sim->parts[i].temp-(elements[t].HighTemperature-800.0f);
+		double shift[3];
+		const double * glow = GetHotGlow(t, caddress, shift);
+		colr += glow[0];
+		colg += glow[1];
+		colb += glow[2];
+	}
+
+	if((pixel_mode & FIRE_ADD) && !(renderMode & FIRE_ADD))
+		pixel_mode |= PMODE_GLOW;
+	if((pixel_mode & FIRE_BLEND) && !(renderMode & FIRE_BLEND))
+		pixel_mode |= PMODE_BLUR;
+	if((pixel_mode & PMODE_BLUR) && !(renderMode & PMODE_BLUR))
+		pixel_mode |= PMODE_FLAT;
+	if((pixel_mode & PMODE_GLOW) && !(renderMode & PMODE_GLOW))
+		pixel_mode |= PMODE_BLEND;
+	if (renderMode & PMODE_BLOB)
+		pixel_mode |= PMODE_BLOB;
+
+	pixel_mode &= renderMode;
+
+	//Alter colour based on display mode
+	if(colourMode & COLOUR_HEAT)
+	{
+		caddress = HeatStep(sim->parts[i].temp)*3;
+		firea = 255;
+		firer = colr = color_data[caddress];
+		fireg = colg = color_data[caddress+1];
+		fireb = colb = color_data[caddress+2];
+		cola = 255;
+		if(pixel_mode & (FIREMODE | PMODE_GLOW))
+			pixel_mode = (pixel_mode & ~(FIREMODE|PMODE_GLOW)) | PMODE_BLUR;
+		else if ((pixel_mode & (PMODE_BLEND | PMODE_ADD)) == (PMODE_BLEND | PMODE_ADD))
+			pixel_mode = (pixel_mode & ~(PMODE_BLEND|PMODE_ADD)) | PMODE_FLAT;
+		else if (!pixel_mode)
+			pixel_mode |= PMODE_FLAT;
+	}
+	else if(colourMode & COLOUR_LIFE)
+	{
+		if (!(sim->parts[i].life<5))
+			q = sqrt((float)sim->parts[i].life);
+		else
+			q = sim->parts[i].life;
+		colr = colg = colb = (q >= 0 && q < LIFE_SHADES) ? lifeShades[q] : LifeShade(q);
+		cola = 255;
+		if(pixel_mode & (FIREMODE | PMODE_GLOW))
+			pixel_mode = (pixel_mode & ~(FIREMODE|PMODE_GLOW)) | PMODE_BLUR;
+		else if ((pixel_mode & (PMODE_BLEND | PMODE_ADD)) == (PMODE_BLEND | PMODE_ADD))
+			pixel_mode = (pixel_mode & ~(PMODE_BLEND|PMODE_ADD)) | PMODE_FLAT;
+		else if (!pixel_mode)
+			pixel_mode |= PMODE_FLAT;
+	}
+	else if(colourMode & COLOUR_BASC)
+	{
+		colr = PIXR(elements[t].Colour);
+		colg = PIXG(elements[t].Colour);
+		colb = PIXB(elements[t].Colour);
+		pixel_mode = PMODE_FLAT;
+	}
+
+	//Apply decoration colour
+	if(!(colourMode & ~COLOUR_GRAD) && decorations && deca)
+	{
+		deca++;
+		if(!(pixel_mode & NO_DECO))
+		{
+			colr = (deca*decr + (256-deca)*colr) >> 8;
+			colg = (deca*decg + (256-deca)*colg) >> 8;
+			colb = (deca*decb + (256-deca)*colb) >> 8;
+		}
+
+		if(pixel_mode & DECO_FIRE)
+		{
+			firer = (deca*decr + (256-deca)*firer) >> 8;
+			fireg = (deca*decg + (256-deca)*fireg) >> 8;
+			fireb = (deca*decb + (256-deca)*fireb) >> 8;
+		}
+	}
+
+	if (findingElement)
+	{
+		if (findingElement == parts[i].type)
+		{
+			colr = firer = 255;
+			colg = fireg = colb = fireb = 0;
+			foundElements++;
+		}
+		else
+		{
+			colr /= 10;
+			colg /= 10;
+			colb /= 10;
+			firer /= 5;
+			fireg /= 5;
+			fireb /= 5;
+		}
+	}
+
+	if (colourMode & COLOUR_GRAD)
+	{
+		float frequency = 0.05;
+		int q = sim->parts[i].temp-40;
+		colr = sin(frequency*q) * 16 + colr;
+		colg = sin(frequency*q) * 16 + colg;
+		colb = sin(frequency*q) * 16 + colb;
+		if(pixel_mode & (FIREMODE | PMODE_GLOW)) pixel_mode = (pixel_mode & ~(FIREMODE|PMODE_GLOW)) | PMODE_BLUR;
+	}
+
+#ifndef OGLR
+	//All colours are now set, check ranges
+	if(colr>255) colr = 255;
+	else if(colr<0) colr = 0;
+	if(colg>255) colg = 255;
+	else if(colg<0) colg = 0;
+	if(colb>255) colb = 255;
+	else if(colb<0) colb = 0;
+	if(cola>255) cola = 255;
+	else if(cola<0) cola = 0;
+
+	if(firer>255) firer = 255;
+	else if(firer<0) firer = 0;
+	if(fireg>255) fireg = 255;
+	else if(fireg<0) fireg = 0;
+	if(fireb>255) fireb = 255;
+	else if(fireb<0) fireb = 0;
+	if(firea>255) firea = 255;
+	else if(firea<0) firea = 0;
+#endif
+}
+
+#ifndef OGLR
+template<unsigned int RenderMode, unsigned int ColourMode, int Decorations>
+bool Renderer::DrawPartsWith()
+{
+	//Without worker threads particles are drawn right away, otherwise they are collected and drawn in bands
+	//afterwards. Set when a particle draws across the whole screen, which only works if everything is drawn in one go.
+	bool crossScreen = false;
+	Raster::Target wholeFrame = { vid, VIDXRES, 0, 0, VIDXRES, VIDYRES };
+	Particle * parts = sim->parts;
+	PartShade shade;
+	for (int i = 0; i <= sim->parts_lastActiveIndex; i++)
+	{
+		int t = parts[i].type;
+		if (t <= 0 || t >= PT_NUM)
+			continue;
+		int nx = (int)(parts[i].x+0.5f);
+		int ny = (int)(parts[i].y+0.5f);
+		if(nx >= XRES || nx < 0 || ny >= YRES || ny < 0)
+			continue;
+		if (!InRenderRegion(nx, ny))
+			continue;
+		if(TYP(sim->photons[ny][nx]) && !(sim->elements[t].Properties & TYPE_ENERGY) && t!=PT_STKM && t!=PT_STKM2 && t!=PT_FIGH)
+			continue;
+
+		ShadePart<RenderMode, ColourMode, Decorations>(i, t, nx, ny, shade);
+		int pixel_mode = shade.pixel_mode;
+		int cola = shade.cola, colr = shade.colr, colg = shade.colg, colb = shade.colb;
+		int firea = shade.firea, firer = shade.firer, fireg = shade.fireg, fireb = shade.fireb;
+
+#if !defined(OGLR) && !defined(OGLI)
+		//These effects can reach far outside of the particle's tile, or change every frame
+		if ((pixel_mode & (PMODE_SPARK | PMODE_FLARE | PMODE_LFLARE | EFFECT_LINES | PSPEC_STICKMAN)) || ((pixel_mode & EFFECT_DBGLINES) && debugLines))
+		{
+			unboundedTypes[t] = 1;
+			if (renderDirtyOnly)
+				unboundedEffects = true;
+		}
+#endif
+
+		if (!workers && pixel_mode == PMODE_FLAT)
+		{
+			//By far the most common case, not worth going through DrawPart for
+			vid[ny*(VIDXRES)+nx] = PIXRGB(colr,colg,colb);
+			continue;
+		}
+
+		PartDraw part;
+		part.i = i;
+		part.nx = nx;
+		part.ny = ny;
+		part.pixel_mode = pixel_mode;
+		part.cola = cola;
+		part.colr = colr;
+		part.colg = colg;
+		part.colb = colb;
+		part.firea = firea;
+		part.firer = firer;
+		part.fireg = fireg;
+		part.fireb = fireb;
+		//Flickering is random, so it's decided here where the particles are always gone through in the same order
+		part.flicker[0] = (pixel_mode & PMODE_SPARK) ? rng()%20 : 0;
+		part.flicker[1] = (pixel_mode & PMODE_FLARE) ? rng()%20 : 0;
+		part.flicker[2] = (pixel_mode & PMODE_LFLARE) ? rng()%20 : 0;
+		if (!workers)
+		{
+			DrawPart(part, wholeFrame);
+			continue;
+		}
+
+		int reach = 0;
+		if (pixel_mode & (PMODE_BLOB | PMODE_FLARE | PMODE_LFLARE))
+			reach = 1;
+		if (pixel_mode & PMODE_BLUR)
+			reach = std::max(reach, 3);
+		if (pixel_mode & PMODE_GLOW)
+			reach = std::max(reach, 5);
+		if (pixel_mode & (EFFECT_GRAVIN | EFFECT_GRAVOUT))
+			reach = std::max(reach, 16);
+		if (pixel_mode & PMODE_SPARK)
+			reach = std::max(reach, ArmReach(4*parts[i].life + part.flicker[0], 1.5f));
+		if (pixel_mode & PMODE_FLARE)
+			reach = std::max(reach, ArmReach(std::min(part.flicker[1] + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17, 255.0), 1.2f));
+		if (pixel_mode & PMODE_LFLARE)
+			reach = std::max(reach, ArmReach(std::min(part.flicker[2] + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17, 255.0), 1.01f));
+		// Channel lines are only drawn from the portal or WIFI under the mouse, and only with debug lines on
+		if ((pixel_mode & (EFFECT_LINES | PSPEC_STICKMAN)) ||
+		    ((pixel_mode & EFFECT_DBGLINES) && debugLines && !(display_mode & DISPLAY_PERS) && mousePos.X == nx && mousePos.Y == ny))
+		{
+			crossScreen = true;
+			reach = VIDYRES;
+		}
+		part.top = std::max(ny-reach, 0);
+		part.bottom = std::min(ny+reach, VIDYRES-1);
+		partDraws.push_back(part);
+	}
+	return crossScreen;
+}
+
+bool Renderer::DrawParts()
+{
+	//The render and colour modes of the usual presets, with and without decorations, get their own copy of the
+	//particle loop. Anything else goes through the one that looks at the modes for every particle. The first is
+	//what GameModel starts the game in, which isn't one of the presets and has no sparks.
+	typedef bool (Renderer::*DrawPartsFunction)();
+	struct Specialisation
+	{
+		unsigned int renderMode, colourMode;
+		bool decorations;
+		DrawPartsFunction draw;
+	};
+#define SPECIALISE(renderMode, colourMode) \
+	{ (renderMode), (colourMode), true, &Renderer::DrawPartsWith<(renderMode), (colourMode), true> }, \
+	{ (renderMode), (colourMode), false, &Renderer::DrawPartsWith<(renderMode), (colourMode), false> }
+	static const Specialisation specialisations[] = {
+		SPECIALISE(RENDER_FIRE | RENDER_EFFE | RENDER_BASC, COLOUR_DEFAULT),
+		SPECIALISE(RENDER_FIRE | RENDER_SPRK | RENDER_BASC, COLOUR_DEFAULT),
+		SPECIALISE(RENDER_EFFE | RENDER_BASC, COLOUR_DEFAULT),
+		SPECIALISE(RENDER_FIRE | RENDER_SPRK | RENDER_EFFE | RENDER_BASC, COLOUR_DEFAULT),
+		SPECIALISE(RENDER_BASC, COLOUR_HEAT),
+		SPECIALISE(RENDER_BASC, COLOUR_DEFAULT),
+	};
+#undef SPECIALISE
+	DrawPartsFunction draw = &Renderer::DrawPartsWith<ANY_MODE, ANY_MODE, -1>;
+	if (specialisedParts)
+		for (size_t s = 0; s < sizeof(specialisations)/sizeof(specialisations[0]); s++)
+			if (specialisations[s].renderMode == render_mode && specialisations[s].colourMode == colour_mode && specialisations[s].decorations == (decorations_enable != 0))
+			{
+				draw = specialisations[s].draw;
+				break;
+			}
+	return (this->*draw)();
+}
+#endif
+
 void Renderer::render_parts()
 {
-	int deca, decr, decg, decb, cola, colr, colg, colb, firea, firer, fireg, fireb, pixel_mode, q, i, t, nx, ny, x, y, caddress;
-	int orbd[4] = {0, 0, 0, 0}, orbl[4] = {0, 0, 0, 0};
-	float gradv, flicker;
-	Particle * parts;
-	Element *elements;
 	if(!sim)
 		return;
-	parts = sim->parts;
-	elements = sim->elements;
 #ifdef OGLR
+	int cola, colr, colg, colb, firea, firer, fireg, fireb, pixel_mode, i, t, nx, ny;
+	Particle * parts = sim->parts;
+	Element * elements = sim->elements;
+	PartShade shade;
+	int x, y;
+	int orbd[4] = {0, 0, 0, 0}, orbl[4] = {0, 0, 0, 0};
+	float flicker;
 	float fnx, fny;
 	int cfireV = 0, cfireC = 0, cfire = 0;
 	int csmokeV = 0, csmokeC = 0, csmoke = 0;
@@ -1220,19 +1933,6 @@ void Renderer::render_parts()
 	//Render to the particle FBO
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, partsFbo);
 	glTranslated(0, MENUSIZE, 0);
-#else
-	if (gridSize)//draws the grid
-	{
-		for (ny=0; ny<YRES; ny++)
-			for (nx=0; nx<XRES; nx++)
-			{
-				if (ny%(4*gridSize) == 0)
-					blendpixel(nx, ny, 100, 100, 100, 80);
-				if (nx%(4*gridSize) == 0 && ny%(4*gridSize) != 0)
-					blendpixel(nx, ny, 100, 100, 100, 80);
-			}
-	}
-#endif
 	foundElements = 0;
 	for(i = 0; i<=sim->parts_lastActiveIndex; i++) {
 		if (sim->parts[i].type && sim->parts[i].type >= 0 && sim->parts[i].type < PT_NUM) {
@@ -1240,236 +1940,27 @@ void Renderer::render_parts()
 
 			nx = (int)(sim->parts[i].x+0.5f);
 			ny = (int)(sim->parts[i].y+0.5f);
-#ifdef OGLR
 			fnx = sim->parts[i].x;
 			fny = sim->parts[i].y;
-#endif
 
 			if(nx >= XRES || nx < 0 || ny >= YRES || ny < 0)
 				continue;
+			if (!InRenderRegion(nx, ny))
+				continue;
 			if(TYP(sim->photons[ny][nx]) && !(sim->elements[t].Properties & TYPE_ENERGY) && t!=PT_STKM && t!=PT_STKM2 && t!=PT_FIGH)
 				continue;
 
-			//Defaults
-			pixel_mode = 0 | PMODE_FLAT;
-			cola = 255;
-			colr = PIXR(elements[t].Colour);
-			colg = PIXG(elements[t].Colour);
-			colb = PIXB(elements[t].Colour);
-			firer = fireg = fireb = firea = 0;
-
-			deca = (sim->parts[i].dcolour>>24)&0xFF;
-			decr = (sim->parts[i].dcolour>>16)&0xFF;
-			decg = (sim->parts[i].dcolour>>8)&0xFF;
-			decb = (sim->parts[i].dcolour)&0xFF;
-
-			if(decorations_enable && blackDecorations)
-			{
-				if(deca < 250 || decr > 5 || decg > 5 || decb > 5)
-					deca = 0;
-				else
-				{
-					deca = 255;
-					decr = decg = decb = 0;
-				}
-			}
-
+			ShadePart<ANY_MODE, ANY_MODE, -1>(i, t, nx, ny, shade);
+			pixel_mode = shade.pixel_mode;
+			cola = shade.cola;
+			colr = shade.colr;
+			colg = shade.colg;
+			colb = shade.colb;
+			firea = shade.firea;
+			firer = shade.firer;
+			fireg = shade.fireg;
+			fireb = shade.fireb;
 			{
-				if (graphicscache[t].isready)
-				{
-					pixel_mode = graphicscache[t].pixel_mode;
-					cola = graphicscache[t].cola;
-					colr = graphicscache[t].colr;
-					colg = graphicscache[t].colg;
-					colb = graphicscache[t].colb;
-					firea = graphicscache[t].firea;
-					firer = graphicscache[t].firer;
-					fireg = graphicscache[t].fireg;
-					fireb = graphicscache[t].fireb;
-				}
-				else if(!(colour_mode & COLOUR_BASC))
-				{
-					if (elements[t].Graphics)
-					{
-#if !defined(RENDERER) && defined(LUACONSOLE)
-						if (lua_gr_func[t])
-						{
-							if (luacon_graphicsReplacement(this, &(sim->parts[i]), nx, ny, &pixel_mode, &cola, &colr, &colg, &colb, &firea, &firer, &fireg, &fireb, i))
-							{
-								graphicscache[t].isready = 1;
-								graphicscache[t].pixel_mode = pixel_mode;
-								graphicscache[t].cola = cola;
-								graphicscache[t].colr = colr;
-								graphicscache[t].colg = colg;
-								graphicscache[t].colb = colb;
-								graphicscache[t].firea = firea;
-								graphicscache[t].firer = firer;
-								graphicscache[t].fireg = fireg;
-								graphicscache[t].fireb = fireb;
-							}
-						}
-						else if ((*(elements[t].Graphics))(this, &(sim->parts[i]), nx, ny, &pixel_mode, &cola, &colr, &colg, &colb, &firea, &firer, &fireg, &fireb)) //That's a lot of args, a struct might be better
-#else
-						if ((*(elements[t].Graphics))(this, &(sim->parts[i]), nx, ny, &pixel_mode, &cola, &colr, &colg, &colb, &firea, &firer, &fireg, &fireb)) //That's a lot of args, a struct might be better
-#endif
-						{
-							graphicscache[t].isready = 1;
-							graphicscache[t].pixel_mode = pixel_mode;
-							graphicscache[t].cola = cola;
-							graphicscache[t].colr = colr;
-							graphicscache[t].colg = colg;
-							graphicscache[t].colb = colb;
-							graphicscache[t].firea = firea;
-							graphicscache[t].firer = firer;
-							graphicscache[t].fireg = fireg;
-							graphicscache[t].fireb = fireb;
-						}
-					}
-					else
-					{
-						graphicscache[t].isready = 1;
-						graphicscache[t].pixel_mode = pixel_mode;
-						graphicscache[t].cola = cola;
-						graphicscache[t].colr = colr;
-						graphicscache[t].colg = colg;
-						graphicscache[t].colb = colb;
-						graphicscache[t].firea = firea;
-						graphicscache[t].firer = firer;
-						graphicscache[t].fireg = fireg;
-						graphicscache[t].fireb = fireb;
-					}
-				}
-				if((elements[t].Properties & PROP_HOT_GLOW) && sim->parts[i].temp>(elements[t].HighTemperature-800.0f))
-				{
-					gradv = 3.1415/(2*elements[t].HighTemperature-(elements[t].HighTemperature-800.0f));
-					caddress = (sim->parts[i].temp>elements[t].HighTemperature)?elements[t].HighTemperature-(elements[t].HighTemperature-800.0f):sim->parts[i].temp-(elements[t].HighTemperature-800.0f);
-					colr += sin(gradv*caddress) * 226;;
-					colg += sin(gradv*caddress*4.55 +3.14) * 34;
-					colb += sin(gradv*caddress*2.22 +3.14) * 64;
-				}
-
-				if((pixel_mode & FIRE_ADD) && !(render_mode & FIRE_ADD))
-					pixel_mode |= PMODE_GLOW;
-				if((pixel_mode & FIRE_BLEND) && !(render_mode & FIRE_BLEND))
-					pixel_mode |= PMODE_BLUR;
-				if((pixel_mode & PMODE_BLUR) && !(render_mode & PMODE_BLUR))
-					pixel_mode |= PMODE_FLAT;
-				if((pixel_mode & PMODE_GLOW) && !(render_mode & PMODE_GLOW))
-					pixel_mode |= PMODE_BLEND;
-				if (render_mode & PMODE_BLOB)
-					pixel_mode |= PMODE_BLOB;
-
-				pixel_mode &= render_mode;
-
-				//Alter colour based on display mode
-				if(colour_mode & COLOUR_HEAT)
-				{
-					caddress = restrict_flt((int)( restrict_flt((float)(sim->parts[i].temp+(-MIN_TEMP)), 0.0f, MAX_TEMP+(-MIN_TEMP)) / ((MAX_TEMP+(-MIN_TEMP))/1024) ) *3, 0.0f, (1024.0f*3)-3);
-					firea = 255;
-					firer = colr = color_data[caddress];
-					fireg = colg = color_data[caddress+1];
-					fireb = colb = color_data[caddress+2];
-					cola = 255;
-					if(pixel_mode & (FIREMODE | PMODE_GLOW))
-						pixel_mode = (pixel_mode & ~(FIREMODE|PMODE_GLOW)) | PMODE_BLUR;
-					else if ((pixel_mode & (PMODE_BLEND | PMODE_ADD)) == (PMODE_BLEND | PMODE_ADD))
-						pixel_mode = (pixel_mode & ~(PMODE_BLEND|PMODE_ADD)) | PMODE_FLAT;
-					else if (!pixel_mode)
-						pixel_mode |= PMODE_FLAT;
-				}
-				else if(colour_mode & COLOUR_LIFE)
-				{
-					gradv = 0.4f;
-					if (!(sim->parts[i].life<5))
-						q = sqrt((float)sim->parts[i].life);
-					else
-						q = sim->parts[i].life;
-					colr = colg = colb = sin(gradv*q) * 100 + 128;
-					cola = 255;
-					if(pixel_mode & (FIREMODE | PMODE_GLOW))
-						pixel_mode = (pixel_mode & ~(FIREMODE|PMODE_GLOW)) | PMODE_BLUR;
-					else if ((pixel_mode & (PMODE_BLEND | PMODE_ADD)) == (PMODE_BLEND | PMODE_ADD))
-						pixel_mode = (pixel_mode & ~(PMODE_BLEND|PMODE_ADD)) | PMODE_FLAT;
-					else if (!pixel_mode)
-						pixel_mode |= PMODE_FLAT;
-				}
-				else if(colour_mode & COLOUR_BASC)
-				{
-					colr = PIXR(elements[t].Colour);
-					colg = PIXG(elements[t].Colour);
-					colb = PIXB(elements[t].Colour);
-					pixel_mode = PMODE_FLAT;
-				}
-
-				//Apply decoration colour
-				if(!(colour_mode & ~COLOUR_GRAD) && decorations_enable && deca)
-				{
-					deca++;
-					if(!(pixel_mode & NO_DECO))
-					{
-						colr = (deca*decr + (256-deca)*colr) >> 8;
-						colg = (deca*decg + (256-deca)*colg) >> 8;
-						colb = (deca*decb + (256-deca)*colb) >> 8;
-					}
-
-					if(pixel_mode & DECO_FIRE)
-					{
-						firer = (deca*decr + (256-deca)*firer) >> 8;
-						fireg = (deca*decg + (256-deca)*fireg) >> 8;
-						fireb = (deca*decb + (256-deca)*fireb) >> 8;
-					}
-				}
-
-				if (findingElement)
-				{
-					if (findingElement == parts[i].type)
-					{
-						colr = firer = 255;
-						colg = fireg = colb = fireb = 0;
-						foundElements++;
-					}
-					else
-					{
-						colr /= 10;
-						colg /= 10;
-						colb /= 10;
-						firer /= 5;
-						fireg /= 5;
-						fireb /= 5;
-					}
-				}
-
-				if (colour_mode & COLOUR_GRAD)
-				{
-					float frequency = 0.05;
-					int q = sim->parts[i].temp-40;
-					colr = sin(frequency*q) * 16 + colr;
-					colg = sin(frequency*q) * 16 + colg;
-					colb = sin(frequency*q) * 16 + colb;
-					if(pixel_mode & (FIREMODE | PMODE_GLOW)) pixel_mode = (pixel_mode & ~(FIREMODE|PMODE_GLOW)) | PMODE_BLUR;
-				}
-
-	#ifndef OGLR
-				//All colours are now set, check ranges
-				if(colr>255) colr = 255;
-				else if(colr<0) colr = 0;
-				if(colg>255) colg = 255;
-				else if(colg<0) colg = 0;
-				if(colb>255) colb = 255;
-				else if(colb<0) colb = 0;
-				if(cola>255) cola = 255;
-				else if(cola<0) cola = 0;
-
-				if(firer>255) firer = 255;
-				else if(firer<0) firer = 0;
-				if(fireg>255) fireg = 255;
-				else if(fireg<0) fireg = 0;
-				if(fireb>255) fireb = 255;
-				else if(fireb<0) fireb = 0;
-				if(firea>255) firea = 255;
-				else if(firea<0) firea = 0;
-	#endif
-
 				//Pixel rendering
 				if (pixel_mode & EFFECT_LINES)
 				{
@@ -1525,7 +2016,6 @@ void Renderer::render_parts()
 						}
 					}
 
-#ifdef OGLR
 					glColor4f(((float)colr)/255.0f, ((float)colg)/255.0f, ((float)colb)/255.0f, 1.0f);
 					glBegin(GL_LINE_STRIP);
 					if(t==PT_FIGH)
@@ -1549,105 +2039,27 @@ void Renderer::render_parts()
 
 					if (colour_mode!=COLOUR_HEAT)
 					{
-						if (t==PT_STKM2)
-							glColor4f(100.0f/255.0f, 100.0f/255.0f, 1.0f, 1.0f);
-						else
-							glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-					}
-
-					glVertex2f(nx, ny+3);
-					glVertex2f(cplayer->legs[0], cplayer->legs[1]);
-
-					glVertex2f(cplayer->legs[0], cplayer->legs[1]);
-					glVertex2f(cplayer->legs[4], cplayer->legs[5]);
-
-					glVertex2f(nx, ny+3);
-					glVertex2f(cplayer->legs[8], cplayer->legs[9]);
-
-					glVertex2f(cplayer->legs[8], cplayer->legs[9]);
-					glVertex2f(cplayer->legs[12], cplayer->legs[13]);
-					glEnd();
-#else
-					if (findingElement && findingElement == t)
-					{
-						legr = 255;
-						legg = legb = 0;
-					}
-					else if (colour_mode==COLOUR_HEAT)
-					{
-						legr = colr;
-						legg = colg;
-						legb = colb;
-					}
-					else if (t==PT_STKM2)
-					{
-						legr = 100;
-						legg = 100;
-						legb = 255;
-					}
-					else
-					{
-						legr = 255;
-						legg = 255;
-						legb = 255;
-					}
-
-					if (findingElement && findingElement != t)
-					{
-						colr /= 10;
-						colg /= 10;
-						colb /= 10;
-						legr /= 10;
-						legg /= 10;
-						legb /= 10;
-					}
-
-					//head
-					if(t==PT_FIGH)
-					{
-						draw_line(nx, ny+2, nx+2, ny, colr, colg, colb, 255);
-						draw_line(nx+2, ny, nx, ny-2, colr, colg, colb, 255);
-						draw_line(nx, ny-2, nx-2, ny, colr, colg, colb, 255);
-						draw_line(nx-2, ny, nx, ny+2, colr, colg, colb, 255);
-					}
-					else
-					{
-						draw_line(nx-2, ny+2, nx+2, ny+2, colr, colg, colb, 255);
-						draw_line(nx-2, ny-2, nx+2, ny-2, colr, colg, colb, 255);
-						draw_line(nx-2, ny-2, nx-2, ny+2, colr, colg, colb, 255);
-						draw_line(nx+2, ny-2, nx+2, ny+2, colr, colg, colb, 255);
-					}
-					//legs
-					draw_line(nx, ny+3, cplayer->legs[0], cplayer->legs[1], legr, legg, legb, 255);
-					draw_line(cplayer->legs[0], cplayer->legs[1], cplayer->legs[4], cplayer->legs[5], legr, legg, legb, 255);
-					draw_line(nx, ny+3, cplayer->legs[8], cplayer->legs[9], legr, legg, legb, 255);
-					draw_line(cplayer->legs[8], cplayer->legs[9], cplayer->legs[12], cplayer->legs[13], legr, legg, legb, 255);
-					if (cplayer->rocketBoots)
-					{
-						for (int leg=0; leg<2; leg++)
-						{
-							int nx = cplayer->legs[leg*8+4], ny = cplayer->legs[leg*8+5];
-							int colr = 255, colg = 0, colb = 255;
-							if (((int)(cplayer->comm)&0x04) == 0x04 || (((int)(cplayer->comm)&0x01) == 0x01 && leg==0) || (((int)(cplayer->comm)&0x02) == 0x02 && leg==1))
-								blendpixel(nx, ny, 0, 255, 0, 255);
-							else
-								blendpixel(nx, ny, 255, 0, 0, 255);
-							blendpixel(nx+1, ny, colr, colg, colb, 223);
-							blendpixel(nx-1, ny, colr, colg, colb, 223);
-							blendpixel(nx, ny+1, colr, colg, colb, 223);
-							blendpixel(nx, ny-1, colr, colg, colb, 223);
-
-							blendpixel(nx+1, ny-1, colr, colg, colb, 112);
-							blendpixel(nx-1, ny-1, colr, colg, colb, 112);
-							blendpixel(nx+1, ny+1, colr, colg, colb, 112);
-							blendpixel(nx-1, ny+1, colr, colg, colb, 112);
-						}
+						if (t==PT_STKM2)
+							glColor4f(100.0f/255.0f, 100.0f/255.0f, 1.0f, 1.0f);
+						else
+							glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
 					}
-#endif
+
+					glVertex2f(nx, ny+3);
+					glVertex2f(cplayer->legs[0], cplayer->legs[1]);
+
+					glVertex2f(cplayer->legs[0], cplayer->legs[1]);
+					glVertex2f(cplayer->legs[4], cplayer->legs[5]);
+
+					glVertex2f(nx, ny+3);
+					glVertex2f(cplayer->legs[8], cplayer->legs[9]);
+
+					glVertex2f(cplayer->legs[8], cplayer->legs[9]);
+					glVertex2f(cplayer->legs[12], cplayer->legs[13]);
+					glEnd();
 				}
 				if(pixel_mode & PMODE_FLAT)
 				{
-#ifdef OGLR
 					flatV[cflatV++] = nx;
 					flatV[cflatV++] = ny;
 					flatC[cflatC++] = ((float)colr)/255.0f;
@@ -1655,13 +2067,9 @@ void Renderer::render_parts()
 					flatC[cflatC++] = ((float)colb)/255.0f;
 					flatC[cflatC++] = 1.0f;
 					cflat++;
-#else
-					vid[ny*(VIDXRES)+nx] = PIXRGB(colr,colg,colb);
-#endif
 				}
 				if(pixel_mode & PMODE_BLEND)
 				{
-#ifdef OGLR
 					flatV[cflatV++] = nx;
 					flatV[cflatV++] = ny;
 					flatC[cflatC++] = ((float)colr)/255.0f;
@@ -1669,13 +2077,9 @@ void Renderer::render_parts()
 					flatC[cflatC++] = ((float)colb)/255.0f;
 					flatC[cflatC++] = ((float)cola)/255.0f;
 					cflat++;
-#else
-					blendpixel(nx, ny, colr, colg, colb, cola);
-#endif
 				}
 				if(pixel_mode & PMODE_ADD)
 				{
-#ifdef OGLR
 					addV[caddV++] = nx;
 					addV[caddV++] = ny;
 					addC[caddC++] = ((float)colr)/255.0f;
@@ -1683,13 +2087,9 @@ void Renderer::render_parts()
 					addC[caddC++] = ((float)colb)/255.0f;
 					addC[caddC++] = ((float)cola)/255.0f;
 					cadd++;
-#else
-					addpixel(nx, ny, colr, colg, colb, cola);
-#endif
 				}
 				if(pixel_mode & PMODE_BLOB)
 				{
-#ifdef OGLR
 					blobV[cblobV++] = nx;
 					blobV[cblobV++] = ny;
 					blobC[cblobC++] = ((float)colr)/255.0f;
@@ -1697,24 +2097,10 @@ void Renderer::render_parts()
 					blobC[cblobC++] = ((float)colb)/255.0f;
 					blobC[cblobC++] = 1.0f;
 					cblob++;
-#else
-					vid[ny*(VIDXRES)+nx] = PIXRGB(colr,colg,colb);
-
-					blendpixel(nx+1, ny, colr, colg, colb, 223);
-					blendpixel(nx-1, ny, colr, colg, colb, 223);
-					blendpixel(nx, ny+1, colr, colg, colb, 223);
-					blendpixel(nx, ny-1, colr, colg, colb, 223);
-
-					blendpixel(nx+1, ny-1, colr, colg, colb, 112);
-					blendpixel(nx-1, ny-1, colr, colg, colb, 112);
-					blendpixel(nx+1, ny+1, colr, colg, colb, 112);
-					blendpixel(nx-1, ny+1, colr, colg, colb, 112);
-#endif
 				}
 				if(pixel_mode & PMODE_GLOW)
 				{
 					int cola1 = (5*cola)/255;
-#ifdef OGLR
 					glowV[cglowV++] = nx;
 					glowV[cglowV++] = ny;
 					glowC[cglowC++] = ((float)colr)/255.0f;
@@ -1722,32 +2108,9 @@ void Renderer::render_parts()
 					glowC[cglowC++] = ((float)colb)/255.0f;
 					glowC[cglowC++] = 1.0f;
 					cglow++;
-#else
-					addpixel(nx, ny, colr, colg, colb, (192*cola)/255);
-					addpixel(nx+1, ny, colr, colg, colb, (96*cola)/255);
-					addpixel(nx-1, ny, colr, colg, colb, (96*cola)/255);
-					addpixel(nx, ny+1, colr, colg, colb, (96*cola)/255);
-					addpixel(nx, ny-1, colr, colg, colb, (96*cola)/255);
-
-					for (x = 1; x < 6; x++) {
-						addpixel(nx, ny-x, colr, colg, colb, cola1);
-						addpixel(nx, ny+x, colr, colg, colb, cola1);
-						addpixel(nx-x, ny, colr, colg, colb, cola1);
-						addpixel(nx+x, ny, colr, colg, colb, cola1);
-						for (y = 1; y < 6; y++) {
-							if(x + y > 7)
-								continue;
-							addpixel(nx+x, ny-y, colr, colg, colb, cola1);
-							addpixel(nx-x, ny+y, colr, colg, colb, cola1);
-							addpixel(nx+x, ny+y, colr, colg, colb, cola1);
-							addpixel(nx-x, ny-y, colr, colg, colb, cola1);
-						}
-					}
-#endif
 				}
 				if(pixel_mode & PMODE_BLUR)
 				{
-#ifdef OGLR
 					blurV[cblurV++] = nx;
 					blurV[cblurV++] = ny;
 					blurC[cblurC++] = ((float)colr)/255.0f;
@@ -1755,25 +2118,10 @@ void Renderer::render_parts()
 					blurC[cblurC++] = ((float)colb)/255.0f;
 					blurC[cblurC++] = 1.0f;
 					cblur++;
-#else
-					for (x=-3; x<4; x++)
-					{
-						for (y=-3; y<4; y++)
-						{
-							if (abs(x)+abs(y) <2 && !(abs(x)==2||abs(y)==2))
-								blendpixel(x+nx, y+ny, colr, colg, colb, 30);
-							if (abs(x)+abs(y) <=3 && abs(x)+abs(y))
-								blendpixel(x+nx, y+ny, colr, colg, colb, 20);
-							if (abs(x)+abs(y) == 2)
-								blendpixel(x+nx, y+ny, colr, colg, colb, 10);
-						}
-					}
-#endif
 				}
 				if(pixel_mode & PMODE_SPARK)
 				{
-					flicker = random_gen()%20;
-#ifdef OGLR
+					flicker = rng()%20;
 					//Oh god, this is awful
 					lineC[clineC++] = ((float)colr)/255.0f;
 					lineC[clineC++] = ((float)colg)/255.0f;
@@ -1822,22 +2170,10 @@ void Renderer::render_parts()
 					lineV[clineV++] = fnx;
 					lineV[clineV++] = fny+5;
 					cline++;
-#else
-					gradv = 4*sim->parts[i].life + flicker;
-					for (x = 0; gradv>0.5; x++) {
-						addpixel(nx+x, ny, colr, colg, colb, gradv);
-						addpixel(nx-x, ny, colr, colg, colb, gradv);
-
-						addpixel(nx, ny+x, colr, colg, colb, gradv);
-						addpixel(nx, ny-x, colr, colg, colb, gradv);
-						gradv = gradv/1.5f;
-					}
-#endif
 				}
 				if(pixel_mode & PMODE_FLARE)
 				{
-					flicker = random_gen()%20;
-#ifdef OGLR
+					flicker = rng()%20;
 					//Oh god, this is awful
 					lineC[clineC++] = ((float)colr)/255.0f;
 					lineC[clineC++] = ((float)colg)/255.0f;
@@ -1886,31 +2222,10 @@ void Renderer::render_parts()
 					lineV[clineV++] = fnx;
 					lineV[clineV++] = fny+10;
 					cline++;
-#else
-					gradv = flicker + fabs(parts[i].vx)*17 + fabs(sim->parts[i].vy)*17;
-					blendpixel(nx, ny, colr, colg, colb, (gradv*4)>255?255:(gradv*4) );
-					blendpixel(nx+1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					blendpixel(nx-1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					blendpixel(nx, ny+1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					blendpixel(nx, ny-1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					if (gradv>255) gradv=255;
-					blendpixel(nx+1, ny-1, colr, colg, colb, gradv);
-					blendpixel(nx-1, ny-1, colr, colg, colb, gradv);
-					blendpixel(nx+1, ny+1, colr, colg, colb, gradv);
-					blendpixel(nx-1, ny+1, colr, colg, colb, gradv);
-					for (x = 1; gradv>0.5; x++) {
-						addpixel(nx+x, ny, colr, colg, colb, gradv);
-						addpixel(nx-x, ny, colr, colg, colb, gradv);
-						addpixel(nx, ny+x, colr, colg, colb, gradv);
-						addpixel(nx, ny-x, colr, colg, colb, gradv);
-						gradv = gradv/1.2f;
-					}
-#endif
 				}
 				if(pixel_mode & PMODE_LFLARE)
 				{
-					flicker = random_gen()%20;
-#ifdef OGLR
+					flicker = rng()%20;
 					//Oh god, this is awful
 					lineC[clineC++] = ((float)colr)/255.0f;
 					lineC[clineC++] = ((float)colg)/255.0f;
@@ -1959,26 +2274,6 @@ void Renderer::render_parts()
 					lineV[clineV++] = fnx;
 					lineV[clineV++] = fny+70;
 					cline++;
-#else
-					gradv = flicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
-					blendpixel(nx, ny, colr, colg, colb, (gradv*4)>255?255:(gradv*4) );
-					blendpixel(nx+1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					blendpixel(nx-1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					blendpixel(nx, ny+1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					blendpixel(nx, ny-1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
-					if (gradv>255) gradv=255;
-					blendpixel(nx+1, ny-1, colr, colg, colb, gradv);
-					blendpixel(nx-1, ny-1, colr, colg, colb, gradv);
-					blendpixel(nx+1, ny+1, colr, colg, colb, gradv);
-					blendpixel(nx-1, ny+1, colr, colg, colb, gradv);
-					for (x = 1; gradv>0.5; x++) {
-						addpixel(nx+x, ny, colr, colg, colb, gradv);
-						addpixel(nx-x, ny, colr, colg, colb, gradv);
-						addpixel(nx, ny+x, colr, colg, colb, gradv);
-						addpixel(nx, ny-x, colr, colg, colb, gradv);
-						gradv = gradv/1.01f;
-					}
-#endif
 				}
 				if (pixel_mode & EFFECT_GRAVIN)
 				{
@@ -2038,7 +2333,6 @@ void Renderer::render_parts()
 				//Fire effects
 				if(firea && (pixel_mode & FIRE_BLEND))
 				{
-#ifdef OGLR
 					smokeV[csmokeV++] = nx;
 					smokeV[csmokeV++] = ny;
 					smokeC[csmokeC++] = ((float)firer)/255.0f;
@@ -2046,16 +2340,9 @@ void Renderer::render_parts()
 					smokeC[csmokeC++] = ((float)fireb)/255.0f;
 					smokeC[csmokeC++] = ((float)firea)/255.0f;
 					csmoke++;
-#else
-					firea /= 2;
-					fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
-					fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
-					fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
-#endif
 				}
 				if(firea && (pixel_mode & FIRE_ADD))
 				{
-#ifdef OGLR
 					fireV[cfireV++] = nx;
 					fireV[cfireV++] = ny;
 					fireC[cfireC++] = ((float)firer)/255.0f;
@@ -2063,27 +2350,9 @@ void Renderer::render_parts()
 					fireC[cfireC++] = ((float)fireb)/255.0f;
 					fireC[cfireC++] = ((float)firea)/255.0f;
 					cfire++;
-#else
-					firea /= 8;
-					firer = ((firea*firer) >> 8) + fire_r[ny/CELL][nx/CELL];
-					fireg = ((firea*fireg) >> 8) + fire_g[ny/CELL][nx/CELL];
-					fireb = ((firea*fireb) >> 8) + fire_b[ny/CELL][nx/CELL];
-
-					if(firer>255)
-						firer = 255;
-					if(fireg>255)
-						fireg = 255;
-					if(fireb>255)
-						fireb = 255;
-
-					fire_r[ny/CELL][nx/CELL] = firer;
-					fire_g[ny/CELL][nx/CELL] = fireg;
-					fire_b[ny/CELL][nx/CELL] = fireb;
-#endif
 				}
 				if(firea && (pixel_mode & FIRE_SPARK))
 				{
-#ifdef OGLR
 					smokeV[csmokeV++] = nx;
 					smokeV[csmokeV++] = ny;
 					smokeC[csmokeC++] = ((float)firer)/255.0f;
@@ -2091,17 +2360,10 @@ void Renderer::render_parts()
 					smokeC[csmokeC++] = ((float)fireb)/255.0f;
 					smokeC[csmokeC++] = ((float)firea)/255.0f;
 					csmoke++;
-#else
-					firea /= 4;
-					fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
-					fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
-					fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
-#endif
 				}
 			}
 		}
 	}
-#ifdef OGLR
 
 		//Go into array mode
 		glEnableClientState(GL_COLOR_ARRAY);
@@ -2280,9 +2542,439 @@ void Renderer::render_parts()
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFbo);
 
 		glBlendFunc(origBlendSrc, origBlendDst);
+#else
+	if (gridSize)//draws the grid
+	{
+		for (int ny=0; ny<YRES; ny++)
+		{
+			if (ny%(4*gridSize) == 0)
+			{
+				Raster::BlendRow(vid+ny*(VIDXRES), XRES, 100, 100, 100, 80);
+				continue;
+			}
+			for (int nx=0; nx<XRES; nx+=4*gridSize)
+				blendpixel(nx, ny, 100, 100, 100, 80);
+		}
+	}
+#if !defined(OGLR) && !defined(OGLI)
+	//Only a full redraw can tell which elements currently draw outside of their tile
+	if (!renderDirtyOnly)
+		std::fill(unboundedTypes, unboundedTypes+PT_NUM, 0);
+#endif
+	partDraws.clear();
+	foundElements = 0;
+	bool crossScreen = DrawParts();
+	if (workers)
+		DrawPartBands(crossScreen);
 #endif
 }
 
+#ifndef OGLR
+void Renderer::DrawPartBands(bool crossScreen)
+{
+	TRACE_ZONE("DrawPartBands");
+	if (crossScreen)
+	{
+		Raster::Target band = { vid, VIDXRES, 0, 0, VIDXRES, VIDYRES };
+		for (size_t j = 0; j < partDraws.size(); j++)
+			DrawPart(partDraws[j], band);
+		return;
+	}
+
+	for (int b = 0; b < BANDS; b++)
+		bandParts[b].clear();
+	for (size_t j = 0; j < partDraws.size(); j++)
+	{
+		// Everything below the simulation belongs to the last band
+		int last = std::min(partDraws[j].bottom/BAND_HEIGHT, BANDS-1);
+		for (int b = partDraws[j].top/BAND_HEIGHT; b <= last; b++)
+			bandParts[b].push_back(j);
+	}
+
+	DrawBands([this](int top, int bottom) {
+		TRACE_ZONE("DrawPart bands");
+		Raster::Target band = { vid, VIDXRES, 0, top, VIDXRES, bottom };
+		std::vector<int> & indices = bandParts[top/BAND_HEIGHT];
+		for (size_t j = 0; j < indices.size(); j++)
+			DrawPart(partDraws[indices[j]], band);
+	});
+}
+
+void Renderer::DrawBands(const std::function<void(int, int)> & draw)
+{
+	if (!workers)
+	{
+		draw(0, VIDYRES);
+		return;
+	}
+	// Bands are handed out one at a time, so that a thread that got a busy part of the screen doesn't hold
+	// the others up. The last one takes everything below the simulation as well.
+	std::atomic<int> nextBand(0);
+	workers->Run([&draw, &nextBand](int) {
+		for (int b = nextBand++; b < BANDS; b = nextBand++)
+			draw(b*BAND_HEIGHT, b == BANDS-1 ? VIDYRES : (b+1)*BAND_HEIGHT);
+	});
+}
+
+
+void Renderer::DrawPart(const PartDraw & part, Raster::Target & band)
+{
+	int i = part.i, nx = part.nx, ny = part.ny, pixel_mode = part.pixel_mode, x, y;
+	int cola = part.cola, colr = part.colr, colg = part.colg, colb = part.colb;
+	int firea = part.firea, firer = part.firer, fireg = part.fireg, fireb = part.fireb;
+	int orbd[4] = {0, 0, 0, 0}, orbl[4] = {0, 0, 0, 0};
+	float gradv, flicker;
+	Particle * parts = sim->parts;
+	Element * elements = sim->elements;
+	int t = parts[i].type;
+
+	//Pixel rendering
+	if (pixel_mode & EFFECT_LINES)
+	{
+		if (t==PT_SOAP)
+		{
+			if ((parts[i].ctype&3) == 3 && parts[i].tmp >= 0 && parts[i].tmp < NPART)
+				draw_line(nx, ny, (int)(parts[parts[i].tmp].x+0.5f), (int)(parts[parts[i].tmp].y+0.5f), colr, colg, colb, cola);
+		}
+	}
+	if(pixel_mode & PSPEC_STICKMAN)
+	{
+		int legr, legg, legb;
+		playerst *cplayer;
+		if(t==PT_STKM)
+			cplayer = &sim->player;
+		else if(t==PT_STKM2)
+			cplayer = &sim->player2;
+		else if (t==PT_FIGH && sim->parts[i].tmp >= 0 && sim->parts[i].tmp < MAX_FIGHTERS)
+			cplayer = &sim->fighters[(unsigned char)sim->parts[i].tmp];
+		else
+			return;
+
+		if (mousePos.X>(nx-3) && mousePos.X<(nx+3) && mousePos.Y<(ny+3) && mousePos.Y>(ny-3)) //If mouse is in the head
+		{
+			String hp = String::Build(Format::Width(sim->parts[i].life, 3));
+			drawtext(mousePos.X-8-2*(sim->parts[i].life<100)-2*(sim->parts[i].life<10), mousePos.Y-12, hp, 255, 255, 255, 255);
+		}
+
+		if (findingElement == t)
+		{
+			colr = 255;
+			colg = colb = 0;
+		}
+		else if (colour_mode != COLOUR_HEAT)
+		{
+			if (cplayer->fan)
+			{
+				colr = PIXR(0x8080FF);
+				colg = PIXG(0x8080FF);
+				colb = PIXB(0x8080FF);
+			}
+			else if (cplayer->elem < PT_NUM && cplayer->elem > 0)
+			{
+				colr = PIXR(elements[cplayer->elem].Colour);
+				colg = PIXG(elements[cplayer->elem].Colour);
+				colb = PIXB(elements[cplayer->elem].Colour);
+			}
+			else
+			{
+				colr = 0x80;
+				colg = 0x80;
+				colb = 0xFF;
+			}
+		}
+
+		if (findingElement && findingElement == t)
+		{
+			legr = 255;
+			legg = legb = 0;
+		}
+		else if (colour_mode==COLOUR_HEAT)
+		{
+			legr = colr;
+			legg = colg;
+			legb = colb;
+		}
+		else if (t==PT_STKM2)
+		{
+			legr = 100;
+			legg = 100;
+			legb = 255;
+		}
+		else
+		{
+			legr = 255;
+			legg = 255;
+			legb = 255;
+		}
+
+		if (findingElement && findingElement != t)
+		{
+			colr /= 10;
+			colg /= 10;
+			colb /= 10;
+			legr /= 10;
+			legg /= 10;
+			legb /= 10;
+		}
+
+		//head
+		if(t==PT_FIGH)
+		{
+			draw_line(nx, ny+2, nx+2, ny, colr, colg, colb, 255);
+			draw_line(nx+2, ny, nx, ny-2, colr, colg, colb, 255);
+			draw_line(nx, ny-2, nx-2, ny, colr, colg, colb, 255);
+			draw_line(nx-2, ny, nx, ny+2, colr, colg, colb, 255);
+		}
+		else
+		{
+			draw_line(nx-2, ny+2, nx+2, ny+2, colr, colg, colb, 255);
+			draw_line(nx-2, ny-2, nx+2, ny-2, colr, colg, colb, 255);
+			draw_line(nx-2, ny-2, nx-2, ny+2, colr, colg, colb, 255);
+			draw_line(nx+2, ny-2, nx+2, ny+2, colr, colg, colb, 255);
+		}
+		//legs
+		draw_line(nx, ny+3, cplayer->legs[0], cplayer->legs[1], legr, legg, legb, 255);
+		draw_line(cplayer->legs[0], cplayer->legs[1], cplayer->legs[4], cplayer->legs[5], legr, legg, legb, 255);
+		draw_line(nx, ny+3, cplayer->legs[8], cplayer->legs[9], legr, legg, legb, 255);
+		draw_line(cplayer->legs[8], cplayer->legs[9], cplayer->legs[12], cplayer->legs[13], legr, legg, legb, 255);
+		if (cplayer->rocketBoots)
+		{
+			for (int leg=0; leg<2; leg++)
+			{
+				int nx = cplayer->legs[leg*8+4], ny = cplayer->legs[leg*8+5];
+				int colr = 255, colg = 0, colb = 255;
+				if (((int)(cplayer->comm)&0x04) == 0x04 || (((int)(cplayer->comm)&0x01) == 0x01 && leg==0) || (((int)(cplayer->comm)&0x02) == 0x02 && leg==1))
+					band.BlendPixel(nx, ny, 0, 255, 0, 255);
+				else
+					band.BlendPixel(nx, ny, 255, 0, 0, 255);
+				band.BlendPixel(nx+1, ny, colr, colg, colb, 223);
+				band.BlendPixel(nx-1, ny, colr, colg, colb, 223);
+				band.BlendPixel(nx, ny+1, colr, colg, colb, 223);
+				band.BlendPixel(nx, ny-1, colr, colg, colb, 223);
+
+				band.BlendPixel(nx+1, ny-1, colr, colg, colb, 112);
+				band.BlendPixel(nx-1, ny-1, colr, colg, colb, 112);
+				band.BlendPixel(nx+1, ny+1, colr, colg, colb, 112);
+				band.BlendPixel(nx-1, ny+1, colr, colg, colb, 112);
+			}
+		}
+	}
+	if(pixel_mode & PMODE_FLAT)
+	{
+		band.BlendPixel(nx, ny, colr, colg, colb, 255);
+	}
+	if(pixel_mode & PMODE_BLEND)
+	{
+		band.BlendPixel(nx, ny, colr, colg, colb, cola);
+	}
+	if(pixel_mode & PMODE_ADD)
+	{
+		band.AddPixel(nx, ny, colr, colg, colb, cola);
+	}
+	if(pixel_mode & PMODE_BLOB)
+	{
+		band.BlendPixel(nx, ny, colr, colg, colb, 255);
+
+		band.BlendPixel(nx+1, ny, colr, colg, colb, 223);
+		band.BlendPixel(nx-1, ny, colr, colg, colb, 223);
+		band.BlendPixel(nx, ny+1, colr, colg, colb, 223);
+		band.BlendPixel(nx, ny-1, colr, colg, colb, 223);
+
+		band.BlendPixel(nx+1, ny-1, colr, colg, colb, 112);
+		band.BlendPixel(nx-1, ny-1, colr, colg, colb, 112);
+		band.BlendPixel(nx+1, ny+1, colr, colg, colb, 112);
+		band.BlendPixel(nx-1, ny+1, colr, colg, colb, 112);
+	}
+	if(pixel_mode & PMODE_GLOW)
+	{
+		int cola1 = (5*cola)/255;
+		band.AddPixel(nx, ny, colr, colg, colb, (192*cola)/255);
+		band.AddPixel(nx+1, ny, colr, colg, colb, (96*cola)/255);
+		band.AddPixel(nx-1, ny, colr, colg, colb, (96*cola)/255);
+		band.AddPixel(nx, ny+1, colr, colg, colb, (96*cola)/255);
+		band.AddPixel(nx, ny-1, colr, colg, colb, (96*cola)/255);
+
+		for (x = 1; x < 6; x++) {
+			band.AddPixel(nx, ny-x, colr, colg, colb, cola1);
+			band.AddPixel(nx, ny+x, colr, colg, colb, cola1);
+			band.AddPixel(nx-x, ny, colr, colg, colb, cola1);
+			band.AddPixel(nx+x, ny, colr, colg, colb, cola1);
+			for (y = 1; y < 6; y++) {
+				if(x + y > 7)
+					continue;
+				band.AddPixel(nx+x, ny-y, colr, colg, colb, cola1);
+				band.AddPixel(nx-x, ny+y, colr, colg, colb, cola1);
+				band.AddPixel(nx+x, ny+y, colr, colg, colb, cola1);
+				band.AddPixel(nx-x, ny-y, colr, colg, colb, cola1);
+			}
+		}
+	}
+	if(pixel_mode & PMODE_BLUR)
+	{
+		for (x=-3; x<4; x++)
+		{
+			for (y=-3; y<4; y++)
+			{
+				if (abs(x)+abs(y) <2 && !(abs(x)==2||abs(y)==2))
+					band.BlendPixel(x+nx, y+ny, colr, colg, colb, 30);
+				if (abs(x)+abs(y) <=3 && abs(x)+abs(y))
+					band.BlendPixel(x+nx, y+ny, colr, colg, colb, 20);
+				if (abs(x)+abs(y) == 2)
+					band.BlendPixel(x+nx, y+ny, colr, colg, colb, 10);
+			}
+		}
+	}
+	if(pixel_mode & PMODE_SPARK)
+	{
+		flicker = part.flicker[0];
+		gradv = 4*sim->parts[i].life + flicker;
+		for (x = 0; gradv>0.5; x++) {
+			band.AddPixel(nx+x, ny, colr, colg, colb, gradv);
+			band.AddPixel(nx-x, ny, colr, colg, colb, gradv);
+
+			band.AddPixel(nx, ny+x, colr, colg, colb, gradv);
+			band.AddPixel(nx, ny-x, colr, colg, colb, gradv);
+			gradv = gradv/1.5f;
+		}
+	}
+	if(pixel_mode & PMODE_FLARE)
+	{
+		flicker = part.flicker[1];
+		gradv = flicker + fabs(parts[i].vx)*17 + fabs(sim->parts[i].vy)*17;
+		band.BlendPixel(nx, ny, colr, colg, colb, (gradv*4)>255?255:(gradv*4) );
+		band.BlendPixel(nx+1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		band.BlendPixel(nx-1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		band.BlendPixel(nx, ny+1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		band.BlendPixel(nx, ny-1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		if (gradv>255) gradv=255;
+		band.BlendPixel(nx+1, ny-1, colr, colg, colb, gradv);
+		band.BlendPixel(nx-1, ny-1, colr, colg, colb, gradv);
+		band.BlendPixel(nx+1, ny+1, colr, colg, colb, gradv);
+		band.BlendPixel(nx-1, ny+1, colr, colg, colb, gradv);
+		for (x = 1; gradv>0.5; x++) {
+			band.AddPixel(nx+x, ny, colr, colg, colb, gradv);
+			band.AddPixel(nx-x, ny, colr, colg, colb, gradv);
+			band.AddPixel(nx, ny+x, colr, colg, colb, gradv);
+			band.AddPixel(nx, ny-x, colr, colg, colb, gradv);
+			gradv = gradv/1.2f;
+		}
+	}
+	if(pixel_mode & PMODE_LFLARE)
+	{
+		flicker = part.flicker[2];
+		gradv = flicker + fabs(parts[i].vx)*17 + fabs(parts[i].vy)*17;
+		band.BlendPixel(nx, ny, colr, colg, colb, (gradv*4)>255?255:(gradv*4) );
+		band.BlendPixel(nx+1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		band.BlendPixel(nx-1, ny, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		band.BlendPixel(nx, ny+1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		band.BlendPixel(nx, ny-1, colr, colg, colb, (gradv*2)>255?255:(gradv*2) );
+		if (gradv>255) gradv=255;
+		band.BlendPixel(nx+1, ny-1, colr, colg, colb, gradv);
+		band.BlendPixel(nx-1, ny-1, colr, colg, colb, gradv);
+		band.BlendPixel(nx+1, ny+1, colr, colg, colb, gradv);
+		band.BlendPixel(nx-1, ny+1, colr, colg, colb, gradv);
+		for (x = 1; gradv>0.5; x++) {
+			band.AddPixel(nx+x, ny, colr, colg, colb, gradv);
+			band.AddPixel(nx-x, ny, colr, colg, colb, gradv);
+			band.AddPixel(nx, ny+x, colr, colg, colb, gradv);
+			band.AddPixel(nx, ny-x, colr, colg, colb, gradv);
+			gradv = gradv/1.01f;
+		}
+	}
+	if (pixel_mode & EFFECT_GRAVIN)
+	{
+		int nxo = 0;
+		int nyo = 0;
+		int r;
+		float drad = 0.0f;
+		float ddist = 0.0f;
+		sim->orbitalparts_get(parts[i].life, parts[i].ctype, orbd, orbl);
+		for (r = 0; r < 4; r++) {
+			ddist = ((float)orbd[r])/16.0f;
+			drad = (M_PI * ((float)orbl[r]) / 180.0f)*1.41f;
+			nxo = (int)(ddist*cos(drad));
+			nyo = (int)(ddist*sin(drad));
+			if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(sim->pmap[ny+nyo][nx+nxo]) != PT_PRTI)
+				band.AddPixel(nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
+		}
+	}
+	if (pixel_mode & EFFECT_GRAVOUT)
+	{
+		int nxo = 0;
+		int nyo = 0;
+		int r;
+		float drad = 0.0f;
+		float ddist = 0.0f;
+		sim->orbitalparts_get(parts[i].life, parts[i].ctype, orbd, orbl);
+		for (r = 0; r < 4; r++) {
+			ddist = ((float)orbd[r])/16.0f;
+			drad = (M_PI * ((float)orbl[r]) / 180.0f)*1.41f;
+			nxo = (int)(ddist*cos(drad));
+			nyo = (int)(ddist*sin(drad));
+			if (ny+nyo>0 && ny+nyo<YRES && nx+nxo>0 && nx+nxo<XRES && TYP(sim->pmap[ny+nyo][nx+nxo]) != PT_PRTO)
+				band.AddPixel(nx+nxo, ny+nyo, colr, colg, colb, 255-orbd[r]);
+		}
+	}
+	if (pixel_mode & EFFECT_DBGLINES && !(display_mode&DISPLAY_PERS))
+	{
+		// draw lines connecting wifi/portal channels
+		if (mousePos.X == nx && mousePos.Y == ny && i == ID(sim->pmap[ny][nx]) && debugLines)
+		{
+			int type = parts[i].type, tmp = (int)((parts[i].temp-73.15f)/100+1), othertmp;
+			if (type == PT_PRTI)
+				type = PT_PRTO;
+			else if (type == PT_PRTO)
+				type = PT_PRTI;
+			for (int z = 0; z <= sim->parts_lastActiveIndex; z++)
+			{
+				if (parts[z].type == type)
+				{
+					othertmp = (int)((parts[z].temp-73.15f)/100+1);
+					if (tmp == othertmp)
+						xor_line(nx,ny,(int)(parts[z].x+0.5f),(int)(parts[z].y+0.5f));
+				}
+			}
+		}
+	}
+	//Fire is kept per cell, the cell belongs to the band the particle is in
+	if (ny < band.top || ny >= band.bottom)
+		return;
+	//Fire effects
+	if(firea && (pixel_mode & FIRE_BLEND))
+	{
+		firea /= 2;
+		fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
+		fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
+		fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
+	}
+	if(firea && (pixel_mode & FIRE_ADD))
+	{
+		firea /= 8;
+		firer = ((firea*firer) >> 8) + fire_r[ny/CELL][nx/CELL];
+		fireg = ((firea*fireg) >> 8) + fire_g[ny/CELL][nx/CELL];
+		fireb = ((firea*fireb) >> 8) + fire_b[ny/CELL][nx/CELL];
+
+		if(firer>255)
+			firer = 255;
+		if(fireg>255)
+			fireg = 255;
+		if(fireb>255)
+			fireb = 255;
+
+		fire_r[ny/CELL][nx/CELL] = firer;
+		fire_g[ny/CELL][nx/CELL] = fireg;
+		fire_b[ny/CELL][nx/CELL] = fireb;
+	}
+	if(firea && (pixel_mode & FIRE_SPARK))
+	{
+		firea /= 4;
+		fire_r[ny/CELL][nx/CELL] = (firea*firer + (255-firea)*fire_r[ny/CELL][nx/CELL]) >> 8;
+		fire_g[ny/CELL][nx/CELL] = (firea*fireg + (255-firea)*fire_g[ny/CELL][nx/CELL]) >> 8;
+		fire_b[ny/CELL][nx/CELL] = (firea*fireb + (255-firea)*fire_b[ny/CELL][nx/CELL]) >> 8;
+	}
+}
+#endif
+
 void Renderer::draw_other() // EMP effect
 {
 	int i, j;
@@ -2358,6 +3050,65 @@ void Renderer::draw_grav()
 	}
 }
 
+// clamp_flt(f, 0.0f, max) written out where the compiler can see it, so that the loops over whole rows of air
+// cells below turn into vector code
+static inline int AirShade(float f, float max)
+{
+	return f < 0.0f ? 0 : (f > max ? 255 : (int)(255.0f*f/max));
+}
+
+void Renderer::UpdateAirColours()
+{
+	unsigned int mode = display_mode & DISPLAY_AIR;
+	bool finding = findingElement != 0;
+	if (reuseAirColours && airColoursValid && airColoursRevision == sim->air->revision && airColoursMode == mode && airColoursFinding == finding)
+		return;
+	airColoursValid = true;
+	airColoursRevision = sim->air->revision;
+	airColoursMode = mode;
+	airColoursFinding = finding;
+	for (int y = 0; y < YRES/CELL; y++)
+	{
+		const float * pv = sim->air->pv[y];
+		const float * vx = sim->air->vx[y];
+		const float * vy = sim->air->vy[y];
+		const float * hv = sim->air->hv[y];
+		pixel * c = airColours[y];
+		// Only one of the shades of pressure is ever more than 0, so both are added instead of choosing between them
+		if (mode & DISPLAY_AIRP)
+		{
+			for (int x = 0; x < XRES/CELL; x++)
+				c[x] = PIXRGB(AirShade(pv[x], 8.0f), 0, AirShade(-pv[x], 8.0f));//positive pressure is red, negative is blue
+		}
+		else if (mode & DISPLAY_AIRV)
+		{
+			for (int x = 0; x < XRES/CELL; x++)
+				c[x] = PIXRGB(AirShade(fabsf(vx[x]), 8.0f),//vx adds red
+					AirShade(pv[x], 8.0f),//pressure adds green
+					AirShade(fabsf(vy[x]), 8.0f));//vy adds blue
+		}
+		else if (mode & DISPLAY_AIRH)
+		{
+			for (int x = 0; x < XRES/CELL; x++)
+				c[x] = airHeatColours[HeatStep(hv[x])];
+		}
+		else
+		{
+			for (int x = 0; x < XRES/CELL; x++)
+			{
+				// velocity adds grey, pressure adds red or blue
+				int r = AirShade(fabsf(vx[x]), 24.0f) + AirShade(fabsf(vy[x]), 20.0f) + AirShade(pv[x], 16.0f);
+				int g = AirShade(fabsf(vx[x]), 20.0f) + AirShade(fabsf(vy[x]), 24.0f);
+				int b = AirShade(fabsf(vx[x]), 24.0f) + AirShade(fabsf(vy[x]), 20.0f) + AirShade(-pv[x], 16.0f);
+				c[x] = PIXRGB(std::min(r, 255), std::min(g, 255), std::min(b, 255));
+			}
+		}
+		if (finding)
+			for (int x = 0; x < XRES/CELL; x++)
+				c[x] = PIXRGB(PIXR(c[x])/10, PIXG(c[x])/10, PIXB(c[x])/10);
+	}
+}
+
 void Renderer::draw_air()
 {
 	if(!sim->aheat_enable && (display_mode & DISPLAY_AIRH))
@@ -2365,74 +3116,24 @@ void Renderer::draw_air()
 #ifndef OGLR
 	if(!(display_mode & DISPLAY_AIR))
 		return;
-	int x, y, i, j;
-	float (*pv)[XRES/CELL] = sim->air->pv;
-	float (*hv)[XRES/CELL] = sim->air->hv;
-	float (*vx)[XRES/CELL] = sim->air->vx;
-	float (*vy)[XRES/CELL] = sim->air->vy;
-	pixel c = 0;
-	for (y=0; y<YRES/CELL; y++)
-		for (x=0; x<XRES/CELL; x++)
+	UpdateAirColours();
+	// Runs of cells inside the render region are blown up along the top row of their cells and copied down
+	for (int y = 0; y < YRES/CELL; y++)
+		for (int x = 0; x < XRES/CELL;)
 		{
-			if (display_mode & DISPLAY_AIRP)
-			{
-				if (pv[y][x] > 0.0f)
-					c  = PIXRGB(clamp_flt(pv[y][x], 0.0f, 8.0f), 0, 0);//positive pressure is red!
-				else
-					c  = PIXRGB(0, 0, clamp_flt(-pv[y][x], 0.0f, 8.0f));//negative pressure is blue!
-			}
-			else if (display_mode & DISPLAY_AIRV)
-			{
-				c  = PIXRGB(clamp_flt(fabsf(vx[y][x]), 0.0f, 8.0f),//vx adds red
-					clamp_flt(pv[y][x], 0.0f, 8.0f),//pressure adds green
-					clamp_flt(fabsf(vy[y][x]), 0.0f, 8.0f));//vy adds blue
-			}
-			else if (display_mode & DISPLAY_AIRH)
-			{
-				float ttemp = hv[y][x]+(-MIN_TEMP);
-				int caddress = restrict_flt((int)( restrict_flt(ttemp, 0.0f, MAX_TEMP+(-MIN_TEMP)) / ((MAX_TEMP+(-MIN_TEMP))/1024) ) *3, 0.0f, (1024.0f*3)-3);
-				c = PIXRGB((int)(color_data[caddress]*0.7f), (int)(color_data[caddress+1]*0.7f), (int)(color_data[caddress+2]*0.7f));
-				//c  = PIXRGB(clamp_flt(fabsf(vx[y][x]), 0.0f, 8.0f),//vx adds red
-				//	clamp_flt(hv[y][x], 0.0f, 1600.0f),//heat adds green
-				//	clamp_flt(fabsf(vy[y][x]), 0.0f, 8.0f));//vy adds blue
-			}
-			else if (display_mode & DISPLAY_AIRC)
+			if (!InRenderRegion(x*CELL, y*CELL))
 			{
-				int r;
-				int g;
-				int b;
-				// velocity adds grey
-				r = clamp_flt(fabsf(vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 20.0f);
-				g = clamp_flt(fabsf(vx[y][x]), 0.0f, 20.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 24.0f);
-				b = clamp_flt(fabsf(vx[y][x]), 0.0f, 24.0f) + clamp_flt(fabsf(vy[y][x]), 0.0f, 20.0f);
-				if (pv[y][x] > 0.0f)
-				{
-					r += clamp_flt(pv[y][x], 0.0f, 16.0f);//pressure adds red!
-					if (r>255)
-						r=255;
-					if (g>255)
-						g=255;
-					if (b>255)
-						b=255;
-					c  = PIXRGB(r, g, b);
-				}
-				else
-				{
-					b += clamp_flt(-pv[y][x], 0.0f, 16.0f);//pressure adds blue!
-					if (r>255)
-						r=255;
-					if (g>255)
-						g=255;
-					if (b>255)
-						b=255;
-					c  = PIXRGB(r, g, b);
-				}
+				x++;
+				continue;
 			}
-			if (findingElement)
-				c = PIXRGB(PIXR(c)/10,PIXG(c)/10,PIXB(c)/10);
-			for (j=0; j<CELL; j++)//draws the colors
-				for (i=0; i<CELL; i++)
-					vid[(x*CELL+i) + (y*CELL+j)*(VIDXRES)] = c;
+			int end = x+1;
+			while (end < XRES/CELL && InRenderRegion(end*CELL, y*CELL))
+				end++;
+			pixel * row = vid + (y*CELL)*(VIDXRES) + x*CELL;
+			Raster::ScaleRow(row, &airColours[y][x], end-x, CELL);
+			for (int j = 1; j < CELL; j++)
+				std::copy(row, row + (end-x)*CELL, row + j*(VIDXRES));
+			x = end;
 		}
 #else
 	int sdl_scale = 1;
@@ -2558,12 +3259,16 @@ Renderer::Renderer(Graphics * g, Simulation * sim):
 	findingElement(0),
     foundElements(0),
 	mousePos(0, 0),
+	incrementalRendering(true),
+	specialisedParts(true),
+	reuseAirColours(true),
 	zoomWindowPosition(0, 0),
 	zoomScopePosition(0, 0),
 	zoomScopeSize(32),
 	zoomEnabled(false),
 	ZFACTOR(8),
-	gridSize(0)
+	gridSize(0),
+	workers(NULL)
 {
 	this->g = g;
 	this->sim = sim;
@@ -2576,6 +3281,23 @@ Renderer::Renderer(Graphics * g, Simulation * sim):
 	persistentVid = new pixel[VIDXRES*YRES];
 	warpVid = new pixel[VIDXRES*VIDYRES];
 #endif
+#if !defined(OGLR) && !defined(OGLI)
+	tileVid = new pixel[XRES*YRES];
+	unboundedTypes = new unsigned char[PT_NUM];
+	std::fill(unboundedTypes, unboundedTypes+PT_NUM, 0);
+	tileCacheValid = false;
+	renderDirtyOnly = false;
+	unboundedEffects = false;
+	tileSettings = 0;
+	memset(tileSignature, 0, sizeof(tileSignature));
+	tileSignaturesValid = false;
+	tileSimRevision = tileAirRevision = 0;
+	tileStreamlines = false;
+	tileTypes = new unsigned char[PT_NUM];
+	std::fill(tileTypes, tileTypes+PT_NUM, 0);
+	memset(animatedTiles, 0, sizeof(animatedTiles));
+	memset(fireTiles, 0, sizeof(fireTiles));
+#endif
 
 	memset(fire_r, 0, sizeof(fire_r));
 	memset(fire_g, 0, sizeof(fire_g));
@@ -2662,6 +3384,23 @@ Renderer::Renderer(Graphics * g, Simulation * sim):
 	flm_data = Graphics::GenerateGradient(fireColours, fireColoursPoints, fireColoursCount, 200);
 	plasma_data = Graphics::GenerateGradient(plasmaColours, plasmaColoursPoints, plasmaColoursCount, 200);
 
+	//Lookup tables for the heat and life displays and for hot glow, so that none of them needs any maths per
+	//particle or air cell
+	for (int step = 0; step < 1024; step++)
+	{
+		int caddress = step*3;
+		airHeatColours[step] = PIXRGB((int)(color_data[caddress]*0.7f), (int)(color_data[caddress+1]*0.7f), (int)(color_data[caddress+2]*0.7f));
+	}
+	for (int q = 0; q < LIFE_SHADES; q++)
+		lifeShades[q] = LifeShade(q);
+	airColoursValid = false;
+	hotGlow.resize(PT_NUM);
+	graphicsStates.resize(PT_NUM);
+	if (sim)
+		for (int t = 0; t < PT_NUM; t++)
+			if (sim->elements[t].Properties & PROP_HOT_GLOW)
+				BuildHotGlow(t);
+
 #ifdef OGLR
 	//FBO Texture
 	glEnable(GL_TEXTURE_2D);
@@ -2829,6 +3568,14 @@ void Renderer::ClearAccumulation()
 	std::fill(fire_b[0]+0, fire_b[(YRES/CELL)-1]+((XRES/CELL)-1), 0);
 #ifndef OGLR
 	std::fill(persistentVid, persistentVid+(VIDXRES*YRES), 0);
+#endif
+	MarkAllDirty();
+}
+
+void Renderer::MarkAllDirty()
+{
+#if !defined(OGLR) && !defined(OGLI)
+	tileCacheValid = false;
 #endif
 }
 
@@ -2959,6 +3706,11 @@ Renderer::~Renderer()
 #endif
 	delete[] persistentVid;
 	delete[] warpVid;
+#endif
+#if !defined(OGLR) && !defined(OGLI)
+	delete[] tileVid;
+	delete[] unboundedTypes;
+	delete[] tileTypes;
 #endif
 	delete[] graphicscache;
 	free(flm_data);
@@ -1,6 +1,7 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <functional>
 #include <vector>
 #ifdef OGLR
 #include "OpenGLHeaders.h"
@@ -8,11 +9,15 @@
 
 #include "Config.h"
 #include "Graphics.h"
+#include "common/tpt-rand.h"
 #include "gui/interface/Point.h"
 
 class RenderPreset;
 class Simulation;
 class Graphics;
+class WorkerPool;
+struct Particle;
+namespace Raster { struct Target; }
 
 struct gcache_item
 {
@@ -36,6 +41,29 @@ struct gcache_item
 };
 typedef struct gcache_item gcache_item;
 
+// How a particle is going to be drawn, worked out by render_parts before anything is drawn so that drawing
+// can be split between threads
+struct PartDraw
+{
+	int i;
+	short nx, ny;
+	// Rows the particle can draw into, everything from top to bottom inclusive
+	short top, bottom;
+	int pixel_mode;
+	unsigned char cola, colr, colg, colb;
+	unsigned char firea, firer, fireg, fireb;
+	// For PMODE_SPARK, PMODE_FLARE and PMODE_LFLARE
+	unsigned char flicker[3];
+};
+
+// What a particle's graphics function and the render and colour modes make of it
+struct PartShade
+{
+	int pixel_mode;
+	int cola, colr, colg, colb;
+	int firea, firer, fireg, fireb;
+};
+
 class Renderer
 {
 public:
@@ -65,10 +93,20 @@ public:
 	pixel sampleColor;
 	int findingElement;
 	int foundElements;
+	//For effects like flicker, kept apart from the simulation's generators so drawing doesn't change the simulation
+	RNG rng;
 
 	//Mouse position for debug information
 	ui::Point mousePos;
 
+	//Only redraw the parts of the screen that changed since the last frame, software renderer only
+	bool incrementalRendering;
+	//Draw particles with the copy of render_parts made for the current render and colour modes where there is one,
+	//only turned off to compare against the copy that handles any mode
+	bool specialisedParts;
+	//Keep the air display's colours from the frame before while the air and the display mode stay the same
+	bool reuseAirColours;
+
 	//Zoom window
 	ui::Point zoomWindowPosition;
 	ui::Point zoomScopePosition;
@@ -86,6 +124,8 @@ public:
 	void DrawSigns();
 	void render_gravlensing(pixel * source);
 	void render_fire();
+	//Keeps the frame one step darker for the persistent display mode to draw over next time
+	void StorePersistent();
 	void prepare_alpha(int size, float intensity);
 	void render_parts();
 	void draw_grav_zones();
@@ -95,7 +135,10 @@ public:
 	void FinaliseParts();
 
 	void ClearAccumulation();
+	void MarkAllDirty();
 	void clearScreen(float alpha);
+	// What was last drawn of the simulation, vid holds on to it until the next frame is drawn
+	pixel * LastFrame();
 	void SetSample(int x, int y);
 
 #ifdef OGLR
@@ -113,8 +156,8 @@ public:
 
 	void draw_icon(int x, int y, Icon icon);
 
-	int drawtext_outline(int x, int y, String s, int r, int g, int b, int a);
-	int drawtext(int x, int y, String s, int r, int g, int b, int a);
+	int drawtext_outline(int x, int y, const String & s, int r, int g, int b, int a);
+	int drawtext(int x, int y, const String & s, int r, int g, int b, int a);
 	int drawchar(int x, int y, String::value_type c, int r, int g, int b, int a);
 	int addchar(int x, int y, String::value_type c, int r, int g, int b, int a);
 
@@ -157,6 +200,8 @@ public:
 
 	int GetGridSize() { return gridSize; }
 	void SetGridSize(int value) { gridSize = value; }
+	// Particles are drawn on these threads when set, software renderer only
+	void SetWorkerPool(WorkerPool * pool) { workers = pool; }
 
 	static VideoBuffer * WallIcon(int wallID, int width, int height);
 
@@ -165,6 +210,114 @@ public:
 
 private:
 	int gridSize;
+	WorkerPool * workers;
+	//Stands in for a render or colour mode that is only known when drawing
+	static const unsigned int ANY_MODE = ~0u;
+
+	template<unsigned int RenderMode, unsigned int ColourMode, int Decorations>
+	void ShadePart(int i, int t, int nx, int ny, PartShade & shade);
+
+	//Colours of the air heat display for each step of the heat gradient
+	pixel airHeatColours[1024];
+	//The air display at one pixel per cell, blown up to the whole screen by draw_air. Rebuilt when the air's
+	//revision, the air display mode or whether an element is being looked for differ from what it was built for.
+	pixel airColours[YRES/CELL][XRES/CELL];
+	bool airColoursValid;
+	unsigned int airColoursRevision;
+	unsigned int airColoursMode;
+	bool airColoursFinding;
+	void UpdateAirColours();
+	//Greys of the life gradient display for the small values of life and its root that nearly all particles have
+	static const int LIFE_SHADES = 4096;
+	unsigned char lifeShades[LIFE_SHADES];
+	//What PROP_HOT_GLOW adds to red, green and blue for each whole degree in the 800 below an element's high
+	//temperature, built for the high temperature the element had at the time
+	static const int HOT_GLOW_DEGREES = 800;
+	struct HotGlow
+	{
+		float highTemperature;
+		std::vector<double> shift;
+	};
+	std::vector<HotGlow> hotGlow;
+	void BuildHotGlow(int t);
+	//Returns the three shifts for caddress degrees, worked out into shift if they aren't in the table
+	const double * GetHotGlow(int t, int caddress, double * shift);
+
+	//What the Graphics functions of elements with a GraphicsState gave for the last particles with each state,
+	//each state has one place it can be kept in and replaces whatever was there before
+	static const int GRAPHICS_STATES = 256;
+	struct GraphicsStateEntry
+	{
+		bool valid;
+		int life, ctype, tmp, tmp2, flags;
+		PartShade shade;
+		GraphicsStateEntry() : valid(false) {}
+	};
+	struct GraphicsStateCache
+	{
+		int (*graphics)(Renderer *, Particle *, int, int, int *, int *, int *, int *, int *, int *, int *, int *, int *);
+		pixel colour;
+		std::vector<GraphicsStateEntry> entries;
+	};
+	std::vector<GraphicsStateCache> graphicsStates;
+	//Fills in shade the way the element's Graphics function would, without calling it if it was already called
+	//for a particle with the same state
+	void GraphicsFromState(int i, int t, int nx, int ny, PartShade & shade);
+#ifndef OGLR
+	//Particles are drawn in bands of rows, each band only by one thread and with the particles that reach into
+	//it in the order they were found, so every pixel ends up blended the same way no matter how many threads draw
+	static const int BAND_HEIGHT = 4*CELL;
+	static const int BANDS = (YRES+BAND_HEIGHT-1)/BAND_HEIGHT;
+	std::vector<PartDraw> partDraws;
+	std::vector<int> bandParts[BANDS];
+
+	// Decides how every particle is drawn and draws it or leaves it for DrawPartBands, true if one draws across
+	// the whole screen. Decorations of -1 and ANY_MODE take what is set when drawing.
+	template<unsigned int RenderMode, unsigned int ColourMode, int Decorations>
+	bool DrawPartsWith();
+	// Picks the DrawPartsWith for the current modes
+	bool DrawParts();
+	void DrawPartBands(bool crossScreen);
+	void DrawPart(const PartDraw & part, Raster::Target & band);
+	// Calls draw with the top and bottom row of every band on the worker threads, or once with the whole
+	// buffer without them. Also used by the passes over the whole frame that come after the particles.
+	void DrawBands(const std::function<void(int, int)> & draw);
+#endif
+#if !defined(OGLR) && !defined(OGLI)
+	//Incremental rendering, the screen is split into tiles which are only redrawn when their contents change
+	static const int TILE_SIZE = 16;
+	static const int TILESX = (XRES+TILE_SIZE-1)/TILE_SIZE;
+	static const int TILESY = (YRES+TILE_SIZE-1)/TILE_SIZE;
+	pixel * tileVid;
+	bool tileCacheValid;
+	bool renderDirtyOnly;
+	bool unboundedEffects;
+	unsigned int tileSettings;
+	unsigned int tileSignature[TILESY][TILESX];
+	unsigned int newTileSignature[TILESY][TILESX];
+	unsigned char dirtyTiles[TILESY][TILESX];
+	unsigned char renderTiles[TILESY][TILESX];
+	unsigned char fireTiles[TILESY][TILESX];
+	unsigned char * unboundedTypes;
+	unsigned char fireBackup[3][YRES/CELL][XRES/CELL];
+	//The signatures are only worked out again once the simulation's or the air's revision moves on, while
+	//paused or between ticks these keep what the last time found
+	bool tileSignaturesValid;
+	unsigned int tileSimRevision, tileAirRevision;
+	bool tileStreamlines;
+	unsigned char * tileTypes;
+	unsigned char animatedTiles[TILESY][TILESX];
+
+	bool RenderIncremental();
+	bool UpdateTileSignatures();
+	void HashTiles();
+	void StoreTiles();
+	void UpdateFireTiles();
+	void DilateTiles(unsigned char (*src)[TILESX], unsigned char (*dst)[TILESX]);
+	bool InRenderRegion(int x, int y) { return !renderDirtyOnly || renderTiles[y/TILE_SIZE][x/TILE_SIZE]; }
+#else
+	bool InRenderRegion(int x, int y) { return true; }
+#endif
 #ifdef OGLR
 	GLuint zoomTex, airBuf, fireAlpha, glowAlpha, blurAlpha, partsFboTex, partsFbo, partsTFX, partsTFY, airPV, airVY, airVX;
 	GLuint fireProg, airProg_Pressure, airProg_Velocity, airProg_Cracker, lensProg;
@@ -12,6 +12,7 @@
 #include "gui/interface/Button.h"
 #include "gui/interface/Mouse.h"
 #include "gui/interface/Keys.h"
+#include "graphics/FontAtlas.h"
 #include "graphics/Graphics.h"
 
 #ifdef FONTEDITOR
@@ -267,6 +268,7 @@ FontEditor::FontEditor(ByteString _header):
 	font_data = fontData.data();
 	font_ptrs = fontPtrs.data();
 	font_ranges = (unsigned int (*)[2])fontRanges.data();
+	FontAtlas::Reload();
 	
 	int baseline = 8 + FONT_H * FONT_SCALE + 4 + FONT_H + 4 + 1;
 	int currentX = 1;
@@ -651,6 +653,7 @@ void FontEditor::Render()
 	font_data = fontData.data();
 	font_ptrs = fontPtrs.data();
 	font_ranges = (unsigned int (*)[2])fontRanges.data();
+	FontAtlas::Reload();
 }
 
 void FontEditor::Save()
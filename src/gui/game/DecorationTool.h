@@ -4,6 +4,7 @@
 
 #include "Tool.h"
 #include "graphics/Graphics.h"
+#include "simulation/Replay.h"
 
 class Renderer;
 class DecorationTool: public Tool
@@ -69,20 +70,29 @@ public:
 	}
 	virtual ~DecorationTool() {}
 	virtual void Draw(Simulation * sim, Brush * brush, ui::Point position){
+		if (sim->recorder)
+			sim->recorder->ApplyDecorationPoint(position.X, position.Y, Red, Green, Blue, Alpha, toolID, brush);
 		sim->ApplyDecorationPoint(position.X, position.Y, Red, Green, Blue, Alpha, toolID, brush);
 	}
 	virtual void DrawLine(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2, bool dragging) {
+		if (sim->recorder)
+			sim->recorder->ApplyDecorationLine(position1.X, position1.Y, position2.X, position2.Y, Red, Green, Blue, Alpha, toolID, brush);
 		sim->ApplyDecorationLine(position1.X, position1.Y, position2.X, position2.Y, Red, Green, Blue, Alpha, toolID, brush);
 	}
 	virtual void DrawRect(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2) {
+		if (sim->recorder)
+			sim->recorder->ApplyDecorationBox(position1.X, position1.Y, position2.X, position2.Y, Red, Green, Blue, Alpha, toolID);
 		sim->ApplyDecorationBox(position1.X, position1.Y, position2.X, position2.Y, Red, Green, Blue, Alpha, toolID);
 	}
 	virtual void DrawFill(Simulation * sim, Brush * brush, ui::Point position) {
-		pixel loc = ren->vid[position.X+position.Y*WINDOWW];
+		pixel loc = ren->LastFrame()[position.X+position.Y*WINDOWW];
 		if (toolID == DECO_CLEAR)
 			sim->ApplyDecorationFill(ren, position.X, position.Y, 0, 0, 0, 0, PIXR(loc), PIXG(loc), PIXB(loc));
 		else
 			sim->ApplyDecorationFill(ren, position.X, position.Y, Red, Green, Blue, Alpha, PIXR(loc), PIXG(loc), PIXB(loc));
+		// The fill follows what is on screen, which a replay doesn't have
+		if (sim->recorder)
+			sim->recorder->State();
 	}
 };
 
@@ -1,18 +1,24 @@
 #include <iostream>
 #include <queue>
-#include <chrono>
+#include <cstdio>
+#include <ctime>
 #include "Config.h"
 #include "Format.h"
 #include "Platform.h"
+#include "common/tpt-trace.h"
 #include "GameController.h"
 #include "GameModel.h"
 #include "gui/render/RenderController.h"
 #include "gui/interface/Point.h"
+#include "graphics/FrameCapture.h"
 #include "gui/dialogues/ErrorMessage.h"
 #include "gui/dialogues/InformationMessage.h"
 #include "gui/dialogues/ConfirmPrompt.h"
+#include "gui/dialogues/TextPrompt.h"
 #include "GameModelException.h"
 #include "simulation/Air.h"
+#include "simulation/Replay.h"
+#include "simulation/SaveFile.h"
 #include "gui/elementsearch/ElementSearchActivity.h"
 #include "gui/colourpicker/ColourPickerActivity.h"
 #include "Notification.h"
@@ -24,6 +30,7 @@
 #include "debug/DebugParts.h"
 #include "debug/ElementPopulation.h"
 #include "debug/DebugLines.h"
+#include "debug/ElementCost.h"
 
 using namespace std;
 
@@ -68,30 +75,15 @@ public:
 	}
 };
 
-void UpdateParticlesByRegion(GameModel* gameModel, Barrier* sbr, Barrier* ebr, atomic<bool>& work, int* rp, int id)
-{
-	while(true)
-	{
-		Simulation * sim = gameModel->GetSimulation();
-		chrono::nanoseconds logic_time;
-
-		sbr->Wait();
-		if(!work)
-			break;
-		sim->UpdateParticles(0, NPART, logic_time, rp[id]);
-		ebr->Wait();
-	}
-}
-
 GameController::GameController():
 	firstTick(true),
 	foundSignID(-1),
-	startbarrier(THRDS+1),
-	endbarrier(THRDS+1),
-	do_work(true),
+	workers(THRDS),
 	renderOptions(NULL),
 	options(NULL),
 	debugFlags(0),
+	frameCapture(NULL),
+	fastForward(),
 	HasDone(false)
 {
 	gameView = new GameView();
@@ -105,18 +97,18 @@ GameController::GameController():
 	debugInfo.push_back(new ElementPopulationDebug(0x2, gameModel->GetSimulation()));
 	debugInfo.push_back(new DebugLines(0x4, gameView, this));
 	//debugInfo.push_back(new ParticleDebug(0x8, gameModel->GetSimulation(), gameModel));
-	
-	for(int thr = 0; thr < THRDS; thr++)
-		thread_pool[thr] = std::thread(UpdateParticlesByRegion, gameModel, &startbarrier, &endbarrier, std::ref(do_work), region_pool, thr);
+	debugInfo.push_back(new ElementCostDebug(0x10, gameModel->GetSimulation()));
+
+	gameModel->GetRenderer()->SetWorkerPool(&workers);
 }
 
 GameController::~GameController()
 {
-	//Stop threads
-	do_work = false;
-	startbarrier.Wait();
-	for(int thr = 0; thr < THRDS; thr++)
-		thread_pool[thr].join();
+	delete gameModel->GetSimulation()->recorder;
+	gameModel->GetSimulation()->recorder = NULL;
+	delete frameCapture;
+	if (fastForward.total)
+		ui::Engine::Ref().Unthrottled = false;
 
 	if(renderOptions)
 	{
@@ -130,12 +122,6 @@ GameController::~GameController()
 	{
 		delete *iter;
 	}
-	//deleted here because it refuses to be deleted when deleted from gameModel even with the same code
-	std::deque<Snapshot*> history = gameModel->GetHistory();
-	for(std::deque<Snapshot*>::iterator iter = history.begin(), end = history.end(); iter != end; ++iter)
-	{
-		delete *iter;
-	}
 	std::vector<QuickOption*> quickOptions = gameModel->GetQuickOptions();
 	for(std::vector<QuickOption*>::iterator iter = quickOptions.begin(), end = quickOptions.end(); iter != end; ++iter)
 	{
@@ -188,6 +174,8 @@ void GameController::AdjustGridSize(int direction)
 void GameController::InvertAirSim()
 {
 	gameModel->GetSimulation()->air->Invert();
+	if (gameModel->GetSimulation()->recorder)
+		gameModel->GetSimulation()->recorder->State();
 }
 
 
@@ -405,7 +393,10 @@ bool GameController::MouseUp(int x, int y, unsigned button, char type)
 					else if (type == 'b')
 					{
 						Simulation * sim = gameModel->GetSimulation();
+						if (sim->recorder)
+							sim->recorder->CreatePart(-1, foundSign.x, foundSign.y, PT_SPRK, -1);
 						sim->create_part(-1, foundSign.x, foundSign.y, PT_SPRK);
+						sim->Changed();
 					}
 				}
 			}
@@ -484,6 +475,67 @@ bool GameController::KeyPress(int key, int scan, bool repeat, bool shift, bool c
 			}
 		}
 
+		// Shift+F3 toggles the element cost panel
+		if (key == SDLK_F3 && shift)
+		{
+			SetDebugFlags(debugFlags ^ 0x10);
+			return false;
+		}
+		// Shift+F5 writes the recent frame trace out for chrome://tracing or Perfetto
+		if (key == SDLK_F5 && shift)
+		{
+			ByteString filename = ByteString::Build("trace-", (long)time(NULL), ".json");
+			if (Trace::Export(filename))
+				gameModel->Log("Saved trace to " + filename.FromUtf8(), true);
+			else
+				gameModel->Log("Could not save trace to " + filename.FromUtf8(), true);
+			return false;
+		}
+		// Ctrl+F5 turns tracing off and on again
+		if (key == SDLK_F5 && ctrl)
+		{
+			Trace::SetEnabled(!Trace::Enabled());
+			gameModel->Log(Trace::Enabled() ? String("Tracing on") : String("Tracing off"), false);
+			return false;
+		}
+
+		// Shift+F6 starts recording a replay, pressing it again writes the replay out
+		if (key == SDLK_F6 && shift)
+		{
+			ToggleReplayRecording();
+			return false;
+		}
+
+		// F7 captures frames as images, Shift+F7 as a raw stream, pressing either again stops
+		if (key == SDLK_F7)
+		{
+			ToggleFrameCapture(shift);
+			return false;
+		}
+
+		// F8 asks how many ticks to fast forward by, pressing it again while that goes on stops it
+		if (key == SDLK_F8)
+		{
+			ToggleFastForward();
+			return false;
+		}
+
+		// F6 and F9 quicksave and quickload the whole simulation
+		if (key == SDLK_F6 || key == SDLK_F9)
+		{
+			ByteString error;
+			bool saving = key == SDLK_F6;
+			if (!saving)
+				HistorySnapshot();
+			if (saving ? SaveFile::Save(sim, "quicksave.mtps", error) : SaveFile::Load(sim, "quicksave.mtps", error))
+				gameModel->Log(saving ? String("Saved quicksave.mtps") : String("Loaded quicksave.mtps"), true);
+			else
+				gameModel->Log(error.FromUtf8(), true);
+			if (!saving && sim->recorder)
+				sim->recorder->State();
+			return false;
+		}
+
 		for(std::vector<DebugInfo*>::iterator iter = debugInfo.begin(), end = debugInfo.end(); iter != end; ++iter)
 		{
 			if ((*iter)->debugID & debugFlags)
@@ -536,6 +588,20 @@ bool GameController::KeyRelease(int key, int scan, bool repeat, bool shift, bool
 void GameController::Tick()
 {
 	firstTick = false;
+	for(std::vector<DebugInfo*>::iterator iter = debugInfo.begin(), end = debugInfo.end(); iter != end; ++iter)
+	{
+		if ((*iter)->debugID & debugFlags)
+			(*iter)->Draw();
+	}
+}
+
+void GameController::SetDebugFlags(unsigned int flags)
+{
+	debugFlags = flags;
+	// Only pay for the instrumentation while its panel is shown
+	gameModel->GetSimulation()->profiler.enabled = (debugFlags & 0x10) != 0;
+	if (!gameModel->GetSimulation()->profiler.enabled)
+		gameModel->GetSimulation()->profiler.Reset();
 }
 
 void GameController::Exit()
@@ -554,6 +620,9 @@ void GameController::ResetAir()
 			sim->parts[i].pavg[0] = sim->parts[i].pavg[1] = 0;
 		}
 	}
+	sim->Changed();
+	if (sim->recorder)
+		sim->recorder->State();
 }
 
 void GameController::ResetSpark()
@@ -571,6 +640,9 @@ void GameController::ResetSpark()
 				sim->kill_part(i);
 		}
 	memset(sim->wireless, 0, sizeof(sim->wireless));
+	sim->Changed();
+	if (sim->recorder)
+		sim->recorder->State();
 }
 
 void GameController::SwitchGravity()
@@ -642,14 +714,7 @@ void GameController::LoadRenderPreset(int presetNum)
 
 void GameController::Update()
 {
-	static chrono::milliseconds before_time {};
-	static chrono::milliseconds update_time {};
-	static chrono::milliseconds after_time {};
-	static chrono::milliseconds mark_time {};
-	static chrono::nanoseconds logic_time1 {};
-	static chrono::nanoseconds logic_time2 {};
-	static chrono::nanoseconds logic_time {};
-	static int frames {};
+	TRACE_ZONE("Simulation");
 	ui::Point pos = gameView->GetMousePosition();
 	gameModel->GetRenderer()->mousePos = PointTranslate(pos);
 	if (pos.X < XRES && pos.Y < YRES)
@@ -659,59 +724,26 @@ void GameController::Update()
 
 	Simulation * sim = gameModel->GetSimulation();
 
-	auto start = chrono::high_resolution_clock::now();
-	sim->BeforeSim();
-	before_time += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
-
-	if (!sim->sys_pause || sim->framerender)
-	{
-		start = chrono::high_resolution_clock::now();
-		//Mark regions for each part
-		sim->MarkPartsRegions(0, NPART);
-		mark_time += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
-
-		for(int thr = 0; thr < THRDS; thr++)
-			region_pool[thr] = thr*2;
-
-		startbarrier.Wait();
-		endbarrier.Wait();
-
-		for(int thr = 0; thr < THRDS; thr++)
-			region_pool[thr] = 1 + thr*2;
-
-		startbarrier.Wait();
-		endbarrier.Wait();
-
-		logic_time = logic_time1 + logic_time2;
-
-		update_time += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
-
-		start = chrono::high_resolution_clock::now();
-		sim->AfterSim();
-		after_time += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
-	}
-
-	if (++frames == 300)
+	// The main loop works out how many ticks are due in this frame, which can be none at all or several when the
+	// simulation runs at a rate of its own. While paused there is always the one, which only keeps the particle
+	// counts up to date for drawing. The main loop is told how many actually simulated, for the TPS shown and for
+	// how long it thinks a tick takes.
+	int ran = 0;
+	if (fastForward.total)
+		ran = RunFastForward();
+	else
 	{
-		auto before = chrono::duration <double, milli>(before_time).count()/300.0;
-		auto update = chrono::duration <double, milli>(update_time).count()/300.0;
-		auto after = chrono::duration <double, milli>(after_time).count()/300.0;
-		auto mark = chrono::duration <double, milli>(mark_time).count()/300.0;
-		auto logic = chrono::duration <double, milli>(logic_time).count()/300.0;
-
-		if (update)
+		int ticks = ui::Engine::Ref().GetSimTicks();
+		if (sim->sys_pause && !sim->framerender)
+			ticks = 1;
+		for (int i = 0; i < ticks; i++)
 		{
-			cout << "BeforeSim: " << before << " ms, MarkRegions: " << mark << 
-				" ms, UpdateParticles: " << update << " ms, AfterSim: " << after << " ms" << endl;
-			cout << "movement/update: " << (update - logic)/update << endl;
+			if (!sim->sys_pause || sim->framerender)
+				ran++;
+			sim->Tick(&workers);
 		}
-		frames = 0;
-		before_time = chrono::milliseconds(0);
-		update_time = chrono::milliseconds(0);
-		after_time = chrono::milliseconds(0);
-		mark_time = chrono::milliseconds(0);
-		logic_time = chrono::milliseconds(0);
 	}
+	ui::Engine::Ref().SetSimTicksRun(ran);
 
 	//if either STKM or STK2 isn't out, reset it's selected element. Defaults to PT_DUST unless right selected is something else
 	//This won't run if the stickmen dies in a frame, since it respawns instantly
@@ -959,9 +991,178 @@ void GameController::ChangeBrush()
 
 void GameController::ClearSim()
 {
+	HistorySnapshot();
 	gameModel->ClearSimulation();
 }
 
+void GameController::HistoryRestore()
+{
+	if (!gameModel->HistoryCanRestore())
+		return;
+	// When undoing for the first time since the last HistorySnapshot, keep the current state around
+	// so that redoing all the way brings back the point right before the first undo
+	if (!gameModel->GetRedoHistory())
+		gameModel->SetRedoHistory(gameModel->GetSimulation()->CreateSnapshot());
+	gameModel->HistoryRestore();
+	gameModel->GetSimulation()->Restore(*gameModel->HistoryCurrent());
+	if (gameModel->GetSimulation()->recorder)
+		gameModel->GetSimulation()->recorder->State();
+}
+
+void GameController::HistorySnapshot()
+{
+	// The user decided to keep working from the current state, whatever was undone is gone
+	delete gameModel->GetRedoHistory();
+	gameModel->SetRedoHistory(NULL);
+	gameModel->HistoryPush();
+}
+
+void GameController::HistoryForward()
+{
+	if (!gameModel->HistoryCanForward())
+		return;
+	gameModel->HistoryForward();
+	// Past the newest entry is the state from before the first undo
+	const Snapshot * current = gameModel->HistoryCurrent();
+	if (current)
+		gameModel->GetSimulation()->Restore(*current);
+	else if (gameModel->GetRedoHistory())
+	{
+		gameModel->GetSimulation()->Restore(*gameModel->GetRedoHistory());
+		delete gameModel->GetRedoHistory();
+		gameModel->SetRedoHistory(NULL);
+	}
+	if (gameModel->GetSimulation()->recorder)
+		gameModel->GetSimulation()->recorder->State();
+}
+
+void GameController::ToggleReplayRecording()
+{
+	Simulation * sim = gameModel->GetSimulation();
+	if (!sim->recorder)
+	{
+		StopFastForward();
+		sim->recorder = new ReplayRecorder(sim, time(NULL));
+		gameModel->Log(String("Recording replay, press Shift+F6 again to stop"), false);
+		return;
+	}
+	ByteString filename = ByteString::Build("replay-", (long)time(NULL), ".mtpr");
+	ByteString error;
+	if (sim->recorder->Save(filename, error))
+		gameModel->Log(ByteString::Build("Saved ", sim->recorder->GetFrameCount(), " frames of replay to ", filename).FromUtf8(), true);
+	else
+		gameModel->Log(error.FromUtf8(), true);
+	delete sim->recorder;
+	sim->recorder = NULL;
+}
+
+void GameController::ToggleFrameCapture(bool raw)
+{
+	if (!frameCapture)
+	{
+		ByteString path = ByteString::Build("capture-", (long)time(NULL), raw ? ".rgb" : "");
+		FrameCapture * capture = new FrameCapture(path, raw ? FrameCapture::RawStream : FrameCapture::ImageSequence, XRES, YRES);
+		ByteString error;
+		if (!capture->Start(error))
+		{
+			gameModel->Log(error.FromUtf8(), true);
+			delete capture;
+			return;
+		}
+		frameCapture = capture;
+		gameModel->Log(ByteString::Build("Capturing frames to ", path, ", press F7 again to stop").FromUtf8(), false);
+		if (raw)
+			gameModel->Log(ByteString::Build("The stream is ", XRES, "x", YRES, " rgb24 without a header").FromUtf8(), false);
+		return;
+	}
+	ByteString error;
+	bool ok = frameCapture->Stop(error);
+	FrameCapture::Stats stats = frameCapture->GetStats();
+	ByteString message = ByteString::Build("Wrote ", stats.written, " frames to ", frameCapture->GetPath());
+	if (stats.dropped || stats.throttled)
+		message += ByteString::Build(", ", stats.throttled, " skipped and ", stats.dropped, " dropped while behind");
+	gameModel->Log(message.FromUtf8(), true);
+	if (!ok)
+		gameModel->Log(error.FromUtf8(), true);
+	delete frameCapture;
+	frameCapture = NULL;
+}
+
+// The longest fast forward goes without a frame, so that input is still handled and progress still shown while
+// every frame takes a lot of ticks or the ticks are slow
+static const long long FAST_FORWARD_FRAME_NANOSECONDS = 500000000LL;
+
+void GameController::FastForward(int ticks, int renderEvery)
+{
+	if (ticks <= 0)
+		return;
+	Simulation * sim = gameModel->GetSimulation();
+	if (sim->recorder || sim->replayPlayer)
+	{
+		gameModel->Log(String("Can't fast forward while a replay is being recorded or played"), false);
+		return;
+	}
+	// The whole run can be undone in one go
+	HistorySnapshot();
+	fastForward.total = ticks;
+	fastForward.done = 0;
+	fastForward.renderEvery = std::max(renderEvery, 0);
+	fastForward.start = GetNanoTicks();
+	ui::Engine::Ref().Unthrottled = true;
+}
+
+void GameController::StopFastForward()
+{
+	if (!fastForward.total)
+		return;
+	FastForwardStats stats = GetFastForwardStats();
+	StringBuilder message;
+	message << "Fast forwarded " << stats.done << " of " << stats.total << " ticks, " << Format::Precision(2) << stats.ticksPerSecond << " ticks per second";
+	gameModel->Log(message.Build(), false);
+	fastForward.total = 0;
+	ui::Engine::Ref().Unthrottled = false;
+}
+
+void GameController::ToggleFastForward()
+{
+	if (fastForward.total)
+	{
+		StopFastForward();
+		return;
+	}
+	String text = TextPrompt::Blocking("Fast forward", "How many ticks to run, and optionally after how many of them to draw a frame", "10000 100", "ticks [frame every]", false);
+	String::Split split = text.SplitBy(' ');
+	int ticks = split.Before().ToNumber<int>(true);
+	int renderEvery = split ? split.After().ToNumber<int>(true) : 0;
+	FastForward(ticks, renderEvery);
+}
+
+GameController::FastForwardStats GameController::GetFastForwardStats()
+{
+	FastForwardStats stats;
+	stats.done = fastForward.done;
+	stats.total = fastForward.total;
+	long long elapsed = GetNanoTicks() - fastForward.start;
+	stats.ticksPerSecond = elapsed > 0 ? fastForward.done * 1e9f / elapsed : 0.0f;
+	return stats;
+}
+
+int GameController::RunFastForward()
+{
+	TRACE_ZONE("Fast forward");
+	int left = fastForward.total - fastForward.done;
+	int batch = fastForward.renderEvery ? std::min(fastForward.renderEvery, left) : left;
+	long long batchStart = GetNanoTicks();
+	int ran = gameModel->GetSimulation()->FastForward(batch, &workers, [batchStart](int) {
+		return GetNanoTicks() - batchStart < FAST_FORWARD_FRAME_NANOSECONDS;
+	});
+	fastForward.done += ran;
+	// Nothing runs once a replay has started, so the fast forward stops there rather than hanging
+	if (!ran || fastForward.done >= fastForward.total)
+		StopFastForward();
+	return ran;
+}
+
 ByteString GameController::ElementResolve(int type, int ctype)
 {
 	if(gameModel && gameModel->GetSimulation())
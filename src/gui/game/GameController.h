@@ -14,41 +14,12 @@
 #include "gui/options/OptionsController.h"
 #include "RenderPreset.h"
 #include "Menu.h"
+#include "common/WorkerPool.h"
 
 using namespace std;
 
-//Barrier class taken from StackOverflow
-class Barrier 
-{
-public:
-	explicit Barrier(size_t iCount) : 
-		mThreshold(iCount), 
-		mCount(iCount), 
-		mGeneration(0) {
-		}
-
-	void Wait() {
-		unique_lock<mutex> lLock{mMutex};
-		auto lGen = mGeneration;
-		if (!--mCount) {
-			mGeneration++;
-			mCount = mThreshold;
-			mCond.notify_all();
-		} else {
-			mCond.wait(lLock, [this, lGen] { return lGen != mGeneration; });
-		}
-	}
-
-private:
-	mutex mMutex;
-	condition_variable mCond;
-	size_t mThreshold;
-	size_t mCount;
-	size_t mGeneration;
-};
-
-
 class DebugInfo;
+class FrameCapture;
 class Notification;
 class GameModel;
 class GameView;
@@ -61,16 +32,23 @@ private:
 	GameView * gameView;
 	GameModel * gameModel;
 
-	thread thread_pool[THRDS];
-	int region_pool[THRDS];
-	Barrier startbarrier;
-	Barrier endbarrier;
-	atomic<bool> do_work;
+	WorkerPool workers;
 
 	RenderController * renderOptions;
 	OptionsController * options;
 	vector<DebugInfo*> debugInfo;
 	unsigned int debugFlags;
+	FrameCapture * frameCapture;
+
+	// Ticks to run in fast forward and how many have been so far, total is 0 when there is none going on
+	struct FastForwardRun
+	{
+		int total, done, renderEvery;
+		long long start;
+	};
+	FastForwardRun fastForward;
+	// Runs the ticks of fast forward that go between two frames, returns how many that was
+	int RunFastForward();
 public:
 	bool HasDone;
 	class SearchCallback;
@@ -100,6 +78,23 @@ public:
 	void HistoryRestore();
 	void HistorySnapshot();
 	void HistoryForward();
+	// Starts recording a replay or stops and saves the one being recorded
+	void ToggleReplayRecording();
+	// Starts capturing the frames that are drawn, as images or as a raw stream, or stops the capture
+	void ToggleFrameCapture(bool raw);
+	FrameCapture * GetFrameCapture() { return frameCapture; }
+	// Runs ticks ticks of the simulation back to back as fast as they go, drawing a frame only after every
+	// renderEvery of them, or only as often as it takes to keep the window responding if that is 0
+	void FastForward(int ticks, int renderEvery);
+	void StopFastForward();
+	// Asks how many ticks to fast forward by, or stops the fast forward that is going on
+	void ToggleFastForward();
+	struct FastForwardStats
+	{
+		int done, total;
+		float ticksPerSecond;
+	};
+	FastForwardStats GetFastForwardStats();
 
 	void AdjustGridSize(int direction);
 	void InvertAirSim();
@@ -127,7 +122,7 @@ public:
 	bool GetHudEnable();
 	void SetDebugHUD(bool hudState);
 	bool GetDebugHUD();
-	void SetDebugFlags(unsigned int flags) { debugFlags = flags; }
+	void SetDebugFlags(unsigned int flags);
 	void SetActiveMenu(int menuID);
 	std::vector<Menu*> GetMenuList();
 	int GetNumMenus(bool onlyEnabled);
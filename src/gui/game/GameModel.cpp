@@ -12,8 +12,10 @@
 #include "common/tpt-minmax.h"
 #include "graphics/Renderer.h"
 #include "simulation/Air.h"
+#include "simulation/Replay.h"
 #include "simulation/Simulation.h"
 #include "simulation/Snapshot.h"
+#include "simulation/SnapshotDelta.h"
 
 #include "gui/game/DecorationTool.h"
 #include "gui/interface/Engine.h"
@@ -24,8 +26,10 @@ GameModel::GameModel():
 	activeMenu(-1),
 	currentBrush(0),
 	toolStrength(1.0f),
+	historyCurrent(NULL),
 	redoHistory(NULL),
 	historyPosition(0),
+	historyMemory(0),
 	activeColourPreset(0),
 	colourSelector(false),
 	colour(255, 0, 0, 255),
@@ -68,6 +72,7 @@ GameModel::GameModel():
 	colourPresets.push_back(ui::Colour(0, 0, 0));
 
 	undoHistoryLimit = 200;
+	undoHistoryMemoryLimit = 256 << 20;
 }
 
 GameModel::~GameModel()
@@ -88,6 +93,7 @@ GameModel::~GameModel()
 	}
 	delete sim;
 	delete ren;
+	HistoryClear();
 	delete redoHistory;
 	//if(activeTools)
 	//	delete[] activeTools;
@@ -303,24 +309,141 @@ int GameModel::GetEdgeMode()
 	return this->edgeMode;
 }
 
-std::deque<Snapshot*> GameModel::GetHistory()
+const Snapshot * GameModel::HistoryCurrent()
 {
-	return history;
+	return historyCurrent;
 }
 
-unsigned int GameModel::GetHistoryPosition()
+bool GameModel::HistoryCanRestore()
 {
-	return historyPosition;
+	return historyPosition > 0;
 }
 
-void GameModel::SetHistory(const std::deque<Snapshot*> &newHistory)
+void GameModel::HistoryRestore()
 {
-	history = newHistory;
+	historyPosition--;
+	HistoryEntry & entry = history[historyPosition];
+	HistoryCollect(entry, false);
+	Snapshot * restored = entry.snap ? new Snapshot(*entry.snap) : entry.delta->Restore(*historyCurrent);
+	delete historyCurrent;
+	historyCurrent = restored;
 }
 
-void GameModel::SetHistoryPosition(unsigned int newHistoryPosition)
+bool GameModel::HistoryCanForward()
 {
-	historyPosition = newHistoryPosition;
+	return historyPosition < history.size();
+}
+
+void GameModel::HistoryForward()
+{
+	historyPosition++;
+	Snapshot * forward = NULL;
+	if (historyPosition < history.size())
+	{
+		HistoryEntry & entry = history[historyPosition];
+		HistoryCollect(entry, false);
+		if (entry.snap)
+			forward = new Snapshot(*entry.snap);
+		else
+		{
+			// The entry before this one may still have its full snapshot, but the delta is what leads here
+			HistoryCollect(history[historyPosition-1], true);
+			forward = history[historyPosition-1].delta->Forward(*historyCurrent);
+		}
+	}
+	delete historyCurrent;
+	historyCurrent = forward;
+}
+
+void GameModel::HistoryPush()
+{
+	std::shared_ptr<Snapshot> last = historySpare ? historySpare : std::make_shared<Snapshot>();
+	historySpare.reset();
+	sim->CreateSnapshot(*last);
+
+	// The previous entry is stored as a delta against the new one, that needs the previous entry's full state
+	std::shared_ptr<Snapshot> rebaseOnto;
+	if (historyPosition)
+	{
+		HistoryEntry & previous = history[historyPosition-1];
+		HistoryCollect(previous, false);
+		if (previous.snap)
+			rebaseOnto = previous.snap;
+		else
+			rebaseOnto.reset(previous.delta->Restore(*historyCurrent));
+	}
+	// Anything that was undone can't be redone anymore
+	while (historyPosition < history.size())
+	{
+		HistoryEntry & entry = history.back();
+		HistoryCollect(entry, true);
+		if (entry.delta)
+			historyMemory -= entry.delta->Size();
+		delete entry.delta;
+		history.pop_back();
+	}
+	if (rebaseOnto)
+	{
+		HistoryEntry & previous = history.back();
+		HistoryCollect(previous, true);
+		if (previous.delta)
+		{
+			historyMemory -= previous.delta->Size();
+			delete previous.delta;
+			previous.delta = NULL;
+		}
+		previous.snap = rebaseOnto;
+		previous.packing = std::async(std::launch::async, [rebaseOnto, last]() {
+			return SnapshotDelta::FromSnapshots(*rebaseOnto, *last);
+		});
+	}
+	HistoryEntry entry = { last, NULL, std::future<SnapshotDelta *>() };
+	history.push_back(std::move(entry));
+	historyPosition++;
+	delete historyCurrent;
+	historyCurrent = NULL;
+
+	// Oldest entries go first, whether there are too many or they take up too much memory
+	for (size_t i = 0; i < history.size(); i++)
+		HistoryCollect(history[i], false);
+	while (history.size() > 1 && (history.size() > undoHistoryLimit || historyMemory > undoHistoryMemoryLimit))
+	{
+		HistoryEntry & oldest = history.front();
+		HistoryCollect(oldest, true);
+		historyMemory -= oldest.delta->Size();
+		delete oldest.delta;
+		history.pop_front();
+		historyPosition--;
+	}
+}
+
+void GameModel::HistoryCollect(HistoryEntry & entry, bool wait)
+{
+	if (!entry.packing.valid())
+		return;
+	if (!wait && entry.packing.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+	entry.delta = entry.packing.get();
+	historyMemory += entry.delta->Size();
+	// Nothing else needs the full snapshot anymore unless the previous entry is still being packed against it
+	if (entry.snap.use_count() == 1 && !historySpare)
+		historySpare = entry.snap;
+	entry.snap.reset();
+}
+
+void GameModel::HistoryClear()
+{
+	for (size_t i = 0; i < history.size(); i++)
+	{
+		HistoryCollect(history[i], true);
+		delete history[i].delta;
+	}
+	history.clear();
+	historySpare.reset();
+	historyPosition = 0;
+	historyMemory = 0;
+	delete historyCurrent;
+	historyCurrent = NULL;
 }
 
 Snapshot * GameModel::GetRedoHistory()
@@ -343,6 +466,16 @@ void GameModel::SetUndoHistoryLimit(unsigned int undoHistoryLimit_)
 	undoHistoryLimit = undoHistoryLimit_;
 }
 
+size_t GameModel::GetUndoHistoryMemoryLimit()
+{
+	return undoHistoryMemoryLimit;
+}
+
+void GameModel::SetUndoHistoryMemoryLimit(size_t undoHistoryMemoryLimit_)
+{
+	undoHistoryMemoryLimit = undoHistoryMemoryLimit_;
+}
+
 void GameModel::SetVote(int direction)
 {
 }
@@ -734,6 +867,8 @@ void GameModel::ClearSimulation()
 	sim->water_equal_test = false;
 	sim->SetEdgeMode(edgeMode);
 
+	if (sim->recorder)
+		sim->recorder->ClearSim();
 	sim->clear_sim();
 	ren->ClearAccumulation();
 
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <deque>
+#include <future>
+#include <memory>
 #include "simulation/Simulation.h"
 #include "gui/interface/Colour.h"
 #include "graphics/Renderer.h"
@@ -21,6 +23,18 @@ class GameController;
 class Simulation;
 class Renderer;
 
+class Snapshot;
+class SnapshotDelta;
+
+// Only the newest entry keeps a full snapshot, the others keep the delta to the entry after them. The delta
+// is packed on a worker thread, the entry keeps its full snapshot until that's done
+struct HistoryEntry
+{
+	std::shared_ptr<Snapshot> snap;
+	SnapshotDelta * delta;
+	std::future<SnapshotDelta *> packing;
+};
+
 class ToolSelection
 {
 public:
@@ -57,10 +71,16 @@ private:
 	Tool * decoToolset[4];
 	Tool * regularToolset[4];
 	float toolStrength;
-	std::deque<Snapshot*> history;
+	std::deque<HistoryEntry> history;
+	// The state at historyPosition, rebuilt from the deltas while undoing and redoing
+	Snapshot *historyCurrent;
+	// Memory of a snapshot that has been packed, reused for the next capture
+	std::shared_ptr<Snapshot> historySpare;
 	Snapshot *redoHistory;
 	unsigned int historyPosition;
 	unsigned int undoHistoryLimit;
+	size_t undoHistoryMemoryLimit;
+	size_t historyMemory;
 
 	size_t activeColourPreset;
 	std::vector<ui::Colour> colourPresets;
@@ -124,14 +144,21 @@ public:
 	void BuildFavoritesMenu();
 	void BuildQuickOptionMenu(GameController * controller);
 
-	std::deque<Snapshot*> GetHistory();
-	unsigned int GetHistoryPosition();
-	void SetHistory(const std::deque<Snapshot*> &newHistory);
-	void SetHistoryPosition(unsigned int newHistoryPosition);
+	const Snapshot * HistoryCurrent();
+	bool HistoryCanRestore();
+	void HistoryRestore();
+	bool HistoryCanForward();
+	void HistoryForward();
+	// Captures the simulation as the newest entry
+	void HistoryPush();
+	void HistoryCollect(HistoryEntry & entry, bool wait);
+	void HistoryClear();
 	Snapshot * GetRedoHistory();
 	void SetRedoHistory(Snapshot * redo);
 	unsigned int GetUndoHistoryLimit();
 	void SetUndoHistoryLimit(unsigned int undoHistoryLimit_);
+	size_t GetUndoHistoryMemoryLimit();
+	void SetUndoHistoryMemoryLimit(size_t undoHistoryMemoryLimit_);
 
 	void UpdateQuickOptions();
 
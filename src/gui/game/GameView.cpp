@@ -1,3 +1,4 @@
+#include <cstring>
 #include <iomanip>
 #include <algorithm>
 #include "GameView.h"
@@ -7,6 +8,7 @@
 #include "IntroText.h"
 #include "QuickOptions.h"
 #include "DecorationTool.h"
+#include "graphics/FrameCapture.h"
 #include "graphics/Graphics.h"
 #include "gui/Style.h"
 #include "gui/dialogues/ConfirmPrompt.h"
@@ -50,7 +52,7 @@ public:
 	}
 	void SetRightToolTip(String tooltip) { toolTip2 = tooltip; }
 	bool GetShowSplit() { return showSplit; }
-	void SetShowSplit(bool split) { showSplit = split; }
+	void SetShowSplit(bool split) { showSplit = split; MarkDirty(); }
 	SplitButtonAction * GetSplitActionCallback() { return splitActionCallback; }
 	void SetSplitActionCallback(SplitButtonAction * newAction) { splitActionCallback = newAction; }
 	void SetToolTip(int x, int y)
@@ -93,6 +95,7 @@ public:
 	virtual void OnMouseEnter(int x, int y)
 	{
 		isMouseInside = true;
+		MarkDirty();
 		if(!Enabled)
 			return;
 		SetToolTip(x, y);
@@ -140,6 +143,10 @@ public:
 		if(showSplit)
 			g->draw_line(splitPosition+screenPos.X, screenPos.Y+1, splitPosition+screenPos.X, screenPos.Y+Size.Y-2, 180, 180, 180, 255);
 	}
+	virtual bool DrawsInside()
+	{
+		return splitPosition >= 0 && splitPosition < Size.X && ui::Button::DrawsInside();
+	}
 	virtual ~SplitButton()
 	{
 		delete splitActionCallback;
@@ -183,9 +190,6 @@ GameView::GameView():
 
 	doScreenshot(false),
 	screenshotIndex(0),
-	recording(false),
-	recordingFolder(0),
-	recordingIndex(0),
 	currentPoint(ui::Point(0, 0)),
 	lastPoint(ui::Point(0, 0)),
 	ren(NULL),
@@ -201,7 +205,12 @@ GameView::GameView():
 	currentMouse(0, 0),
 	mousePosition(0, 0),
 	placeSaveThumb(NULL),
-	placeSaveOffset(0, 0)
+	placeSaveOffset(0, 0),
+	sampleRevision(0),
+	sampleLabelRevision(0),
+	sampleLabelDebug(false),
+	sampleLabelAHeat(false),
+	wavelengthGfx(0)
 {
 
 	int currentX = 1;
@@ -595,11 +604,31 @@ void GameView::NotifyMenuListChanged(GameModel * sender)
 	}
 }
 
+// Particle is nothing but 4 byte numbers, there is no padding for memcmp to trip over
+static bool SameSample(const SimulationSample & a, const SimulationSample & b)
+{
+	return !memcmp(&a.particle, &b.particle, sizeof(Particle)) && a.ParticleID == b.ParticleID &&
+		a.PositionX == b.PositionX && a.PositionY == b.PositionY && a.AirPressure == b.AirPressure &&
+		a.AirTemperature == b.AirTemperature && a.AirVelocityX == b.AirVelocityX && a.AirVelocityY == b.AirVelocityY &&
+		a.WallType == b.WallType && a.Gravity == b.Gravity && a.GravityVelocityX == b.GravityVelocityX &&
+		a.GravityVelocityY == b.GravityVelocityY && a.NumParts == b.NumParts && a.isMouseInSim == b.isMouseInSim;
+}
+
 void GameView::SetSample(SimulationSample sample)
 {
+	if (!SameSample(this->sample, sample))
+		sampleRevision++;
 	this->sample = sample;
 }
 
+void GameView::HudLabel::SetText(const String & newText)
+{
+	if (width >= 0 && newText == text)
+		return;
+	text = newText;
+	width = Graphics::textwidth(text);
+}
+
 void GameView::SetHudEnable(bool hudState)
 {
 	showHud = hudState;
@@ -1030,6 +1059,7 @@ void GameView::OnMouseDown(int x, int y, unsigned button)
 			UpdateDrawMode();
 
 			isMouseDown = true;
+			c->HistorySnapshot();
 			if (drawMode == DrawRect || drawMode == DrawLine)
 			{
 				drawPoint1 = c->PointTranslate(currentMouse);
@@ -1240,6 +1270,7 @@ void GameView::OnKeyPress(int key, int scan, bool repeat, bool shift, bool ctrl,
 			break;
 		if (ctrl && !isMouseDown)
 		{
+			c->HistoryRestore();
 		}
 		else
 		{
@@ -1328,6 +1359,7 @@ void GameView::OnKeyPress(int key, int scan, bool repeat, bool shift, bool ctrl,
 	case 'y':
 		if (ctrl)
 		{
+			c->HistoryForward();
 		}
 		else
 		{
@@ -1937,112 +1969,144 @@ void GameView::OnDraw()
 
 		ren->RenderEnd();
 
+		if (FrameCapture * capture = c->GetFrameCapture())
+			capture->Capture(ren->vid, WINDOWW);
 	}
 
 	if(showHud)
 	{
 		//Draw info about simulation under cursor
-		int wavelengthGfx = 0, alpha = 255;
+		int alpha = 255;
 		if (toolTipPosition.Y < 120)
 			alpha = 255-toolTipPresence*3;
 		if (alpha < 50)
 			alpha = 50;
-		StringBuilder sampleInfo;
-		sampleInfo << Format::Precision(2);
 
-		int type = sample.particle.type;
-		if (type)
+		bool aheat = c->GetAHeatEnable();
+		if (sampleLabel.width < 0 || sampleLabelRevision != sampleRevision || sampleLabelDebug != showDebug || sampleLabelAHeat != aheat)
 		{
-			int ctype = sample.particle.ctype;
-
-			if (type == PT_PHOT || type == PT_BIZR || type == PT_BIZRG || type == PT_BIZRS || type == PT_FILT || type == PT_BRAY || type == PT_C5)
-				wavelengthGfx = (ctype&0x3FFFFFFF);
+			sampleLabelRevision = sampleRevision;
+			sampleLabelDebug = showDebug;
+			sampleLabelAHeat = aheat;
+			wavelengthGfx = 0;
+			StringBuilder sampleInfo;
+			sampleInfo << Format::Precision(2);
 
-			if (showDebug)
+			int type = sample.particle.type;
+			if (type)
 			{
-				if (type == PT_LAVA && c->IsValidElement(ctype))
-					sampleInfo << "Molten " << c->ElementResolve(ctype, -1).FromAscii();
-				else if ((type == PT_PIPE || type == PT_PPIP) && c->IsValidElement(ctype))
-					sampleInfo << c->ElementResolve(type, -1).FromAscii() << " with " << c->ElementResolve(ctype, (int)sample.particle.pavg[1]).FromAscii();
-				else if (type == PT_LIFE)
-					sampleInfo << c->ElementResolve(type, ctype).FromAscii();
-				else if (type == PT_FILT)
-				{
-					sampleInfo << c->ElementResolve(type, ctype).FromAscii();
-					String filtModes[] = {"set colour", "AND", "OR", "subtract colour", "red shift", "blue shift", "no effect", "XOR", "NOT", "old QRTZ scattering", "variable red shift", "variable blue shift"};
-					if (sample.particle.tmp>=0 && sample.particle.tmp<=11)
-						sampleInfo << " (" << filtModes[sample.particle.tmp] << ")";
-					else
-						sampleInfo << " (unknown mode)";
-				}
-				else
-				{
-					sampleInfo << c->ElementResolve(type, ctype).FromAscii();
-					if (wavelengthGfx)
-						sampleInfo << " (" << ctype << ")";
-					// Some elements store extra LIFE info in upper bits of ctype, instead of tmp/tmp2
-					else if (type == PT_CRAY || type == PT_DRAY || type == PT_CONV)
-						sampleInfo << " (" << c->ElementResolve(TYP(ctype), ID(ctype)).FromAscii() << ")";
-					else if (c->IsValidElement(ctype))
-						sampleInfo << " (" << c->ElementResolve(ctype, -1).FromAscii() << ")";
-					else
-						sampleInfo << " ()";
-				}
-				sampleInfo << ", Temp: " << (sample.particle.temp - 273.15f) << " C";
-				sampleInfo << ", Life: " << sample.particle.life;
-				if (sample.particle.type != PT_RFRG && sample.particle.type != PT_RFGL)
+				int ctype = sample.particle.ctype;
+
+				if (type == PT_PHOT || type == PT_BIZR || type == PT_BIZRG || type == PT_BIZRS || type == PT_FILT || type == PT_BRAY || type == PT_C5)
+					wavelengthGfx = (ctype&0x3FFFFFFF);
+
+				if (showDebug)
 				{
-					if (sample.particle.type == PT_CONV)
+					if (type == PT_LAVA && c->IsValidElement(ctype))
+						sampleInfo << "Molten " << c->ElementResolve(ctype, -1).FromAscii();
+					else if ((type == PT_PIPE || type == PT_PPIP) && c->IsValidElement(ctype))
+						sampleInfo << c->ElementResolve(type, -1).FromAscii() << " with " << c->ElementResolve(ctype, (int)sample.particle.pavg[1]).FromAscii();
+					else if (type == PT_LIFE)
+						sampleInfo << c->ElementResolve(type, ctype).FromAscii();
+					else if (type == PT_FILT)
 					{
-						String elemName = c->ElementResolve(
-							TYP(sample.particle.tmp),
-							ID(sample.particle.tmp)).FromAscii();
-						if (elemName == "")
-							sampleInfo << ", Tmp: " << sample.particle.tmp;
+						sampleInfo << c->ElementResolve(type, ctype).FromAscii();
+						String filtModes[] = {"set colour", "AND", "OR", "subtract colour", "red shift", "blue shift", "no effect", "XOR", "NOT", "old QRTZ scattering", "variable red shift", "variable blue shift"};
+						if (sample.particle.tmp>=0 && sample.particle.tmp<=11)
+							sampleInfo << " (" << filtModes[sample.particle.tmp] << ")";
 						else
-							sampleInfo << ", Tmp: " << elemName;
+							sampleInfo << " (unknown mode)";
 					}
 					else
-						sampleInfo << ", Tmp: " << sample.particle.tmp;
-				}
+					{
+						sampleInfo << c->ElementResolve(type, ctype).FromAscii();
+						if (wavelengthGfx)
+							sampleInfo << " (" << ctype << ")";
+						// Some elements store extra LIFE info in upper bits of ctype, instead of tmp/tmp2
+						else if (type == PT_CRAY || type == PT_DRAY || type == PT_CONV)
+							sampleInfo << " (" << c->ElementResolve(TYP(ctype), ID(ctype)).FromAscii() << ")";
+						else if (c->IsValidElement(ctype))
+							sampleInfo << " (" << c->ElementResolve(ctype, -1).FromAscii() << ")";
+						else
+							sampleInfo << " ()";
+					}
+					sampleInfo << ", Temp: " << (sample.particle.temp - 273.15f) << " C";
+					sampleInfo << ", Life: " << sample.particle.life;
+					if (sample.particle.type != PT_RFRG && sample.particle.type != PT_RFGL)
+					{
+						if (sample.particle.type == PT_CONV)
+						{
+							String elemName = c->ElementResolve(
+								TYP(sample.particle.tmp),
+								ID(sample.particle.tmp)).FromAscii();
+							if (elemName == "")
+								sampleInfo << ", Tmp: " << sample.particle.tmp;
+							else
+								sampleInfo << ", Tmp: " << elemName;
+						}
+						else
+							sampleInfo << ", Tmp: " << sample.particle.tmp;
+					}
 
-				// only elements that use .tmp2 show it in the debug HUD
-				if (type == PT_CRAY || type == PT_DRAY || type == PT_EXOT || type == PT_LIGH || type == PT_SOAP || type == PT_TRON || type == PT_VIBR || type == PT_VIRS || type == PT_WARP || type == PT_LCRY || type == PT_CBNW || type == PT_TSNS || type == PT_DTEC || type == PT_LSNS || type == PT_PSTN || type == PT_LDTC)
-					sampleInfo << ", Tmp2: " << sample.particle.tmp2;
+					// only elements that use .tmp2 show it in the debug HUD
+					if (type == PT_CRAY || type == PT_DRAY || type == PT_EXOT || type == PT_LIGH || type == PT_SOAP || type == PT_TRON || type == PT_VIBR || type == PT_VIRS || type == PT_WARP || type == PT_LCRY || type == PT_CBNW || type == PT_TSNS || type == PT_DTEC || type == PT_LSNS || type == PT_PSTN || type == PT_LDTC)
+						sampleInfo << ", Tmp2: " << sample.particle.tmp2;
 
+					sampleInfo << ", Pressure: " << sample.AirPressure;
+				}
+				else
+				{
+					if (type == PT_LAVA && c->IsValidElement(ctype))
+						sampleInfo << "Molten " << c->ElementResolve(ctype, -1).FromAscii();
+					else if ((type == PT_PIPE || type == PT_PPIP) && c->IsValidElement(ctype))
+						sampleInfo << c->ElementResolve(type, -1).FromAscii() << " with " << c->ElementResolve(ctype, (int)sample.particle.pavg[1]).FromAscii();
+					else if (type == PT_LIFE)
+						sampleInfo << c->ElementResolve(type, ctype).FromAscii();
+					else
+						sampleInfo << c->ElementResolve(type, ctype).FromAscii();
+					sampleInfo << ", Temp: " << sample.particle.temp - 273.15f << " C";
+					sampleInfo << ", Pressure: " << sample.AirPressure;
+				}
+			}
+			else if (sample.WallType)
+			{
+				sampleInfo << c->WallName(sample.WallType);
 				sampleInfo << ", Pressure: " << sample.AirPressure;
 			}
+			else if (sample.isMouseInSim)
+			{
+				sampleInfo << "Empty, Pressure: " << sample.AirPressure;
+			}
 			else
 			{
-				if (type == PT_LAVA && c->IsValidElement(ctype))
-					sampleInfo << "Molten " << c->ElementResolve(ctype, -1).FromAscii();
-				else if ((type == PT_PIPE || type == PT_PPIP) && c->IsValidElement(ctype))
-					sampleInfo << c->ElementResolve(type, -1).FromAscii() << " with " << c->ElementResolve(ctype, (int)sample.particle.pavg[1]).FromAscii();
-				else if (type == PT_LIFE)
-					sampleInfo << c->ElementResolve(type, ctype).FromAscii();
-				else
-					sampleInfo << c->ElementResolve(type, ctype).FromAscii();
-				sampleInfo << ", Temp: " << sample.particle.temp - 273.15f << " C";
-				sampleInfo << ", Pressure: " << sample.AirPressure;
+				sampleInfo << "Empty";
+			}
+
+			sampleLabel.SetText(sampleInfo.Build());
+
+			if (showDebug)
+			{
+				StringBuilder sampleInfo;
+				sampleInfo << Format::Precision(2);
+
+				if (type)
+					sampleInfo << "#" << sample.ParticleID << ", ";
+
+				sampleInfo << "X:" << sample.PositionX << " Y:" << sample.PositionY;
+
+				if (sample.Gravity)
+					sampleInfo << ", GX: " << sample.GravityVelocityX << " GY: " << sample.GravityVelocityY;
+
+				if (aheat)
+					sampleInfo << ", AHeat: " << sample.AirTemperature - 273.15f << " C";
+
+				sampleDebugLabel.SetText(sampleInfo.Build());
 			}
-		}
-		else if (sample.WallType)
-		{
-			sampleInfo << c->WallName(sample.WallType);
-			sampleInfo << ", Pressure: " << sample.AirPressure;
-		}
-		else if (sample.isMouseInSim)
-		{
-			sampleInfo << "Empty, Pressure: " << sample.AirPressure;
-		}
-		else
-		{
-			sampleInfo << "Empty";
 		}
 
-		int textWidth = Graphics::textwidth(sampleInfo.Build());
+		int textWidth = sampleLabel.width;
 		g->fillrect(XRES-20-textWidth, 12, textWidth+8, 15, 0, 0, 0, alpha*0.5f);
-		g->drawtext(XRES-16-textWidth, 16, sampleInfo.Build(), 255, 255, 255, alpha*0.75f);
+		g->drawtext(XRES-16-textWidth, 16, sampleLabel.text, 255, 255, 255, alpha*0.75f);
 
 #ifndef OGLI
 		if (wavelengthGfx)
@@ -2083,23 +2147,9 @@ void GameView::OnDraw()
 
 		if (showDebug)
 		{
-			StringBuilder sampleInfo;
-			sampleInfo << Format::Precision(2);
-
-			if (type)
-				sampleInfo << "#" << sample.ParticleID << ", ";
-
-			sampleInfo << "X:" << sample.PositionX << " Y:" << sample.PositionY;
-
-			if (sample.Gravity)
-				sampleInfo << ", GX: " << sample.GravityVelocityX << " GY: " << sample.GravityVelocityY;
-
-			if (c->GetAHeatEnable())
-				sampleInfo << ", AHeat: " << sample.AirTemperature - 273.15f << " C";
-
-			textWidth = Graphics::textwidth(sampleInfo.Build());
+			textWidth = sampleDebugLabel.width;
 			g->fillrect(XRES-20-textWidth, 27, textWidth+8, 14, 0, 0, 0, alpha*0.5f);
-			g->drawtext(XRES-16-textWidth, 30, sampleInfo.Build(), 255, 255, 255, alpha*0.75f);
+			g->drawtext(XRES-16-textWidth, 30, sampleDebugLabel.text, 255, 255, 255, alpha*0.75f);
 		}
 	}
 
@@ -2108,6 +2158,8 @@ void GameView::OnDraw()
 		//FPS and some version info
 		StringBuilder fpsInfo;
 		fpsInfo << Format::Precision(2) << "FPS: " << ui::Engine::Ref().GetFps();
+		if (ui::Engine::Ref().SimTickRate > 0)
+			fpsInfo << " TPS: " << ui::Engine::Ref().GetTps();
 
 		if (showDebug)
 		{
@@ -2124,11 +2176,23 @@ void GameView::OnDraw()
 			fpsInfo << " [GRID: " << ren->GetGridSize() << "]";
 		if (ren && ren->findingElement)
 			fpsInfo << " [FIND]";
+		GameController::FastForwardStats fastForward = c->GetFastForwardStats();
+		if (fastForward.total)
+			fpsInfo << " [FAST FORWARD " << fastForward.done << "/" << fastForward.total << ", " << fastForward.ticksPerSecond << " TPS]";
+		if (FrameCapture * capture = c->GetFrameCapture())
+		{
+			FrameCapture::Stats stats = capture->GetStats();
+			fpsInfo << " [REC " << stats.captured;
+			if (stats.dropped || stats.throttled)
+				fpsInfo << ", behind " << stats.throttled + stats.dropped;
+			fpsInfo << "]";
+		}
 
-		int textWidth = Graphics::textwidth(fpsInfo.Build());
+		fpsLabel.SetText(fpsInfo.Build());
+		int textWidth = fpsLabel.width;
 		int alpha = 255-introText*5;
 		g->fillrect(12, 12, textWidth+8, 15, 0, 0, 0, alpha*0.5);
-		g->drawtext(16, 16, fpsInfo.Build(), 32, 216, 255, alpha*0.75);
+		g->drawtext(16, 16, fpsLabel.text, 32, 216, 255, alpha*0.75);
 	}
 
 	//Tooltips
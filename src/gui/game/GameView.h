@@ -67,9 +67,6 @@ private:
 
 	bool doScreenshot;
 	int screenshotIndex;
-	bool recording;
-	int recordingFolder;
-	int recordingIndex;
 
 	ui::Point currentPoint, lastPoint;
 	GameController * c;
@@ -114,6 +111,24 @@ private:
 	ui::Point placeSaveOffset;
 
 	SimulationSample sample;
+	// SetSample is called every frame, this only counts the times the sample was different from the last one
+	unsigned int sampleRevision;
+
+	// A line of the HUD, which is drawn every frame but mostly says what it did the frame before, so it is only
+	// measured again once its text has changed
+	struct HudLabel
+	{
+		String text;
+		int width;
+
+		HudLabel(): width(-1) {}
+		void SetText(const String & newText);
+	};
+	HudLabel sampleLabel, sampleDebugLabel, fpsLabel;
+	// What the sample labels were last put together from, they are kept as they are until any of it changes
+	unsigned int sampleLabelRevision;
+	bool sampleLabelDebug, sampleLabelAHeat;
+	int wavelengthGfx;
 
 	void updateToolButtonScroll();
 
@@ -9,6 +9,7 @@
 #include "gui/interface/DropDown.h"
 #include "gui/interface/Keys.h"
 #include "gui/dialogues/ErrorMessage.h"
+#include "simulation/Replay.h"
 #include "simulation/Simulation.h"
 
 class PropertyWindow: public ui::Window
@@ -236,6 +237,8 @@ void PropertyTool::SetProperty(Simulation *sim, ui::Point position)
 		i = sim->photons[position.Y][position.X];
 	if(!i)
 		return;
+	if (sim->recorder)
+		sim->recorder->SetProperty(ID(i), propOffset, propValue, propType);
 	switch (propType)
 	{
 		case StructProperty::Float:
@@ -251,6 +254,7 @@ void PropertyTool::SetProperty(Simulation *sim, ui::Point position)
 		default:
 			break;
 	}
+	sim->Changed();
 }
 
 void PropertyTool::Draw(Simulation *sim, Brush *cBrush, ui::Point position)
@@ -343,5 +347,8 @@ void PropertyTool::DrawRect(Simulation *sim, Brush *cBrush, ui::Point position,
 
 void PropertyTool::DrawFill(Simulation *sim, Brush *cBrush, ui::Point position)
 {
+	if (sim->recorder)
+		sim->recorder->FloodProperty(position.X, position.Y, propOffset, propValue, propType);
 	sim->flood_prop(position.X, position.Y, propOffset, propValue, propType);
+	sim->Changed();
 }
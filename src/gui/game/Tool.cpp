@@ -2,6 +2,7 @@
 #include "Tool.h"
 #include "gui/game/Brush.h"
 
+#include "simulation/Replay.h"
 #include "simulation/Simulation.h"
 
 using namespace std;
@@ -39,12 +40,18 @@ Tool::~Tool() {}
 
 void Tool::Click(Simulation * sim, Brush * brush, ui::Point position) { }
 void Tool::Draw(Simulation * sim, Brush * brush, ui::Point position) {
+	if (sim->recorder)
+		sim->recorder->ToolBrush(position.X, position.Y, toolID, brush, strength);
 	sim->ToolBrush(position.X, position.Y, toolID, brush, strength);
 }
 void Tool::DrawLine(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2, bool dragging) {
+	if (sim->recorder)
+		sim->recorder->ToolLine(position1.X, position1.Y, position2.X, position2.Y, toolID, brush, strength);
 	sim->ToolLine(position1.X, position1.Y, position2.X, position2.Y, toolID, brush, strength);
 }
 void Tool::DrawRect(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2) {
+	if (sim->recorder)
+		sim->recorder->ToolBox(position1.X, position1.Y, position2.X, position2.Y, toolID, strength);
 	sim->ToolBox(position1.X, position1.Y, position2.X, position2.Y, toolID, strength);
 }
 void Tool::DrawFill(Simulation * sim, Brush * brush, ui::Point position) {}
@@ -56,15 +63,23 @@ ElementTool::ElementTool(int id, ByteString name, String description, int r, int
 }
 ElementTool::~ElementTool() {}
 void ElementTool::Draw(Simulation * sim, Brush * brush, ui::Point position){
+	if (sim->recorder)
+		sim->recorder->CreateParts(position.X, position.Y, toolID, brush, -1);
 	sim->CreateParts(position.X, position.Y, toolID, brush);
 }
 void ElementTool::DrawLine(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2, bool dragging) {
+	if (sim->recorder)
+		sim->recorder->CreateLine(position1.X, position1.Y, position2.X, position2.Y, toolID, brush, -1);
 	sim->CreateLine(position1.X, position1.Y, position2.X, position2.Y, toolID, brush);
 }
 void ElementTool::DrawRect(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2) {
+	if (sim->recorder)
+		sim->recorder->CreateBox(position1.X, position1.Y, position2.X, position2.Y, toolID, -1);
 	sim->CreateBox(position1.X, position1.Y, position2.X, position2.Y, toolID);
 }
 void ElementTool::DrawFill(Simulation * sim, Brush * brush, ui::Point position) {
+	if (sim->recorder)
+		sim->recorder->FloodParts(position.X, position.Y, toolID, -1, -1);
 	sim->FloodParts(position.X, position.Y, toolID, -1);
 }
 
@@ -76,6 +91,8 @@ Tool(id, name, description, r, g, b, identifier, textureGen)
 }
 WallTool::~WallTool() {}
 void WallTool::Draw(Simulation * sim, Brush * brush, ui::Point position) {
+	if (sim->recorder)
+		sim->recorder->CreateWalls(position.X, position.Y, 1, 1, toolID, brush);
 	sim->CreateWalls(position.X, position.Y, 1, 1, toolID, brush);
 }
 void WallTool::DrawLine(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2, bool dragging) {
@@ -87,27 +104,29 @@ void WallTool::DrawLine(Simulation * sim, Brush * brush, ui::Point position1, ui
 		newFanVelX *= strength;
 		float newFanVelY = (position2.Y-position1.Y)*0.005f;
 		newFanVelY *= strength;
-		sim->FloodWalls(position1.X, position1.Y, WL_FLOODHELPER, WL_FAN);
-		for (int j = 0; j < YRES/CELL; j++)
-			for (int i = 0; i < XRES/CELL; i++)
-				if (sim->bmap[j][i] == WL_FLOODHELPER)
-				{
-					sim->fvx[j][i] = newFanVelX;
-					sim->fvy[j][i] = newFanVelY;
-					sim->bmap[j][i] = WL_FAN;
-				}
+		if (sim->recorder)
+			sim->recorder->SetFanVelocity(position1.X, position1.Y, newFanVelX, newFanVelY);
+		sim->SetFanVelocity(position1.X, position1.Y, newFanVelX, newFanVelY);
 	}
 	else
 	{
+		if (sim->recorder)
+			sim->recorder->CreateWallLine(position1.X, position1.Y, position2.X, position2.Y, 1, 1, toolID, brush);
 		sim->CreateWallLine(position1.X, position1.Y, position2.X, position2.Y, 1, 1, toolID, brush);
 	}
 }
 void WallTool::DrawRect(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2) {
+	if (sim->recorder)
+		sim->recorder->CreateWallBox(position1.X, position1.Y, position2.X, position2.Y, toolID);
 	sim->CreateWallBox(position1.X, position1.Y, position2.X, position2.Y, toolID);
 }
 void WallTool::DrawFill(Simulation * sim, Brush * brush, ui::Point position) {
 	if (toolID != WL_STREAM)
+	{
+		if (sim->recorder)
+			sim->recorder->FloodWalls(position.X, position.Y, toolID, -1);
 		sim->FloodWalls(position.X, position.Y, toolID, -1);
+	}
 }
 
 WindTool::WindTool(int id, ByteString name, String description, int r, int g, int b, ByteString identifier, VideoBuffer * (*textureGen)(int, int, int)):
@@ -117,51 +136,46 @@ WindTool::WindTool(int id, ByteString name, String description, int r, int g, in
 
 void WindTool::DrawLine(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2, bool dragging)
 {
-	int radiusX, radiusY, sizeX, sizeY;
-
 	float strength = dragging?0.01f:0.002f;
 	strength *= this->strength;
 
-	radiusX = brush->GetRadius().X;
-	radiusY = brush->GetRadius().Y;
-
-	sizeX = brush->GetSize().X;
-	sizeY = brush->GetSize().Y;
-
-	unsigned char *bitmap = brush->GetBitmap();
-
-	for(int y = 0; y < sizeY; y++)
-	{
-		for(int x = 0; x < sizeX; x++)
-		{
-			if(bitmap[(y*sizeX)+x] && (position1.X+(x-radiusX) >= 0 && position1.Y+(y-radiusY) >= 0 && position1.X+(x-radiusX) < XRES && position1.Y+(y-radiusY) < YRES))
-			{
-				sim->vx[(position1.Y+(y-radiusY))/CELL][(position1.X+(x-radiusX))/CELL] += (position2.X-position1.X)*strength;
-				sim->vy[(position1.Y+(y-radiusY))/CELL][(position1.X+(x-radiusX))/CELL] += (position2.Y-position1.Y)*strength;
-			}
-		}
-	}
+	float windX = (position2.X-position1.X)*strength;
+	float windY = (position2.Y-position1.Y)*strength;
+	if (sim->recorder)
+		sim->recorder->ApplyWind(position1.X, position1.Y, windX, windY, brush);
+	sim->ApplyWind(position1.X, position1.Y, windX, windY, brush);
 }
 
 
 void Element_LIGH_Tool::DrawLine(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2, bool dragging)
 {
 	if (dragging)
+	{
+		if (sim->recorder)
+			sim->recorder->CreateParts(position1.X, position1.Y, brush->GetRadius().X, brush->GetRadius().Y, PT_LIGH, -1);
 		sim->CreateParts(position1.X, position1.Y, brush->GetRadius().X, brush->GetRadius().Y, PT_LIGH);
+	}
 }
 
 
 void Element_TESC_Tool::DrawRect(Simulation * sim, Brush * brush, ui::Point position1, ui::Point position2) {
 	int radiusInfo = brush->GetRadius().X*4+brush->GetRadius().Y*4+7;
+	if (sim->recorder)
+		sim->recorder->CreateBox(position1.X, position1.Y, position2.X, position2.Y, toolID | PMAPID(radiusInfo), -1);
 	sim->CreateBox(position1.X, position1.Y, position2.X, position2.Y, toolID | PMAPID(radiusInfo));
 }
 void Element_TESC_Tool::DrawFill(Simulation * sim, Brush * brush, ui::Point position) {
 	int radiusInfo = brush->GetRadius().X*4+brush->GetRadius().Y*4+7;
+	if (sim->recorder)
+		sim->recorder->FloodParts(position.X, position.Y, toolID | PMAPID(radiusInfo), -1, -1);
 	sim->FloodParts(position.X, position.Y, toolID | PMAPID(radiusInfo), -1);
 }
 
 
 void PlopTool::Click(Simulation * sim, Brush * brush, ui::Point position)
 {
+	if (sim->recorder)
+		sim->recorder->CreatePart(-2, position.X, position.Y, TYP(toolID), ID(toolID));
 	sim->create_part(-2, position.X, position.Y, TYP(toolID), ID(toolID));
+	sim->Changed();
 }
@@ -74,9 +74,18 @@ void ToolButton::Draw(const ui::Point& screenPos)
 	}
 }
 
+bool ToolButton::DrawsInside()
+{
+	VideoBuffer * texture = Appearance.GetTexture();
+	if (texture && (texture->Width > Size.X-4 || texture->Height > Size.Y-4))
+		return false;
+	return TextInside();
+}
+
 void ToolButton::SetSelectionState(int state)
 {
 	currentSelection = state;
+	MarkDirty();
 	switch(state)
 	{
 	case 0:
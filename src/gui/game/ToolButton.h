@@ -13,6 +13,7 @@ public:
 	virtual void OnMouseUp(int x, int y, unsigned int button);
 	virtual void OnMouseClick(int x, int y, unsigned int button);
 	virtual void Draw(const ui::Point& screenPos);
+	virtual bool DrawsInside();
 	void SetSelectionState(int state);
 	int GetSelectionState();
 	virtual ~ToolButton();
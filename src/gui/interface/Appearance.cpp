@@ -1,4 +1,5 @@
 #include <iostream>
+#include <stdint.h>
 #include "Appearance.h"
 #include "graphics/Graphics.h"
 
@@ -6,6 +7,7 @@ namespace ui
 {
 	Appearance::Appearance():
 		texture(NULL),
+		textureRevision(0),
 
 		VerticalAlign(AlignMiddle),
 		HorizontalAlign(AlignCentre),
@@ -39,12 +41,58 @@ namespace ui
 	void Appearance::SetTexture(VideoBuffer * texture)
 	{
 		delete this->texture;
+		textureRevision++;
 		if(texture)
 			this->texture = new VideoBuffer(texture);
 		else
 			this->texture = NULL;
 	}
 
+	// FNV-1a, one field at a time
+	static void Mix(unsigned long long & hash, unsigned long long value)
+	{
+		hash = (hash ^ value) * 1099511628211ULL;
+	}
+
+	static void Mix(unsigned long long & hash, const ui::Colour & colour)
+	{
+		Mix(hash, (colour.Red << 24) | (colour.Green << 16) | (colour.Blue << 8) | colour.Alpha);
+	}
+
+	static void Mix(unsigned long long & hash, const ui::Border & border)
+	{
+		Mix(hash, (unsigned long long)border.Top);
+		Mix(hash, (unsigned long long)border.Right);
+		Mix(hash, (unsigned long long)border.Bottom);
+		Mix(hash, (unsigned long long)border.Left);
+	}
+
+	unsigned long long Appearance::Fingerprint() const
+	{
+		unsigned long long hash = 14695981039346656037ULL;
+		Mix(hash, VerticalAlign);
+		Mix(hash, HorizontalAlign);
+		Mix(hash, BackgroundHover);
+		Mix(hash, BackgroundInactive);
+		Mix(hash, BackgroundActive);
+		Mix(hash, BackgroundDisabled);
+		Mix(hash, TextHover);
+		Mix(hash, TextInactive);
+		Mix(hash, TextActive);
+		Mix(hash, TextDisabled);
+		Mix(hash, BorderHover);
+		Mix(hash, BorderInactive);
+		Mix(hash, BorderActive);
+		Mix(hash, BorderFavorite);
+		Mix(hash, BorderDisabled);
+		Mix(hash, Margin);
+		Mix(hash, Border);
+		Mix(hash, icon);
+		Mix(hash, (unsigned long long)(uintptr_t)texture);
+		Mix(hash, textureRevision);
+		return hash;
+	}
+
 	Appearance::~Appearance()
 	{
 		delete texture;
@@ -12,6 +12,8 @@ namespace ui
 	{
 	private:
 			VideoBuffer * texture;
+			// Counts the calls to SetTexture, as a new texture can end up at the address of the old one
+			unsigned int textureRevision;
 	public:
 		enum HorizontalAlignment
 		{
@@ -51,6 +53,9 @@ namespace ui
 		VideoBuffer * GetTexture();
 		void SetTexture(VideoBuffer * texture);
 
+		// Changes whenever any of the above does, for telling whether something drawn with it still looks the same
+		unsigned long long Fingerprint() const;
+
 		Appearance();
 		~Appearance();
 	};
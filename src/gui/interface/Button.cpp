@@ -51,6 +51,7 @@ void Button::SetTogglable(bool togglable)
 {
 	toggle = false;
 	isTogglable = togglable;
+	MarkDirty();
 }
 
 bool Button::GetTogglable()
@@ -66,6 +67,7 @@ bool Button::GetToggleState()
 void Button::SetToggleState(bool state)
 {
 	toggle = state;
+	MarkDirty();
 }
 
 void Button::Draw(const Point& screenPos)
@@ -139,6 +141,12 @@ void Button::Draw(const Point& screenPos)
 	}
 }
 
+bool Button::DrawsInside()
+{
+	// Icons are left out, they are drawn from characters that stick out of their cell
+	return drawn && !Appearance.icon && TextInside();
+}
+
 void Button::OnMouseUnclick(int x, int y, unsigned int button)
 {
 	if(button == 1)
@@ -150,6 +158,7 @@ void Button::OnMouseUnclick(int x, int y, unsigned int button)
 				toggle = !toggle;
 			}
 			isButtonDown = false;
+			MarkDirty();
 			DoAction();
 		}
 	}
@@ -166,6 +175,8 @@ void Button::OnMouseUnclick(int x, int y, unsigned int button)
 void Button::OnMouseUp(int x, int y, unsigned int button)
 {
 	// mouse was unclicked, reset variables in case the unclick happened outside
+	if(isButtonDown)
+		MarkDirty();
 	isButtonDown = false;
 	isAltButtonDown = false;
 }
@@ -177,6 +188,7 @@ void Button::OnMouseClick(int x, int y, unsigned int button)
 	if(button == 1)
 	{
 		isButtonDown = true;
+		MarkDirty();
 	}
 	else if(button == 3)
 	{
@@ -187,6 +199,7 @@ void Button::OnMouseClick(int x, int y, unsigned int button)
 void Button::OnMouseEnter(int x, int y)
 {
 	isMouseInside = true;
+	MarkDirty();
 	if(!Enabled)
 		return;
 	if(actionCallback)
@@ -205,6 +218,7 @@ void Button::OnMouseLeave(int x, int y)
 {
 	isMouseInside = false;
 	isButtonDown = false;
+	MarkDirty();
 }
 
 void Button::DoAction()
@@ -33,6 +33,7 @@ public:
 	virtual void OnMouseLeave(int x, int y);
 
 	virtual void Draw(const Point& screenPos);
+	virtual bool DrawsInside();
 
 	virtual void TextPosition(String);
 	inline bool GetState() { return state; }
@@ -18,6 +18,7 @@ Checkbox::Checkbox(ui::Point position, ui::Point size, String text, String toolT
 void Checkbox::SetText(String text)
 {
 	this->text = text;
+	MarkDirty();
 }
 
 String Checkbox::GetText()
@@ -30,6 +31,7 @@ void Checkbox::SetIcon(Icon icon)
 	Appearance.icon = icon;
 	iconPosition.X = 16;
 	iconPosition.Y = 3;
+	MarkDirty();
 }
 
 void Checkbox::OnMouseClick(int x, int y, unsigned int button)
@@ -42,6 +44,7 @@ void Checkbox::OnMouseClick(int x, int y, unsigned int button)
 	{
 		checked = true;
 	}
+	MarkDirty();
 	if(actionCallback)
 		actionCallback->ActionCallback(this);
 }
@@ -55,6 +58,7 @@ void Checkbox::OnMouseUp(int x, int y, unsigned int button)
 void Checkbox::OnMouseEnter(int x, int y)
 {
 	isMouseOver = true;
+	MarkDirty();
 }
 
 void Checkbox::OnMouseHover(int x, int y)
@@ -68,6 +72,7 @@ void Checkbox::OnMouseHover(int x, int y)
 void Checkbox::OnMouseLeave(int x, int y)
 {
 	isMouseOver = false;
+	MarkDirty();
 }
 
 void Checkbox::Draw(const Point& screenPos)
@@ -96,6 +101,12 @@ void Checkbox::Draw(const Point& screenPos)
 	}
 }
 
+bool Checkbox::DrawsInside()
+{
+	// The box takes up 16 pixels square, the text is put to the right of it. Icons stick out of their cell.
+	return !Appearance.icon && Size.Y >= 16 && 18 + Graphics::textwidth(text) <= Size.X;
+}
+
 void Checkbox::SetActionCallback(CheckboxAction * action)
 {
 	delete actionCallback;
@@ -24,6 +24,7 @@ public:
 	String GetText();
 	void SetIcon(Icon icon);
 	void Draw(const Point& screenPos);
+	bool DrawsInside();
 	virtual void OnMouseEnter(int x, int y);
 	virtual void OnMouseHover(int x, int y);
 	virtual void OnMouseLeave(int x, int y);
@@ -32,7 +33,7 @@ public:
 	void SetActionCallback(CheckboxAction * action);
 	CheckboxAction * GetActionCallback() { return actionCallback; }
 	bool GetChecked() { return checked; }
-	void SetChecked(bool checked_) { checked = checked_; }
+	void SetChecked(bool checked_) { checked = checked_; MarkDirty(); }
 	virtual ~Checkbox();
 };
 }
@@ -13,6 +13,7 @@ Component::Component(Window* parent_state):
 	parentstate_(parent_state),
 	_parent(NULL),
 	drawn(false),
+	dirty(true),
 	textPosition(0, 0),
 	textSize(0, 0),
 	iconPosition(0, 0),
@@ -29,6 +30,7 @@ Component::Component(Point position, Point size):
 	parentstate_(0),
 	_parent(NULL),
 	drawn(false),
+	dirty(true),
 	textPosition(0, 0),
 	textSize(0, 0),
 	iconPosition(0, 0),
@@ -45,6 +47,7 @@ Component::Component():
 	parentstate_(NULL),
 	_parent(NULL),
 	drawn(false),
+	dirty(true),
 	textPosition(0, 0),
 	textSize(0, 0),
 	iconPosition(0, 0),
@@ -60,6 +63,31 @@ Component::Component():
 void Component::Refresh()
 {
 	drawn = false;
+	MarkDirty();
+}
+
+void Component::MarkDirty()
+{
+	dirty = true;
+	if (_parent)
+		_parent->MarkDirty();
+}
+
+unsigned long long Component::MixFingerprint(unsigned long long hash, unsigned long long value)
+{
+	return (hash ^ value) * 1099511628211ULL;
+}
+
+unsigned long long Component::Fingerprint()
+{
+	return MixFingerprint(Appearance.Fingerprint(), Enabled ? 1 : 0);
+}
+
+bool Component::TextInside() const
+{
+	// Characters are drawn from 2 pixels above where they are put
+	return textPosition.X >= 0 && textPosition.Y >= 2 &&
+	       textPosition.X + textSize.X <= Size.X && textPosition.Y + textSize.Y <= Size.Y;
 }
 
 void Component::TextPosition(String displayText)
@@ -110,6 +138,7 @@ void Component::TextPosition(String displayText)
 		iconPosition = textPosition-ui::Point(0, 1);
 		textPosition.X += 15;
 	}
+	MarkDirty();
 }
 
 bool Component::IsFocused() const
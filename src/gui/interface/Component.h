@@ -22,13 +22,30 @@ namespace ui
 	private:
 		Window* parentstate_;
 		Panel* _parent;
+
+		// Where and how the component was last drawn into the Window's layer, see Window::UpdateLayer. The area
+		// includes Overdraw.
+		struct Retained
+		{
+			bool valid, onTop;
+			Point position, size;
+			unsigned long long look;
+			Retained(): valid(false), onTop(false), position(0, 0), size(0, 0), look(0) {}
+		} retained;
+		friend class Window;
 	protected:
 		bool drawn;
+		// Set by anything that changes how the component looks, cleared once the Window has drawn it again
+		bool dirty;
 		ui::Point textPosition;
 		ui::Point textSize;
 		ui::Point iconPosition;
 		ui::ContextMenu * menu;
 		Graphics * GetGraphics();
+		// Whether the text drawn at textPosition stays inside of the component
+		bool TextInside() const;
+		// One step of the hash that Fingerprint is made of
+		static unsigned long long MixFingerprint(unsigned long long hash, unsigned long long value);
 	public:
 		Component(Window* parent_state);
 		Component(Point position, Point size);
@@ -39,7 +56,9 @@ namespace ui
 		inline Window* const GetParentWindow() const { return parentstate_; }
 		bool IsFocused() const;
 
-		void Invalidate() { drawn = false; }
+		void Invalidate() { drawn = false; MarkDirty(); }
+		// Says that the component looks different now, and so does the Panel it is in
+		void MarkDirty();
 
 		Point Position;
 		Point Size;
@@ -80,6 +99,14 @@ namespace ui
 		///
 		virtual void Draw(const Point& screenPos);
 
+		// True for components whose Draw only ever touches the pixels inside of Position and Size, give or take
+		// Overdraw, and that call MarkDirty whenever anything that Draw uses changes, other than what Fingerprint
+		// covers. Only these are kept in the Window's layer.
+		virtual bool DrawsInside() { return false; }
+		// How many pixels past its edges Draw goes
+		virtual int Overdraw() { return 0; }
+		// What the Window checks for changes itself every frame: the Appearance and whether it is enabled
+		virtual unsigned long long Fingerprint();
 
 
 
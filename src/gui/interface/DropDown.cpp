@@ -120,14 +120,22 @@ void DropDown::Draw(const Point& screenPos)
 		g->drawtext(Position.X+textPosition.X, Position.Y+textPosition.Y, options[optionIndex].first, textColour.Red, textColour.Green, textColour.Blue, textColour.Alpha);
 }
 
+bool DropDown::DrawsInside()
+{
+	// The background is filled a pixel past the edges, see Overdraw
+	return drawn && (optionIndex == -1 || TextInside());
+}
+
 void DropDown::OnMouseEnter(int x, int y)
 {
 	isMouseInside = true;
+	MarkDirty();
 }
 
 void DropDown::OnMouseLeave(int x, int y)
 {
 	isMouseInside = false;
+	MarkDirty();
 }
 	std::pair<String, int> DropDown::GetOption()
 	{
@@ -179,7 +187,10 @@ void DropDown::OnMouseLeave(int x, int y)
 			if (options[i].first == option)
 			{
 				if ((int)i == optionIndex)
+				{
 					optionIndex = -1;
+					MarkDirty();
+				}
 				options.erase(options.begin()+i);
 				goto start;
 			}
@@ -188,6 +199,7 @@ void DropDown::OnMouseLeave(int x, int y)
 	void DropDown::SetOptions(const std::vector<std::pair<String, int> > &options)
 	{
 		this->options = options;
+		MarkDirty();
 	}
 
 
@@ -31,6 +31,8 @@ public:
 	void SetOptions(const std::vector<std::pair<String, int> > &options);
 	void SetActionCallback(DropDownAction * action) { callback = action;}
 	virtual void Draw(const Point& screenPos);
+	virtual bool DrawsInside();
+	virtual int Overdraw() { return 1; }
 	virtual void OnMouseClick(int x, int y, unsigned int button);
 	virtual void OnMouseEnter(int x, int y);
 	virtual void OnMouseLeave(int x, int y);
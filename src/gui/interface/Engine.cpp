@@ -15,11 +15,16 @@ using namespace std;
 
 Engine::Engine():
 	FpsLimit(1.0f), //Originally 60.0f
+	SimTickRate(0.0f),
+	Unthrottled(false),
 	Scale(1),
 	Fullscreen(false),
 	FrameIndex(0),
 	altFullscreen(false),
 	resizable(false),
+	tps(0.0f),
+	simTicks(1),
+	simTicksRun(0),
 	lastBuffer(NULL),
 	prevBuffers(stack<pixel*>()),
 	windows(stack<Window*>()),
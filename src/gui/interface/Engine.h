@@ -44,6 +44,12 @@ namespace ui
 		void Draw();
 
 		void SetFps(float fps);
+		void SetTps(float tps) { this->tps = tps; }
+		// How many ticks the simulation is to advance in the frame that is about to be ticked
+		void SetSimTicks(int ticks) { simTicks = ticks; }
+		// How many it actually advanced, which is none while it is paused or not on screen, and can be more while
+		// it is being fast forwarded
+		void SetSimTicksRun(int ticks) { simTicksRun = ticks; }
 
 		void SetMaxSize(int width, int height);
 
@@ -52,6 +58,11 @@ namespace ui
 		//void SetState(Window* state);
 		//inline State* GetState() { return state_; }
 		float FpsLimit;
+		// Ticks of the simulation per second, independent of how often frames are drawn. 0 advances it once
+		// every frame instead.
+		float SimTickRate;
+		// Frames follow each other as fast as they can while this is set, whatever FpsLimit is
+		bool Unthrottled;
 		Graphics * g;
 		int Scale;
 		bool Fullscreen;
@@ -75,6 +86,9 @@ namespace ui
 		inline bool GetFastQuit() {return FastQuit; }
 
 		inline float GetFps() { return fps; }
+		inline float GetTps() { return tps; }
+		inline int GetSimTicks() { return simTicks; }
+		inline int GetSimTicksRun() { return simTicksRun; }
 
 		inline int GetMouseButton() { return mouseb_; }
 		inline int GetMouseX() { return mousex_; }
@@ -91,6 +105,9 @@ namespace ui
 
 		float dt;
 		float fps;
+		float tps;
+		int simTicks;
+		int simTicksRun;
 		pixel * lastBuffer;
 		std::stack<pixel*> prevBuffers;
 		std::stack<Window*> windows;
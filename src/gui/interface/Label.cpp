@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "Config.h"
 #include "Format.h"
 #include "Point.h"
@@ -18,6 +19,10 @@ Label::Label(Point position, Point size, String labelText):
 	selectionIndex1(-1),
 	selectionXL(-1),
 	selectionXH(-1),
+	selectionYL(-1),
+	selectionYH(-1),
+	selectionLineL(-1),
+	selectionLineH(-1),
 	multiline(false),
 	selecting(false),
 	autoHeight(size.Y==-1?true:false)
@@ -297,6 +302,17 @@ void Label::selectAll()
 }
 
 void Label::updateSelection()
+{
+	// Tick clears the selection of every label that isn't focused every time, only an actual change is worth
+	// drawing again
+	int previous[] = { selectionXL, selectionXH, selectionYL, selectionYH, selectionLineL, selectionLineH };
+	placeSelection();
+	int current[] = { selectionXL, selectionXH, selectionYL, selectionYH, selectionLineL, selectionLineH };
+	if (!std::equal(previous, previous + 6, current))
+		MarkDirty();
+}
+
+void Label::placeSelection()
 {
 	String currentText;
 
@@ -367,6 +383,13 @@ void Label::SetDisplayText(String newText)
 {
 	ClearSelection();
 	displayText = tDisplayText = newText;
+	MarkDirty();
+}
+
+bool Label::DrawsInside()
+{
+	// Display text can be any width
+	return drawn && TextInside() && !displayText.length();
 }
 
 void Label::Draw(const Point& screenPos)
@@ -34,6 +34,7 @@ namespace ui
 
 		void updateMultiline();
 		void updateSelection();
+		void placeSelection();
 
 		int getLowerSelectionBound();
 		int getHigherSelectionBound();
@@ -56,7 +57,7 @@ namespace ui
 		virtual void selectAll();
 		virtual void AutoHeight();
 
-		void SetTextColour(Colour textColour) { this->textColour = textColour; }
+		void SetTextColour(Colour textColour) { this->textColour = textColour; MarkDirty(); }
 
 		virtual void OnContextMenuAction(int item);
 		virtual void OnMouseClick(int x, int y, unsigned button);
@@ -64,6 +65,7 @@ namespace ui
 		virtual void OnMouseMoved(int localx, int localy, int dx, int dy);
 		virtual void OnKeyPress(int key, int scan, bool repeat, bool shift, bool ctrl, bool alt);
 		virtual void Draw(const Point& screenPos);
+		virtual bool DrawsInside();
 		virtual void Tick(float dt);
 	};
 }
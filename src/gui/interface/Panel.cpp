@@ -59,6 +59,7 @@ void Panel::AddChild(Component* c)
 {
 	c->SetParent(this);
 	c->SetParentWindow(this->GetParentWindow());
+	MarkDirty();
 }
 
 int Panel::GetChildCount()
@@ -81,6 +82,7 @@ void Panel::RemoveChild(Component* c)
 			children.erase(children.begin() + i);
 			if (this->GetParentWindow()->IsFocused(c))
 				this->GetParentWindow()->FocusComponent(NULL);
+			MarkDirty();
 			break;
 		}
 	}
@@ -92,6 +94,30 @@ void Panel::RemoveChild(unsigned idx, bool freeMem)
 		delete children[idx];
 
 	children.erase(children.begin() + idx);
+	MarkDirty();
+}
+
+bool Panel::DrawsInside()
+{
+	for (size_t i = 0; i < children.size(); i++)
+		if (children[i]->Visible && !children[i]->DrawsInside())
+			return false;
+	return true;
+}
+
+unsigned long long Panel::Fingerprint()
+{
+	unsigned long long hash = Component::Fingerprint();
+	hash = MixFingerprint(hash, (ViewportPosition.X << 16) ^ ViewportPosition.Y);
+	hash = MixFingerprint(hash, children.size());
+	for (size_t i = 0; i < children.size(); i++)
+	{
+		hash = MixFingerprint(hash, children[i]->Visible ? 1 : 0);
+		hash = MixFingerprint(hash, (children[i]->Position.X << 16) ^ children[i]->Position.Y);
+		hash = MixFingerprint(hash, (children[i]->Size.X << 16) ^ children[i]->Size.Y);
+		hash = MixFingerprint(hash, children[i]->Fingerprint());
+	}
+	return hash;
 }
 
 void Panel::Draw(const Point& screenPos)
@@ -60,6 +60,10 @@ class Component;
 
 		void Tick(float dt);
 		void Draw(const Point& screenPos);
+		// Children are drawn into a buffer of the panel's own and only its rectangle of that is copied out, but
+		// they have to say when they change for the panel to know when it does
+		bool DrawsInside();
+		unsigned long long Fingerprint();
 
 		void OnMouseHover(int localx, int localy);
 		void OnMouseMoved(int localx, int localy, int dx, int dy);
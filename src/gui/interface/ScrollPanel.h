@@ -26,6 +26,8 @@ namespace ui
 		void SetScrollPosition(int position);
 
 		virtual void Draw(const Point& screenPos);
+		// The scroll bar slides in and out and the contents keep scrolling from XTick
+		bool DrawsInside() { return false; }
 		virtual void XTick(float dt);
 		virtual void XOnMouseWheelInside(int localx, int localy, int d);
 		virtual void XOnMouseClick(int localx, int localy, unsigned int button);
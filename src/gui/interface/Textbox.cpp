@@ -51,11 +51,13 @@ void Textbox::SetHidden(bool hidden)
 	menu->AddItem(ContextMenuItem("Paste", 2, true));
 
 	masked = hidden;
+	MarkDirty();
 }
 
 void Textbox::SetPlaceholder(String text)
 {
 	placeHolder = text;
+	MarkDirty();
 }
 
 void Textbox::SetText(String newText)
@@ -570,3 +572,10 @@ void Textbox::Draw(const Point& screenPos)
 	if(Appearance.icon)
 		g->draw_icon(screenPos.X+iconPosition.X, screenPos.Y+iconPosition.Y, Appearance.icon);
 }
+
+bool Textbox::DrawsInside()
+{
+	// The cursor of the focused textbox moves with every key, that one is simply drawn every frame
+	return !IsFocused() && !Appearance.icon && Label::DrawsInside() &&
+	       (text.length() || textPosition.X + Graphics::textwidth(placeHolder) <= Size.X);
+}
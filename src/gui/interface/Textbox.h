@@ -33,7 +33,7 @@ public:
 
 	virtual void SetPlaceholder(String text);
 
-	void SetBorder(bool border) { this->border = border; }
+	void SetBorder(bool border) { this->border = border; MarkDirty(); }
 	void SetHidden(bool hidden);
 	bool GetHidden() { return masked; }
 	void SetActionCallback(TextboxAction * action) { actionCallback = action; }
@@ -60,6 +60,7 @@ public:
 	virtual void OnKeyRelease(int key, int scan, bool repeat, bool shift, bool ctrl, bool alt);
 	void OnTextInput(String text) override;
 	virtual void Draw(const Point& screenPos);
+	virtual bool DrawsInside();
 
 protected:
 	ValidInput inputType;
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <algorithm>
+#include "Config.h"
 #include "Window.h"
 #include "Engine.h"
 #include "Keys.h"
@@ -12,6 +14,7 @@ Window::Window(Point _position, Point _size):
 	Position(_position),
 	Size(_size),
 	AllowExclusiveDrawing(true),
+	RetainComponents(true),
 	okayButton(NULL),
 	cancelButton(NULL),
 	focusedComponent_(NULL),
@@ -76,6 +79,11 @@ void Window::RemoveComponent(Component* c)
 				focusedComponent_ = NULL;
 			if (Components[i] == hoverComponent)
 				hoverComponent = NULL;
+#ifndef OGLI
+			if (c->retained.valid)
+				layerDirty.push_back(RetainedArea(c));
+			c->retained.valid = false;
+#endif
 
 			Components.erase(Components.begin() + i);
 
@@ -105,6 +113,10 @@ void Window::RemoveComponent(unsigned idx)
 		focusedComponent_ = NULL;
 	if (Components[idx] == hoverComponent)
 		hoverComponent = NULL;
+#ifndef OGLI
+	if (Components[idx]->retained.valid)
+		layerDirty.push_back(RetainedArea(Components[idx]));
+#endif
 	delete Components[idx];
 	Components.erase(Components.begin() + idx);
 }
@@ -116,6 +128,14 @@ bool Window::IsFocused(const Component* c) const
 
 void Window::FocusComponent(Component* c)
 {
+	// Textboxes look different while focused
+	if (focusedComponent_ != c)
+	{
+		if (focusedComponent_)
+			focusedComponent_->MarkDirty();
+		if (c)
+			c->MarkDirty();
+	}
 	this->focusedComponent_ = c;
 }
 
@@ -160,65 +180,269 @@ void Window::DoFocus()
 	OnFocus();
 }
 
-void Window::DoDraw()
+#ifndef OGLI
+namespace
 {
-	OnDraw();
-	for (int i = 0, sz = Components.size(); i < sz; ++i)
-		if (Components[i]->Visible && ((Components[i] != focusedComponent_ && Components[i] != hoverComponent) || Components[i]->GetParent()))
+	// Components that aren't kept may draw a little past their edges, icons stick out for example, nothing in
+	// the layer can be this close to them
+	const int LIVE_OVERDRAW = 4;
+}
+
+Window::LayerArea Window::RetainedArea(const Component * c)
+{
+	LayerArea area = { c->retained.position.X, c->retained.position.Y, c->retained.position.X + c->retained.size.X, c->retained.position.Y + c->retained.size.Y };
+	return area;
+}
+
+void Window::LayerArea::Extend(const LayerArea & other)
+{
+	left = std::min(left, other.left);
+	top = std::min(top, other.top);
+	right = std::max(right, other.right);
+	bottom = std::max(bottom, other.bottom);
+}
+
+// base + spread * under / 255 for every channel, rounded
+static inline pixel Composite(pixel base, pixel spread, pixel under)
+{
+	int r = PIXR(base) + (PIXR(spread) * PIXR(under) + 127) / 255;
+	int g = PIXG(base) + (PIXG(spread) * PIXG(under) + 127) / 255;
+	int b = PIXB(base) + (PIXB(spread) * PIXB(under) + 127) / 255;
+	return PIXRGB(std::min(r, 255), std::min(g, 255), std::min(b, 255));
+}
+
+void Window::UpdateLayer(const std::vector<Component*> & order, size_t firstOnTop, std::vector<bool> & live)
+{
+	// Anything drawn after a component that is drawn every frame would end up under it if it was in the layer
+	std::vector<LayerArea> liveAreas;
+	std::vector<Component*> layered;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		Component * c = order[i];
+		Component::Retained & retained = c->retained;
+		int outset = c->Overdraw();
+		LayerArea area = { Position.X + c->Position.X - outset, Position.Y + c->Position.Y - outset, Position.X + c->Position.X + c->Size.X + outset, Position.Y + c->Position.Y + c->Size.Y + outset };
+		bool keep = c->Size.X > 0 && c->Size.Y > 0 && area.left >= 0 && area.top >= 0 && area.right <= WINDOWW && area.bottom <= WINDOWH && c->DrawsInside();
+		for (size_t j = 0; keep && j < liveAreas.size(); j++)
+			keep = !area.Overlaps(liveAreas[j]);
+		if (!keep)
 		{
-			Point scrpos(Components[i]->Position.X + Position.X, Components[i]->Position.Y + Position.Y);
-			if (AllowExclusiveDrawing)
-			{
-				Components[i]->Draw(scrpos);
-			}
-			else
+			if (retained.valid)
+				layerDirty.push_back(RetainedArea(c));
+			retained.valid = false;
+			LayerArea reach = { area.left - LIVE_OVERDRAW, area.top - LIVE_OVERDRAW, area.right + LIVE_OVERDRAW, area.bottom + LIVE_OVERDRAW };
+			liveAreas.push_back(reach);
+			continue;
+		}
+		live[i] = false;
+		layered.push_back(c);
+		bool onTop = i >= firstOnTop;
+		Point position(area.left, area.top), size(area.right - area.left, area.bottom - area.top);
+		if (retained.valid && !c->dirty && retained.onTop == onTop && retained.position == position && retained.size == size && retained.look == c->Fingerprint())
+			continue;
+		if (retained.valid)
+			layerDirty.push_back(RetainedArea(c));
+		layerDirty.push_back(area);
+		retained.valid = true;
+		retained.onTop = onTop;
+		retained.position = position;
+		retained.size = size;
+	}
+	// Components that were hidden or went off screen left the layer without going through the loop above
+	std::vector<Component*> sorted(layered);
+	std::sort(sorted.begin(), sorted.end());
+	for (size_t i = 0; i < Components.size(); i++)
+		if (Components[i]->retained.valid && !std::binary_search(sorted.begin(), sorted.end(), Components[i]))
+		{
+			layerDirty.push_back(RetainedArea(Components[i]));
+			Components[i]->retained.valid = false;
+		}
+
+	if (layered.size() && layerBase.empty())
+	{
+		layerBase.assign(WINDOWW * WINDOWH, PIXRGB(0, 0, 0));
+		layerSpread.assign(WINDOWW * WINDOWH, PIXRGB(255, 255, 255));
+		layerSpans.resize(WINDOWH);
+	}
+	if (layerBase.empty())
+	{
+		layerDirty.clear();
+		return;
+	}
+
+	// Components that overlap are drawn again together, in order, so an area grows until every component that
+	// it touches is inside of it
+	for (size_t i = 0; i < layerDirty.size(); i++)
+	{
+		LayerArea & area = layerDirty[i];
+		area.left = std::max(area.left, 0);
+		area.top = std::max(area.top, 0);
+		area.right = std::min(area.right, WINDOWW);
+		area.bottom = std::min(area.bottom, WINDOWH);
+	}
+	bool grown = true;
+	while (grown)
+	{
+		grown = false;
+		for (size_t i = 0; i < layerDirty.size(); i++)
+		{
+			for (size_t j = 0; j < layered.size(); j++)
 			{
-				if (scrpos.X + Components[i]->Size.X >= 0 &&
-				    scrpos.Y + Components[i]->Size.Y >= 0 &&
-				    scrpos.X < ui::Engine::Ref().GetWidth() &&
-				    scrpos.Y < ui::Engine::Ref().GetHeight())
+				LayerArea area = RetainedArea(layered[j]);
+				if (layerDirty[i].Overlaps(area) && !layerDirty[i].Contains(area))
 				{
-					Components[i]->Draw(scrpos);
+					layerDirty[i].Extend(area);
+					grown = true;
 				}
 			}
-#ifdef DEBUG
-			if (debugMode)
-			{
-				if (focusedComponent_==Components[i])
+			for (size_t j = i + 1; j < layerDirty.size(); j++)
+				if (layerDirty[i].Overlaps(layerDirty[j]))
 				{
-					ui::Engine::Ref().g->fillrect(Components[i]->Position.X+Position.X, Components[i]->Position.Y+Position.Y, Components[i]->Size.X, Components[i]->Size.Y, 0, 255, 0, 90);
-				}
-				else
-				{
-					ui::Engine::Ref().g->fillrect(Components[i]->Position.X+Position.X, Components[i]->Position.Y+Position.Y, Components[i]->Size.X, Components[i]->Size.Y, 255, 0, 0, 90);
+					layerDirty[i].Extend(layerDirty[j]);
+					layerDirty.erase(layerDirty.begin() + j);
+					j--;
+					grown = true;
 				}
+		}
+	}
+	for (size_t i = 0; i < layerDirty.size(); i++)
+		if (layerDirty[i].left < layerDirty[i].right && layerDirty[i].top < layerDirty[i].bottom)
+			DrawLayerArea(layerDirty[i], layered);
+	layerDirty.clear();
+
+	pixel * vid = GetGraphics()->vid;
+	for (int y = 0; y < WINDOWH; y++)
+	{
+		const std::vector<LayerSpan> & spans = layerSpans[y];
+		for (size_t i = 0; i < spans.size(); i++)
+		{
+			int offset = y * WINDOWW + spans[i].x;
+			if (spans[i].opaque)
+				std::copy(&layerBase[offset], &layerBase[offset] + spans[i].count, vid + offset);
+			else
+				for (int x = 0; x < spans[i].count; x++)
+					vid[offset + x] = Composite(layerBase[offset + x], layerSpread[offset + x], vid[offset + x]);
+		}
+	}
+}
+
+void Window::DrawLayerArea(const LayerArea & area, const std::vector<Component*> & layered)
+{
+	Graphics * g = GetGraphics();
+	pixel * vid = g->vid;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		std::vector<pixel> & target = pass ? layerSpread : layerBase;
+		pixel background = pass ? PIXRGB(255, 255, 255) : PIXRGB(0, 0, 0);
+		for (int y = area.top; y < area.bottom; y++)
+			std::fill(&target[y * WINDOWW + area.left], &target[y * WINDOWW + area.right], background);
+		g->vid = &target[0];
+		for (size_t i = 0; i < layered.size(); i++)
+			if (area.Overlaps(RetainedArea(layered[i])))
+				layered[i]->Draw(Point(Position.X + layered[i]->Position.X, Position.Y + layered[i]->Position.Y));
+	}
+	g->vid = vid;
+	for (size_t i = 0; i < layered.size(); i++)
+		if (area.Overlaps(RetainedArea(layered[i])))
+		{
+			layered[i]->dirty = false;
+			// Draw can change the Appearance itself, so this is taken after
+			layered[i]->retained.look = layered[i]->Fingerprint();
+		}
+
+	for (int y = area.top; y < area.bottom; y++)
+	{
+		for (int x = area.left; x < area.right; x++)
+		{
+			pixel base = layerBase[y * WINDOWW + x], white = layerSpread[y * WINDOWW + x];
+			layerSpread[y * WINDOWW + x] = PIXRGB(PIXR(white) - PIXR(base), PIXG(white) - PIXG(base), PIXB(white) - PIXB(base));
+		}
+		std::vector<LayerSpan> & spans = layerSpans[y];
+		spans.clear();
+		for (int x = 0; x < WINDOWW; x++)
+		{
+			pixel base = layerBase[y * WINDOWW + x], spread = layerSpread[y * WINDOWW + x];
+			if (base == PIXRGB(0, 0, 0) && spread == PIXRGB(255, 255, 255))
+				continue;
+			bool opaque = spread == PIXRGB(0, 0, 0);
+			if (spans.size() && spans.back().opaque == opaque && spans.back().x + spans.back().count == x)
+				spans.back().count++;
+			else
+			{
+				LayerSpan span = { x, 1, opaque };
+				spans.push_back(span);
 			}
-#endif
 		}
-	// the component the mouse is hovering over and the focused component are always drawn last
+	}
+}
+
+void Window::ForgetLayer()
+{
+	for (size_t i = 0; i < Components.size(); i++)
+		Components[i]->retained.valid = false;
+	layerBase.clear();
+	layerSpread.clear();
+	layerSpans.clear();
+	layerDirty.clear();
+}
+#endif
+
+void Window::DoDraw()
+{
+	OnDraw();
+	// The component the mouse is hovering over and the focused component are always drawn last
+	std::vector<Component*> order;
+	for (int i = 0, sz = Components.size(); i < sz; ++i)
+		if (Components[i]->Visible && ((Components[i] != focusedComponent_ && Components[i] != hoverComponent) || Components[i]->GetParent()))
+			order.push_back(Components[i]);
+	size_t firstOnTop = order.size();
 	if (hoverComponent && hoverComponent->Visible && hoverComponent->GetParent() == NULL)
+		order.push_back(hoverComponent);
+	if (focusedComponent_ && focusedComponent_ != hoverComponent && focusedComponent_->Visible && focusedComponent_->GetParent() == NULL)
+		order.push_back(focusedComponent_);
+	if (!AllowExclusiveDrawing)
 	{
-		Point scrpos(hoverComponent->Position.X + Position.X, hoverComponent->Position.Y + Position.Y);
-		if ((scrpos.X + hoverComponent->Size.X >= 0 &&
-		     scrpos.Y + hoverComponent->Size.Y >= 0 &&
-		     scrpos.X < ui::Engine::Ref().GetWidth() &&
-		     scrpos.Y < ui::Engine::Ref().GetHeight()
-		    ) || AllowExclusiveDrawing)
+		std::vector<Component*> onScreen;
+		size_t onScreenOnTop = 0;
+		for (size_t i = 0; i < order.size(); i++)
 		{
-			hoverComponent->Draw(scrpos);
+			Point scrpos(order[i]->Position.X + Position.X, order[i]->Position.Y + Position.Y);
+			if (scrpos.X + order[i]->Size.X >= 0 &&
+			    scrpos.Y + order[i]->Size.Y >= 0 &&
+			    scrpos.X < ui::Engine::Ref().GetWidth() &&
+			    scrpos.Y < ui::Engine::Ref().GetHeight())
+				onScreen.push_back(order[i]);
+			if (i < firstOnTop)
+				onScreenOnTop = onScreen.size();
 		}
+		order.swap(onScreen);
+		firstOnTop = onScreenOnTop;
 	}
-	if (focusedComponent_ && focusedComponent_ != hoverComponent && focusedComponent_->Visible && focusedComponent_->GetParent() == NULL)
+
+	std::vector<bool> live(order.size(), true);
+#ifndef OGLI
+	if (RetainComponents)
+		UpdateLayer(order, firstOnTop, live);
+	else if (layerBase.size())
+		ForgetLayer();
+#endif
+	for (size_t i = 0; i < order.size(); i++)
 	{
-		Point scrpos(focusedComponent_->Position.X + Position.X, focusedComponent_->Position.Y + Position.Y);
-		if ((scrpos.X + focusedComponent_->Size.X >= 0 &&
-		     scrpos.Y + focusedComponent_->Size.Y >= 0 &&
-		     scrpos.X < ui::Engine::Ref().GetWidth() &&
-		     scrpos.Y < ui::Engine::Ref().GetHeight()
-		    ) || AllowExclusiveDrawing)
+		if (live[i])
+			order[i]->Draw(Point(order[i]->Position.X + Position.X, order[i]->Position.Y + Position.Y));
+#ifdef DEBUG
+		if (debugMode && i < firstOnTop)
 		{
-			focusedComponent_->Draw(scrpos);
+			if (focusedComponent_==order[i])
+			{
+				ui::Engine::Ref().g->fillrect(order[i]->Position.X+Position.X, order[i]->Position.Y+Position.Y, order[i]->Size.X, order[i]->Size.Y, 0, 255, 0, 90);
+			}
+			else
+			{
+				ui::Engine::Ref().g->fillrect(order[i]->Position.X+Position.X, order[i]->Position.Y+Position.Y, order[i]->Size.X, order[i]->Size.Y, 255, 0, 0, 90);
+			}
 		}
+#endif
 	}
 #ifdef DEBUG
 	if (debugMode)
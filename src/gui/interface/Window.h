@@ -4,6 +4,7 @@
 #include "common/String.h"
 #include <vector>
 #include "common/tpt-compat.h"
+#include "graphics/Pixel.h"
 #include "gui/interface/Point.h"
 
 class Graphics;
@@ -36,6 +37,9 @@ namespace ui
 		void SetCancelButton(ui::Button * button) { cancelButton = button; }
 
 		bool AllowExclusiveDrawing; //false will not call draw on objects outside of bounds
+		// Keep the components that can be kept in a layer that is only drawn again where something in it changed,
+		// instead of drawing them every frame. See Component::DrawsInside.
+		bool RetainComponents;
 
 		// Add Component to window
 		void AddComponent(Component* c);
@@ -120,6 +124,43 @@ namespace ui
 		bool destruct;
 		bool stop;
 
+	private:
+#ifndef OGLI
+		// From left to right and top to bottom, right and bottom not included
+		struct LayerArea
+		{
+			int left, top, right, bottom;
+
+			bool Overlaps(const LayerArea & other) const
+			{
+				return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+			}
+			bool Contains(const LayerArea & other) const
+			{
+				return left <= other.left && top <= other.top && right >= other.right && bottom >= other.bottom;
+			}
+			void Extend(const LayerArea & other);
+		};
+		struct LayerSpan
+		{
+			int x, count;
+			bool opaque;
+		};
+		// The layer is the kept components drawn over black, and drawn again over white with that taken away,
+		// which leaves how much of what is under each pixel still shows through. Pixels that none of them cover
+		// are black with everything showing through, the spans of each row are the rest.
+		std::vector<pixel> layerBase, layerSpread;
+		std::vector<std::vector<LayerSpan> > layerSpans;
+		// Parts of the layer that have to be drawn again before it is used next
+		std::vector<LayerArea> layerDirty;
+
+		static LayerArea RetainedArea(const Component * c);
+		// Works out which of the components, in the order they are drawn in, can be in the layer, brings the
+		// layer up to date and draws it. The ones that can't be are left in live.
+		void UpdateLayer(const std::vector<Component*> & order, size_t firstOnTop, std::vector<bool> & live);
+		void DrawLayerArea(const LayerArea & area, const std::vector<Component*> & layered);
+		void ForgetLayer();
+#endif
 	};
 }
 #endif // WINDOW_H
@@ -0,0 +1,328 @@
+#include "Config.h"
+#if defined(HIGH_QUALITY_RESAMPLE) && !defined(PIX16)
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ImageResampler.h"
+#include "resampler.h"
+#include "common/String.h"
+#include "common/WorkerPool.h"
+
+#ifdef __SSE2__
+#define RESAMPLE_VECTOR
+#include <emmintrin.h>
+#endif
+
+namespace ImageResampler
+{
+	// Resampler's contributor list for one axis, flattened so that the source pixels and weights of every result
+	// pixel follow each other
+	struct Axis
+	{
+		int sourceSize, resultSize;
+		ByteString filter;
+		float filterScale;
+		std::vector<int> first, count;
+		std::vector<int> pixels;
+		std::vector<float> weights;
+		// Whether any result pixel takes anything from each source pixel
+		std::vector<bool> used;
+	};
+
+	// Enough for the few sizes that thumbnails and icons come in
+	static const size_t CACHED_AXES = 16;
+	static std::mutex cacheMutex;
+	// The most recently used at the back
+	static std::vector<std::shared_ptr<const Axis> > cache;
+
+	static std::shared_ptr<const Axis> GetAxis(int sourceSize, int resultSize, const char * filter, float filterScale)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			const Axis & axis = *cache[i];
+			if (axis.sourceSize == sourceSize && axis.resultSize == resultSize && axis.filter == filter && axis.filterScale == filterScale)
+			{
+				std::shared_ptr<const Axis> found = cache[i];
+				cache.erase(cache.begin() + i);
+				cache.push_back(found);
+				return found;
+			}
+		}
+
+		Resampler::Contrib_List * list = Resampler::create_clist(sourceSize, resultSize, Resampler::BOUNDARY_CLAMP, filter, filterScale);
+		if (!list)
+			return std::shared_ptr<const Axis>();
+		std::shared_ptr<Axis> axis = std::make_shared<Axis>();
+		axis->sourceSize = sourceSize;
+		axis->resultSize = resultSize;
+		axis->filter = filter;
+		axis->filterScale = filterScale;
+		axis->used.resize(sourceSize, false);
+		for (int i = 0; i < resultSize; i++)
+		{
+			axis->first.push_back(axis->pixels.size());
+			axis->count.push_back(list[i].n);
+			for (int j = 0; j < list[i].n; j++)
+			{
+				axis->pixels.push_back(list[i].p[j].pixel);
+				axis->weights.push_back(list[i].p[j].weight);
+				axis->used[list[i].p[j].pixel] = true;
+			}
+		}
+		Resampler::free_clist(list);
+
+		if (cache.size() >= CACHED_AXES)
+			cache.erase(cache.begin());
+		cache.push_back(axis);
+		return axis;
+	}
+
+	// The four bytes of a pixel as four floats from 0 to 1, in the order they are in memory like Resampler's
+	// channels. Every operation is done on all four the way Resampler does it to one, so the results are the same.
+#ifdef RESAMPLE_VECTOR
+	typedef __m128 Channels;
+	static inline Channels Zero() { return _mm_setzero_ps(); }
+	static inline Channels Load(const float * p) { return _mm_loadu_ps(p); }
+	static inline void Store(float * p, Channels c) { _mm_storeu_ps(p, c); }
+	static inline Channels Add(Channels a, Channels b) { return _mm_add_ps(a, b); }
+	static inline Channels Scale(Channels c, float weight) { return _mm_mul_ps(c, _mm_set1_ps(weight)); }
+
+	static inline Channels Unpack(pixel p)
+	{
+		__m128i zero = _mm_setzero_si128();
+		__m128i bytes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p), zero), zero);
+		return _mm_mul_ps(_mm_cvtepi32_ps(bytes), _mm_set1_ps(1.0f/255.0f));
+	}
+
+	static inline pixel Pack(Channels c)
+	{
+		c = _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		__m128i v = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.0f)), _mm_set1_ps(.5f)));
+		v = _mm_packs_epi32(v, v);
+		return _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+	}
+#else
+	struct Channels
+	{
+		float c[4];
+	};
+
+	static inline Channels Zero()
+	{
+		Channels z = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+		return z;
+	}
+
+	static inline Channels Load(const float * p)
+	{
+		Channels c;
+		std::memcpy(c.c, p, sizeof(c.c));
+		return c;
+	}
+
+	static inline void Store(float * p, Channels c)
+	{
+		std::memcpy(p, c.c, sizeof(c.c));
+	}
+
+	static inline Channels Add(Channels a, Channels b)
+	{
+		for (int i = 0; i < 4; i++)
+			a.c[i] += b.c[i];
+		return a;
+	}
+
+	static inline Channels Scale(Channels c, float weight)
+	{
+		for (int i = 0; i < 4; i++)
+			c.c[i] *= weight;
+		return c;
+	}
+
+	static inline Channels Unpack(pixel p)
+	{
+		const unsigned char * bytes = (const unsigned char *)&p;
+		Channels c;
+		for (int i = 0; i < 4; i++)
+			c.c[i] = bytes[i] * (1.0f/255.0f);
+		return c;
+	}
+
+	static inline pixel Pack(Channels c)
+	{
+		pixel p;
+		unsigned char * bytes = (unsigned char *)&p;
+		for (int i = 0; i < 4; i++)
+		{
+			float f = c.c[i];
+			if (f < 0.0f)
+				f = 0.0f;
+			else if (f > 1.0f)
+				f = 1.0f;
+			bytes[i] = (int)(255.0f * f + .5f);
+		}
+		return p;
+	}
+#endif
+
+	// Source pixels are unpacked once up front, as every one of them goes into a good few results
+	static void UnpackRow(const pixel * row, int width, float * out)
+	{
+		for (int x = 0; x < width; x++)
+			Store(out + x*4, Unpack(row[x]));
+	}
+
+	static inline Channels FilterPixel(const Axis & axis, const float * row, int x)
+	{
+		Channels total = Zero();
+		for (int k = axis.first[x], end = axis.first[x] + axis.count[x]; k < end; k++)
+			total = Add(total, Scale(Load(row + axis.pixels[k]*4), axis.weights[k]));
+		return total;
+	}
+
+	// Every result pixel is a long chain of additions that can't be reordered without changing the result, so
+	// two of them are worked on side by side to keep the processor busy
+	static void FilterAcross(const Axis & axis, const float * row, float * out)
+	{
+		const int * pixels = &axis.pixels[0];
+		const float * weights = &axis.weights[0];
+		int x = 0;
+		for (; x + 1 < axis.resultSize; x += 2)
+		{
+			int a = axis.first[x], b = axis.first[x+1];
+			int aEnd = a + axis.count[x], bEnd = b + axis.count[x+1];
+			Channels totalA = Zero(), totalB = Zero();
+			for (; a < aEnd && b < bEnd; a++, b++)
+			{
+				totalA = Add(totalA, Scale(Load(row + pixels[a]*4), weights[a]));
+				totalB = Add(totalB, Scale(Load(row + pixels[b]*4), weights[b]));
+			}
+			for (; a < aEnd; a++)
+				totalA = Add(totalA, Scale(Load(row + pixels[a]*4), weights[a]));
+			for (; b < bEnd; b++)
+				totalB = Add(totalB, Scale(Load(row + pixels[b]*4), weights[b]));
+			Store(out + x*4, totalA);
+			Store(out + (x+1)*4, totalB);
+		}
+		for (; x < axis.resultSize; x++)
+			Store(out + x*4, FilterPixel(axis, row, x));
+	}
+
+	// Adds up the rows of image, which are width pixels wide, that make row y of the result one after the other.
+	// Each channel of each pixel is worked out on its own, so this is left as plain loops over the floats for the
+	// compiler to vectorise as widely as it can.
+	static void FilterDown(const Axis & axis, int y, const float * image, int width, float * out)
+	{
+		const int * pixels = &axis.pixels[axis.first[y]];
+		const float * weights = &axis.weights[axis.first[y]];
+		int floats = width*4;
+		const float * row = image + pixels[0]*floats;
+		for (int i = 0; i < floats; i++)
+			out[i] = row[i] * weights[0];
+		for (int k = 1; k < axis.count[y]; k++)
+		{
+			row = image + pixels[k]*floats;
+			float weight = weights[k];
+			for (int i = 0; i < floats; i++)
+				out[i] += row[i] * weight;
+		}
+	}
+
+	// Like the pixel formats, the channels that aren't there come out as 0
+	static pixel ChannelMask()
+	{
+		pixel mask = 0;
+		unsigned char * bytes = (unsigned char *)&mask;
+		for (int i = 0; i < PIXELCHANNELS; i++)
+			bytes[i] = 0xFF;
+		return mask;
+	}
+
+	static void PackRow(const float * row, pixel * out, int width)
+	{
+		pixel mask = ChannelMask();
+		for (int x = 0; x < width; x++)
+			out[x] = Pack(Load(row + x*4)) & mask;
+	}
+
+	// Smaller images aren't worth waking the workers for
+	static const int THREADED_PIXELS = 1<<15;
+
+	// Calls job with the first row and the row after the last of every band
+	static void InBands(WorkerPool * workers, int rows, const std::function<void(int, int)> & job)
+	{
+		if (!workers)
+		{
+			job(0, rows);
+			return;
+		}
+		int bands = workers->GetCount();
+		workers->Run([rows, bands, &job](int id) {
+			job(rows*id/bands, rows*(id+1)/bands);
+		});
+	}
+
+	pixel * Resize(const pixel * source, int sourceWidth, int sourceHeight, int resultWidth, int resultHeight,
+		const char * filter, float filterScale, WorkerPool * workers)
+	{
+		if (sourceWidth <= 0 || sourceHeight <= 0 || resultWidth <= 0 || resultHeight <= 0)
+			return NULL;
+		std::shared_ptr<const Axis> across = GetAxis(sourceWidth, resultWidth, filter, filterScale);
+		std::shared_ptr<const Axis> down = GetAxis(sourceHeight, resultHeight, filter, filterScale);
+		if (!across || !down)
+			return NULL;
+		if (resultWidth*resultHeight < THREADED_PIXELS)
+			workers = NULL;
+		pixel * result = new pixel[resultWidth*resultHeight];
+
+		// Resampler's way of picking which axis to filter first, which makes a slight difference to the result
+		long long acrossOps = across->pixels.size(), downOps = down->pixels.size();
+		long long acrossFirstOps = acrossOps*sourceHeight + (4*downOps*resultWidth)/3;
+		long long downFirstOps = (4*downOps*sourceWidth)/3 + acrossOps*resultHeight;
+		if (acrossFirstOps > downFirstOps || (acrossFirstOps == downFirstOps && sourceWidth < resultWidth))
+		{
+			std::vector<float> unpacked(sourceHeight*sourceWidth*4);
+			InBands(workers, sourceHeight, [&](int top, int bottom) {
+				for (int y = top; y < bottom; y++)
+					if (down->used[y])
+						UnpackRow(source + y*sourceWidth, sourceWidth, &unpacked[y*sourceWidth*4]);
+			});
+			InBands(workers, resultHeight, [&](int top, int bottom) {
+				std::vector<float> column(sourceWidth*4), row(resultWidth*4);
+				for (int y = top; y < bottom; y++)
+				{
+					FilterDown(*down, y, &unpacked[0], sourceWidth, &column[0]);
+					FilterAcross(*across, &column[0], &row[0]);
+					PackRow(&row[0], result + y*resultWidth, resultWidth);
+				}
+			});
+		}
+		else
+		{
+			std::vector<float> acrossOnly(sourceHeight*resultWidth*4);
+			InBands(workers, sourceHeight, [&](int top, int bottom) {
+				std::vector<float> unpacked(sourceWidth*4);
+				for (int y = top; y < bottom; y++)
+					if (down->used[y])
+					{
+						UnpackRow(source + y*sourceWidth, sourceWidth, &unpacked[0]);
+						FilterAcross(*across, &unpacked[0], &acrossOnly[y*resultWidth*4]);
+					}
+			});
+			InBands(workers, resultHeight, [&](int top, int bottom) {
+				std::vector<float> row(resultWidth*4);
+				for (int y = top; y < bottom; y++)
+				{
+					FilterDown(*down, y, &acrossOnly[0], resultWidth, &row[0]);
+					PackRow(&row[0], result + y*resultWidth, resultWidth);
+				}
+			});
+		}
+		return result;
+	}
+}
+
+#endif
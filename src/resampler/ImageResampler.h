@@ -0,0 +1,21 @@
+#ifndef IMAGERESAMPLER_H
+#define IMAGERESAMPLER_H
+
+#include "graphics/Pixel.h"
+
+class WorkerPool;
+
+// Resizes whole images with the filters of Resampler, which by itself goes through one channel of one row at a
+// time and works out its filter weights again for every image. Here the weights for each pair of sizes are kept
+// for the next image that needs them, all four bytes of a pixel are filtered together, and big images are
+// shared out between the workers a band of rows each. The result is the same as running a Resampler over every
+// channel.
+namespace ImageResampler
+{
+	// Returns a new[] image of resultWidth by resultHeight made from source with the filter of that name, or NULL
+	// if either size is empty or the filter doesn't exist
+	pixel * Resize(const pixel * source, int sourceWidth, int sourceHeight, int resultWidth, int resultHeight,
+		const char * filter, float filterScale, WorkerPool * workers = NULL);
+}
+
+#endif
@@ -723,6 +723,36 @@ Resampler::Contrib_List* Resampler::make_clist(
    return Pcontrib;
 }
 
+Resampler::Contrib_List* Resampler::create_clist(
+   int src_x, int dst_x, Boundary_Op boundary_op,
+   const char* Pfilter_name,
+   Resample_Real filter_scale,
+   Resample_Real src_ofs)
+{
+   int i;
+
+   if (Pfilter_name == NULL)
+      Pfilter_name = RESAMPLER_DEFAULT_FILTER;
+
+   for (i = 0; i < NUM_FILTERS; i++)
+      if (strcmp(Pfilter_name, g_filters[i].name) == 0)
+         break;
+
+   if (i == NUM_FILTERS)
+      return NULL;
+
+   return make_clist(src_x, dst_x, boundary_op, g_filters[i].func, g_filters[i].support, filter_scale, src_ofs);
+}
+
+void Resampler::free_clist(Contrib_List* Pclist)
+{
+   if (Pclist)
+   {
+      free(Pclist->p);
+      free(Pclist);
+   }
+}
+
 void Resampler::resample_x(Sample* Pdst, const Sample* Psrc)
 {
    resampler_assert(Pdst);
@@ -81,6 +81,16 @@ public:
    Contrib_List* get_clist_x() const {	return m_Pclist_x; }
    Contrib_List* get_clist_y() const {	return m_Pclist_y; }
 
+   // Builds the contributor list for one axis on its own, as the constructor would, so that it can be kept
+   // and used without a Resampler. NULL on a bad filter name or out of memory. Free it with free_clist.
+   static Contrib_List* create_clist(
+      int src_x, int dst_x,
+      Boundary_Op boundary_op = BOUNDARY_CLAMP,
+      const char* Pfilter_name = RESAMPLER_DEFAULT_FILTER,
+      Resample_Real filter_scale = 1.0f,
+      Resample_Real src_ofs = 0.0f);
+   static void free_clist(Contrib_List* Pclist);
+
    // Filter accessors.
    static int get_filter_num();
    static char* get_filter_name(int filter_num);
@@ -139,9 +149,9 @@ private:
    void clamp(Sample* Pdst, int n);
    void resample_y(Sample* Pdst);
 
-   int reflect(const int j, const int src_x, const Boundary_Op boundary_op);
+   static int reflect(const int j, const int src_x, const Boundary_Op boundary_op);
 
-   Contrib_List* make_clist(
+   static Contrib_List* make_clist(
       int src_x, int dst_x, Boundary_Op boundary_op,
       Resample_Real (*Pfilter)(Resample_Real),
       Resample_Real filter_support,
@@ -42,6 +42,7 @@ void Air::make_kernel(void) //used for velocity
 
 void Air::Clear()
 {
+	Changed();
 	std::fill(&pv[0][0], &pv[0][0]+((XRES/CELL)*(YRES/CELL)), 0.0f);
 	std::fill(&vy[0][0], &vy[0][0]+((XRES/CELL)*(YRES/CELL)), 0.0f);
 	std::fill(&vx[0][0], &vx[0][0]+((XRES/CELL)*(YRES/CELL)), 0.0f);
@@ -49,6 +50,7 @@ void Air::Clear()
 
 void Air::ClearAirH()
 {
+	Changed();
 	std::fill(&hv[0][0], &hv[0][0]+((XRES/CELL)*(YRES/CELL)), ambientAirTemp);
 }
 
@@ -56,6 +58,7 @@ void Air::update_airh(void)
 {
 	int x, y, i, j;
 	float odh, dh, dx, dy, f, tx, ty;
+	Changed();
 	for (i=0; i<YRES/CELL; i++) //reduces pressure/velocity on the edges every frame
 	{
 		hv[i][0] = ambientAirTemp;
@@ -133,6 +136,7 @@ void Air::update_air(void)
 	int x = 0, y = 0, i = 0, j = 0;
 	float dp = 0.0f, dx = 0.0f, dy = 0.0f, f = 0.0f, tx = 0.0f, ty = 0.0f;
 	const float advDistanceMult = 0.7f;
+	Changed();
 	float stepX, stepY;
 	int stepLimit, step;
 
@@ -344,6 +348,7 @@ void Air::update_air(void)
 void Air::Invert()
 {
 	int nx, ny;
+	Changed();
 	for (nx = 0; nx<XRES/CELL; nx++)
 		for (ny = 0; ny<YRES/CELL; ny++)
 		{
@@ -386,7 +391,8 @@ void Air::RecalculateBlockAirMaps()
 Air::Air(Simulation & simulation):
 	sim(simulation),
 	airMode(0),
-	ambientAirTemp(295.15f)
+	ambientAirTemp(295.15f),
+	revision(0)
 {
 	//Simulation should do this.
 	make_kernel();
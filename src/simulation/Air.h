@@ -27,6 +27,10 @@ public:
 	unsigned char bmap_blockair[YRES/CELL][XRES/CELL];
 	unsigned char bmap_blockairh[YRES/CELL][XRES/CELL];
 	float kernel[9];
+	//Goes up whenever pv, vx, vy or hv may have changed, so that anything made from them can tell when to redo it.
+	//Air's own updates count themselves, everything else that writes to the maps calls Changed.
+	unsigned int revision;
+	void Changed() { revision++; }
 	void make_kernel(void);
 	void update_airh(void);
 	void update_air(void);
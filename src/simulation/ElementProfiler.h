@@ -0,0 +1,125 @@
+#ifndef ELEMENTPROFILER_H
+#define ELEMENTPROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include "Config.h"
+#include "Elements.h"
+
+// Sampled per element timing of the update, graphics and movement code. Call counts are exact, only
+// every SAMPLE_INTERVAL-th call is timed. Each worker thread writes to its own slot, the slots are only
+// added up when the results are read, which happens while the workers are waiting on their barrier.
+class ElementProfiler
+{
+public:
+	enum Phase
+	{
+		Update = 0,
+		Graphics,
+		Movement,
+		PhaseCount
+	};
+
+	struct Counter
+	{
+		uint64_t calls;
+		uint64_t samples;
+		uint64_t time; // nanoseconds spent in the sampled calls
+
+		// Estimated time spent in all calls
+		double Estimate() const { return samples ? (double)time * calls / samples : 0.0; }
+	};
+
+	static const int RENDER_SLOT = THRDS;
+	static const int SLOTS = THRDS+1;
+	static const unsigned int SAMPLE_INTERVAL = 16;
+
+	class Sample
+	{
+		Counter * counter;
+		std::chrono::high_resolution_clock::time_point start;
+	public:
+		Sample(ElementProfiler & profiler, int slot, int type, Phase phase):
+			counter(NULL)
+		{
+			if (!profiler.enabled)
+				return;
+			Slot & s = profiler.slots[slot];
+			Counter & c = s.counters[type][phase];
+			c.calls++;
+			if (++s.sampleTick % SAMPLE_INTERVAL)
+				return;
+			c.samples++;
+			counter = &c;
+			start = std::chrono::high_resolution_clock::now();
+		}
+
+		~Sample()
+		{
+			Stop();
+		}
+
+		void Stop()
+		{
+			if (!counter)
+				return;
+			counter->time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+			counter = NULL;
+		}
+	};
+
+	bool enabled;
+	// Ticks simulated since the last Reset. The update and movement counters cover these, while the graphics
+	// ones cover however many frames were drawn in the meantime, which is a different number when the
+	// simulation has a tick rate of its own or is paused.
+	unsigned int ticks;
+
+	ElementProfiler():
+		enabled(false)
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		ticks = 0;
+		for (int i = 0; i < SLOTS; i++)
+		{
+			memset(slots[i].counters, 0, sizeof(slots[i].counters));
+			slots[i].sampleTick = 0;
+		}
+	}
+
+	void CountTick()
+	{
+		if (enabled)
+			ticks++;
+	}
+
+	// Adds up the counters of all slots into result
+	void Sum(Counter (*result)[PhaseCount]) const
+	{
+		memset(result, 0, sizeof(Counter)*PT_NUM*PhaseCount);
+		for (int i = 0; i < SLOTS; i++)
+			for (int t = 0; t < PT_NUM; t++)
+				for (int p = 0; p < PhaseCount; p++)
+				{
+					result[t][p].calls += slots[i].counters[t][p].calls;
+					result[t][p].samples += slots[i].counters[t][p].samples;
+					result[t][p].time += slots[i].counters[t][p].time;
+				}
+	}
+
+private:
+	// Padded so that two workers never write to the same cache line
+	struct Slot
+	{
+		Counter counters[PT_NUM][PhaseCount];
+		unsigned int sampleTick;
+		char padding[64];
+	};
+	Slot slots[SLOTS];
+};
+
+#endif
@@ -39,6 +39,13 @@
 #define FLAG_MOVABLE  0x8 // compatibility with old saves (moving SPNG), only applies to SPNG
 #define FLAG_PHOTDECO  0x8 // compatibility with old saves (decorated photons), only applies to PHOT. Having the same value as FLAG_MOVABLE is fine because they apply to different elements, and this saves space for future flags,
 
+// Particle properties an element's look can depend on, for Element::GraphicsState
+#define GSTATE_LIFE		0x01
+#define GSTATE_CTYPE	0x02
+#define GSTATE_TMP		0x04
+#define GSTATE_TMP2		0x08
+#define GSTATE_FLAGS	0x10
+
 
 #define UPDATE_FUNC_ARGS Simulation* sim, int i, int x, int y, int surround_space, int nt, Particle *parts, int pmap[YRES][XRES]
 #define UPDATE_FUNC_SUBCALL_ARGS sim, i, x, y, surround_space, nt, parts, pmap
@@ -1,6 +1,7 @@
 #include <cmath>
 #include <sys/types.h>
 #include "common/tpt-thread.h"
+#include "common/tpt-trace.h"
 #include "Config.h"
 #include "Gravity.h"
 #include "Misc.h"
@@ -43,6 +44,7 @@ void Gravity::Clear()
 void Gravity::gravity_init()
 {
 	ngrav_enable = 0;
+	synchronous = false;
 	//Allocate full size Gravmaps
 	th_ogravmap = (float *)calloc((XRES/CELL)*(YRES/CELL), sizeof(float));
 	th_gravmap = (float *)calloc((XRES/CELL)*(YRES/CELL), sizeof(float));
@@ -80,7 +82,24 @@ void Gravity::gravity_cleanup()
 void Gravity::gravity_update_async()
 {
 	int result;
-	if(ngrav_enable)
+	if(ngrav_enable && synchronous)
+	{
+		memcpy(th_gravmap, gravmap, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+		{
+			TRACE_ZONE("update_grav");
+			update_grav();
+		}
+		if(th_gravchanged)
+		{
+			memcpy(gravy, th_gravy, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+			memcpy(gravx, th_gravx, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+			memcpy(gravp, th_gravp, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+		}
+		membwand(gravy, gravmask, (XRES/CELL)*(YRES/CELL)*sizeof(float), (XRES/CELL)*(YRES/CELL)*sizeof(unsigned));
+		membwand(gravx, gravmask, (XRES/CELL)*(YRES/CELL)*sizeof(float), (XRES/CELL)*(YRES/CELL)*sizeof(unsigned));
+		memset(gravmap, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+	}
+	else if(ngrav_enable)
 	{
 		pthread_mutex_lock(&gravmutex);
 		result = grav_ready;
@@ -137,6 +156,7 @@ void Gravity::update_grav_async()
 {
 	int done = 0;
 	int thread_done = 0;
+	Trace::SetThreadName("Gravity");
 	memset(th_ogravmap, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
 	memset(th_gravmap, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
 	memset(th_gravy, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
@@ -151,7 +171,10 @@ void Gravity::update_grav_async()
 #endif
 	while(!thread_done){
 		if(!done){
-			update_grav();
+			{
+				TRACE_ZONE("update_grav");
+				update_grav();
+			}
 			done = 1;
 			pthread_mutex_lock(&gravmutex);
 
@@ -177,11 +200,28 @@ void Gravity::start_grav_async()
 	if(ngrav_enable)	//If it's already enabled, restart it
 		stop_grav_async();
 
-	gravthread_done = 0;
-	grav_ready = 0;
-	pthread_mutex_init (&gravmutex, NULL);
-	pthread_cond_init(&gravcv, NULL);
-	pthread_create(&gravthread, NULL, &Gravity::update_grav_async_helper, this); //Start asynchronous gravity simulation
+	if(synchronous)
+	{
+		//Same starting point as the gravity thread
+		memset(th_ogravmap, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+		memset(th_gravmap, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+		memset(th_gravy, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+		memset(th_gravx, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+		memset(th_gravp, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+		th_gravchanged = 0;
+#ifdef GRAVFFT
+		if (!grav_fft_status)
+			grav_fft_init();
+#endif
+	}
+	else
+	{
+		gravthread_done = 0;
+		grav_ready = 0;
+		pthread_mutex_init (&gravmutex, NULL);
+		pthread_cond_init(&gravcv, NULL);
+		pthread_create(&gravthread, NULL, &Gravity::update_grav_async_helper, this); //Start asynchronous gravity simulation
+	}
 	ngrav_enable = 1;
 
 	memset(gravy, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
@@ -192,15 +232,15 @@ void Gravity::start_grav_async()
 
 void Gravity::stop_grav_async()
 {
-	if(ngrav_enable){
+	if(ngrav_enable && !synchronous){
 		pthread_mutex_lock(&gravmutex);
 		gravthread_done = 1;
 		pthread_cond_signal(&gravcv);
 		pthread_mutex_unlock(&gravmutex);
 		pthread_join(gravthread, NULL);
 		pthread_mutex_destroy(&gravmutex); //Destroy the mutex
-		ngrav_enable = 0;
 	}
+	ngrav_enable = 0;
 	//Clear the grav velocities
 	memset(gravy, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
 	memset(gravx, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
@@ -208,6 +248,41 @@ void Gravity::stop_grav_async()
 	memset(gravmap, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
 }
 
+void Gravity::SetSynchronous(bool newSynchronous)
+{
+	if (newSynchronous == synchronous)
+		return;
+	bool enabled = ngrav_enable;
+	stop_grav_async();
+	synchronous = newSynchronous;
+	if (enabled)
+		start_grav_async();
+}
+
+std::vector<unsigned char> Gravity::GetSolverState()
+{
+	const size_t cells = (XRES/CELL)*(YRES/CELL);
+	std::vector<unsigned char> state(4*cells*sizeof(float) + cells);
+	unsigned char * position = state.data();
+	float * buffers[] = { th_ogravmap, th_gravx, th_gravy, th_gravp };
+	for (int i = 0; i < 4; i++, position += cells*sizeof(float))
+		memcpy(position, buffers[i], cells*sizeof(float));
+	memcpy(position, obmap, cells);
+	return state;
+}
+
+bool Gravity::SetSolverState(const unsigned char * data, size_t size)
+{
+	const size_t cells = (XRES/CELL)*(YRES/CELL);
+	if (size != 4*cells*sizeof(float) + cells)
+		return false;
+	float * buffers[] = { th_ogravmap, th_gravx, th_gravy, th_gravp };
+	for (int i = 0; i < 4; i++, data += cells*sizeof(float))
+		memcpy(buffers[i], data, cells*sizeof(float));
+	memcpy(obmap, data, cells);
+	return true;
+}
+
 #ifdef GRAVFFT
 
 void Gravity::grav_fft_init()
@@ -285,7 +360,7 @@ void Gravity::grav_fft_cleanup()
 	grav_fft_status = false;
 }
 
-void Gravity::update_grav()
+void Gravity::update_grav_fft()
 {
 	int x, y, changed = 0;
 	int xblock2 = XRES/CELL*2, yblock2 = YRES/CELL*2;
@@ -357,16 +432,17 @@ void Gravity::update_grav()
 	memcpy(obmap, bmap, (XRES/CELL)*(YRES/CELL)*sizeof(unsigned char));
 }
 
-#else
-// gravity without fast Fourier transforms
+#endif
 
-void Gravity::update_grav(void)
+// gravity without fast Fourier transforms
+void Gravity::update_grav_direct()
 {
-	int x, y, i, j, changed = 0;
+	int x, y, i, j;
 	float val, distance;
 	th_gravchanged = 0;
 #ifndef GRAV_DIFF
 	//Find any changed cells
+	int changed = 0;
 	for (i=0; i<YRES/CELL; i++)
 	{
 		if(changed)
@@ -413,11 +489,40 @@ void Gravity::update_grav(void)
 			}
 		}
 	}
+#ifndef GRAV_DIFF
 fin:
+#endif
 	memcpy(th_ogravmap, th_gravmap, (XRES/CELL)*(YRES/CELL)*sizeof(float));
 	memcpy(obmap, bmap, (XRES/CELL)*(YRES/CELL)*sizeof(unsigned char));
 }
+
+void Gravity::update_grav()
+{
+#ifdef GRAVFFT
+	update_grav_fft();
+#else
+	update_grav_direct();
+#endif
+}
+
+void Gravity::update_grav_sync(bool fft)
+{
+	memcpy(th_gravmap, gravmap, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+	// Forget the previous map so that the solver always sees a change, as long as gravmap has any mass in it
+	memset(th_ogravmap, 0, (XRES/CELL)*(YRES/CELL)*sizeof(float));
+#ifdef GRAVFFT
+	if (fft)
+	{
+		if (!grav_fft_status)
+			grav_fft_init();
+		update_grav_fft();
+		return;
+	}
+#else
+	(void)fft;
 #endif
+	update_grav_direct();
+}
 
 
 
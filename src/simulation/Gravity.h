@@ -1,6 +1,7 @@
 #ifndef GRAVITY_H
 #define GRAVITY_H
 
+#include <vector>
 #include "common/tpt-thread.h"
 #include "Config.h"
 #include "Simulation.h"
@@ -75,6 +76,9 @@ public:
 	unsigned char (*bmap)[XRES/CELL];
 	unsigned char (*obmap)[XRES/CELL];
 	int ngrav_enable;
+	// Solve on the simulation thread from gravity_update_async instead of on the gravity thread, so that the
+	// result doesn't depend on timing. Used while recording and playing replays.
+	bool synchronous;
 	void grav_mask_r(int x, int y, char checkmap[YRES/CELL][XRES/CELL], char shape[YRES/CELL][XRES/CELL], char *shapeout);
 	void mask_free(mask_el *c_mask_el);
 
@@ -89,7 +93,19 @@ public:
 
 	void start_grav_async();
 	void stop_grav_async();
+	// Restarts gravity if it is enabled, which clears the gravity maps
+	void SetSynchronous(bool newSynchronous);
+	// The solver's own buffers, which a synchronous run needs along with the gravity maps to continue exactly
+	std::vector<unsigned char> GetSolverState();
+	bool SetSolverState(const unsigned char * data, size_t size);
 	void update_grav();
+	// The solvers behind update_grav, the direct sum is always built so it can be compared against the FFT one
+	void update_grav_direct();
+	#ifdef GRAVFFT
+	void update_grav_fft();
+	#endif
+	// Runs one solver step on gravmap on the calling thread, for benchmarks. The gravity thread must not be running.
+	void update_grav_sync(bool fft);
 	void gravity_mask();
 
 	void bilinear_interpolation(float *src, float *dst, int sw, int sh, int rw, int rh);
@@ -0,0 +1,1130 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include "Replay.h"
+#include "Air.h"
+#include "Gravity.h"
+#include "SaveFile.h"
+#include "Simulation.h"
+#include "StateHash.h"
+#include "common/tpt-lz.h"
+#include "common/tpt-rand.h"
+#include "common/tpt-trace.h"
+#include "gui/game/Brush.h"
+
+// Brush rebuilt from the bitmap stored in a replay
+class ReplayBrush: public Brush
+{
+	std::vector<unsigned char> shape;
+public:
+	ReplayBrush(ui::Point radius, const std::vector<unsigned char> & newShape):
+		Brush(ui::Point(0, 0)),
+		shape(newShape)
+	{
+		SetRadius(radius);
+	}
+
+	virtual void GenerateBitmap()
+	{
+		delete[] bitmap;
+		bitmap = new unsigned char[size.X*size.Y];
+		std::fill(bitmap, bitmap+size.X*size.Y, 0);
+		if (shape.size() == (size_t)(size.X*size.Y))
+			std::copy(shape.begin(), shape.end(), bitmap);
+	}
+};
+
+namespace
+{
+	const char MAGIC[4] = { 'M', 'T', 'P', 'R' };
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t frameCount;
+		uint32_t seed;
+	};
+
+	enum Op
+	{
+		OpTicks, OpState, OpSettings, OpSigns, OpHash, OpBrush,
+		OpCreateParts, OpCreatePartsRadius, OpCreateLine, OpCreateBox, OpFloodParts, OpCreatePart,
+		OpToolBrush, OpToolLine, OpToolBox,
+		OpCreateWalls, OpCreateWallLine, OpCreateWallBox, OpFloodWalls, OpSetFanVelocity, OpApplyWind,
+		OpDecorationPoint, OpDecorationLine, OpDecorationBox,
+		OpSetProperty, OpFloodProperty, OpClearSim,
+	};
+
+	enum Setting
+	{
+		SettingPause, SettingFrameRender, SettingEdgeMode, SettingGravityMode, SettingAirMode, SettingAmbientAirTemp,
+		SettingAmbientHeat, SettingWaterEqualisation, SettingPrettyPowder, SettingNewtonianGravity,
+		SettingReplaceModeSelected, SettingReplaceModeFlags, SettingGolSpeed,
+		// comm, pcomm, elem and fan of each stickman
+		SettingPlayer = SettingGolSpeed + 1,
+		SettingPlayer2 = SettingPlayer + 4,
+		SettingCount = SettingPlayer2 + 4
+	};
+
+	void PutVarint(std::vector<unsigned char> & data, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			data.push_back((value & 0x7F) | 0x80);
+			value >>= 7;
+		}
+		data.push_back(value);
+	}
+
+	void PutInt(std::vector<unsigned char> & data, int value)
+	{
+		PutVarint(data, ((uint64_t)(int64_t)value << 1) ^ (uint64_t)((int64_t)value >> 63));
+	}
+
+	void PutInts(std::vector<unsigned char> & data, std::initializer_list<int> values)
+	{
+		for (int value : values)
+			PutInt(data, value);
+	}
+
+	void PutRaw(std::vector<unsigned char> & data, const void * source, size_t size)
+	{
+		data.insert(data.end(), (const unsigned char *)source, (const unsigned char *)source + size);
+	}
+
+	void PutFloat(std::vector<unsigned char> & data, float value)
+	{
+		PutRaw(data, &value, 4);
+	}
+
+	class Reader
+	{
+		const unsigned char * position;
+		const unsigned char * end;
+	public:
+		bool ok;
+
+		Reader(const unsigned char * data, size_t size):
+			position(data),
+			end(data + size),
+			ok(true)
+		{
+		}
+
+		uint64_t Varint()
+		{
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64 && position < end; shift += 7)
+			{
+				unsigned char byte = *position++;
+				value |= (uint64_t)(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return value;
+			}
+			ok = false;
+			return 0;
+		}
+
+		int Int()
+		{
+			uint64_t value = Varint();
+			return (int)(int64_t)((value >> 1) ^ (0 - (value & 1)));
+		}
+
+		const unsigned char * Raw(size_t size)
+		{
+			if (size > (size_t)(end - position))
+			{
+				ok = false;
+				position = end;
+				return NULL;
+			}
+			const unsigned char * bytes = position;
+			position += size;
+			return bytes;
+		}
+
+		template<class T>
+		void Read(T & value)
+		{
+			const unsigned char * bytes = Raw(sizeof(T));
+			if (bytes)
+				memcpy(&value, bytes, sizeof(T));
+		}
+
+		float Float()
+		{
+			float value = 0;
+			Read(value);
+			return value;
+		}
+
+		size_t Remaining()
+		{
+			return end - position;
+		}
+	};
+
+	std::vector<int> GetSettings(const Simulation * sim)
+	{
+		std::vector<int> settings(SettingCount);
+		settings[SettingPause] = sim->sys_pause;
+		settings[SettingFrameRender] = sim->framerender;
+		settings[SettingEdgeMode] = sim->edgeMode;
+		settings[SettingGravityMode] = sim->gravityMode;
+		settings[SettingAirMode] = sim->air->airMode;
+		memcpy(&settings[SettingAmbientAirTemp], &sim->air->ambientAirTemp, 4);
+		settings[SettingAmbientHeat] = sim->aheat_enable;
+		settings[SettingWaterEqualisation] = sim->water_equal_test;
+		settings[SettingPrettyPowder] = sim->pretty_powder;
+		settings[SettingNewtonianGravity] = sim->grav->ngrav_enable;
+		settings[SettingReplaceModeSelected] = sim->replaceModeSelected;
+		settings[SettingReplaceModeFlags] = sim->replaceModeFlags;
+		settings[SettingGolSpeed] = sim->GSPEED;
+		const playerst * players[] = { &sim->player, &sim->player2 };
+		for (int i = 0; i < 2; i++)
+		{
+			settings[SettingPlayer + i*4 + 0] = players[i]->comm;
+			settings[SettingPlayer + i*4 + 1] = players[i]->pcomm;
+			settings[SettingPlayer + i*4 + 2] = players[i]->elem;
+			settings[SettingPlayer + i*4 + 3] = players[i]->fan;
+		}
+		return settings;
+	}
+
+	// Walls and gravity are only touched when their setting actually changed, the same as in the game
+	void SetSettings(Simulation * sim, const std::vector<int> & settings)
+	{
+		sim->sys_pause = settings[SettingPause];
+		sim->framerender = settings[SettingFrameRender];
+		if (sim->edgeMode != settings[SettingEdgeMode])
+			sim->SetEdgeMode(settings[SettingEdgeMode]);
+		sim->gravityMode = settings[SettingGravityMode];
+		sim->air->airMode = settings[SettingAirMode];
+		memcpy(&sim->air->ambientAirTemp, &settings[SettingAmbientAirTemp], 4);
+		sim->aheat_enable = settings[SettingAmbientHeat];
+		sim->water_equal_test = settings[SettingWaterEqualisation];
+		sim->pretty_powder = settings[SettingPrettyPowder];
+		if (!sim->grav->ngrav_enable != !settings[SettingNewtonianGravity])
+		{
+			if (settings[SettingNewtonianGravity])
+				sim->grav->start_grav_async();
+			else
+				sim->grav->stop_grav_async();
+		}
+		sim->replaceModeSelected = settings[SettingReplaceModeSelected];
+		sim->replaceModeFlags = settings[SettingReplaceModeFlags];
+		sim->GSPEED = settings[SettingGolSpeed];
+		playerst * players[] = { &sim->player, &sim->player2 };
+		for (int i = 0; i < 2; i++)
+		{
+			players[i]->comm = settings[SettingPlayer + i*4 + 0];
+			players[i]->pcomm = settings[SettingPlayer + i*4 + 1];
+			players[i]->elem = settings[SettingPlayer + i*4 + 2];
+			players[i]->fan = settings[SettingPlayer + i*4 + 3];
+		}
+	}
+
+	bool SameSigns(const std::vector<sign> & a, const std::vector<sign> & b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++)
+			if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].ju != b[i].ju || a[i].text != b[i].text)
+				return false;
+		return true;
+	}
+
+	// A save of the simulation along with everything a save leaves out but a tick depends on: counters,
+	// the random number generators, the order of the free particle list and the gravity solver's buffers.
+	// The extra part is compressed on its own and comes first, it says whether gravity has to be started
+	// before the save is loaded.
+	void CaptureState(const Simulation * sim, std::vector<unsigned char> & state)
+	{
+		TRACE_ZONE("Replay CaptureState");
+		std::vector<unsigned char> extra;
+		int ngrav = sim->grav->ngrav_enable;
+		PutRaw(extra, &ngrav, sizeof(ngrav));
+		int counters[] = {
+			sim->currentTick, sim->lightningRecreate, sim->emp_decor, sim->emp_trigger_count, sim->CGOL,
+			sim->ISWIRE, sim->sandcolour, sim->sandcolour_frame, sim->force_stacking_check, sim->elementRecount,
+			sim->parts_lastActiveIndex, sim->pfree,
+		};
+		PutRaw(extra, counters, sizeof(counters));
+		PutRaw(extra, sim->elementCount, sizeof(sim->elementCount));
+		RNG::State generators[] = { RNG::Ref().state(), random_gen.state() };
+		PutRaw(extra, generators, sizeof(generators));
+		PutRaw(extra, sim->gol, sizeof(sim->gol));
+		PutRaw(extra, sim->air->bmap_blockair, sizeof(sim->air->bmap_blockair));
+		PutRaw(extra, sim->air->bmap_blockairh, sizeof(sim->air->bmap_blockairh));
+		// Loading links up every free slot in order, so keep the order that the free list really has
+		std::vector<unsigned char> freeList;
+		int freeCount = 0, previous = 0;
+		for (int i = sim->pfree; i >= 0 && i < NPART && !sim->parts[i].type && freeCount < NPART; i = sim->parts[i].life, freeCount++)
+		{
+			PutInt(freeList, i - previous);
+			previous = i;
+		}
+		PutRaw(extra, &freeCount, sizeof(freeCount));
+		PutRaw(extra, freeList.data(), freeList.size());
+		if (ngrav)
+		{
+			std::vector<unsigned char> solver = sim->grav->GetSolverState();
+			PutRaw(extra, solver.data(), solver.size());
+		}
+
+		std::vector<unsigned char> save;
+		SaveFile::Serialise(sim, save);
+		state.clear();
+		PutVarint(state, extra.size());
+		size_t sizePosition = state.size();
+		state.resize(sizePosition + LZ::Bound(extra.size()));
+		size_t compressedSize = LZ::Compress(extra.data(), extra.size(), &state[sizePosition], state.size() - sizePosition);
+		state.resize(sizePosition + compressedSize);
+		std::vector<unsigned char> header;
+		PutVarint(header, compressedSize);
+		state.insert(state.begin() + sizePosition, header.begin(), header.end());
+		state.insert(state.end(), save.begin(), save.end());
+	}
+
+	bool LoadState(Simulation * sim, const unsigned char * data, size_t size, ByteString & error)
+	{
+		TRACE_ZONE("Replay LoadState");
+		Reader reader(data, size);
+		size_t extraSize = reader.Varint(), compressedSize = reader.Varint();
+		const unsigned char * compressed = reader.Raw(compressedSize);
+		// The sizes are checked before anything is allocated for them
+		if (!reader.ok || extraSize > 64 << 20)
+		{
+			error = "State is corrupt";
+			return false;
+		}
+		std::vector<unsigned char> extra(extraSize);
+		if (!LZ::Decompress(compressed, compressedSize, extra.data(), extraSize))
+		{
+			error = "State is corrupt";
+			return false;
+		}
+		Reader extraReader(extra.data(), extra.size());
+		int ngrav = 0;
+		extraReader.Read(ngrav);
+		if (!sim->grav->ngrav_enable != !ngrav)
+		{
+			if (ngrav)
+				sim->grav->start_grav_async();
+			else
+				sim->grav->stop_grav_async();
+		}
+		size_t saveSize = reader.Remaining();
+		if (!SaveFile::Deserialise(sim, reader.Raw(saveSize), saveSize, error))
+			return false;
+
+		int counters[12];
+		extraReader.Read(counters);
+		extraReader.Read(sim->elementCount);
+		RNG::State generators[2];
+		extraReader.Read(generators);
+		extraReader.Read(sim->gol);
+		extraReader.Read(sim->air->bmap_blockair);
+		extraReader.Read(sim->air->bmap_blockairh);
+		int freeCount = 0;
+		extraReader.Read(freeCount);
+		if (!extraReader.ok || freeCount < 0 || freeCount > NPART)
+		{
+			error = "State is corrupt";
+			return false;
+		}
+		sim->currentTick = counters[0];
+		sim->lightningRecreate = counters[1];
+		sim->emp_decor = counters[2];
+		sim->emp_trigger_count = counters[3];
+		sim->CGOL = counters[4];
+		sim->ISWIRE = counters[5];
+		sim->sandcolour = counters[6];
+		sim->sandcolour_frame = counters[7];
+		sim->force_stacking_check = counters[8];
+		sim->elementRecount = counters[9];
+		sim->parts_lastActiveIndex = counters[10];
+		sim->pfree = counters[11];
+		RNG::Ref().state(generators[0]);
+		random_gen.state(generators[1]);
+		int previous = 0, last = -1;
+		for (int i = 0; i < freeCount; i++)
+		{
+			int slot = previous + extraReader.Int();
+			if (slot < 0 || slot >= NPART || sim->parts[slot].type)
+			{
+				error = "State is corrupt";
+				return false;
+			}
+			if (last >= 0)
+				sim->parts[last].life = slot;
+			last = previous = slot;
+		}
+		if (last >= 0)
+			sim->parts[last].life = -1;
+		if (ngrav)
+		{
+			size_t solverSize = extraReader.Remaining();
+			if (!sim->grav->SetSolverState(extraReader.Raw(solverSize), solverSize))
+			{
+				error = "State is corrupt";
+				return false;
+			}
+		}
+		if (!extraReader.ok)
+		{
+			error = "State is corrupt";
+			return false;
+		}
+		return true;
+	}
+
+	bool ReadFile(ByteString path, std::vector<unsigned char> & data, ByteString & error)
+	{
+		FILE * file = fopen(path.c_str(), "rb");
+		if (!file)
+		{
+			error = "Can't open " + path;
+			return false;
+		}
+		unsigned char buffer[65536];
+		size_t count;
+		data.clear();
+		while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			data.insert(data.end(), buffer, buffer + count);
+		bool failed = ferror(file);
+		fclose(file);
+		if (failed)
+		{
+			error = "Can't read " + path;
+			return false;
+		}
+		return true;
+	}
+}
+
+namespace Replay
+{
+	uint64_t Hash(const Simulation * sim)
+	{
+		std::vector<StateHash::Section> sections = StateHash::Compute(sim);
+		uint64_t hash = UINT64_C(14695981039346656037);
+		for (size_t i = 0; i < sections.size(); i++)
+			hash = (hash ^ sections[i].hash) * UINT64_C(1099511628211);
+		return hash;
+	}
+}
+
+ReplayRecorder::ReplayRecorder(Simulation * sim_, unsigned int seed_):
+	sim(sim_),
+	seed(seed_),
+	frames(0),
+	pendingTicks(0),
+	brushRadiusX(-2),
+	brushRadiusY(-2)
+{
+	RNG::Ref().seed(seed);
+	random_gen.seed(seed + 1);
+	sim->grav->SetSynchronous(true);
+	State();
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+	sim->grav->SetSynchronous(false);
+}
+
+void ReplayRecorder::Flush()
+{
+	std::vector<int> currentSettings = GetSettings(sim);
+	bool settingsChanged = currentSettings != settings, signsChanged = !SameSigns(signs, sim->signs);
+	if ((settingsChanged || signsChanged) && pendingTicks)
+	{
+		data.push_back(OpTicks);
+		PutVarint(data, pendingTicks);
+		pendingTicks = 0;
+	}
+	if (settingsChanged)
+	{
+		data.push_back(OpSettings);
+		PutVarint(data, currentSettings.size());
+		for (size_t i = 0; i < currentSettings.size(); i++)
+			PutInt(data, currentSettings[i]);
+		settings = currentSettings;
+	}
+	if (signsChanged)
+	{
+		data.push_back(OpSigns);
+		PutVarint(data, sim->signs.size());
+		for (size_t i = 0; i < sim->signs.size(); i++)
+		{
+			ByteString text = sim->signs[i].text.ToUtf8();
+			PutInts(data, { sim->signs[i].x, sim->signs[i].y, sim->signs[i].ju });
+			PutVarint(data, text.size());
+			PutRaw(data, text.data(), text.size());
+		}
+		signs = sim->signs;
+	}
+}
+
+void ReplayRecorder::Op(int op)
+{
+	Flush();
+	if (pendingTicks)
+	{
+		data.push_back(OpTicks);
+		PutVarint(data, pendingTicks);
+		pendingTicks = 0;
+	}
+	data.push_back(op);
+}
+
+void ReplayRecorder::WriteBrush(Brush * brush)
+{
+	int radiusX = brush ? brush->GetRadius().X : -1, radiusY = brush ? brush->GetRadius().Y : -1;
+	std::vector<unsigned char> bitmap;
+	if (brush)
+	{
+		int size = brush->GetSize().X * brush->GetSize().Y;
+		unsigned char * pixels = brush->GetBitmap();
+		bitmap.resize((size + 7) / 8);
+		for (int i = 0; i < size; i++)
+			if (pixels[i])
+				bitmap[i / 8] |= 1 << (i % 8);
+	}
+	if (radiusX == brushRadiusX && radiusY == brushRadiusY && bitmap == brushBitmap)
+		return;
+	Op(OpBrush);
+	PutInts(data, { radiusX, radiusY });
+	PutRaw(data, bitmap.data(), bitmap.size());
+	brushRadiusX = radiusX;
+	brushRadiusY = radiusY;
+	brushBitmap = bitmap;
+}
+
+void ReplayRecorder::BeforeTick()
+{
+	Flush();
+	pendingTicks++;
+	frames++;
+}
+
+void ReplayRecorder::AfterTick()
+{
+	if (frames % Replay::HASH_INTERVAL)
+		return;
+	Op(OpHash);
+	uint64_t hash = Replay::Hash(sim);
+	PutRaw(data, &hash, sizeof(hash));
+}
+
+void ReplayRecorder::CreateParts(int x, int y, int c, Brush * brush, int flags)
+{
+	WriteBrush(brush);
+	Op(OpCreateParts);
+	PutInts(data, { x, y, c, flags });
+}
+
+void ReplayRecorder::CreateParts(int x, int y, int rx, int ry, int c, int flags)
+{
+	Op(OpCreatePartsRadius);
+	PutInts(data, { x, y, rx, ry, c, flags });
+}
+
+void ReplayRecorder::CreateLine(int x1, int y1, int x2, int y2, int c, Brush * brush, int flags)
+{
+	WriteBrush(brush);
+	Op(OpCreateLine);
+	PutInts(data, { x1, y1, x2, y2, c, flags });
+}
+
+void ReplayRecorder::CreateBox(int x1, int y1, int x2, int y2, int c, int flags)
+{
+	Op(OpCreateBox);
+	PutInts(data, { x1, y1, x2, y2, c, flags });
+}
+
+void ReplayRecorder::FloodParts(int x, int y, int c, int cm, int flags)
+{
+	Op(OpFloodParts);
+	PutInts(data, { x, y, c, cm, flags });
+}
+
+void ReplayRecorder::CreatePart(int p, int x, int y, int t, int v)
+{
+	Op(OpCreatePart);
+	PutInts(data, { p, x, y, t, v });
+}
+
+void ReplayRecorder::ToolBrush(int x, int y, int tool, Brush * brush, float strength)
+{
+	WriteBrush(brush);
+	Op(OpToolBrush);
+	PutInts(data, { x, y, tool });
+	PutFloat(data, strength);
+}
+
+void ReplayRecorder::ToolLine(int x1, int y1, int x2, int y2, int tool, Brush * brush, float strength)
+{
+	WriteBrush(brush);
+	Op(OpToolLine);
+	PutInts(data, { x1, y1, x2, y2, tool });
+	PutFloat(data, strength);
+}
+
+void ReplayRecorder::ToolBox(int x1, int y1, int x2, int y2, int tool, float strength)
+{
+	Op(OpToolBox);
+	PutInts(data, { x1, y1, x2, y2, tool });
+	PutFloat(data, strength);
+}
+
+void ReplayRecorder::CreateWalls(int x, int y, int rx, int ry, int wall, Brush * brush)
+{
+	WriteBrush(brush);
+	Op(OpCreateWalls);
+	PutInts(data, { x, y, rx, ry, wall });
+}
+
+void ReplayRecorder::CreateWallLine(int x1, int y1, int x2, int y2, int rx, int ry, int wall, Brush * brush)
+{
+	WriteBrush(brush);
+	Op(OpCreateWallLine);
+	PutInts(data, { x1, y1, x2, y2, rx, ry, wall });
+}
+
+void ReplayRecorder::CreateWallBox(int x1, int y1, int x2, int y2, int wall)
+{
+	Op(OpCreateWallBox);
+	PutInts(data, { x1, y1, x2, y2, wall });
+}
+
+void ReplayRecorder::FloodWalls(int x, int y, int wall, int bm)
+{
+	Op(OpFloodWalls);
+	PutInts(data, { x, y, wall, bm });
+}
+
+void ReplayRecorder::SetFanVelocity(int x, int y, float fvx, float fvy)
+{
+	Op(OpSetFanVelocity);
+	PutInts(data, { x, y });
+	PutFloat(data, fvx);
+	PutFloat(data, fvy);
+}
+
+void ReplayRecorder::ApplyWind(int x, int y, float vx, float vy, Brush * brush)
+{
+	WriteBrush(brush);
+	Op(OpApplyWind);
+	PutInts(data, { x, y });
+	PutFloat(data, vx);
+	PutFloat(data, vy);
+}
+
+void ReplayRecorder::ApplyDecorationPoint(int x, int y, int r, int g, int b, int a, int mode, Brush * brush)
+{
+	WriteBrush(brush);
+	Op(OpDecorationPoint);
+	PutInts(data, { x, y, r, g, b, a, mode });
+}
+
+void ReplayRecorder::ApplyDecorationLine(int x1, int y1, int x2, int y2, int r, int g, int b, int a, int mode, Brush * brush)
+{
+	WriteBrush(brush);
+	Op(OpDecorationLine);
+	PutInts(data, { x1, y1, x2, y2, r, g, b, a, mode });
+}
+
+void ReplayRecorder::ApplyDecorationBox(int x1, int y1, int x2, int y2, int r, int g, int b, int a, int mode)
+{
+	Op(OpDecorationBox);
+	PutInts(data, { x1, y1, x2, y2, r, g, b, a, mode });
+}
+
+void ReplayRecorder::SetProperty(int i, size_t offset, PropertyValue value, StructProperty::PropertyType type)
+{
+	Op(OpSetProperty);
+	PutInts(data, { i, (int)offset, type });
+	PutRaw(data, &value, 4);
+}
+
+void ReplayRecorder::FloodProperty(int x, int y, size_t offset, PropertyValue value, StructProperty::PropertyType type)
+{
+	Op(OpFloodProperty);
+	PutInts(data, { x, y, (int)offset, type });
+	PutRaw(data, &value, 4);
+}
+
+void ReplayRecorder::ClearSim()
+{
+	Op(OpClearSim);
+}
+
+void ReplayRecorder::State()
+{
+	Op(OpState);
+	std::vector<unsigned char> state;
+	CaptureState(sim, state);
+	PutVarint(data, state.size());
+	PutRaw(data, state.data(), state.size());
+	ByteString error;
+	LoadState(sim, state.data(), state.size(), error);
+	settings = GetSettings(sim);
+	signs = sim->signs;
+}
+
+bool ReplayRecorder::Save(ByteString path, ByteString & error)
+{
+	if (pendingTicks)
+	{
+		data.push_back(OpTicks);
+		PutVarint(data, pendingTicks);
+		pendingTicks = 0;
+	}
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = Replay::VERSION;
+	header.frameCount = frames;
+	header.seed = seed;
+	FILE * file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		error = "Can't write " + path;
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data.data(), 1, data.size(), file) == data.size();
+	if (fclose(file) || !written)
+	{
+		error = "Can't write " + path;
+		return false;
+	}
+	return true;
+}
+
+ReplayPlayer::ReplayPlayer(Simulation * sim_):
+	sim(sim_),
+	start(0),
+	position(0),
+	frame(0),
+	frameCount(0),
+	pendingTicks(0),
+	desyncFrame(-1),
+	keyframeInterval(0),
+	brushRadiusX(-1),
+	brushRadiusY(-1),
+	brush(NULL)
+{
+	sim->grav->SetSynchronous(true);
+	sim->replayPlayer = this;
+}
+
+ReplayPlayer::~ReplayPlayer()
+{
+	delete brush;
+	sim->grav->SetSynchronous(false);
+	if (sim->replayPlayer == this)
+		sim->replayPlayer = NULL;
+}
+
+bool ReplayPlayer::Load(ByteString path, ByteString & error)
+{
+	std::vector<unsigned char> file;
+	if (!ReadFile(path, file, error))
+		return false;
+	return Load(file.data(), file.size(), error);
+}
+
+bool ReplayPlayer::Load(const unsigned char * newData, size_t size, ByteString & error)
+{
+	Header header;
+	if (size < sizeof(header))
+	{
+		error = "Not a replay";
+		return false;
+	}
+	memcpy(&header, newData, sizeof(header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)))
+	{
+		error = "Not a replay";
+		return false;
+	}
+	if (header.version != Replay::VERSION)
+	{
+		error = ByteString::Build("Replay version ", header.version, " is not supported");
+		return false;
+	}
+	data.assign(newData + sizeof(header), newData + size);
+	frameCount = header.frameCount;
+	keyframes.clear();
+	desyncFrame = -1;
+	Rewind();
+	// The state the recording starts from is always kept, so that seeking back never plays ops over
+	// whatever the simulation happens to be at
+	while (!pendingTicks && position < data.size())
+		if (!ApplyOp(error))
+			return false;
+	AddKeyframe();
+	return true;
+}
+
+void ReplayPlayer::Rewind()
+{
+	position = 0;
+	frame = 0;
+	pendingTicks = 0;
+	SetBrush(-1, -1, std::vector<unsigned char>());
+}
+
+void ReplayPlayer::SetBrush(int radiusX, int radiusY, const std::vector<unsigned char> & bitmap)
+{
+	brushRadiusX = radiusX;
+	brushRadiusY = radiusY;
+	brushBitmap = bitmap;
+	delete brush;
+	brush = NULL;
+	if (radiusX < 0 || radiusY < 0)
+		return;
+	int size = (radiusX*2+1) * (radiusY*2+1);
+	std::vector<unsigned char> shape(size);
+	for (int i = 0; i < size && i / 8 < (int)bitmap.size(); i++)
+		shape[i] = (bitmap[i / 8] >> (i % 8)) & 1 ? 255 : 0;
+	brush = new ReplayBrush(ui::Point(radiusX, radiusY), shape);
+}
+
+bool ReplayPlayer::ApplyOp(ByteString & error)
+{
+	Reader reader(&data[position], data.size() - position);
+	int op = *reader.Raw(1);
+	switch (op)
+	{
+	case OpTicks:
+		pendingTicks = reader.Varint();
+		break;
+	case OpState:
+	{
+		size_t size = reader.Varint();
+		const unsigned char * state = reader.Raw(size);
+		if (reader.ok && !LoadState(sim, state, size, error))
+			return false;
+		break;
+	}
+	case OpSettings:
+	{
+		std::vector<int> settings = GetSettings(sim);
+		size_t count = reader.Varint();
+		for (size_t i = 0; i < count && reader.ok; i++)
+		{
+			int value = reader.Int();
+			if (i < settings.size())
+				settings[i] = value;
+		}
+		if (reader.ok)
+			SetSettings(sim, settings);
+		break;
+	}
+	case OpSigns:
+	{
+		size_t count = reader.Varint();
+		std::vector<sign> signs;
+		for (size_t i = 0; i < count && reader.ok; i++)
+		{
+			int x = reader.Int(), y = reader.Int(), justification = reader.Int();
+			size_t length = reader.Varint();
+			const unsigned char * text = reader.Raw(length);
+			if (reader.ok)
+				signs.push_back(sign(ByteString((const char *)text, length).FromUtf8(), x, y, (sign::Justification)justification));
+		}
+		if (reader.ok)
+			sim->signs = signs;
+		break;
+	}
+	case OpHash:
+	{
+		uint64_t hash = 0;
+		reader.Read(hash);
+		if (reader.ok && desyncFrame < 0 && hash != Replay::Hash(sim))
+			desyncFrame = frame;
+		break;
+	}
+	case OpBrush:
+	{
+		int radiusX = reader.Int(), radiusY = reader.Int();
+		std::vector<unsigned char> bitmap;
+		if (radiusX >= 0 && radiusY >= 0 && radiusX < XRES && radiusY < YRES)
+		{
+			size_t size = (radiusX*2+1) * (radiusY*2+1);
+			const unsigned char * bytes = reader.Raw((size + 7) / 8);
+			if (bytes)
+				bitmap.assign(bytes, bytes + (size + 7) / 8);
+		}
+		if (reader.ok)
+			SetBrush(radiusX, radiusY, bitmap);
+		break;
+	}
+	case OpCreateParts:
+	{
+		int x = reader.Int(), y = reader.Int(), c = reader.Int(), flags = reader.Int();
+		if (reader.ok && brush)
+			sim->CreateParts(x, y, c, brush, flags);
+		break;
+	}
+	case OpCreatePartsRadius:
+	{
+		int x = reader.Int(), y = reader.Int(), rx = reader.Int(), ry = reader.Int(), c = reader.Int(), flags = reader.Int();
+		if (reader.ok)
+			sim->CreateParts(x, y, rx, ry, c, flags);
+		break;
+	}
+	case OpCreateLine:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int(), c = reader.Int(), flags = reader.Int();
+		if (reader.ok && brush)
+			sim->CreateLine(x1, y1, x2, y2, c, brush, flags);
+		break;
+	}
+	case OpCreateBox:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int(), c = reader.Int(), flags = reader.Int();
+		if (reader.ok)
+			sim->CreateBox(x1, y1, x2, y2, c, flags);
+		break;
+	}
+	case OpFloodParts:
+	{
+		int x = reader.Int(), y = reader.Int(), c = reader.Int(), cm = reader.Int(), flags = reader.Int();
+		if (reader.ok)
+			sim->FloodParts(x, y, c, cm, flags);
+		break;
+	}
+	case OpCreatePart:
+	{
+		int p = reader.Int(), x = reader.Int(), y = reader.Int(), t = reader.Int(), v = reader.Int();
+		// -1 and -2 ask create_part to find a slot, anything else is written to directly
+		if (reader.ok && p >= -2 && p < NPART)
+			sim->create_part(p, x, y, t, v);
+		break;
+	}
+	case OpToolBrush:
+	{
+		int x = reader.Int(), y = reader.Int(), tool = reader.Int();
+		float strength = reader.Float();
+		if (reader.ok && brush)
+			sim->ToolBrush(x, y, tool, brush, strength);
+		break;
+	}
+	case OpToolLine:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int(), tool = reader.Int();
+		float strength = reader.Float();
+		if (reader.ok && brush)
+			sim->ToolLine(x1, y1, x2, y2, tool, brush, strength);
+		break;
+	}
+	case OpToolBox:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int(), tool = reader.Int();
+		float strength = reader.Float();
+		if (reader.ok)
+			sim->ToolBox(x1, y1, x2, y2, tool, strength);
+		break;
+	}
+	case OpCreateWalls:
+	{
+		int x = reader.Int(), y = reader.Int(), rx = reader.Int(), ry = reader.Int(), wall = reader.Int();
+		if (reader.ok)
+			sim->CreateWalls(x, y, rx, ry, wall, brush);
+		break;
+	}
+	case OpCreateWallLine:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int(), rx = reader.Int(), ry = reader.Int(), wall = reader.Int();
+		if (reader.ok)
+			sim->CreateWallLine(x1, y1, x2, y2, rx, ry, wall, brush);
+		break;
+	}
+	case OpCreateWallBox:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int(), wall = reader.Int();
+		if (reader.ok)
+			sim->CreateWallBox(x1, y1, x2, y2, wall);
+		break;
+	}
+	case OpFloodWalls:
+	{
+		int x = reader.Int(), y = reader.Int(), wall = reader.Int(), bm = reader.Int();
+		if (reader.ok)
+			sim->FloodWalls(x, y, wall, bm);
+		break;
+	}
+	case OpSetFanVelocity:
+	{
+		int x = reader.Int(), y = reader.Int();
+		float fvx = reader.Float(), fvy = reader.Float();
+		if (reader.ok)
+			sim->SetFanVelocity(x, y, fvx, fvy);
+		break;
+	}
+	case OpApplyWind:
+	{
+		int x = reader.Int(), y = reader.Int();
+		float vx = reader.Float(), vy = reader.Float();
+		if (reader.ok && brush)
+			sim->ApplyWind(x, y, vx, vy, brush);
+		break;
+	}
+	case OpDecorationPoint:
+	{
+		int x = reader.Int(), y = reader.Int(), r = reader.Int(), g = reader.Int(), b = reader.Int(), a = reader.Int(), mode = reader.Int();
+		if (reader.ok)
+			sim->ApplyDecorationPoint(x, y, r, g, b, a, mode, brush);
+		break;
+	}
+	case OpDecorationLine:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int();
+		int r = reader.Int(), g = reader.Int(), b = reader.Int(), a = reader.Int(), mode = reader.Int();
+		if (reader.ok)
+			sim->ApplyDecorationLine(x1, y1, x2, y2, r, g, b, a, mode, brush);
+		break;
+	}
+	case OpDecorationBox:
+	{
+		int x1 = reader.Int(), y1 = reader.Int(), x2 = reader.Int(), y2 = reader.Int();
+		int r = reader.Int(), g = reader.Int(), b = reader.Int(), a = reader.Int(), mode = reader.Int();
+		if (reader.ok)
+			sim->ApplyDecorationBox(x1, y1, x2, y2, r, g, b, a, mode);
+		break;
+	}
+	case OpSetProperty:
+	{
+		int i = reader.Int(), offset = reader.Int(), type = reader.Int();
+		PropertyValue value = {};
+		reader.Read(value);
+		if (!reader.ok || i < 0 || i >= NPART || offset < 0 || offset + 4 > (int)sizeof(Particle))
+			break;
+		void * field = ((char*)&sim->parts[i]) + offset;
+		switch (type)
+		{
+			case StructProperty::Float:
+				*((float*)field) = value.Float;
+				break;
+			case StructProperty::ParticleType:
+			case StructProperty::Integer:
+				*((int*)field) = value.Integer;
+				break;
+			case StructProperty::UInteger:
+				*((unsigned int*)field) = value.UInteger;
+				break;
+			default:
+				break;
+		}
+		break;
+	}
+	case OpFloodProperty:
+	{
+		int x = reader.Int(), y = reader.Int(), offset = reader.Int(), type = reader.Int();
+		PropertyValue value = {};
+		reader.Read(value);
+		if (reader.ok && x >= 0 && y >= 0 && x < XRES && y < YRES && offset >= 0 && offset + 4 <= (int)sizeof(Particle))
+			sim->flood_prop(x, y, offset, value, (StructProperty::PropertyType)type);
+		break;
+	}
+	case OpClearSim:
+		sim->clear_sim();
+		break;
+	default:
+		error = ByteString::Build("Unknown op ", op, " at frame ", frame);
+		return false;
+	}
+	if (!reader.ok)
+	{
+		error = ByteString::Build("Replay is truncated at frame ", frame);
+		return false;
+	}
+	// Some ops write particles directly rather than going through the simulation's edit functions
+	sim->Changed();
+	position = data.size() - reader.Remaining();
+	return true;
+}
+
+bool ReplayPlayer::Step(ByteString & error)
+{
+	error = "";
+	while (!pendingTicks)
+	{
+		if (position >= data.size())
+			return false;
+		if (!ApplyOp(error))
+			return false;
+	}
+	// Right before a tick is the only place where the state doesn't depend on how it was reached, the
+	// tick starts by rebuilding pmap
+	if (keyframeInterval && frame % keyframeInterval == 0 && frame && keyframes.back().frame < frame)
+		AddKeyframe();
+	pendingTicks--;
+	sim->TickSerial();
+	frame++;
+	// Check the hash that belongs to this frame now rather than at the start of the next one
+	while (!pendingTicks && position < data.size() && data[position] == OpHash)
+		if (!ApplyOp(error))
+			return false;
+	return true;
+}
+
+void ReplayPlayer::AddKeyframe()
+{
+	Keyframe keyframe;
+	keyframe.frame = frame;
+	keyframe.position = position;
+	keyframe.pendingTicks = pendingTicks;
+	keyframe.brushRadiusX = brushRadiusX;
+	keyframe.brushRadiusY = brushRadiusY;
+	keyframe.brushBitmap = brushBitmap;
+	CaptureState(sim, keyframe.state);
+	// The state leaves out settings that only the replay records, like the pause
+	keyframe.settings = GetSettings(sim);
+	keyframes.push_back(keyframe);
+}
+
+bool ReplayPlayer::Seek(int targetFrame, ByteString & error)
+{
+	if (targetFrame < 0 || targetFrame > frameCount)
+	{
+		error = ByteString::Build("Frame ", targetFrame, " is outside of the replay, which has ", frameCount, " frames");
+		return false;
+	}
+	if (keyframes.empty())
+	{
+		error = "No replay is loaded";
+		return false;
+	}
+	// There is always one at frame 0
+	const Keyframe * closest = &keyframes[0];
+	for (size_t i = 1; i < keyframes.size(); i++)
+		if (keyframes[i].frame <= targetFrame && keyframes[i].frame > closest->frame)
+			closest = &keyframes[i];
+	if (targetFrame < frame || closest->frame > frame)
+	{
+		if (!LoadState(sim, closest->state.data(), closest->state.size(), error))
+			return false;
+		position = closest->position;
+		frame = closest->frame;
+		pendingTicks = closest->pendingTicks;
+		SetSettings(sim, closest->settings);
+		SetBrush(closest->brushRadiusX, closest->brushRadiusY, closest->brushBitmap);
+	}
+	while (frame < targetFrame)
+	{
+		if (!Step(error))
+		{
+			if (!error.length())
+				error = ByteString::Build("Replay ended at frame ", frame);
+			return false;
+		}
+	}
+	return true;
+}
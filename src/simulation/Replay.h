@@ -0,0 +1,149 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "common/String.h"
+#include "Sign.h"
+#include "StructProperty.h"
+
+class Brush;
+class ReplayBrush;
+class Simulation;
+
+// Input replays: the state of the simulation when recording started followed by every edit made to it and
+// the ticks in between, so that a session can be run again exactly, without the game and as fast as the
+// simulation goes. Ticks have to be TickSerial and gravity has to be synchronous for this to work, the
+// recorder switches gravity over and leaves running the ticks to its owner.
+//
+// The stream is a list of ops, each one byte followed by its arguments as zigzag varints, floats as their
+// four raw bytes. Edits that can't be described as an op, like undo or a decoration fill that depends on
+// what is on screen, are recorded as a whole new state instead. A hash of the state is added every
+// HASH_INTERVAL ticks so that playback can tell exactly where it stopped matching the recording.
+namespace Replay
+{
+	const uint32_t VERSION = 1;
+	const int HASH_INTERVAL = 60;
+
+	// Folds StateHash::Compute into a single value
+	uint64_t Hash(const Simulation * sim);
+}
+
+class ReplayRecorder
+{
+	Simulation * sim;
+	unsigned int seed;
+	std::vector<unsigned char> data;
+	int frames;
+	int pendingTicks;
+	// Options and stickman controls are set from outside the simulation without going through an op,
+	// they and the signs are compared with what was last written before every op and tick
+	std::vector<int> settings;
+	std::vector<sign> signs;
+	std::vector<unsigned char> brushBitmap;
+	int brushRadiusX, brushRadiusY;
+
+	void Flush();
+	void Op(int op);
+	void WriteBrush(Brush * brush);
+
+public:
+	// Starts recording from the current state, seeds the random number generators with seed and makes
+	// gravity synchronous until the recorder is deleted
+	ReplayRecorder(Simulation * sim, unsigned int seed);
+	~ReplayRecorder();
+
+	// Around every TickSerial, including the ones that run while paused
+	void BeforeTick();
+	void AfterTick();
+	int GetFrameCount() { return frames; }
+	size_t GetSize() { return data.size(); }
+
+	// Each of these must be called right before the simulation method of the same name
+	void CreateParts(int x, int y, int c, Brush * brush, int flags);
+	void CreateParts(int x, int y, int rx, int ry, int c, int flags);
+	void CreateLine(int x1, int y1, int x2, int y2, int c, Brush * brush, int flags);
+	void CreateBox(int x1, int y1, int x2, int y2, int c, int flags);
+	void FloodParts(int x, int y, int c, int cm, int flags);
+	void CreatePart(int p, int x, int y, int t, int v);
+	void ToolBrush(int x, int y, int tool, Brush * brush, float strength);
+	void ToolLine(int x1, int y1, int x2, int y2, int tool, Brush * brush, float strength);
+	void ToolBox(int x1, int y1, int x2, int y2, int tool, float strength);
+	void CreateWalls(int x, int y, int rx, int ry, int wall, Brush * brush);
+	void CreateWallLine(int x1, int y1, int x2, int y2, int rx, int ry, int wall, Brush * brush);
+	void CreateWallBox(int x1, int y1, int x2, int y2, int wall);
+	void FloodWalls(int x, int y, int wall, int bm);
+	void SetFanVelocity(int x, int y, float fvx, float fvy);
+	void ApplyWind(int x, int y, float vx, float vy, Brush * brush);
+	void ApplyDecorationPoint(int x, int y, int r, int g, int b, int a, int mode, Brush * brush);
+	void ApplyDecorationLine(int x1, int y1, int x2, int y2, int r, int g, int b, int a, int mode, Brush * brush);
+	void ApplyDecorationBox(int x1, int y1, int x2, int y2, int r, int g, int b, int a, int mode);
+	// Right before a single particle property is written by the property tool
+	void SetProperty(int i, size_t offset, PropertyValue value, StructProperty::PropertyType type);
+	void FloodProperty(int x, int y, size_t offset, PropertyValue value, StructProperty::PropertyType type);
+	void ClearSim();
+
+	// Records the whole current state, must be called after any change that doesn't have an op. The state
+	// is also loaded back into the simulation so that the game continues from exactly what playback sees.
+	void State();
+
+	bool Save(ByteString path, ByteString & error);
+};
+
+class ReplayPlayer
+{
+	// Everything needed to continue from a frame, taken right before the frame's tick
+	struct Keyframe
+	{
+		int frame;
+		size_t position;
+		int pendingTicks;
+		int brushRadiusX, brushRadiusY;
+		std::vector<unsigned char> brushBitmap;
+		std::vector<unsigned char> state;
+		std::vector<int> settings;
+	};
+
+	Simulation * sim;
+	std::vector<unsigned char> data;
+	size_t start;
+	size_t position;
+	int frame;
+	int frameCount;
+	int pendingTicks;
+	int desyncFrame;
+	int keyframeInterval;
+	std::vector<Keyframe> keyframes;
+	int brushRadiusX, brushRadiusY;
+	std::vector<unsigned char> brushBitmap;
+	ReplayBrush * brush;
+
+	bool ApplyOp(ByteString & error);
+	void SetBrush(int radiusX, int radiusY, const std::vector<unsigned char> & bitmap);
+	void Rewind();
+	void AddKeyframe();
+
+public:
+	// Makes gravity synchronous for as long as the player exists
+	ReplayPlayer(Simulation * sim);
+	~ReplayPlayer();
+
+	bool Load(ByteString path, ByteString & error);
+	bool Load(const unsigned char * newData, size_t size, ByteString & error);
+	// Playing keeps the state every interval frames, so that seeking back doesn't have to start over from
+	// the beginning. 0 turns this off.
+	void SetKeyframeInterval(int interval) { keyframeInterval = interval; }
+
+	// Runs the next frame. Returns false at the end of the replay, with error left empty, or if it is corrupt.
+	bool Step(ByteString & error);
+	// Moves to right before the given frame, going back to the closest keyframe first if needed
+	bool Seek(int targetFrame, ByteString & error);
+
+	int GetFrame() { return frame; }
+	int GetFrameCount() { return frameCount; }
+	// First frame after which the state didn't match the hash in the recording, -1 if it always did
+	int GetDesyncFrame() { return desyncFrame; }
+};
+
+#endif
@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#ifndef WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "SaveFile.h"
+#include "Air.h"
+#include "Gravity.h"
+#include "Simulation.h"
+#include "common/tpt-lz.h"
+#include "common/tpt-trace.h"
+
+namespace
+{
+	const char MAGIC[4] = { 'M', 'T', 'P', 'S' };
+	const uint32_t CHUNK_COMPRESSED = 1;
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t xres, yres, cell;
+		uint32_t particleSize;
+		uint32_t chunkCount;
+		uint32_t reserved;
+	};
+
+	struct ChunkHeader
+	{
+		char id[4];
+		uint32_t flags;
+		uint64_t size; // uncompressed
+		uint64_t storedSize;
+	};
+
+	// Chunks with a fixed size that are stored exactly as they are in memory
+	struct Block
+	{
+		const char * id;
+		void * data;
+		size_t size;
+		bool gravity;
+	};
+
+	std::vector<Block> Blocks(Simulation * sim)
+	{
+		const size_t cells = (XRES/CELL)*(YRES/CELL);
+		Block blocks[] = {
+			{ "AIRP", sim->air->pv, sizeof(sim->air->pv), false },
+			{ "AIRX", sim->air->vx, sizeof(sim->air->vx), false },
+			{ "AIRY", sim->air->vy, sizeof(sim->air->vy), false },
+			{ "AIRH", sim->air->hv, sizeof(sim->air->hv), false },
+			{ "GMAP", sim->grav->gravmap, cells*sizeof(float), true },
+			{ "GRVX", sim->grav->gravx, cells*sizeof(float), true },
+			{ "GRVY", sim->grav->gravy, cells*sizeof(float), true },
+			{ "GRVP", sim->grav->gravp, cells*sizeof(float), true },
+			{ "BMAP", sim->bmap, sizeof(sim->bmap), false },
+			{ "EMAP", sim->emap, sizeof(sim->emap), false },
+			{ "FANX", sim->fvx, sizeof(sim->fvx), false },
+			{ "FANY", sim->fvy, sizeof(sim->fvy), false },
+			{ "PRTL", sim->portalp, sizeof(sim->portalp), false },
+			{ "WIFI", sim->wireless, sizeof(sim->wireless), false },
+			{ "STK1", &sim->player, sizeof(sim->player), false },
+			{ "STK2", &sim->player2, sizeof(sim->player2), false },
+			{ "FIGH", sim->fighters, sizeof(sim->fighters), false },
+		};
+		return std::vector<Block>(blocks, blocks + sizeof(blocks)/sizeof(blocks[0]));
+	}
+
+	// Settings, stored as a list of 32 bit values. New ones only ever go at the end.
+	enum Setting
+	{
+		SettingEdgeMode = 0,
+		SettingGravityMode,
+		SettingAirMode,
+		SettingAmbientAirTemp,
+		SettingAmbientHeat,
+		SettingWaterEqualisation,
+		SettingPrettyPowder,
+		SettingFighterCount,
+		SettingCount
+	};
+
+	void AppendChunk(std::vector<unsigned char> & data, const char * id, const void * source, size_t size)
+	{
+		size_t start = data.size();
+		data.resize(start + sizeof(ChunkHeader) + LZ::Bound(size));
+		ChunkHeader header;
+		memcpy(header.id, id, 4);
+		header.size = size;
+		unsigned char * payload = &data[start + sizeof(ChunkHeader)];
+		size_t compressed = LZ::Compress((const unsigned char *)source, size, payload, LZ::Bound(size));
+		if (compressed && compressed < size)
+		{
+			header.flags = CHUNK_COMPRESSED;
+			header.storedSize = compressed;
+		}
+		else
+		{
+			header.flags = 0;
+			header.storedSize = size;
+			if (size)
+				memcpy(payload, source, size);
+		}
+		memcpy(&data[start], &header, sizeof(header));
+		// Keep every chunk header aligned
+		data.resize(start + sizeof(ChunkHeader) + ((header.storedSize + 7) & ~(uint64_t)7), 0);
+	}
+
+	bool ReadChunk(const ChunkHeader & header, const unsigned char * payload, void * destination)
+	{
+		if (header.flags & CHUNK_COMPRESSED)
+			return LZ::Decompress(payload, header.storedSize, (unsigned char *)destination, header.size);
+		if (header.storedSize != header.size)
+			return false;
+		memcpy(destination, payload, header.size);
+		return true;
+	}
+
+	void AppendInt(std::vector<unsigned char> & data, uint32_t value)
+	{
+		unsigned char bytes[4];
+		memcpy(bytes, &value, 4);
+		data.insert(data.end(), bytes, bytes + 4);
+	}
+
+	bool ReadInt(const std::vector<unsigned char> & data, size_t & position, uint32_t & value)
+	{
+		if (data.size() - position < 4)
+			return false;
+		memcpy(&value, &data[position], 4);
+		position += 4;
+		return true;
+	}
+
+	std::vector<unsigned char> SerialiseSigns(const Simulation * sim)
+	{
+		std::vector<unsigned char> data;
+		AppendInt(data, sim->signs.size());
+		for (size_t i = 0; i < sim->signs.size(); i++)
+		{
+			ByteString text = sim->signs[i].text.ToUtf8();
+			AppendInt(data, sim->signs[i].x);
+			AppendInt(data, sim->signs[i].y);
+			AppendInt(data, sim->signs[i].ju);
+			AppendInt(data, text.size());
+			data.insert(data.end(), text.begin(), text.end());
+		}
+		return data;
+	}
+
+	bool DeserialiseSigns(Simulation * sim, const std::vector<unsigned char> & data)
+	{
+		size_t position = 0;
+		uint32_t count;
+		if (!ReadInt(data, position, count))
+			return false;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t x, y, justification, length;
+			if (!ReadInt(data, position, x) || !ReadInt(data, position, y) || !ReadInt(data, position, justification) || !ReadInt(data, position, length))
+				return false;
+			if (data.size() - position < length || justification > sign::None)
+				return false;
+			ByteString text((const char *)&data[position], length);
+			position += length;
+			if (sim->signs.size() < MAXSIGNS)
+				sim->signs.push_back(sign(text.FromUtf8(), (int)x, (int)y, (sign::Justification)justification));
+		}
+		return true;
+	}
+
+	bool Fail(Simulation * sim, ByteString & error, ByteString message)
+	{
+		sim->clear_sim();
+		error = message;
+		return false;
+	}
+}
+
+namespace SaveFile
+{
+	void Serialise(const Simulation * sim, std::vector<unsigned char> & data)
+	{
+		TRACE_ZONE("SaveFile::Serialise");
+		// Nothing is written through this, Blocks is shared with loading
+		Simulation * source = const_cast<Simulation *>(sim);
+		std::vector<Block> blocks = Blocks(source);
+
+		int particleCount = sim->parts_lastActiveIndex + 1;
+		std::vector<unsigned char> signs = SerialiseSigns(sim);
+		size_t bound = sizeof(Header) + 3*sizeof(ChunkHeader) + LZ::Bound(particleCount * sizeof(Particle)) + LZ::Bound(signs.size()) + LZ::Bound(SettingCount*4) + 24;
+		for (size_t i = 0; i < blocks.size(); i++)
+			bound += sizeof(ChunkHeader) + LZ::Bound(blocks[i].size) + 8;
+		data.clear();
+		data.reserve(bound);
+		data.resize(sizeof(Header));
+
+		AppendChunk(data, "PART", sim->parts, particleCount * sizeof(Particle));
+		for (size_t i = 0; i < blocks.size(); i++)
+			AppendChunk(data, blocks[i].id, blocks[i].data, blocks[i].size);
+
+		AppendChunk(data, "SIGN", signs.data(), signs.size());
+
+		uint32_t settings[SettingCount];
+		settings[SettingEdgeMode] = sim->edgeMode;
+		settings[SettingGravityMode] = sim->gravityMode;
+		settings[SettingAirMode] = sim->air->airMode;
+		memcpy(&settings[SettingAmbientAirTemp], &sim->air->ambientAirTemp, 4);
+		settings[SettingAmbientHeat] = sim->aheat_enable;
+		settings[SettingWaterEqualisation] = sim->water_equal_test;
+		settings[SettingPrettyPowder] = sim->pretty_powder;
+		settings[SettingFighterCount] = sim->fighcount;
+		AppendChunk(data, "OPTS", settings, sizeof(settings));
+
+		Header header;
+		memcpy(header.magic, MAGIC, 4);
+		header.version = VERSION;
+		header.xres = XRES;
+		header.yres = YRES;
+		header.cell = CELL;
+		header.particleSize = sizeof(Particle);
+		header.chunkCount = blocks.size() + 3;
+		header.reserved = 0;
+		memcpy(&data[0], &header, sizeof(header));
+	}
+
+	bool Deserialise(Simulation * sim, const unsigned char * data, size_t size, ByteString & error)
+	{
+		TRACE_ZONE("SaveFile::Deserialise");
+		sim->Changed();
+		Header header;
+		if (size < sizeof(Header))
+		{
+			error = "File is too short";
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.magic, MAGIC, 4))
+		{
+			error = "Not a save file";
+			return false;
+		}
+		if (header.version > VERSION)
+		{
+			error = ByteString::Build("Save is from a newer version (", header.version, ")");
+			return false;
+		}
+		if (header.xres != XRES || header.yres != YRES || header.cell != CELL || header.particleSize != sizeof(Particle))
+		{
+			error = "Save was made with a different simulation size";
+			return false;
+		}
+
+		// Check every chunk before anything is overwritten, so that a truncated file leaves the simulation alone
+		std::vector<Block> blocks = Blocks(sim);
+		std::vector<size_t> offsets;
+		size_t position = sizeof(Header);
+		for (uint32_t i = 0; i < header.chunkCount; i++)
+		{
+			ChunkHeader chunk;
+			if (size - position < sizeof(ChunkHeader))
+			{
+				error = "File is truncated";
+				return false;
+			}
+			memcpy(&chunk, data + position, sizeof(chunk));
+			uint64_t padded = (chunk.storedSize + 7) & ~(uint64_t)7;
+			if (chunk.storedSize > size || padded > size - position - sizeof(ChunkHeader))
+			{
+				error = "File is truncated";
+				return false;
+			}
+			if ((chunk.flags & CHUNK_COMPRESSED) ? chunk.size > chunk.storedSize*255 + 64 : chunk.size != chunk.storedSize)
+			{
+				error = ByteString("Chunk ") + ByteString(chunk.id, 4) + " is corrupt";
+				return false;
+			}
+			if (!memcmp(chunk.id, "PART", 4) && (chunk.size % sizeof(Particle) || chunk.size > sizeof(Particle)*NPART))
+			{
+				error = "Too many particles";
+				return false;
+			}
+			for (size_t b = 0; b < blocks.size(); b++)
+				if (!memcmp(chunk.id, blocks[b].id, 4) && chunk.size != blocks[b].size)
+				{
+					error = ByteString("Chunk ") + ByteString(chunk.id, 4) + " has the wrong size";
+					return false;
+				}
+			offsets.push_back(position);
+			position += sizeof(ChunkHeader) + padded;
+		}
+
+		sim->clear_sim();
+		uint32_t settings[SettingCount] = { 0 };
+		bool hasSettings = false;
+		int particleCount = 0;
+		for (size_t i = 0; i < offsets.size(); i++)
+		{
+			ChunkHeader chunk;
+			memcpy(&chunk, data + offsets[i], sizeof(chunk));
+			const unsigned char * payload = data + offsets[i] + sizeof(ChunkHeader);
+			ByteString id(chunk.id, 4);
+			bool ok = true;
+			if (id == "PART")
+			{
+				particleCount = chunk.size / sizeof(Particle);
+				ok = ReadChunk(chunk, payload, sim->parts);
+			}
+			else if (id == "SIGN")
+			{
+				std::vector<unsigned char> signs(chunk.size);
+				ok = ReadChunk(chunk, payload, signs.data()) && DeserialiseSigns(sim, signs);
+			}
+			else if (id == "OPTS")
+			{
+				// Older files have fewer settings, newer ones more
+				std::vector<uint32_t> values((chunk.size + 3) / 4);
+				ok = ReadChunk(chunk, payload, values.data());
+				std::copy(values.begin(), values.begin() + std::min<size_t>(values.size(), SettingCount), settings);
+				hasSettings = true;
+			}
+			else
+			{
+				// Like snapshots, the gravity maps are only restored while Newtonian gravity is running
+				for (size_t b = 0; b < blocks.size(); b++)
+					if (id == blocks[b].id && (!blocks[b].gravity || sim->grav->ngrav_enable))
+						ok = ReadChunk(chunk, payload, blocks[b].data);
+			}
+			if (!ok)
+				return Fail(sim, error, "Chunk " + id + " is corrupt");
+		}
+
+		for (int i = 0; i < particleCount; i++)
+		{
+			int type = sim->parts[i].type;
+			if (type < 0 || type >= PT_NUM || !sim->elements[type].Enabled)
+				sim->parts[i].type = 0;
+		}
+		for (int i = particleCount; i < NPART; i++)
+			sim->parts[i].type = 0;
+		sim->parts_lastActiveIndex = NPART-1;
+		sim->elementRecount = true;
+		sim->force_stacking_check = true;
+		sim->gravWallChanged = true;
+		sim->RecalcFreeParticles(false);
+
+		if (hasSettings)
+		{
+			// edgeMode is only assigned, the edge walls were saved with the rest of the walls
+			sim->edgeMode = settings[SettingEdgeMode];
+			sim->gravityMode = settings[SettingGravityMode];
+			sim->air->airMode = settings[SettingAirMode];
+			memcpy(&sim->air->ambientAirTemp, &settings[SettingAmbientAirTemp], 4);
+			sim->aheat_enable = settings[SettingAmbientHeat];
+			sim->water_equal_test = settings[SettingWaterEqualisation];
+			sim->pretty_powder = settings[SettingPrettyPowder];
+			sim->fighcount = settings[SettingFighterCount];
+		}
+		return true;
+	}
+
+	bool Save(const Simulation * sim, ByteString path, ByteString & error)
+	{
+		std::vector<unsigned char> data;
+		Serialise(sim, data);
+
+		TRACE_ZONE("SaveFile::Save");
+		// Written next to the destination first, so that a failed save never replaces a good one
+		ByteString temporary = path + ".tmp";
+		FILE * file = fopen(temporary.c_str(), "wb");
+		if (!file)
+		{
+			error = "Could not open " + temporary;
+			return false;
+		}
+		bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+		if (fclose(file) || !written)
+		{
+			remove(temporary.c_str());
+			error = "Could not write " + temporary;
+			return false;
+		}
+#ifdef WIN
+		remove(path.c_str());
+#endif
+		if (rename(temporary.c_str(), path.c_str()))
+		{
+			remove(temporary.c_str());
+			error = "Could not replace " + path;
+			return false;
+		}
+		return true;
+	}
+
+	bool Load(Simulation * sim, ByteString path, ByteString & error)
+	{
+		TRACE_ZONE("SaveFile::Load");
+#ifdef WIN
+		FILE * file = fopen(path.c_str(), "rb");
+		if (!file)
+		{
+			error = "Could not open " + path;
+			return false;
+		}
+		std::vector<unsigned char> data;
+		unsigned char buffer[65536];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			data.insert(data.end(), buffer, buffer + read);
+		fclose(file);
+		return Deserialise(sim, data.data(), data.size(), error);
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			error = "Could not open " + path;
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) || info.st_size <= 0)
+		{
+			close(fd);
+			error = "Could not read " + path;
+			return false;
+		}
+		size_t size = info.st_size;
+		void * mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED)
+		{
+			error = "Could not map " + path;
+			return false;
+		}
+		// The whole file is read front to back exactly once
+		madvise(mapping, size, MADV_SEQUENTIAL);
+		bool loaded = Deserialise(sim, (const unsigned char *)mapping, size, error);
+		munmap(mapping, size);
+		return loaded;
+#endif
+	}
+}
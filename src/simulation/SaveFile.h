@@ -0,0 +1,26 @@
+#ifndef SAVEFILE_H
+#define SAVEFILE_H
+
+#include <cstdint>
+#include <vector>
+#include "common/String.h"
+
+class Simulation;
+
+// Binary save format for the full simulation state: particles, walls, air, gravity, portals, wifi,
+// stickmen, signs and the simulation settings. A file is a header followed by chunks, one per array,
+// each compressed on its own with LZ. Chunks that aren't known are skipped. Every chunk of a file that
+// is being loaded is decompressed straight from the mapped file into the simulation.
+namespace SaveFile
+{
+	const uint32_t VERSION = 1;
+
+	void Serialise(const Simulation * sim, std::vector<unsigned char> & data);
+	// On failure the simulation is left cleared
+	bool Deserialise(Simulation * sim, const unsigned char * data, size_t size, ByteString & error);
+
+	bool Save(const Simulation * sim, ByteString path, ByteString & error);
+	bool Load(Simulation * sim, ByteString path, ByteString & error);
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include "Scenes.h"
+#include "Simulation.h"
+#include "common/tpt-rand.h"
+
+namespace
+{
+	// Walls around the edges of the screen, one cell thick
+	void Container(Simulation * sim)
+	{
+		sim->CreateWallBox(0, 0, XRES-1, CELL-1, WL_WALL);
+		sim->CreateWallBox(0, YRES-CELL, XRES-1, YRES-1, WL_WALL);
+		sim->CreateWallBox(0, 0, CELL-1, YRES-1, WL_WALL);
+		sim->CreateWallBox(XRES-CELL, 0, XRES-1, YRES-1, WL_WALL);
+	}
+
+	void Avalanche(Simulation * sim)
+	{
+		// Powder piled up at the top of a staircase of wall steps, it all slides down into the bottom right
+		Container(sim);
+		int steps = 12;
+		for (int i = 0; i < steps; i++)
+		{
+			int x = XRES/4 + i*(XRES*5/8)/steps, y = YRES/3 + i*(YRES/2)/steps;
+			sim->CreateWalls(x + XRES/steps/2, y, XRES/steps/2, 0, WL_WALL);
+		}
+		sim->CreateBox(CELL, CELL, XRES/4 + XRES/steps, YRES/3 - 1, PT_SAND);
+		sim->CreateBox(CELL, CELL, XRES/4 + XRES/steps, YRES/6, PT_DUST);
+		for (int i = 0; i < 40; i++)
+		{
+			int x = RNG::Ref().between(CELL + 4, XRES/4), y = RNG::Ref().between(CELL + 4, YRES/3 - 4);
+			sim->CreateParts(x, y, 3, 3, RNG::Ref().chance(1, 2) ? PT_SALT : PT_BCOL);
+		}
+	}
+
+	void WaterTank(Simulation * sim)
+	{
+		// A tank filled three quarters of the way up, with a few blocks of other liquids that have to settle
+		Container(sim);
+		sim->CreateBox(CELL, YRES/4, XRES-CELL-1, YRES-CELL-1, PT_WATR);
+		for (int i = 0; i < 8; i++)
+		{
+			int x = RNG::Ref().between(CELL, XRES-CELL-33), y = RNG::Ref().between(YRES/4, YRES-CELL-17);
+			sim->CreateBox(x, y, x+32, y+16, i % 2 ? PT_OIL : PT_SLTW);
+		}
+	}
+
+	void GasCloud(Simulation * sim)
+	{
+		// A dense cloud in the middle of an empty room that spreads out until it fills it
+		Container(sim);
+		int cx = XRES/2, cy = YRES/2;
+		for (int y = CELL; y < YRES-CELL; y++)
+			for (int x = CELL; x < XRES-CELL; x++)
+			{
+				int dx = x - cx, dy = y - cy;
+				int distance = dx*dx/4 + dy*dy;
+				if (distance < 90*90 && RNG::Ref().chance(90*90 - distance, 90*90))
+					sim->create_part(-1, x, y, RNG::Ref().chance(1, 4) ? PT_CO2 : PT_GAS);
+			}
+	}
+
+	void Prism(Simulation * sim)
+	{
+		// A column of photon emitters shining through a field of glass triangles
+		Container(sim);
+		sim->CreateBox(CELL, CELL*4, CELL+3, YRES-CELL*4, PT_CLNE);
+		// Drawing an element over CLNE sets its ctype, just like using the brush
+		sim->CreateBox(CELL, CELL*4, CELL+3, YRES-CELL*4, PT_PHOT);
+		for (int i = 0; i < 60; i++)
+		{
+			int x = RNG::Ref().between(XRES/6, XRES-CELL-40), y = RNG::Ref().between(CELL, YRES-CELL-40);
+			int size = RNG::Ref().between(10, 30);
+			for (int row = 0; row < size; row++)
+				sim->CreateLine(x + size - row, y + row, x + size + row, y + row, PT_GLAS);
+		}
+	}
+
+	void Circuit(Simulation * sim)
+	{
+		// A long METL serpentine with batteries along it, sparks run around it the whole time
+		Container(sim);
+		int spacing = 6;
+		int left = CELL*2, right = XRES-CELL*2-1;
+		int rows = 0;
+		for (int y = CELL*2; y < YRES-CELL*2; y += spacing, rows++)
+		{
+			sim->CreateLine(left, y, right, y, PT_METL);
+			if (y + spacing < YRES-CELL*2)
+			{
+				int x = rows % 2 ? left : right;
+				sim->CreateLine(x, y, x, y + spacing, PT_METL);
+			}
+		}
+		for (int i = 0; i < 40; i++)
+		{
+			int row = RNG::Ref().between(0, rows-1);
+			int x = RNG::Ref().between(left + 4, right - 4), y = CELL*2 + row*spacing + 1;
+			sim->create_part(-1, x, y, PT_BTRY);
+		}
+		for (int i = 0; i < 200; i++)
+		{
+			int row = RNG::Ref().between(0, rows-1);
+			sim->create_part(-1, RNG::Ref().between(left, right), CELL*2 + row*spacing, PT_SPRK);
+		}
+	}
+
+	void Life(Simulation * sim)
+	{
+		// Random soup of a few life rules, one per vertical band
+		Container(sim);
+		const int rules[] = { 0, 1, 9, 10 }; // GOL, HLIF, 34, LLIF
+		const int bands = sizeof(rules)/sizeof(rules[0]);
+		for (int y = CELL; y < YRES-CELL; y++)
+			for (int x = CELL; x < XRES-CELL; x++)
+				if (RNG::Ref().chance(3, 10))
+					sim->create_part(-1, x, y, PT_LIFE, rules[(x - CELL) * bands / (XRES - 2*CELL)]);
+	}
+
+	void Lava(Simulation * sim)
+	{
+		// A pool of lava under a stone crust with water on top, lots of heat transfer and state changes
+		Container(sim);
+		sim->CreateBox(CELL, YRES*2/3, XRES-CELL-1, YRES-CELL-1, PT_LAVA);
+		sim->CreateBox(CELL, YRES/2, XRES-CELL-1, YRES*2/3 - 1, PT_STNE);
+		sim->CreateBox(CELL, YRES/4, XRES-CELL-1, YRES/2 - 1, PT_WATR);
+		for (int i = 0; i < 20; i++)
+		{
+			int x = RNG::Ref().between(CELL*2, XRES-CELL*2);
+			sim->CreateLine(x, YRES/2, x, YRES*2/3, PT_LAVA);
+		}
+	}
+
+	void FullPack(Simulation * sim)
+	{
+		// Every pixel inside the container filled with random powders and liquids in 8x8 blocks,
+		// very close to NPART particles
+		Container(sim);
+		const int types[] = { PT_SAND, PT_DUST, PT_WATR, PT_SALT, PT_OIL, PT_STNE, PT_BCOL, PT_SAWD };
+		const int typeCount = sizeof(types)/sizeof(types[0]);
+		for (int y = CELL; y < YRES-CELL; y += 8)
+			for (int x = CELL; x < XRES-CELL; x += 8)
+				sim->CreateBox(x, y, std::min(x+7, XRES-CELL-1), std::min(y+7, YRES-CELL-1), types[RNG::Ref().between(0, typeCount-1)]);
+	}
+
+	void Reactor(Simulation * sim)
+	{
+		// Rods of PLUT in DEUT with a few neutrons, the chain reaction grows until it fills the container
+		Container(sim);
+		sim->CreateBox(XRES/4, YRES/4, XRES*3/4, YRES*3/4, PT_DEUT);
+		for (int x = XRES/4 + 8; x < XRES*3/4 - 8; x += 24)
+			sim->CreateBox(x, YRES/4 + 8, x+5, YRES*3/4 - 8, PT_PLUT);
+		for (int i = 0; i < 50; i++)
+			sim->create_part(-1, RNG::Ref().between(XRES/4, XRES*3/4), RNG::Ref().between(YRES/4, YRES*3/4), PT_NEUT);
+	}
+
+	struct Scene
+	{
+		const char * name;
+		const char * description;
+		void (*build)(Simulation * sim);
+	};
+
+	const Scene scenes[] = {
+		{ "avalanche", "Powder sliding down a staircase of walls", Avalanche },
+		{ "water-tank", "A deep tank of water with blocks of other liquids", WaterTank },
+		{ "gas-cloud", "A gas cloud diffusing through an empty room", GasCloud },
+		{ "prism", "Photon emitters shining through a field of glass", Prism },
+		{ "circuit", "A large METL serpentine with batteries and sparks", Circuit },
+		{ "life", "Random soup of several life rules", Life },
+		{ "lava", "Lava under stone and water, a heat transfer stress test", Lava },
+		{ "full-pack", "Powders and liquids filling almost every pixel", FullPack },
+		{ "reactor", "PLUT rods in DEUT with neutrons", Reactor },
+	};
+	const int sceneCount = sizeof(scenes)/sizeof(scenes[0]);
+
+	const Scene * Find(ByteString name)
+	{
+		for (int i = 0; i < sceneCount; i++)
+			if (name == scenes[i].name)
+				return &scenes[i];
+		return NULL;
+	}
+}
+
+namespace Scenes
+{
+	std::vector<ByteString> Names()
+	{
+		std::vector<ByteString> names;
+		for (int i = 0; i < sceneCount; i++)
+			names.push_back(scenes[i].name);
+		return names;
+	}
+
+	ByteString Description(ByteString name)
+	{
+		const Scene * scene = Find(name);
+		return scene ? scene->description : "";
+	}
+
+	bool Build(Simulation * sim, ByteString name, unsigned int seed)
+	{
+		const Scene * scene = Find(name);
+		if (!scene)
+			return false;
+		sim->clear_sim();
+		RNG::Ref().seed(seed);
+		scene->build(sim);
+		return true;
+	}
+}
@@ -0,0 +1,21 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <vector>
+#include "common/String.h"
+
+class Simulation;
+
+// Procedurally built stress scenes. A scene is only built from its name and a seed, so the benchmarks
+// and regression tools can all run on exactly the same inputs without shipping any saves.
+namespace Scenes
+{
+	std::vector<ByteString> Names();
+	ByteString Description(ByteString name);
+
+	// Clears the simulation, seeds the random number generator and builds the scene, returns false if
+	// there is no scene called name
+	bool Build(Simulation * sim, ByteString name, unsigned int seed);
+}
+
+#endif
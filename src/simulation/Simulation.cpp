@@ -12,6 +12,7 @@
 #include "Elements.h"
 #include "elements/Element.h"
 #include "Gravity.h"
+#include "Replay.h"
 #include "Sample.h"
 #include "Simulation.h"
 #include "Snapshot.h"
@@ -21,6 +22,8 @@
 #include "common/tpt-compat.h"
 #include "common/tpt-minmax.h"
 #include "common/tpt-rand.h"
+#include "common/tpt-trace.h"
+#include "common/WorkerPool.h"
 #include "gui/game/Brush.h"
 
 #ifdef LUACONSOLE
@@ -32,34 +35,42 @@
 Snapshot * Simulation::CreateSnapshot()
 {
 	Snapshot * snap = new Snapshot();
-	snap->AirPressure.insert(snap->AirPressure.begin(), &pv[0][0], &pv[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->AirVelocityX.insert(snap->AirVelocityX.begin(), &vx[0][0], &vx[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->AirVelocityY.insert(snap->AirVelocityY.begin(), &vy[0][0], &vy[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->AmbientHeat.insert(snap->AmbientHeat.begin(), &hv[0][0], &hv[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->Particles.insert(snap->Particles.begin(), parts, parts+parts_lastActiveIndex+1);
-	snap->PortalParticles.insert(snap->PortalParticles.begin(), &portalp[0][0][0], &portalp[CHANNELS-1][8-1][80-1]);
-	snap->WirelessData.insert(snap->WirelessData.begin(), &wireless[0][0], &wireless[CHANNELS-1][2-1]);
-	snap->GravVelocityX.insert(snap->GravVelocityX.begin(), gravx, gravx+((XRES/CELL)*(YRES/CELL)));
-	snap->GravVelocityY.insert(snap->GravVelocityY.begin(), gravy, gravy+((XRES/CELL)*(YRES/CELL)));
-	snap->GravValue.insert(snap->GravValue.begin(), gravp, gravp+((XRES/CELL)*(YRES/CELL)));
-	snap->GravMap.insert(snap->GravMap.begin(), gravmap, gravmap+((XRES/CELL)*(YRES/CELL)));
-	snap->BlockMap.insert(snap->BlockMap.begin(), &bmap[0][0], &bmap[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->ElecMap.insert(snap->ElecMap.begin(), &emap[0][0], &emap[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->FanVelocityX.insert(snap->FanVelocityX.begin(), &fvx[0][0], &fvx[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->FanVelocityY.insert(snap->FanVelocityY.begin(), &fvy[0][0], &fvy[0][0]+((XRES/CELL)*(YRES/CELL)));
-	snap->stickmen.push_back(player2);
-	snap->stickmen.push_back(player);
-	snap->stickmen.insert(snap->stickmen.begin(), &fighters[0], &fighters[MAX_FIGHTERS]);
-	snap->signs = signs;
+	CreateSnapshot(*snap);
 	return snap;
 }
 
+void Simulation::CreateSnapshot(Snapshot & snap)
+{
+	TRACE_ZONE("CreateSnapshot");
+	snap.AirPressure.assign(&pv[0][0], &pv[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.AirVelocityX.assign(&vx[0][0], &vx[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.AirVelocityY.assign(&vy[0][0], &vy[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.AmbientHeat.assign(&hv[0][0], &hv[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.Particles.assign(parts, parts+parts_lastActiveIndex+1);
+	snap.PortalParticles.assign(&portalp[0][0][0], &portalp[CHANNELS-1][8-1][80-1]);
+	snap.WirelessData.assign(&wireless[0][0], &wireless[CHANNELS-1][2-1]);
+	snap.GravVelocityX.assign(gravx, gravx+((XRES/CELL)*(YRES/CELL)));
+	snap.GravVelocityY.assign(gravy, gravy+((XRES/CELL)*(YRES/CELL)));
+	snap.GravValue.assign(gravp, gravp+((XRES/CELL)*(YRES/CELL)));
+	snap.GravMap.assign(gravmap, gravmap+((XRES/CELL)*(YRES/CELL)));
+	snap.BlockMap.assign(&bmap[0][0], &bmap[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.ElecMap.assign(&emap[0][0], &emap[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.FanVelocityX.assign(&fvx[0][0], &fvx[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.FanVelocityY.assign(&fvy[0][0], &fvy[0][0]+((XRES/CELL)*(YRES/CELL)));
+	snap.stickmen.assign(&fighters[0], &fighters[MAX_FIGHTERS]);
+	snap.stickmen.push_back(player2);
+	snap.stickmen.push_back(player);
+	snap.signs = signs;
+}
+
 void Simulation::Restore(const Snapshot & snap)
 {
+	Changed();
 	parts_lastActiveIndex = NPART-1;
 	elementRecount = true;
 	force_stacking_check = true;
 
+	air->Changed();
 	std::copy(snap.AirPressure.begin(), snap.AirPressure.end(), &pv[0][0]);
 	std::copy(snap.AirVelocityX.begin(), snap.AirVelocityX.end(), &vx[0][0]);
 	std::copy(snap.AirVelocityY.begin(), snap.AirVelocityY.end(), &vy[0][0]);
@@ -91,6 +102,7 @@ void Simulation::Restore(const Snapshot & snap)
 
 void Simulation::clear_area(int area_x, int area_y, int area_w, int area_h)
 {
+	Changed();
 	float fx = area_x-.5f, fy = area_y-.5f;
 	for (int i = 0; i <= parts_lastActiveIndex; i++)
 	{
@@ -495,6 +507,7 @@ void Simulation::SetEdgeMode(int newEdgeMode)
 
 void Simulation::ApplyDecoration(int x, int y, int colR_, int colG_, int colB_, int colA_, int mode)
 {
+	Changed();
 	int rp;
 	float tr, tg, tb, ta, colR = colR_, colG = colG_, colB = colB_, colA = colA_;
 	float strength = 0.01f;
@@ -787,6 +800,7 @@ void Simulation::ApplyDecorationFill(Renderer *ren, int x, int y, int colR, int
 
 int Simulation::Tool(int x, int y, int tool, int brushX, int brushY, float strength)
 {
+	Changed();
 	if(tools[tool])
 	{
 		Particle * cpart = NULL;
@@ -795,6 +809,8 @@ int Simulation::Tool(int x, int y, int tool, int brushX, int brushY, float stren
 			cpart = &(parts[ID(r)]);
 		else if ((r = photons[y][x]))
 			cpart = &(parts[ID(r)]);
+		// Some tools push the air around, which has to be shown even while paused
+		air->Changed();
 		return tools[tool]->Perform(this, cpart, x, y, brushX, brushY, strength);
 	}
 	return 0;
@@ -889,8 +905,27 @@ void Simulation::ToolBox(int x1, int y1, int x2, int y2, int tool, float strengt
 			Tool(i, j, tool, brushX, brushY, strength);
 }
 
+void Simulation::ApplyWind(int x, int y, float windX, float windY, Brush * cBrush)
+{
+	int radiusX = cBrush->GetRadius().X, radiusY = cBrush->GetRadius().Y, sizeX = cBrush->GetSize().X, sizeY = cBrush->GetSize().Y;
+	unsigned char *bitmap = cBrush->GetBitmap();
+	air->Changed();
+	for(int j = 0; j < sizeY; j++)
+	{
+		for(int i = 0; i < sizeX; i++)
+		{
+			if(bitmap[(j*sizeX)+i] && (x+(i-radiusX) >= 0 && y+(j-radiusY) >= 0 && x+(i-radiusX) < XRES && y+(j-radiusY) < YRES))
+			{
+				vx[(y+(j-radiusY))/CELL][(x+(i-radiusX))/CELL] += windX;
+				vy[(y+(j-radiusY))/CELL][(x+(i-radiusX))/CELL] += windY;
+			}
+		}
+	}
+}
+
 int Simulation::CreateWalls(int x, int y, int rx, int ry, int wall, Brush * cBrush)
 {
+	Changed();
 	if(cBrush)
 	{
 		rx = cBrush->GetRadius().X;
@@ -1004,6 +1039,7 @@ void Simulation::CreateWallLine(int x1, int y1, int x2, int y2, int rx, int ry,
 
 void Simulation::CreateWallBox(int x1, int y1, int x2, int y2, int wall)
 {
+	Changed();
 	int i, j;
 	if (x1>x2)
 	{
@@ -1024,6 +1060,7 @@ void Simulation::CreateWallBox(int x1, int y1, int x2, int y2, int wall)
 
 int Simulation::FloodWalls(int x, int y, int wall, int bm)
 {
+	Changed();
 	int x1, x2, dy = CELL;
 	if (bm==-1)
 	{
@@ -1079,8 +1116,22 @@ int Simulation::FloodWalls(int x, int y, int wall, int bm)
 	return 1;
 }
 
+void Simulation::SetFanVelocity(int x, int y, float newFanVelX, float newFanVelY)
+{
+	FloodWalls(x, y, WL_FLOODHELPER, WL_FAN);
+	for (int j = 0; j < YRES/CELL; j++)
+		for (int i = 0; i < XRES/CELL; i++)
+			if (bmap[j][i] == WL_FLOODHELPER)
+			{
+				fvx[j][i] = newFanVelX;
+				fvy[j][i] = newFanVelY;
+				bmap[j][i] = WL_FAN;
+			}
+}
+
 int Simulation::CreateParts(int positionX, int positionY, int c, Brush * cBrush, int flags)
 {
+	Changed();
 	if (flags == -1)
 		flags = replaceModeFlags;
 	if (cBrush)
@@ -1124,6 +1175,7 @@ int Simulation::CreateParts(int positionX, int positionY, int c, Brush * cBrush,
 
 int Simulation::CreateParts(int x, int y, int rx, int ry, int c, int flags)
 {
+	Changed();
 	bool created = false;
 
 	if (flags == -1)
@@ -1320,6 +1372,7 @@ void Simulation::CreateBox(int x1, int y1, int x2, int y2, int c, int flags)
 
 int Simulation::FloodParts(int x, int y, int fullc, int cm, int flags)
 {
+	Changed();
 	int c = TYP(fullc);
 	int x1, x2, dy = (c<PT_NUM)?1:CELL;
 	int coord_stack_limit = XRES*YRES;
@@ -1665,6 +1718,7 @@ void Simulation::create_arc(int sx, int sy, int dx, int dy, int midpoints, int v
 
 void Simulation::clear_sim(void)
 {
+	Changed();
 	debug_currentParticle = 0;
 	emp_decor = 0;
 	emp_trigger_count = 0;
@@ -3196,6 +3250,7 @@ void Simulation::delete_part(int x, int y)//calls kill_part with the particle lo
 
 void Simulation::MarkPartsRegions(int start, int end)
 {
+	TRACE_ZONE("MarkPartsRegions");
 	int i, x;
 
 	//Clear strip lists
@@ -3216,7 +3271,7 @@ void Simulation::MarkPartsRegions(int start, int end)
 
 }
 
-void Simulation::UpdateParticles(int start, int end, std::chrono::nanoseconds& total, int region)
+void Simulation::UpdateParticles(int start, int end, int region)
 {
 	int i, j, x, y, t, nx, ny, r, surround_space, s, rt, nt;
 	float mv, dx, dy, nrx, nry, dp, ctemph, ctempl, gravtot;
@@ -3230,6 +3285,8 @@ void Simulation::UpdateParticles(int start, int end, std::chrono::nanoseconds& t
 	int surround_hconduct[8];
 	float pGravX, pGravY, pGravD;
 	bool transitionOccurred, neighbourBlocked;
+	// Regions 2n and 2n+1 are always run by worker n
+	int profilerSlot = region/2;
 
 	//the main particle loop function, goes over all particles.
 	for(auto itv = parts_by_region[region].begin(); itv != parts_by_region[region].end(); ++itv)
@@ -3734,13 +3791,11 @@ void Simulation::UpdateParticles(int start, int end, std::chrono::nanoseconds& t
 			//call the particle update function, if there is one
 			if (elements[t].Update)
 			{
-				auto start_time = std::chrono::high_resolution_clock::now();
+				ElementProfiler::Sample updateSample(profiler, profilerSlot, t, ElementProfiler::Update);
 				if ((*(elements[t].Update))(this, i, x, y, surround_space, nt, parts, pmap))
-				{
-					total += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start_time);
 					continue;
-				}
-				else if (t==PT_WARP)
+				updateSample.Stop();
+				if (t==PT_WARP)
 				{
 					// Warp does some movement in its update func, update variables to avoid incorrect data in pmap
 					x = (int)(parts[i].x+0.5f);
@@ -3759,6 +3814,8 @@ killed:
 			if (!parts[i].vx&&!parts[i].vy)//if its not moving, skip to next particle, movement code it next
 				continue;
 
+			ElementProfiler::Sample moveSample(profiler, profilerSlot, parts[i].type, ElementProfiler::Movement);
+
 			mv = fmaxf(fabsf(parts[i].vx), fabsf(parts[i].vy));
 			if (mv < ISTP)
 			{
@@ -4545,15 +4602,23 @@ void Simulation::CheckStacking()
 //updates pmap, gol, and some other simulation stuff (but not particles)
 void Simulation::BeforeSim()
 {
+	TRACE_ZONE("BeforeSim");
 	if (!sys_pause||framerender)
 	{
-		air->update_air();
+		{
+			TRACE_ZONE("update_air");
+			air->update_air();
+		}
 
 		if(aheat_enable)
+		{
+			TRACE_ZONE("update_airh");
 			air->update_airh();
+		}
 
 		if(grav->ngrav_enable)
 		{
+			TRACE_ZONE("gravity_update_async");
 			grav->gravity_update_async();
 
 			//Get updated buffer pointers for gravity
@@ -4564,6 +4629,7 @@ void Simulation::BeforeSim()
 		}
 		if(gravWallChanged)
 		{
+			TRACE_ZONE("gravity_mask");
 			grav->gravity_mask();
 			gravWallChanged = false;
 		}
@@ -4584,11 +4650,15 @@ void Simulation::BeforeSim()
 	sandcolour_frame = (sandcolour_frame+1)%360;
 
 	if (debug_currentParticle == 0)
+	{
+		TRACE_ZONE("RecalcFreeParticles");
 		RecalcFreeParticles(true);
+	}
 
 	if (!sys_pause || framerender)
 	{
 		// decrease wall conduction, make walls block air and ambient heat
+		TRACE_ZONE("BeforeSim passes");
 		int x, y;
 		for (y = 0; y < YRES/CELL; y++)
 		{
@@ -4604,12 +4674,14 @@ void Simulation::BeforeSim()
 		// check for stacking and create BHOL if found
 		if (force_stacking_check || RNG::Ref().chance(1, 10))
 		{
+			TRACE_ZONE("CheckStacking");
 			CheckStacking();
 		}
 
 		// LOVE and LOLZ element handling
 		if (elementCount[PT_LOVE] > 0 || elementCount[PT_LOLZ] > 0)
 		{
+			TRACE_ZONE("LOVE/LOLZ");
 			int nx, nnx, ny, nny, r, rt;
 			for (ny=0; ny<YRES-4; ny++)
 			{
@@ -4680,6 +4752,7 @@ void Simulation::BeforeSim()
 		// make WIRE work
 		if(elementCount[PT_WIRE] > 0)
 		{
+			TRACE_ZONE("WIRE");
 			for (int nx = 0; nx < XRES; nx++)
 			{
 				for (int ny = 0; ny < YRES; ny++)
@@ -4711,6 +4784,7 @@ void Simulation::BeforeSim()
 		// GSPEED is frames per generation
 		if (elementCount[PT_LIFE]>0 && ++CGOL>=GSPEED)
 		{
+			TRACE_ZONE("SimulateGoL");
 			SimulateGoL();
 		}
 
@@ -4731,6 +4805,8 @@ void Simulation::BeforeSim()
 
 void Simulation::AfterSim()
 {
+	TRACE_ZONE("AfterSim");
+	profiler.CountTick();
 	if (emp_trigger_count)
 	{
 		Element_EMP::Trigger(this, emp_trigger_count);
@@ -4738,6 +4814,84 @@ void Simulation::AfterSim()
 	}
 }
 
+void Simulation::TickSerial()
+{
+	BeforeSim();
+	if (!sys_pause || framerender)
+	{
+		Changed();
+		MarkPartsRegions(0, NPART);
+		// Same order as the worker threads, all even regions first and then all odd ones
+		for (int region = 0; region < 2*THRDS; region += 2)
+			UpdateParticles(0, NPART, region);
+		for (int region = 1; region < 2*THRDS; region += 2)
+			UpdateParticles(0, NPART, region);
+		AfterSim();
+	}
+}
+
+void Simulation::Tick(WorkerPool * workers)
+{
+	if (recorder)
+	{
+		// Replays need the same result every time, so no worker threads
+		recorder->BeforeTick();
+		TickSerial();
+		recorder->AfterTick();
+		return;
+	}
+	if (!workers)
+	{
+		TickSerial();
+		return;
+	}
+
+	BeforeSim();
+	if (!sys_pause || framerender)
+	{
+		Changed();
+		//Mark regions for each part
+		MarkPartsRegions(0, NPART);
+
+		{
+			TRACE_ZONE("Even regions");
+			workers->Run([this](int id) {
+				TRACE_ZONE("UpdateParticles");
+				UpdateParticles(0, NPART, id*2);
+			});
+		}
+
+		{
+			TRACE_ZONE("Odd regions");
+			workers->Run([this](int id) {
+				TRACE_ZONE("UpdateParticles");
+				UpdateParticles(0, NPART, 1 + id*2);
+			});
+		}
+
+		AfterSim();
+	}
+}
+
+int Simulation::FastForward(int ticks, WorkerPool * workers, const std::function<bool(int)> & keepGoing)
+{
+	TRACE_ZONE("FastForward");
+	if (recorder || replayPlayer)
+		return 0;
+	int wasPaused = sys_pause;
+	sys_pause = 0;
+	int done = 0;
+	while (done < ticks)
+	{
+		Tick(workers);
+		done++;
+		if (keepGoing && !keepGoing(done))
+			break;
+	}
+	sys_pause = wasPaused;
+	return done;
+}
+
 Simulation::~Simulation()
 {
 	delete grav;
@@ -4750,6 +4904,8 @@ Simulation::Simulation():
 	replaceModeSelected(0),
 	replaceModeFlags(0),
 	debug_currentParticle(0),
+	recorder(NULL),
+	replayPlayer(NULL),
 	ISWIRE(0),
 	force_stacking_check(false),
 	emp_decor(0),
@@ -4776,6 +4932,7 @@ Simulation::Simulation():
 	memcpy(portal_ry, tportal_ry, sizeof(tportal_ry));
 
 	currentTick = 0;
+	revision = 0;
 	std::fill(elementCount, elementCount+PT_NUM, 0);
 	elementRecount = true;
 
@@ -4,12 +4,14 @@
 #include <cstddef>
 #include <vector>
 #include <chrono>
+#include <functional>
 
 #include "Config.h"
 #include "Elements.h"
 #include "SimulationData.h"
 #include "Sign.h"
 #include "Particle.h"
+#include "ElementProfiler.h"
 #include "Stickman.h"
 #include "WallType.h"
 #include "GOLMenu.h"
@@ -29,6 +31,9 @@ class Simulation;
 class Renderer;
 class Gravity;
 class Air;
+class ReplayRecorder;
+class ReplayPlayer;
+class WorkerPool;
 
 class Simulation
 {
@@ -49,6 +54,10 @@ public:
 	std::vector<menu_section> msections;
 
 	int currentTick;
+	//Goes up whenever the particles or walls may have changed, so that anything made from them can tell when to
+	//redo it. Every tick that simulates counts itself, edits made between ticks call Changed.
+	unsigned int revision;
+	void Changed() { revision++; }
 	int replaceModeSelected;
 	int replaceModeFlags;
 
@@ -59,6 +68,11 @@ public:
 	int NUM_PARTS;
 	bool elementRecount;
 	int elementCount[PT_NUM];
+	ElementProfiler profiler;
+	// Edits coming from the game are reported here while a replay is being recorded, NULL otherwise
+	ReplayRecorder * recorder;
+	// The replay being played back into this simulation, NULL otherwise
+	ReplayPlayer * replayPlayer;
 	int ISWIRE;
 	bool force_stacking_check;
 	int emp_decor;
@@ -118,6 +132,8 @@ public:
 	SimulationSample GetSample(int x, int y);
 
 	Snapshot * CreateSnapshot();
+	// Overwrites snap, reusing the memory it already has
+	void CreateSnapshot(Snapshot & snap);
 	void Restore(const Snapshot & snap);
 
 	int is_blocking(int t, int x, int y);
@@ -153,12 +169,21 @@ public:
 	int parts_avg(int ci, int ni, int t);
 	void create_arc(int sx, int sy, int dx, int dy, int midpoints, int variance, int type, int flags);
 	void MarkPartsRegions(int start, int end);
-	__attribute__((nothrow)) void UpdateParticles(int start, int end, std::chrono::nanoseconds& total, int region);
+	__attribute__((nothrow)) void UpdateParticles(int start, int end, int region);
 	void SimulateGoL();
 	void RecalcFreeParticles(bool do_life_dec);
 	void CheckStacking();
 	void BeforeSim();
 	void AfterSim();
+	// A whole tick on the calling thread, regions in a fixed order so that the result only depends on the state and the random seed
+	void TickSerial();
+	// A whole tick with the regions shared out between workers, or TickSerial if there are none or a replay is
+	// being recorded, in which case the recorder is told about it
+	void Tick(WorkerPool * workers);
+	// Runs ticks ticks back to back as fast as they go, paused or not, asking keepGoing after every one of them
+	// with how many have been run so far whether to go on. Returns how many were run, which is none while a
+	// replay is being recorded or played back, as those have to get exactly the ticks the user asked for.
+	int FastForward(int ticks, WorkerPool * workers, const std::function<bool(int)> & keepGoing = std::function<bool(int)>());
 	void rotate_area(int area_x, int area_y, int area_w, int area_h, int invert);
 	void clear_area(int area_x, int area_y, int area_w, int area_h);
 
@@ -177,12 +202,16 @@ public:
 	int ToolBrush(int x, int y, int tool, Brush * cBrush, float strength = 1.0f);
 	void ToolLine(int x1, int y1, int x2, int y2, int tool, Brush * cBrush, float strength = 1.0f);
 	void ToolBox(int x1, int y1, int x2, int y2, int tool, float strength = 1.0f);
+	// Adds (windX, windY) to the air velocity under every point of the brush
+	void ApplyWind(int x, int y, float windX, float windY, Brush * cBrush);
 
 	//Drawing Walls
 	int CreateWalls(int x, int y, int rx, int ry, int wall, Brush * cBrush = NULL);
 	void CreateWallLine(int x1, int y1, int x2, int y2, int rx, int ry, int wall, Brush * cBrush = NULL);
 	void CreateWallBox(int x1, int y1, int x2, int y2, int wall);
 	int FloodWalls(int x, int y, int wall, int bm);
+	// Sets the velocity of every fan connected to the one at x, y
+	void SetFanVelocity(int x, int y, float newFanVelX, float newFanVelY);
 
 	//Drawing Particles
 	int CreateParts(int positionX, int positionY, int c, Brush * cBrush, int flags = -1);
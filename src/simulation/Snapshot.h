@@ -3,6 +3,8 @@
 #include <vector>
 
 #include "Particle.h"
+#include "Sign.h"
+#include "Stickman.h"
 
 class Snapshot
 {
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include "SnapshotDelta.h"
+#include "Snapshot.h"
+#include "common/tpt-lz.h"
+#include "common/tpt-trace.h"
+
+namespace
+{
+	// Big enough that the block indices are noise, small enough that a brush stroke only touches a few of them
+	const size_t BLOCK_SIZE = 1024;
+
+	// Every array of a snapshot except signs, in the order they are stored in a delta
+	template<class Op, class A, class B>
+	void Arrays(Op & op, A & a, B & b)
+	{
+		op(a.AirPressure, b.AirPressure);
+		op(a.AirVelocityX, b.AirVelocityX);
+		op(a.AirVelocityY, b.AirVelocityY);
+		op(a.AmbientHeat, b.AmbientHeat);
+		op(a.Particles, b.Particles);
+		op(a.GravVelocityX, b.GravVelocityX);
+		op(a.GravVelocityY, b.GravVelocityY);
+		op(a.GravValue, b.GravValue);
+		op(a.GravMap, b.GravMap);
+		op(a.BlockMap, b.BlockMap);
+		op(a.ElecMap, b.ElecMap);
+		op(a.FanVelocityX, b.FanVelocityX);
+		op(a.FanVelocityY, b.FanVelocityY);
+		op(a.PortalParticles, b.PortalParticles);
+		op(a.WirelessData, b.WirelessData);
+		op(a.stickmen, b.stickmen);
+	}
+
+	void AppendInt(std::vector<unsigned char> & data, uint32_t value)
+	{
+		unsigned char bytes[4];
+		memcpy(bytes, &value, 4);
+		data.insert(data.end(), bytes, bytes + 4);
+	}
+
+	// For each array: old size, new size, the changed blocks as (index, old XOR new) and then the
+	// tail of whichever array is longer
+	class Differ
+	{
+	public:
+		std::vector<unsigned char> raw;
+
+		template<class T>
+		void operator()(const std::vector<T> & oldArray, const std::vector<T> & newArray)
+		{
+			const unsigned char * oldBytes = (const unsigned char *)oldArray.data();
+			const unsigned char * newBytes = (const unsigned char *)newArray.data();
+			size_t oldSize = oldArray.size() * sizeof(T), newSize = newArray.size() * sizeof(T);
+			size_t common = std::min(oldSize, newSize);
+			AppendInt(raw, oldSize);
+			AppendInt(raw, newSize);
+			size_t countPosition = raw.size();
+			AppendInt(raw, 0);
+			uint32_t changed = 0;
+			for (size_t start = 0; start < common; start += BLOCK_SIZE)
+			{
+				size_t length = std::min(BLOCK_SIZE, common - start);
+				if (!memcmp(oldBytes + start, newBytes + start, length))
+					continue;
+				AppendInt(raw, start / BLOCK_SIZE);
+				size_t position = raw.size();
+				raw.resize(position + length);
+				for (size_t i = 0; i < length; i++)
+					raw[position + i] = oldBytes[start + i] ^ newBytes[start + i];
+				changed++;
+			}
+			memcpy(&raw[countPosition], &changed, 4);
+			if (oldSize > common)
+				raw.insert(raw.end(), oldBytes + common, oldBytes + oldSize);
+			if (newSize > common)
+				raw.insert(raw.end(), newBytes + common, newBytes + newSize);
+		}
+	};
+
+	class Applier
+	{
+		const unsigned char * position;
+		bool forward;
+
+		uint32_t ReadInt()
+		{
+			uint32_t value;
+			memcpy(&value, position, 4);
+			position += 4;
+			return value;
+		}
+
+	public:
+		Applier(const unsigned char * raw, bool forward_):
+			position(raw),
+			forward(forward_)
+		{
+		}
+
+		template<class T>
+		void operator()(std::vector<T> & target, const std::vector<T> & source)
+		{
+			size_t oldSize = ReadInt(), newSize = ReadInt();
+			uint32_t changed = ReadInt();
+			size_t common = std::min(oldSize, newSize);
+			target.resize((forward ? newSize : oldSize) / sizeof(T));
+			unsigned char * targetBytes = (unsigned char *)target.data();
+			if (common)
+				memcpy(targetBytes, source.data(), common);
+			for (uint32_t i = 0; i < changed; i++)
+			{
+				size_t start = ReadInt() * BLOCK_SIZE;
+				size_t length = std::min(BLOCK_SIZE, common - start);
+				for (size_t j = 0; j < length; j++)
+					targetBytes[start + j] ^= position[j];
+				position += length;
+			}
+			if (oldSize > common)
+			{
+				if (!forward)
+					memcpy(targetBytes + common, position, oldSize - common);
+				position += oldSize - common;
+			}
+			if (newSize > common)
+			{
+				if (forward)
+					memcpy(targetBytes + common, position, newSize - common);
+				position += newSize - common;
+			}
+		}
+	};
+}
+
+SnapshotDelta * SnapshotDelta::FromSnapshots(const Snapshot & oldSnap, const Snapshot & newSnap)
+{
+	TRACE_ZONE("SnapshotDelta::FromSnapshots");
+	Differ differ;
+	Arrays(differ, oldSnap, newSnap);
+
+	SnapshotDelta * delta = new SnapshotDelta();
+	delta->rawSize = differ.raw.size();
+	delta->data.resize(LZ::Bound(delta->rawSize));
+	delta->data.resize(LZ::Compress(differ.raw.data(), delta->rawSize, delta->data.data(), delta->data.size()));
+	delta->data.shrink_to_fit();
+	delta->oldSigns = oldSnap.signs;
+	delta->newSigns = newSnap.signs;
+	return delta;
+}
+
+Snapshot * SnapshotDelta::Apply(const Snapshot & source, bool forward) const
+{
+	TRACE_ZONE("SnapshotDelta::Apply");
+	std::vector<unsigned char> raw(rawSize);
+	LZ::Decompress(data.data(), data.size(), raw.data(), rawSize);
+	Snapshot * snap = new Snapshot();
+	Applier applier(raw.data(), forward);
+	Arrays(applier, *snap, source);
+	snap->signs = forward ? newSigns : oldSigns;
+	return snap;
+}
+
+Snapshot * SnapshotDelta::Forward(const Snapshot & oldSnap) const
+{
+	return Apply(oldSnap, true);
+}
+
+Snapshot * SnapshotDelta::Restore(const Snapshot & newSnap) const
+{
+	return Apply(newSnap, false);
+}
+
+size_t SnapshotDelta::Size() const
+{
+	size_t size = sizeof(*this) + data.capacity();
+	for (size_t i = 0; i < oldSigns.size(); i++)
+		size += sizeof(sign) + oldSigns[i].text.size() * sizeof(String::value_type);
+	for (size_t i = 0; i < newSigns.size(); i++)
+		size += sizeof(sign) + newSigns[i].text.size() * sizeof(String::value_type);
+	return size;
+}
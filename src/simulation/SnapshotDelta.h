@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Sign.h"
+
+class Snapshot;
+
+// Difference between two snapshots, used to keep undo history small. Every array of the snapshots is split
+// into blocks and only the blocks that changed are kept, as the XOR of their old and new contents, so the
+// same delta works in both directions. The kept blocks are then compressed together with LZ.
+class SnapshotDelta
+{
+	std::vector<unsigned char> data;
+	size_t rawSize;
+	std::vector<sign> oldSigns;
+	std::vector<sign> newSigns;
+
+	Snapshot * Apply(const Snapshot & source, bool forward) const;
+
+public:
+	static SnapshotDelta * FromSnapshots(const Snapshot & oldSnap, const Snapshot & newSnap);
+
+	// Rebuilds newSnap from oldSnap
+	Snapshot * Forward(const Snapshot & oldSnap) const;
+	// Rebuilds oldSnap from newSnap
+	Snapshot * Restore(const Snapshot & newSnap) const;
+
+	// Approximate memory use in bytes
+	size_t Size() const;
+};
@@ -0,0 +1,90 @@
+#include <cstring>
+#include "StateHash.h"
+#include "Air.h"
+#include "Gravity.h"
+#include "Simulation.h"
+
+namespace
+{
+	// FNV-1a, a word at a time
+	class Hasher
+	{
+		uint64_t hash;
+	public:
+		Hasher():
+			hash(UINT64_C(14695981039346656037))
+		{
+		}
+
+		void Word(uint32_t word)
+		{
+			hash = (hash ^ word) * UINT64_C(1099511628211);
+		}
+
+		void Words(const void * data, size_t size)
+		{
+			const unsigned char * bytes = (const unsigned char *)data;
+			for (size_t i = 0; i + 4 <= size; i += 4)
+			{
+				uint32_t word;
+				memcpy(&word, bytes + i, 4);
+				Word(word);
+			}
+			for (size_t i = size & ~(size_t)3; i < size; i++)
+				Word(bytes[i]);
+		}
+
+		uint64_t Result() const
+		{
+			return hash;
+		}
+	};
+
+	void Add(std::vector<StateHash::Section> & sections, ByteString name, const void * data, size_t size)
+	{
+		Hasher hasher;
+		hasher.Words(data, size);
+		StateHash::Section section = { name, hasher.Result() };
+		sections.push_back(section);
+	}
+}
+
+namespace StateHash
+{
+	std::vector<Section> Compute(const Simulation * sim)
+	{
+		std::vector<Section> sections;
+		int count = sim->parts_lastActiveIndex + 1;
+		Add(sections, "parts.count", &count, sizeof(count));
+
+		std::vector<StructProperty> properties = Particle::GetProperties();
+		for (size_t p = 0; p < properties.size(); p++)
+		{
+			// Every particle property is four bytes wide
+			Hasher hasher;
+			for (int i = 0; i < count; i++)
+			{
+				uint32_t value;
+				memcpy(&value, (const char *)&sim->parts[i] + properties[p].Offset, 4);
+				hasher.Word(value);
+			}
+			Section section = { "parts." + properties[p].Name, hasher.Result() };
+			sections.push_back(section);
+		}
+
+		Add(sections, "pmap", sim->pmap, sizeof(sim->pmap));
+		Add(sections, "photons", sim->photons, sizeof(sim->photons));
+		Add(sections, "bmap", sim->bmap, sizeof(sim->bmap));
+		Add(sections, "emap", sim->emap, sizeof(sim->emap));
+		Add(sections, "air.pv", sim->air->pv, sizeof(sim->air->pv));
+		Add(sections, "air.vx", sim->air->vx, sizeof(sim->air->vx));
+		Add(sections, "air.vy", sim->air->vy, sizeof(sim->air->vy));
+		Add(sections, "air.hv", sim->air->hv, sizeof(sim->air->hv));
+		const size_t gravSize = (XRES/CELL)*(YRES/CELL)*sizeof(float);
+		Add(sections, "gravity.gravmap", sim->grav->gravmap, gravSize);
+		Add(sections, "gravity.gravx", sim->grav->gravx, gravSize);
+		Add(sections, "gravity.gravy", sim->grav->gravy, gravSize);
+		Add(sections, "gravity.gravp", sim->grav->gravp, gravSize);
+		return sections;
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef STATEHASH_H
+#define STATEHASH_H
+
+#include <stdint.h>
+#include <vector>
+#include "common/String.h"
+
+class Simulation;
+
+// Fast, non-cryptographic hashes of the whole simulation state, split into sections so that a mismatch
+// can be narrowed down to a map or to a single particle field
+namespace StateHash
+{
+	struct Section
+	{
+		ByteString name;
+		uint64_t hash;
+	};
+
+	// Particle fields are hashed up to parts_lastActiveIndex, one section per field, followed by pmap, photons,
+	// the wall maps, air and gravity. The order of the sections never changes.
+	std::vector<Section> Compute(const Simulation * sim);
+}
+
+#endif
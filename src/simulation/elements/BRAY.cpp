@@ -43,6 +43,7 @@ Element_BRAY::Element_BRAY()
 
 	Update = NULL;
 	Graphics = &Element_BRAY::graphics;
+	GraphicsState = GSTATE_LIFE | GSTATE_CTYPE | GSTATE_TMP;
 }
 
 //#TPT-Directive ElementHeader Element_BRAY static int graphics(GRAPHICS_FUNC_ARGS)
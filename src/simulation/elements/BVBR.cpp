@@ -43,6 +43,7 @@ Element_BVBR::Element_BVBR()
 
 	Update = &Element_VIBR::update;
 	Graphics = &Element_VIBR::graphics;
+	GraphicsState = GSTATE_LIFE | GSTATE_TMP | GSTATE_TMP2;
 }
 
 Element_BVBR::~Element_BVBR() {}
@@ -43,6 +43,7 @@ Element_C5::Element_C5()
 
 	Update = &Element_C5::update;
 	Graphics = &Element_C5::graphics;
+	GraphicsState = GSTATE_CTYPE;
 }
 
 //#TPT-Directive ElementHeader Element_C5 static int update(UPDATE_FUNC_ARGS)
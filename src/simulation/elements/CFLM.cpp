@@ -45,6 +45,7 @@ Element_CFLM::Element_CFLM()
 
 	Update = NULL;
 	Graphics = &Element_CFLM::graphics;
+	GraphicsState = GSTATE_LIFE;
 }
 
 //#TPT-Directive ElementHeader Element_CFLM static int graphics(GRAPHICS_FUNC_ARGS)
@@ -186,7 +186,7 @@ int Element_EXOT::graphics(GRAPHICS_FUNC_ARGS)
 	int c = cpart->tmp2;
 	if (cpart->life < 1001)
 	{
-		if (RNG::Ref().chance(cpart->tmp2 - 1, 1000))
+		if (ren->rng.chance(cpart->tmp2 - 1, 1000))
 		{
 			float frequency = 0.04045;
 			*colr = (sin(frequency*c + 4) * 127 + 150);
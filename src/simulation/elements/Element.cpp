@@ -44,6 +44,7 @@ Element::Element():
 
 	Update(NULL),
 	Graphics(&Element::defaultGraphics),
+	GraphicsState(0),
 	IconGenerator(NULL)
 {
 }
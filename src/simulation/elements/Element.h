@@ -52,6 +52,11 @@ public:
 
 	int (*Update) (UPDATE_FUNC_ARGS);
 	int (*Graphics) (GRAPHICS_FUNC_ARGS);
+	// For a Graphics function that returns 0, the GSTATE_ properties that are all it looks at besides the
+	// element's colour. Particles that match in them are drawn the same, so the renderer can reuse what the
+	// function gave for one of them. 0 if the function depends on anything else, like temperature or randomness,
+	// or if it is so simple that looking up what it gave before would take longer than calling it.
+	unsigned int GraphicsState;
 	VideoBuffer * (*IconGenerator)(int, int, int);
 
 	Element();
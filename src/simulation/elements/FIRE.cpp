@@ -45,6 +45,7 @@ Element_FIRE::Element_FIRE()
 
 	Update = &Element_FIRE::update;
 	Graphics = &Element_FIRE::graphics;
+	GraphicsState = GSTATE_LIFE;
 }
 
 //#TPT-Directive ElementHeader Element_FIRE static int update(UPDATE_FUNC_ARGS)
@@ -100,7 +100,7 @@ int Element_GOLD::update(UPDATE_FUNC_ARGS)
 //#TPT-Directive ElementHeader Element_GOLD static int graphics(GRAPHICS_FUNC_ARGS)
 int Element_GOLD::graphics(GRAPHICS_FUNC_ARGS)
 {
-	int rndstore = RNG::Ref().gen();
+	int rndstore = ren->rng.gen();
 	*colr += (rndstore % 10) - 5;
 	rndstore >>= 4;
 	*colg += (rndstore % 10)- 5;
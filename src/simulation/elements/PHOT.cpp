@@ -43,6 +43,7 @@ Element_PHOT::Element_PHOT()
 
 	Update = &Element_PHOT::update;
 	Graphics = &Element_PHOT::graphics;
+	GraphicsState = GSTATE_CTYPE | GSTATE_FLAGS;
 }
 
 //#TPT-Directive ElementHeader Element_PHOT static int update(UPDATE_FUNC_ARGS)
@@ -43,6 +43,7 @@ Element_PLSM::Element_PLSM()
 
 	Update = &Element_FIRE::update;
 	Graphics = &Element_PLSM::graphics;
+	GraphicsState = GSTATE_LIFE;
 }
 
 //#TPT-Directive ElementHeader Element_PLSM static int graphics(GRAPHICS_FUNC_ARGS)
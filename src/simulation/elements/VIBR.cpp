@@ -43,6 +43,7 @@ Element_VIBR::Element_VIBR()
 
 	Update = &Element_VIBR::update;
 	Graphics = &Element_VIBR::graphics;
+	GraphicsState = GSTATE_LIFE | GSTATE_TMP | GSTATE_TMP2;
 }
 
 //#TPT-Directive ElementHeader Element_VIBR static int update(UPDATE_FUNC_ARGS)